@@ -0,0 +1,195 @@
+//
+//  ApplyBench.cpp
+//  Camellia
+//
+//  Compares the assembled fine stiffness matrix (Epetra_CrsMatrix) with the unassembled ElementMatrixOperator that
+//  matrix-free GMG uses in its place: bytes stored and Apply() throughput, over a sweep of dimension, element count, and
+//  polynomial order for Poisson.  Writes the results as JSON (to stdout, or to the file given by --output).
+//  Sample usage:
+//    mpirun -np 4 camellia_apply_bench --dims=2,3 --elementCounts=4,8 --polyOrders=1,2,4 --condense
+//
+
+#include "BC.h"
+#include "ElementMatrixOperator.h"
+#include "Function.h"
+#include "IP.h"
+#include "MeshFactory.h"
+#include "PoissonFormulation.h"
+#include "RHS.h"
+#include "Solution.h"
+#include "SpatialFilter.h"
+
+#include "Epetra_Time.h"
+#include "Teuchos_CommandLineProcessor.hpp"
+#include "Teuchos_GlobalMPISession.hpp"
+
+#include "BenchRevision.h"
+#include "BenchUtilities.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace Camellia;
+using namespace std;
+using namespace BenchUtilities;
+
+namespace
+{
+// bytes stored by a filled Epetra_CrsMatrix on this rank: values and column indices, plus a row offset per row
+size_t crsMatrixMemoryUsed(const Epetra_CrsMatrix &A)
+{
+  return A.NumMyNonzeros() * (sizeof(double) + sizeof(int)) + (A.NumMyRows() + 1) * sizeof(int);
+}
+
+// seconds per application, maximum over ranks
+double timeApply(const Epetra_Operator &A, const Epetra_MultiVector &X, Epetra_MultiVector &Y, int applications)
+{
+  A.Apply(X, Y); // warm-up; for ElementMatrixOperator, this also allocates the overlapped vectors
+  A.Comm().Barrier();
+  Epetra_Time timer(A.Comm());
+  for (int i=0; i<applications; i++)
+  {
+    A.Apply(X, Y);
+  }
+  double myTime = timer.ElapsedTime() / applications, maxTime;
+  A.Comm().MaxAll(&myTime, &maxTime, 1);
+  return maxTime;
+}
+
+size_t sumOverRanks(const Epetra_Comm &Comm, size_t myValue)
+{
+  double myDouble = myValue, sum;
+  Comm.SumAll(&myDouble, &sum, 1);
+  return (size_t) sum;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  Teuchos::GlobalMPISession mpiSession(&argc, &argv);
+  int rank = Teuchos::GlobalMPISession::getRank();
+  int numRanks = Teuchos::GlobalMPISession::getNProc();
+
+  Teuchos::CommandLineProcessor cmdp(false,true); // false: don't throw exceptions; true: do return errors for unrecognized options
+
+  string dims = "2";
+  string elementCountList = "4,8";
+  string polyOrderList = "1,2,3";
+  int delta_k = -1; // -1: use spaceDim
+  int applications = 50;
+  int numVectors = 1;
+  bool condense = false;
+  string outputFile = "";
+  string label = "";
+
+  cmdp.setOption("dims", &dims, "comma-separated list of spatial dimensions");
+  cmdp.setOption("elementCounts", &elementCountList, "comma-separated list of element counts in each direction");
+  cmdp.setOption("polyOrders", &polyOrderList, "comma-separated list of field polynomial orders");
+  cmdp.setOption("delta_k", &delta_k, "test space polynomial order enrichment (-1 to use the spatial dimension)");
+  cmdp.setOption("applications", &applications, "number of timed applications of each operator");
+  cmdp.setOption("numVectors", &numVectors, "number of vectors in each application");
+  cmdp.setOption("condense", "dontCondense", &condense, "use static condensation (the GMG fine level usually does)");
+  cmdp.setOption("output", &outputFile, "file for the JSON output (default: stdout)");
+  cmdp.setOption("label", &label, "label to include in the output (e.g. a build configuration)");
+
+  if (cmdp.parse(argc,argv) != Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL)
+  {
+#ifdef HAVE_MPI
+    MPI_Finalize();
+#endif
+    return -1;
+  }
+
+  ostringstream json;
+  json << "{\n";
+  json << "  \"benchmark\": \"camellia_apply_bench\",\n";
+  json << "  \"revision\": " << jsonString(CAMELLIA_BENCH_REVISION) << ",\n";
+  json << "  \"label\": " << jsonString(label) << ",\n";
+  json << "  \"numRanks\": " << numRanks << ",\n";
+  json << "  \"condense\": " << (condense ? "true" : "false") << ",\n";
+  json << "  \"numVectors\": " << numVectors << ",\n";
+  json << "  \"cases\": [";
+
+  bool firstCase = true;
+  for (int spaceDim : splitIntList(dims))
+  {
+    for (int elementsPerDimension : splitIntList(elementCountList))
+    {
+      for (int polyOrder : splitIntList(polyOrderList))
+      {
+        int caseDelta_k = (delta_k == -1) ? spaceDim : delta_k;
+        ostringstream caseJSON;
+        caseJSON << "\n    {\"spaceDim\": " << spaceDim << ", \"elementsPerDimension\": " << elementsPerDimension;
+        caseJSON << ", \"polyOrder\": " << polyOrder << ", \"delta_k\": " << caseDelta_k;
+        try
+        {
+          bool useConformingTraces = true;
+          PoissonFormulation form(spaceDim, useConformingTraces);
+          vector<double> dimensions(spaceDim, 1.0);
+          vector<int> elementCounts(spaceDim, elementsPerDimension);
+          MeshPtr mesh = MeshFactory::rectilinearMesh(form.bf(), dimensions, elementCounts, polyOrder + 1, caseDelta_k);
+
+          RHSPtr rhs = RHS::rhs();
+          rhs->addTerm(1.0 * form.q());
+          BCPtr bc = BC::bc();
+          bc->addDirichlet(form.phi_hat(), SpatialFilter::allSpace(), Function::zero());
+
+          SolutionPtr solution = Solution::solution(form.bf(), mesh, bc, rhs, form.bf()->graphNorm());
+          solution->setUseCondensedSolve(condense);
+
+          solution->initializeLHSVector();
+          solution->initializeStiffnessAndLoad();
+          solution->populateStiffnessAndLoad();
+          Teuchos::RCP<Epetra_CrsMatrix> A = solution->getStiffnessMatrix();
+
+          solution->setUseMatrixFreeStiffness(true);
+          solution->initializeStiffnessAndLoad();
+          solution->populateStiffnessAndLoad();
+          ElementMatrixOperatorPtr A_mf = solution->getMatrixFreeStiffness();
+
+          const Epetra_Map* map = &A->OperatorDomainMap();
+          Epetra_MultiVector X(*map, numVectors), Y(*map, numVectors);
+          X.Random();
+          double assembledTime = timeApply(*A, X, Y, applications);
+          double matrixFreeTime = timeApply(*A_mf, X, Y, applications);
+
+          const Epetra_Comm &Comm = A->Comm();
+          caseJSON << ", \"numElements\": " << mesh->numActiveElements();
+          caseJSON << ", \"numGlobalRows\": " << map->NumGlobalElements();
+          caseJSON << ", \"assembled\": {\"bytes\": " << sumOverRanks(Comm, crsMatrixMemoryUsed(*A));
+          caseJSON << ", \"applyTime\": " << assembledTime << "}";
+          caseJSON << ", \"matrixFree\": {\"bytes\": " << sumOverRanks(Comm, A_mf->memoryUsed());
+          caseJSON << ", \"applyTime\": " << matrixFreeTime << "}";
+        }
+        catch (std::exception &e)
+        {
+          caseJSON << ", \"error\": " << jsonString(e.what());
+        }
+        caseJSON << "}";
+
+        if (!firstCase) json << ",";
+        json << caseJSON.str();
+        firstCase = false;
+        if (rank == 0) cerr << "camellia_apply_bench: finished spaceDim " << spaceDim << ", ";
+        if (rank == 0) cerr << elementsPerDimension << " elements per dimension, polyOrder " << polyOrder << endl;
+      }
+    }
+  }
+  json << "\n  ]\n}\n";
+
+  if (rank == 0)
+  {
+    if (outputFile == "")
+    {
+      cout << json.str();
+    }
+    else
+    {
+      ofstream fout(outputFile.c_str());
+      fout << json.str();
+      fout.close();
+    }
+  }
+
+  return 0;
+}
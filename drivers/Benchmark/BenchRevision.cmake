@@ -0,0 +1,12 @@
+# Run at build time (cmake -P) by the camellia_bench_revision target: writes BenchRevision.h, defining the revision
+# being benchmarked.  configure_file() leaves the header untouched when the revision has not changed, so the
+# benchmarks are only recompiled after a commit.
+execute_process(COMMAND git rev-parse --short HEAD
+                WORKING_DIRECTORY ${SOURCE_DIR}
+                OUTPUT_VARIABLE CAMELLIA_BENCH_REVISION
+                OUTPUT_STRIP_TRAILING_WHITESPACE
+                ERROR_QUIET)
+if (NOT CAMELLIA_BENCH_REVISION)
+  set(CAMELLIA_BENCH_REVISION "unknown")
+endif()
+configure_file(${SOURCE_DIR}/BenchRevision.h.in ${BINARY_DIR}/BenchRevision.h @ONLY)
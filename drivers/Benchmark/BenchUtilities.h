@@ -0,0 +1,58 @@
+//
+//  BenchUtilities.h
+//  Camellia
+//
+//  Command-line list parsing and JSON output helpers shared by the benchmark drivers.
+//
+
+#ifndef Camellia_BenchUtilities_h
+#define Camellia_BenchUtilities_h
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace BenchUtilities
+{
+  // ! splits a comma-separated list, dropping empty entries
+  inline std::vector<std::string> splitList(const std::string &list)
+  {
+    std::vector<std::string> entries;
+    std::istringstream listStream(list);
+    std::string entry;
+    while (std::getline(listStream, entry, ','))
+    {
+      if (entry != "") entries.push_back(entry);
+    }
+    return entries;
+  }
+
+  // ! splits a comma-separated list of integers
+  inline std::vector<int> splitIntList(const std::string &list)
+  {
+    std::vector<int> values;
+    for (const std::string &entry : splitList(list))
+    {
+      values.push_back(atoi(entry.c_str()));
+    }
+    return values;
+  }
+
+  // ! value as a quoted JSON string
+  inline std::string jsonString(const std::string &value)
+  {
+    std::ostringstream str;
+    str << "\"";
+    for (char c : value)
+    {
+      if ((c == '"') || (c == '\\')) str << "\\" << c;
+      else if (c == '\n') str << "\\n";
+      else str << c;
+    }
+    str << "\"";
+    return str.str();
+  }
+}
+
+#endif
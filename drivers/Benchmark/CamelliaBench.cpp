@@ -0,0 +1,300 @@
+//
+//  CamelliaBench.cpp
+//  Camellia
+//
+//  Sweeps a set of formulations over spatial dimension, element count, and polynomial order, timing the phases of
+//  each solve as recorded by Solution, and writes the results as JSON (to stdout, or to the file given by --output).
+//  Sample usage:
+//    mpirun -np 4 camellia_bench --formulations=Poisson,Stokes --dims=2,3 --elementCounts=2,4,8 --polyOrders=1,2,4
+//
+
+#include "BC.h"
+#include "Function.h"
+#include "IP.h"
+#include "MeshFactory.h"
+#include "MPIWrapper.h"
+#include "NavierStokesVGPFormulation.h"
+#include "PoissonFormulation.h"
+#include "RHS.h"
+#include "Solution.h"
+#include "Solver.h"
+#include "SpaceTimeHeatFormulation.h"
+#include "SpatialFilter.h"
+#include "StokesVGPFormulation.h"
+
+#include "Teuchos_CommandLineProcessor.hpp"
+#include "Teuchos_GlobalMPISession.hpp"
+
+#include "BenchRevision.h"
+#include "BenchUtilities.h"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+using namespace Camellia;
+using namespace std;
+using namespace BenchUtilities;
+
+namespace
+{
+// true on every rank if failed is true on any rank
+bool failedOnAnyRank(bool failed)
+{
+  return MPIWrapper::sum(failed ? 1 : 0) > 0;
+}
+
+struct PhaseTimings
+{
+  // maxima over MPI ranks, in seconds
+  double localStiffness, globalAssembly, bcImposition, applyJumpTerms, solve, distributeSolution;
+  // as reported by the (direct) solver; zero for solvers that do not separate these phases
+  double solverAnalysis, solverFactorization, solverSolve;
+};
+
+PhaseTimings phaseTimings(SolutionPtr solution, SolverPtr solver)
+{
+  PhaseTimings timings;
+  timings.localStiffness = solution->maxTimeLocalStiffness();
+  timings.globalAssembly = solution->maxTimeGlobalAssembly();
+  timings.bcImposition = solution->maxTimeBCImposition();
+  timings.applyJumpTerms = solution->maxTimeApplyJumpTerms();
+  timings.solve = solution->maxTimeSolve();
+  timings.distributeSolution = solution->maxTimeDistributeSolution();
+  timings.solverAnalysis = solver->analysisTime();
+  timings.solverFactorization = solver->factorizationTime();
+  timings.solverSolve = solver->solveTime();
+  return timings;
+}
+
+void writeTimings(ostream &out, const PhaseTimings &timings)
+{
+  out << "{\"localStiffness\": " << timings.localStiffness;
+  out << ", \"globalAssembly\": " << timings.globalAssembly;
+  out << ", \"bcImposition\": " << timings.bcImposition;
+  out << ", \"applyJumpTerms\": " << timings.applyJumpTerms;
+  out << ", \"solve\": " << timings.solve;
+  out << ", \"distributeSolution\": " << timings.distributeSolution;
+  out << ", \"solverAnalysis\": " << timings.solverAnalysis;
+  out << ", \"solverFactorization\": " << timings.solverFactorization;
+  out << ", \"solverSolve\": " << timings.solverSolve << "}";
+}
+
+// sets up the problem, returning the Solution whose solve() we time, or null if the combination is not supported.
+// formulation keeps the formulation object alive for as long as the Solution is in use.
+// Boundary conditions are chosen for well-posedness; the physics is beside the point here.
+SolutionPtr setupProblem(string formulationName, int spaceDim, int elementsPerDimension, int polyOrder, int delta_k,
+                         std::shared_ptr<void> &formulation)
+{
+  bool useConformingTraces = true;
+  vector<double> dimensions(spaceDim, 1.0);
+  vector<int> elementCounts(spaceDim, elementsPerDimension);
+  SpatialFilterPtr boundary = SpatialFilter::allSpace();
+
+  if (formulationName == "Poisson")
+  {
+    PoissonFormulation form(spaceDim, useConformingTraces);
+    int H1Order = polyOrder + 1;
+    MeshPtr mesh = MeshFactory::rectilinearMesh(form.bf(), dimensions, elementCounts, H1Order, delta_k);
+
+    RHSPtr rhs = RHS::rhs();
+    rhs->addTerm(1.0 * form.q());
+
+    BCPtr bc = BC::bc();
+    bc->addDirichlet(form.phi_hat(), boundary, Function::zero());
+
+    return Solution::solution(form.bf(), mesh, bc, rhs, form.bf()->graphNorm());
+  }
+  else if (formulationName == "Stokes")
+  {
+    if (spaceDim < 2) return Teuchos::null;
+    double mu = 1.0;
+    auto form = std::make_shared<StokesVGPFormulation>(StokesVGPFormulation::steadyFormulation(spaceDim, mu, useConformingTraces));
+    formulation = form;
+    MeshTopologyPtr meshTopo = MeshFactory::rectilinearMeshTopology(dimensions, elementCounts);
+    FunctionPtr forcingFunction = Function::constant(vector<double>(spaceDim, 1.0));
+    form->initializeSolution(meshTopo, polyOrder, delta_k, forcingFunction);
+    form->addWallCondition(boundary);
+    form->addZeroMeanPressureCondition();
+    return form->solution();
+  }
+  else if (formulationName == "NavierStokes")
+  {
+    if (spaceDim < 2) return Teuchos::null;
+    double Re = 100.0;
+    MeshTopologyPtr meshTopo = MeshFactory::rectilinearMeshTopology(dimensions, elementCounts);
+    auto form = std::make_shared<NavierStokesVGPFormulation>(NavierStokesVGPFormulation::steadyFormulation(spaceDim, Re, useConformingTraces,
+                                                                                                           meshTopo, polyOrder, delta_k));
+    formulation = form;
+    form->setForcingFunction(Function::constant(vector<double>(spaceDim, 1.0)));
+    form->addWallCondition(boundary);
+    form->addZeroMeanPressureCondition();
+    return form->solutionIncrement(); // the Newton step is what gets solved
+  }
+  else if (formulationName == "SpaceTimeHeat")
+  {
+    if (spaceDim > 2) return Teuchos::null; // space-time meshes are limited to three dimensions
+    double epsilon = 1e-2;
+    auto form = std::make_shared<SpaceTimeHeatFormulation>(spaceDim, epsilon, useConformingTraces);
+    formulation = form;
+    MeshTopologyPtr spatialMeshTopo = MeshFactory::rectilinearMeshTopology(dimensions, elementCounts);
+    double t0 = 0.0, t1 = 1.0;
+    MeshTopologyPtr spaceTimeMeshTopo = MeshFactory::spaceTimeMeshTopology(spatialMeshTopo, t0, t1, elementsPerDimension);
+    form->initializeSolution(spaceTimeMeshTopo, polyOrder, delta_k, Function::constant(1.0));
+    SolutionPtr solution = form->solution();
+    solution->bc()->addDirichlet(form->u_hat(), boundary, Function::zero());
+    return solution;
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Unrecognized formulation: " + formulationName);
+}
+}
+
+int main(int argc, char *argv[])
+{
+  Teuchos::GlobalMPISession mpiSession(&argc, &argv);
+  int rank = Teuchos::GlobalMPISession::getRank();
+  int numRanks = Teuchos::GlobalMPISession::getNProc();
+
+  Teuchos::CommandLineProcessor cmdp(false,true); // false: don't throw exceptions; true: do return errors for unrecognized options
+
+  string formulations = "Poisson,Stokes,NavierStokes,SpaceTimeHeat";
+  string dims = "2";
+  string elementCountList = "2,4,8";
+  string polyOrderList = "1,2,3";
+  int delta_k = -1; // -1: use spaceDim
+  int repetitions = 3;
+  string solverChoiceString = "KLU";
+  bool reuseSymbolicFactorization = false;
+  string outputFile = "";
+  string label = "";
+
+  cmdp.setOption("formulations", &formulations, "comma-separated list from Poisson, Stokes, NavierStokes, SpaceTimeHeat");
+  cmdp.setOption("dims", &dims, "comma-separated list of spatial dimensions");
+  cmdp.setOption("elementCounts", &elementCountList, "comma-separated list of element counts in each spatial (and temporal) direction");
+  cmdp.setOption("polyOrders", &polyOrderList, "comma-separated list of field polynomial orders");
+  cmdp.setOption("delta_k", &delta_k, "test space polynomial order enrichment (-1 to use the spatial dimension)");
+  cmdp.setOption("repetitions", &repetitions, "number of times to solve each problem");
+  cmdp.setOption("solver", &solverChoiceString, "KLU, SuperLUDist, MUMPS, or GMG");
+  cmdp.setOption("reuseSymbolicFactorization", "dontReuseSymbolicFactorization", &reuseSymbolicFactorization);
+  cmdp.setOption("output", &outputFile, "file for the JSON output (default: stdout)");
+  cmdp.setOption("label", &label, "label to include in the output (e.g. a build configuration)");
+
+  if (cmdp.parse(argc,argv) != Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL)
+  {
+#ifdef HAVE_MPI
+    MPI_Finalize();
+#endif
+    return -1;
+  }
+
+  Solver::SolverChoice solverChoice = Solver::solverChoiceFromString(solverChoiceString);
+
+  ostringstream json;
+  json << "{\n";
+  json << "  \"benchmark\": \"camellia_bench\",\n";
+  json << "  \"revision\": " << jsonString(CAMELLIA_BENCH_REVISION) << ",\n";
+  json << "  \"label\": " << jsonString(label) << ",\n";
+  json << "  \"numRanks\": " << numRanks << ",\n";
+  json << "  \"solver\": " << jsonString(solverChoiceString) << ",\n";
+  json << "  \"reuseSymbolicFactorization\": " << (reuseSymbolicFactorization ? "true" : "false") << ",\n";
+  json << "  \"cases\": [";
+
+  bool firstCase = true;
+  for (string formulationName : splitList(formulations))
+  {
+    for (int spaceDim : splitIntList(dims))
+    {
+      for (int elementsPerDimension : splitIntList(elementCountList))
+      {
+        for (int polyOrder : splitIntList(polyOrderList))
+        {
+          int caseDelta_k = (delta_k == -1) ? spaceDim : delta_k;
+          ostringstream caseJSON;
+          caseJSON << "\n    {\"formulation\": " << jsonString(formulationName) << ", \"spaceDim\": " << spaceDim;
+          caseJSON << ", \"elementsPerDimension\": " << elementsPerDimension << ", \"polyOrder\": " << polyOrder;
+          caseJSON << ", \"delta_k\": " << caseDelta_k;
+          // an exception on some ranks but not others would leave the others waiting in the next collective call, so
+          // after each phase we agree on whether any rank failed, and if so abandon the case on all of them
+          string errorMessage = "";
+          bool failed = false;
+          std::shared_ptr<void> formulation;
+          SolutionPtr solution;
+          SolverPtr solver;
+          try
+          {
+            solution = setupProblem(formulationName, spaceDim, elementsPerDimension, polyOrder, caseDelta_k, formulation);
+            if (solution != Teuchos::null)
+            {
+              double residualTolerance = 1e-10;
+              int maxIterations = 50000;
+              solver = Solver::getSolver(solverChoice, false, residualTolerance, maxIterations, solution);
+              solver->setReuseSymbolicFactorization(reuseSymbolicFactorization);
+            }
+          }
+          catch (std::exception &e)
+          {
+            failed = true;
+            errorMessage = e.what();
+          }
+          failed = failedOnAnyRank(failed);
+          if (!failed)
+          {
+            if (solution == Teuchos::null) continue; // unsupported combination (the same on every rank)
+
+            MeshPtr mesh = solution->mesh();
+            caseJSON << ", \"numElements\": " << mesh->numActiveElements();
+            caseJSON << ", \"numGlobalDofs\": " << mesh->numGlobalDofs();
+
+            caseJSON << ", \"samples\": [";
+            for (int repetition=0; repetition<repetitions; repetition++)
+            {
+              try
+              {
+                solution->solve(solver);
+              }
+              catch (std::exception &e)
+              {
+                failed = true;
+                errorMessage = e.what();
+              }
+              failed = failedOnAnyRank(failed);
+              if (failed) break;
+              if (repetition > 0) caseJSON << ", ";
+              writeTimings(caseJSON, phaseTimings(solution, solver));
+            }
+            caseJSON << "]";
+          }
+          if (failed)
+          {
+            if (errorMessage == "") errorMessage = "failed on another rank";
+            caseJSON << ", \"error\": " << jsonString(errorMessage);
+          }
+          caseJSON << "}";
+
+          if (!firstCase) json << ",";
+          json << caseJSON.str();
+          firstCase = false;
+          if (rank == 0) cerr << "camellia_bench: finished " << formulationName << ", spaceDim " << spaceDim << ", ";
+          if (rank == 0) cerr << elementsPerDimension << " elements per dimension, polyOrder " << polyOrder << endl;
+        }
+      }
+    }
+  }
+  json << "\n  ]\n}\n";
+
+  if (rank == 0)
+  {
+    if (outputFile == "")
+    {
+      cout << json.str();
+    }
+    else
+    {
+      ofstream fout(outputFile.c_str());
+      fout << json.str();
+      fout.close();
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,229 @@
+//
+//  IntegrateBench.cpp
+//  Camellia
+//
+//  Times the IntegrationKernels used by TLinearTerm::integrate() against the loops they replaced -- a weighted copy of
+//  the values, Intrepid's FunctionSpaceTools::integrate(), and FieldContainer-indexed accumulation into the element
+//  matrix or vector -- for H^1 bases over a sweep of dimension and polynomial order.  Writes the results as JSON (to
+//  stdout, or to the file given by --output).
+//  Sample usage:
+//    camellia_integrate_bench --dims=2,3 --polyOrders=1,2,3,4,5,6 --numCells=64
+//
+
+#include "BasisCache.h"
+#include "BasisFactory.h"
+#include "CamelliaCellTools.h"
+#include "IntegrationKernels.h"
+
+#include "Intrepid_FunctionSpaceTools.hpp"
+#include "Teuchos_CommandLineProcessor.hpp"
+#include "Teuchos_GlobalMPISession.hpp"
+
+#include "BenchRevision.h"
+#include "BenchUtilities.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+using namespace Camellia;
+using namespace Intrepid;
+using namespace std;
+using namespace BenchUtilities;
+
+namespace
+{
+// seconds per call, minimum over the repetitions
+template<class Kernel>
+double timeKernel(Kernel kernel, int repetitions)
+{
+  kernel(); // warm-up
+  double minTime = -1;
+  for (int i=0; i<repetitions; i++)
+  {
+    auto start = chrono::steady_clock::now();
+    kernel();
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if ((minTime < 0) || (time < minTime)) minTime = time;
+  }
+  return minTime;
+}
+
+double maxDifference(const FieldContainer<double> &a, const FieldContainer<double> &b)
+{
+  double maxDiff = 0.0;
+  for (int i=0; i<a.size(); i++)
+  {
+    maxDiff = max(maxDiff, abs(a[i] - b[i]));
+  }
+  return maxDiff;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  Teuchos::GlobalMPISession mpiSession(&argc, &argv);
+  int rank = Teuchos::GlobalMPISession::getRank();
+
+  Teuchos::CommandLineProcessor cmdp(false,true); // false: don't throw exceptions; true: do return errors for unrecognized options
+
+  string dims = "2,3";
+  string polyOrderList = "1,2,3,4,5";
+  int numCells = 64;
+  int repetitions = 20;
+  string outputFile = "";
+  string label = "";
+
+  cmdp.setOption("dims", &dims, "comma-separated list of spatial dimensions");
+  cmdp.setOption("polyOrders", &polyOrderList, "comma-separated list of polynomial orders");
+  cmdp.setOption("numCells", &numCells, "number of cells in each batch");
+  cmdp.setOption("repetitions", &repetitions, "number of timed repetitions of each kernel (the minimum is reported)");
+  cmdp.setOption("output", &outputFile, "file for the JSON output (default: stdout)");
+  cmdp.setOption("label", &label, "label to include in the output (e.g. a build configuration)");
+
+  if (cmdp.parse(argc,argv) != Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL)
+  {
+#ifdef HAVE_MPI
+    MPI_Finalize();
+#endif
+    return -1;
+  }
+
+  ostringstream json;
+  json << "{\n";
+  json << "  \"benchmark\": \"camellia_integrate_bench\",\n";
+  json << "  \"revision\": " << jsonString(CAMELLIA_BENCH_REVISION) << ",\n";
+  json << "  \"label\": " << jsonString(label) << ",\n";
+  json << "  \"numCells\": " << numCells << ",\n";
+  json << "  \"cases\": [";
+
+  bool firstCase = true;
+  for (int spaceDim : splitIntList(dims))
+  {
+    for (int polyOrder : splitIntList(polyOrderList))
+    {
+      ostringstream caseJSON;
+      caseJSON << "\n    {\"spaceDim\": " << spaceDim << ", \"polyOrder\": " << polyOrder;
+      try
+      {
+        CellTopoPtr cellTopo = (spaceDim == 1) ? CellTopology::line() : (spaceDim == 2) ? CellTopology::quad() : CellTopology::hexahedron();
+        BasisPtr basis = BasisFactory::basisFactory()->getBasis(polyOrder + 1, cellTopo, Camellia::FUNCTION_SPACE_HGRAD);
+
+        // a batch of reference cells, each slightly stretched
+        FieldContainer<double> refCellNodes(cellTopo->getNodeCount(), spaceDim);
+        CamelliaCellTools::refCellNodesForTopology(refCellNodes, cellTopo);
+        FieldContainer<double> physicalCellNodes(numCells, cellTopo->getNodeCount(), spaceDim);
+        for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+        {
+          for (int i=0; i<refCellNodes.size(); i++)
+          {
+            physicalCellNodes[cellOrdinal * refCellNodes.size() + i] = (1.0 + 0.01 * cellOrdinal) * refCellNodes[i];
+          }
+        }
+        int cubDegree = 2 * polyOrder;
+        BasisCachePtr basisCache = Teuchos::rcp( new BasisCache(physicalCellNodes, cellTopo, cubDegree) );
+
+        const FieldContainer<double> &weights = basisCache->getWeightedMeasures();
+        FieldContainer<double> values = *basisCache->getTransformedValues(basis, Camellia::OP_VALUE);
+        FieldContainer<double> gradValues = *basisCache->getTransformedValues(basis, Camellia::OP_GRAD);
+        int numFields = basis->getCardinality();
+        int numPoints = weights.dimension(1);
+
+        // scatter into the element matrix in reverse order, as a stand-in for a DofOrdering
+        vector<int> dofIndices(numFields);
+        for (int i=0; i<numFields; i++)
+        {
+          dofIndices[i] = numFields - 1 - i;
+        }
+
+        // bilinear: (grad u, grad v), as in the general path of TLinearTerm::integrate()
+        FieldContainer<double> referenceMatrix(numCells, numFields, numFields), kernelMatrix(numCells, numFields, numFields);
+        FieldContainer<double> weightedGradValues(gradValues.dimension(0), gradValues.dimension(1), gradValues.dimension(2),
+                                                  gradValues.dimension(3));
+        FieldContainer<double> miniMatrix(numCells, numFields, numFields);
+        double referenceBilinearTime = timeKernel([&]()
+        {
+          referenceMatrix.initialize(0.0);
+          FunctionSpaceTools::multiplyMeasure<double>(weightedGradValues, weights, gradValues);
+          FunctionSpaceTools::integrate<double>(miniMatrix, weightedGradValues, gradValues, COMP_BLAS);
+          for (int k=0; k<numCells; k++)
+          {
+            for (int i=0; i<numFields; i++)
+            {
+              for (int j=0; j<numFields; j++)
+              {
+                referenceMatrix(k,dofIndices[i],dofIndices[j]) += miniMatrix(k,i,j);
+              }
+            }
+          }
+        }, repetitions);
+        double kernelBilinearTime = timeKernel([&]()
+        {
+          kernelMatrix.initialize(0.0);
+          IntegrationKernels::integrate(miniMatrix, gradValues, gradValues, weights);
+          IntegrationKernels::sumInto(kernelMatrix, miniMatrix, dofIndices, dofIndices);
+        }, repetitions);
+
+        // linear: (1, v), as in TLinearTerm::integrate() for a linear term
+        FieldContainer<double> referenceVector(numCells, numFields), kernelVector(numCells, numFields);
+        FieldContainer<double> weightedValues(values.dimension(0), values.dimension(1), values.dimension(2));
+        double referenceLinearTime = timeKernel([&]()
+        {
+          referenceVector.initialize(0.0);
+          FunctionSpaceTools::multiplyMeasure<double>(weightedValues, weights, values);
+          for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+          {
+            for (int basisOrdinal=0; basisOrdinal<numFields; basisOrdinal++)
+            {
+              int dofIndex = dofIndices[basisOrdinal];
+              for (int ptIndex=0; ptIndex<numPoints; ptIndex++)
+              {
+                referenceVector(cellIndex,dofIndex) += weightedValues(cellIndex,basisOrdinal,ptIndex);
+              }
+            }
+          }
+        }, repetitions);
+        double kernelLinearTime = timeKernel([&]()
+        {
+          kernelVector.initialize(0.0);
+          IntegrationKernels::integrate(kernelVector, values, weights, dofIndices);
+        }, repetitions);
+
+        caseJSON << ", \"numFields\": " << numFields << ", \"numPoints\": " << numPoints;
+        caseJSON << ", \"bilinear\": {\"referenceTime\": " << referenceBilinearTime << ", \"kernelTime\": " << kernelBilinearTime;
+        caseJSON << ", \"speedup\": " << referenceBilinearTime / kernelBilinearTime;
+        caseJSON << ", \"maxDifference\": " << maxDifference(referenceMatrix, kernelMatrix) << "}";
+        caseJSON << ", \"linear\": {\"referenceTime\": " << referenceLinearTime << ", \"kernelTime\": " << kernelLinearTime;
+        caseJSON << ", \"speedup\": " << referenceLinearTime / kernelLinearTime;
+        caseJSON << ", \"maxDifference\": " << maxDifference(referenceVector, kernelVector) << "}";
+      }
+      catch (std::exception &e)
+      {
+        caseJSON << ", \"error\": " << jsonString(e.what());
+      }
+      caseJSON << "}";
+
+      if (!firstCase) json << ",";
+      json << caseJSON.str();
+      firstCase = false;
+      if (rank == 0) cerr << "camellia_integrate_bench: finished spaceDim " << spaceDim << ", polyOrder " << polyOrder << endl;
+    }
+  }
+  json << "\n  ]\n}\n";
+
+  if (rank == 0)
+  {
+    if (outputFile == "")
+    {
+      cout << json.str();
+    }
+    else
+    {
+      ofstream fout(outputFile.c_str());
+      fout << json.str();
+      fout.close();
+    }
+  }
+
+  return 0;
+}
@@ -476,6 +476,8 @@ string smootherString(GMGOperator::SmootherChoice smoother)
     return "Block-Jacobi";
   case GMGOperator::POINT_JACOBI:
     return "Point-Jacobi";
+  case GMGOperator::CHEBYSHEV:
+    return "Chebyshev";
   default:
     return "Unknown";
   }
@@ -2009,6 +2011,10 @@ int main(int argc, char *argv[])
   {
     smootherChoice = GMGOperator::BLOCK_SYMMETRIC_GAUSS_SEIDEL;
   }
+  else if (smootherChoiceStr == "Chebyshev")
+  {
+    smootherChoice = GMGOperator::CHEBYSHEV;
+  }
   else
   {
     if (rank==0) cout << "Smoother choice string not recognized.\n";
@@ -60,6 +60,9 @@ typedef FunctionSpaceTools fst;
 
 const static bool CACHE_TRANSFORMED_VALUES = false; // save some memory by not caching these
 
+bool BasisCache::_useAffineIntegration = true;
+bool BasisCache::_memoizeFunctionValues = false;
+
 // TODO: add exceptions for side cache arguments to methods that don't make sense
 // (e.g. useCubPointsSideRefCell==true when _isSideCache==false)
 
@@ -144,32 +147,16 @@ void BasisCache::initVolumeCache(bool createSideCacheToo, bool tensorProductTopo
 
   if (_cellTopo->getDimension() > 0)
   {
-    CubatureFactory cubFactory;
-    Teuchos::RCP<Cubature<double> > cellTopoCub;
-    
+    // cubature points and weights are cached by CubatureFactory, keyed on topology and degree
     if (_cubDegree >= 0)
-      cellTopoCub = cubFactory.create(_cellTopo, _cubDegree);
+      CubatureFactory::getCubature(_cellTopo, _cubDegree, _cubPoints, _cubWeights);
     else if (_cubDegrees.size() > 0)
-      cellTopoCub = cubFactory.create(_cellTopo, _cubDegrees);
-    
-    int cubDim, numCubPoints;
-    
-    if (cellTopoCub != Teuchos::null)
-    {
-      cubDim       = cellTopoCub->getDimension();
-      numCubPoints = cellTopoCub->getNumPoints();
-    }
+      CubatureFactory::getCubature(_cellTopo, _cubDegrees, _cubPoints, _cubWeights);
     else
     {
-      cubDim = _cellTopo->getDimension();
-      numCubPoints = 0;
+      _cubPoints = FieldContainer<double>(0, _cellTopo->getDimension());
+      _cubWeights.resize(0);
     }
-
-    _cubPoints = FieldContainer<double>(numCubPoints, cubDim);
-    _cubWeights.resize(numCubPoints);
-
-    if (numCubPoints > 0)
-      cellTopoCub->getCubature(_cubPoints, _cubWeights);
   }
   else
   {
@@ -487,26 +474,21 @@ BasisCache::BasisCache(int sideIndex, BasisCachePtr volumeCache, int trialDegree
 
   if (sideDim > 0)
   {
-    CubatureFactory cubFactory;
-    Teuchos::RCP<Cubature<double> > sideCub;
-    if (_cubDegree >= 0)
-      sideCub = cubFactory.create(side, _cubDegree);
-    else if (_cubDegrees.size() > 0)
-      sideCub = cubFactory.create(side, _cubDegrees);
-
     int numCubPointsSide;
     
-    if (sideCub != Teuchos::null)
-      numCubPointsSide = sideCub->getNumPoints();
-    else
-      numCubPointsSide = 0;
-    
-    _cubPoints.resize(numCubPointsSide, sideDim); // cubature points from the pov of the side (i.e. a (d-1)-dimensional set)
-    _cubWeights.resize(numCubPointsSide);
     if ( multiBasisIfAny.get() == NULL )
     {
-      if (numCubPointsSide > 0)
-        sideCub->getCubature(_cubPoints, _cubWeights);
+      // cubature points from the pov of the side (i.e. a (d-1)-dimensional set); cached by CubatureFactory
+      if (_cubDegree >= 0)
+        CubatureFactory::getCubature(side, _cubDegree, _cubPoints, _cubWeights);
+      else if (_cubDegrees.size() > 0)
+        CubatureFactory::getCubature(side, _cubDegrees, _cubPoints, _cubWeights);
+      else
+      {
+        _cubPoints.resize(0, sideDim);
+        _cubWeights.resize(0);
+      }
+      numCubPointsSide = _cubPoints.dimension(0);
     }
     else
     {
@@ -819,6 +801,7 @@ void BasisCache::setMesh(MeshPtr mesh)
 void BasisCache::discardPhysicalNodeInfo()
 {
   // discard physicalNodes and all transformed basis values.
+  _knownFunctionValues.clear();
   _knownValuesTransformed.clear();
   _knownValuesTransformedWeighted.clear();
   _knownValuesTransformedDottedWithNormal.clear();
@@ -898,6 +881,100 @@ const FieldContainer<double> & BasisCache::getJacobianInv()
   return _cellJacobInv;
 }
 
+void BasisCache::setUseAffineIntegration(bool value)
+{
+  _useAffineIntegration = value;
+}
+
+bool BasisCache::useAffineIntegration()
+{
+  return _useAffineIntegration;
+}
+
+void BasisCache::setMemoizeFunctionValues(bool value)
+{
+  _memoizeFunctionValues = value;
+}
+
+bool BasisCache::memoizeFunctionValues()
+{
+  return _memoizeFunctionValues;
+}
+
+constFCPtr BasisCache::getFunctionValues(TFunctionPtr<double> f, Camellia::EOperator op)
+{
+  pair< TFunction<double>*, Camellia::EOperator > key = {f.get(), op};
+  if (_memoizeFunctionValues)
+  {
+    auto entryIt = _knownFunctionValues.find(key);
+    if (entryIt != _knownFunctionValues.end()) return entryIt->second.second;
+  }
+
+  int valuesRank = f->rank();
+  if (op == Camellia::OP_GRAD) valuesRank++;
+  else if (op == Camellia::OP_DIV) valuesRank--;
+
+  const FieldContainer<double>* points = &getPhysicalCubaturePoints();
+  Teuchos::Array<int> dim;
+  dim.append(points->dimension(0));
+  dim.append(points->dimension(1));
+  for (int r=0; r<valuesRank; r++)
+  {
+    dim.append(getSpaceDim());
+  }
+  Teuchos::RCP< FieldContainer<double> > values = Teuchos::rcp( new FieldContainer<double>(dim) );
+  BasisCachePtr thisPtr = Teuchos::rcp(this,false);
+  if (op == Camellia::OP_VALUE)
+  {
+    f->values(*values, thisPtr);
+  }
+  else
+  {
+    f->values(*values, op, thisPtr);
+  }
+
+  if (_memoizeFunctionValues)
+  {
+    _knownFunctionValues[key] = {f, values};
+  }
+  return values;
+}
+
+void BasisCache::discardFunctionValues()
+{
+  _knownFunctionValues.clear();
+  for (BasisCachePtr sideCache : _basisCacheSides)
+  {
+    if (sideCache != Teuchos::null) sideCache->discardFunctionValues();
+  }
+}
+
+bool BasisCache::cellsAreAffine()
+{
+  if (!_cellJacobianIsValid) determineJacobian();
+  return _cellsAreAffine && TFunction<double>::isNull(_transformationFxn);
+}
+
+const FieldContainer<double> & BasisCache::getAffineCellJacobian()
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(!cellsAreAffine(), std::invalid_argument, "getAffineCellJacobian() requires affine cells");
+  return _affineCellJacobian;
+}
+
+const FieldContainer<double> & BasisCache::getAffineCellJacobianInv()
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(!cellsAreAffine(), std::invalid_argument, "getAffineCellJacobianInv() requires affine cells");
+  if (!_cellJacobianInverseIsValid) determineJacobianInverseAndDeterminant();
+  return _affineCellJacobInv;
+}
+
+const FieldContainer<double> & BasisCache::getAffineCellJacobianDet()
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(!cellsAreAffine(), std::invalid_argument, "getAffineCellJacobianDet() requires affine cells");
+  if (!_cellJacobianDeterminantIsValid) determineJacobianInverseAndDeterminant();
+  return _affineCellJacobDet;
+}
+
 constFCPtr BasisCache::getValues(BasisPtr basis, Camellia::EOperator op,
                                  bool useCubPointsSideRefCell)
 {
@@ -1202,6 +1279,7 @@ void BasisCache::setRefCellPoints(const FieldContainer<double> &pointsRefCell, c
   _knownValuesTransformedWeighted.clear();
   _knownValuesTransformedDottedWithNormal.clear();
   _knownValuesTransformedWeighted.clear();
+  _knownFunctionValues.clear();
 
   _cubWeights = cubWeights;
 
@@ -1243,6 +1321,7 @@ const FieldContainer<double> & BasisCache::getCellSideParities()
 void BasisCache::setCellIDs(const std::vector<GlobalIndexType> &cellIDs)
 {
   _cellIDs = cellIDs;
+  _knownFunctionValues.clear(); // e.g. solution Functions depend on the cell IDs
 }
 
 void BasisCache::setCellSideParities(const FieldContainer<double> &cellSideParities)
@@ -1250,12 +1329,14 @@ void BasisCache::setCellSideParities(const FieldContainer<double> &cellSideParit
   TEUCHOS_TEST_FOR_EXCEPTION((cellSideParities.rank() != 2) || (cellSideParities.dimension(1) < _cellTopo->getSideCount()),
                              std::invalid_argument, "Incorrectly sized cellSideParities");
   _cellSideParities = cellSideParities;
+  _knownFunctionValues.clear();
 }
 
 void BasisCache::setTransformationFunction(TFunctionPtr<double> fxn, bool composeWithMeshTransformation)
 {
   _transformationFxn = fxn;
   _composeTransformationFxnWithMeshTransformation = composeWithMeshTransformation;
+  _knownFunctionValues.clear();
   // recompute physical points and jacobian values
   
   _cellJacobianIsValid = false;
@@ -1332,9 +1413,67 @@ void BasisCache::determinePhysicalPoints()
   }
 }
 
+// computes the Jacobian at the reference centroid of each cell, and checks whether that Jacobian reproduces every
+// node of the cell from its first node.  If so for all cells, the (multilinear) map is affine and _affineCellJacobian
+// holds the Jacobian for each cell.
+bool BasisCache::determineAffineCellJacobians()
+{
+  int cellDim = _cellTopo->getDimension();
+  if (isSideCache() || !TFunction<double>::isNull(_transformationFxn)) return false;
+  if ((_physicalCellNodes.rank() != 3) || (_physicalCellNodes.dimension(0) != _numCells) || (_numCells == 0)) return false;
+
+  FieldContainer<double> refNodes;
+  CamelliaCellTools::refCellNodesForTopology(refNodes, _cellTopo);
+  int numNodes = refNodes.dimension(0);
+  if (_physicalCellNodes.dimension(1) != numNodes) return false;
+
+  FieldContainer<double> refCentroid(1,cellDim);
+  for (int node=0; node<numNodes; node++)
+  {
+    for (int d=0; d<cellDim; d++)
+    {
+      refCentroid(0,d) += refNodes(node,d) / numNodes;
+    }
+  }
+  FieldContainer<double> centroidJacobian(_numCells,1,cellDim,cellDim);
+  CamelliaCellTools::setJacobian(centroidJacobian, refCentroid, _physicalCellNodes, _cellTopo);
+
+  const double relativeTol = 1e-12;
+  for (int cellOrdinal=0; cellOrdinal<_numCells; cellOrdinal++)
+  {
+    double maxDistance = 0, maxError = 0;
+    for (int node=1; node<numNodes; node++)
+    {
+      double distanceSquared = 0, errorSquared = 0;
+      for (int i=0; i<cellDim; i++)
+      {
+        double offset = _physicalCellNodes(cellOrdinal,node,i) - _physicalCellNodes(cellOrdinal,0,i);
+        double mappedOffset = 0;
+        for (int j=0; j<cellDim; j++)
+        {
+          mappedOffset += centroidJacobian(cellOrdinal,0,i,j) * (refNodes(node,j) - refNodes(0,j));
+        }
+        distanceSquared += offset * offset;
+        errorSquared += (offset - mappedOffset) * (offset - mappedOffset);
+      }
+      maxDistance = max(maxDistance, sqrt(distanceSquared));
+      maxError = max(maxError, sqrt(errorSquared));
+    }
+    if (maxError > relativeTol * maxDistance) return false;
+  }
+
+  _affineCellJacobian.resize(_numCells,cellDim,cellDim);
+  for (int i=0; i<_affineCellJacobian.size(); i++)
+  {
+    _affineCellJacobian[i] = centroidJacobian[i];
+  }
+  return true;
+}
+
 void BasisCache::determineJacobian()
 {
   int cellDim = _cellTopo->getDimension();
+  _cellsAreAffine = false;
 
   if (cellDim == 0)
   {
@@ -1355,6 +1494,27 @@ void BasisCache::determineJacobian()
     return;
   }
 
+  if (determineAffineCellJacobians())
+  {
+    // one Jacobian per cell; copy it to each point
+    _cellsAreAffine = true;
+    int matrixSize = cellDim * cellDim;
+    for (int cellOrdinal=0; cellOrdinal<_numCells; cellOrdinal++)
+    {
+      const double* cellJacobian = &_affineCellJacobian(cellOrdinal,0,0);
+      for (int pointOrdinal=0; pointOrdinal<numCubPoints; pointOrdinal++)
+      {
+        double* pointJacobian = &_cellJacobian(cellOrdinal,pointOrdinal,0,0);
+        for (int i=0; i<matrixSize; i++)
+        {
+          pointJacobian[i] = cellJacobian[i];
+        }
+      }
+    }
+    _cellJacobianIsValid = true;
+    return;
+  }
+
   if ( TFunction<double>::isNull(_transformationFxn) || _composeTransformationFxnWithMeshTransformation)
   {
     if (!isSideCache())
@@ -1410,6 +1570,42 @@ void BasisCache::determineJacobianInverseAndDeterminant()
   
   _cellJacobInv.resize(_numCells, numCubPoints, cellDim, cellDim);
   _cellJacobDet.resize(_numCells, numCubPoints);
+  if (cellsAreAffine())
+  {
+    // invert once per cell, and copy to each point
+    FieldContainer<double> cellJacobian(_numCells, 1, cellDim, cellDim);
+    for (int i=0; i<cellJacobian.size(); i++)
+    {
+      cellJacobian[i] = _affineCellJacobian[i];
+    }
+    FieldContainer<double> cellJacobInv(_numCells, 1, cellDim, cellDim), cellJacobDet(_numCells, 1);
+    SerialDenseWrapper::determinantAndInverse(cellJacobDet, cellJacobInv, cellJacobian);
+
+    _affineCellJacobInv.resize(_numCells, cellDim, cellDim);
+    _affineCellJacobDet.resize(_numCells);
+    int matrixSize = cellDim * cellDim;
+    for (int cellOrdinal=0; cellOrdinal<_numCells; cellOrdinal++)
+    {
+      _affineCellJacobDet(cellOrdinal) = cellJacobDet(cellOrdinal,0);
+      const double* cellInverse = &cellJacobInv(cellOrdinal,0,0,0);
+      for (int i=0; i<matrixSize; i++)
+      {
+        _affineCellJacobInv[cellOrdinal * matrixSize + i] = cellInverse[i];
+      }
+      for (int pointOrdinal=0; pointOrdinal<numCubPoints; pointOrdinal++)
+      {
+        _cellJacobDet(cellOrdinal,pointOrdinal) = cellJacobDet(cellOrdinal,0);
+        double* pointInverse = &_cellJacobInv(cellOrdinal,pointOrdinal,0,0);
+        for (int i=0; i<matrixSize; i++)
+        {
+          pointInverse[i] = cellInverse[i];
+        }
+      }
+    }
+    _cellJacobianInverseIsValid = true;
+    _cellJacobianDeterminantIsValid = true;
+    return;
+  }
   SerialDenseWrapper::determinantAndInverse(_cellJacobDet, _cellJacobInv, getJacobian());
   _cellJacobianInverseIsValid = true;
   _cellJacobianDeterminantIsValid = true;
@@ -1619,6 +1815,47 @@ BasisCachePtr BasisCache::basisCacheForCell(MeshPtr mesh, GlobalIndexType cellID
   return basisCache;
 }
 
+BasisCachePtr BasisCache::basisCacheForCells(MeshPtr mesh, const vector<GlobalIndexType> &cellIDs, bool testVsTest,
+                                             int cubatureDegreeEnrichment, bool tensorProductTopologyMeansSpaceTime)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(cellIDs.size() == 0, std::invalid_argument, "cellIDs must not be empty");
+  if (cellIDs.size() == 1)
+  {
+    return basisCacheForCell(mesh, cellIDs[0], testVsTest, cubatureDegreeEnrichment, tensorProductTopologyMeansSpaceTime);
+  }
+  ElementTypePtr elemType = mesh->getElementType(cellIDs[0]);
+  TEUCHOS_TEST_FOR_EXCEPTION(tensorProductTopologyMeansSpaceTime && (elemType->cellTopoPtr->getTensorialDegree() > 0),
+                             std::invalid_argument, "space-time cells are supported only one at a time");
+  int numCells = cellIDs.size();
+  int numSides = elemType->cellTopoPtr->getSideCount();
+  int numNodes = elemType->cellTopoPtr->getVertexCount();
+  int spaceDim = mesh->getDimension();
+  FieldContainer<double> physicalCellNodes(numCells, numNodes, spaceDim);
+  FieldContainer<double> cellSideParities(numCells, numSides);
+  for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+  {
+    TEUCHOS_TEST_FOR_EXCEPTION(mesh->getElementType(cellIDs[cellOrdinal]).get() != elemType.get(), std::invalid_argument,
+                               "all cells must have the same element type");
+    FieldContainer<double> cellNodes = mesh->physicalCellNodesForCell(cellIDs[cellOrdinal]);
+    for (int i=0; i<numNodes*spaceDim; i++)
+    {
+      physicalCellNodes[cellOrdinal*numNodes*spaceDim + i] = cellNodes[i];
+    }
+    FieldContainer<double> parities = mesh->cellSideParitiesForCell(cellIDs[cellOrdinal]);
+    for (int sideOrdinal=0; sideOrdinal<numSides; sideOrdinal++)
+    {
+      cellSideParities(cellOrdinal,sideOrdinal) = parities(0,sideOrdinal);
+    }
+  }
+
+  BasisCachePtr basisCache = Teuchos::rcp( new BasisCache(elemType, mesh, testVsTest, cubatureDegreeEnrichment, tensorProductTopologyMeansSpaceTime) );
+  bool createSideCache = true;
+  basisCache->setPhysicalCellNodes(physicalCellNodes, cellIDs, createSideCache);
+  basisCache->setCellSideParities(cellSideParities);
+
+  return basisCache;
+}
+
 BasisCachePtr BasisCache::basisCacheForCellTopology(CellTopoPtr cellTopo, int cubatureDegree,
     const FieldContainer<double> &physicalCellNodes,
     bool createSideCacheToo,
@@ -87,4 +87,91 @@ Teuchos::RCP<Intrepid::Cubature<double> > CubatureFactory::create(CellTopoPtr ce
     }
     return Teuchos::rcp(new CubatureTensor<double>(componentCubatures));
   }
-}
\ No newline at end of file
+}
+std::map<CubatureFactory::CubatureKey, CubatureFactory::CachedCubature> CubatureFactory::_cubatureCache;
+long long CubatureFactory::_cacheHitCount = 0;
+long long CubatureFactory::_cacheMissCount = 0;
+
+void CubatureFactory::getCubature(CellTopoPtr cellTopo, int cubDegree, FieldContainer<double> &cubPoints, FieldContainer<double> &cubWeights)
+{
+  std::vector<int> degreeKey(1,cubDegree);
+  getCachedCubature(cellTopo, CubatureKey(cellTopo->getKey(), degreeKey), degreeKey, cubPoints, cubWeights);
+}
+
+void CubatureFactory::getCubature(CellTopoPtr cellTopo, const std::vector<int> &cubDegree,
+                                  FieldContainer<double> &cubPoints, FieldContainer<double> &cubWeights)
+{
+  std::vector<int> degreeKey(1,-1);
+  degreeKey.insert(degreeKey.end(), cubDegree.begin(), cubDegree.end());
+  getCachedCubature(cellTopo, CubatureKey(cellTopo->getKey(), degreeKey), cubDegree, cubPoints, cubWeights);
+}
+
+void CubatureFactory::getCachedCubature(CellTopoPtr cellTopo, const CubatureKey &key, const std::vector<int> &cubDegree,
+                                        FieldContainer<double> &cubPoints, FieldContainer<double> &cubWeights)
+{
+  // BasisCaches may be constructed on several threads at once (see Solution::setNumThreadsForLocalStiffness())
+#ifdef _OPENMP
+#pragma omp critical (CamelliaCubatureCache)
+#endif
+  {
+    auto entry = _cubatureCache.find(key);
+    if (entry == _cubatureCache.end())
+    {
+      _cacheMissCount++;
+      
+      CubatureFactory cubFactory;
+      Teuchos::RCP<Cubature<double> > cub;
+      if (cellTopo->getDimension() > 0)
+      {
+        if (key.second[0] == -1)
+          cub = cubFactory.create(cellTopo, cubDegree);
+        else
+          cub = cubFactory.create(cellTopo, cubDegree[0]);
+      }
+      
+      CachedCubature* cached = &_cubatureCache[key];
+      if (cub != Teuchos::null)
+      {
+        cached->points.resize(cub->getNumPoints(), cub->getDimension());
+        cached->weights.resize(cub->getNumPoints());
+        if (cub->getNumPoints() > 0)
+          cub->getCubature(cached->points, cached->weights);
+      }
+      else
+      {
+        cached->points.resize(0, cellTopo->getDimension());
+        cached->weights.resize(0);
+      }
+      entry = _cubatureCache.find(key);
+    }
+    else
+    {
+      _cacheHitCount++;
+    }
+    cubPoints = entry->second.points;
+    cubWeights = entry->second.weights;
+  }
+}
+
+long long CubatureFactory::cacheHitCount()
+{
+  return _cacheHitCount;
+}
+
+long long CubatureFactory::cacheMissCount()
+{
+  return _cacheMissCount;
+}
+
+void CubatureFactory::clearCache()
+{
+  // same lock as getCachedCubature(), since BasisCaches may be under construction on other threads
+#ifdef _OPENMP
+#pragma omp critical (CamelliaCubatureCache)
+#endif
+  {
+    _cubatureCache.clear();
+    _cacheHitCount = 0;
+    _cacheMissCount = 0;
+  }
+}
@@ -25,5 +25,6 @@ int PhysicalPointCache::getSpaceDim()
 }
 FieldContainer<double> & PhysicalPointCache::writablePhysicalCubaturePoints()   // allows overwriting the contents
 {
+  discardFunctionValues(); // the points are about to change
   return _physCubPoints;
 }
\ No newline at end of file
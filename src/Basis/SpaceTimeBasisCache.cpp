@@ -16,6 +16,7 @@ using namespace Intrepid;
 using namespace Camellia;
 
 bool SpaceTimeBasisCache::_defaultStoreTransformedValues = false;
+bool SpaceTimeBasisCache::_useSumFactorization = true;
 
 // volume constructor
 SpaceTimeBasisCache::SpaceTimeBasisCache(MeshPtr spaceTimeMesh, ElementTypePtr spaceTimeElementType,
@@ -553,14 +554,40 @@ constFCPtr SpaceTimeBasisCache::getTransformedValues(BasisPtr basis, Camellia::E
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "basis must be a subclass of TensorBasis<double>!");
   }
 
+  Intrepid::EOperator spaceOpForSizing = this->spaceOpForSizing(op), timeOpForSizing = this->timeOpForSizing(op);
+
+  constFCPtr spatialValues, temporalValues;
+  getTransformedComponentValues(basis, op, spatialValues, temporalValues, useCubPointsSideRefCell);
+  
+  constFCPtr values = getTensorBasisValues(tensorBasis, FIELD_INDEX, POINT_INDEX, spatialValues, temporalValues,
+                                           spaceOpForSizing, timeOpForSizing);
+  if (_storeTransformedValues)
+  {
+    _knownValuesTransformed[key] = values;
+  }
+  
+  return values;
+}
+
+bool SpaceTimeBasisCache::getTransformedComponentValues(BasisPtr basis, Camellia::EOperator op,
+                                                        constFCPtr &spatialValues, constFCPtr &temporalValues,
+                                                        bool useCubPointsSideRefCell)
+{
+  if ( isSideCache() && !cellTopology()->sideIsSpatial(getSideIndex()) )
+  {
+    // a trace basis on a temporal side is defined on the spatial topology only; it has no temporal factor
+    if (_spatialCache->cellTopology()->getKey() == basis->domainTopology()->getKey()) return false;
+  }
+  if (_temporalCache == Teuchos::null) return false;
+
+  TensorBasis<double>* tensorBasis = dynamic_cast<TensorBasis<double>*>(basis.get());
+  if (tensorBasis == NULL) return false;
+
   BasisPtr spatialBasis = tensorBasis->getSpatialBasis();
   BasisPtr temporalBasis = tensorBasis->getTemporalBasis();
 
-  Intrepid::EOperator spaceOpForSizing = this->spaceOpForSizing(op), timeOpForSizing = this->timeOpForSizing(op);
-
   Camellia::EOperator spaceOp = this->spaceOp(op), timeOp = this->timeOp(op);
 
-  constFCPtr spatialValues, temporalValues;
   if (useCubPointsSideRefCell && !cellTopology()->sideIsSpatial(getSideIndex()))
   {
     // then _spatialCache is a volume cache already, so we shouldn't tell it to use volume points...
@@ -573,15 +600,7 @@ constFCPtr SpaceTimeBasisCache::getTransformedValues(BasisPtr basis, Camellia::E
 
   // _temporalCache is always a volume cache
   temporalValues = _temporalCache->getTransformedValues(temporalBasis, timeOp, false);
-  
-  constFCPtr values = getTensorBasisValues(tensorBasis, FIELD_INDEX, POINT_INDEX, spatialValues, temporalValues,
-                                           spaceOpForSizing, timeOpForSizing);
-  if (_storeTransformedValues)
-  {
-    _knownValuesTransformed[key] = values;
-  }
-  
-  return values;
+  return true;
 }
 
 constFCPtr SpaceTimeBasisCache::getTransformedWeightedValues(BasisPtr basis, Camellia::EOperator op, bool useCubPointsSideRefCell)
@@ -599,6 +618,16 @@ void SpaceTimeBasisCache::setDefaultStoreTransformedValues(bool storeValues)
   _defaultStoreTransformedValues = storeValues;
 }
 
+void SpaceTimeBasisCache::setUseSumFactorization(bool value)
+{
+  _useSumFactorization = value;
+}
+
+bool SpaceTimeBasisCache::useSumFactorization()
+{
+  return _useSumFactorization;
+}
+
 void SpaceTimeBasisCache::setPhysicalCellNodes(const Intrepid::FieldContainer<double> &physicalCellNodes,
     const std::vector<GlobalIndexType> &cellIDs, bool createSideCacheToo)
 {
@@ -0,0 +1,379 @@
+//
+//  TimerRegistry.cpp
+//  Camellia
+//
+//
+
+#include "TimerRegistry.h"
+
+#include "MPIWrapper.h"
+
+#include "Intrepid_FieldContainer.hpp"
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+using namespace Camellia;
+using namespace std;
+
+struct TimerRegistry::Node
+{
+  const char* key; // the pointer passed to enter(); usually a string literal, which makes lookup a pointer comparison
+  string name;
+  Node* parent = NULL;
+  vector< unique_ptr<Node> > children;
+  long long calls = 0;
+  double totalTime = 0, minTime = 0, maxTime = 0;
+};
+
+namespace
+{
+struct TraceEvent
+{
+  const TimerRegistry::Node* node;
+  double start, duration; // microseconds since the registry's epoch
+};
+
+struct ThreadTimers
+{
+  int ordinal;
+  TimerRegistry::Node root;
+  TimerRegistry::Node* current;
+  map<string, long long> counters;
+  vector<TraceEvent> events;
+};
+
+struct RegistryState
+{
+  std::mutex mutex; // guards threads
+  vector< unique_ptr<ThreadTimers> > threads;
+  std::atomic<bool> enabled{true};
+  std::atomic<bool> recordTrace{false};
+  std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+RegistryState &registry()
+{
+  static RegistryState state;
+  return state;
+}
+
+thread_local ThreadTimers* myThreadTimers = NULL;
+
+ThreadTimers* threadTimers()
+{
+  if (myThreadTimers == NULL)
+  {
+    RegistryState &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    ThreadTimers* timers = new ThreadTimers();
+    timers->ordinal = state.threads.size();
+    timers->current = &timers->root;
+    state.threads.push_back(unique_ptr<ThreadTimers>(timers));
+    myThreadTimers = timers;
+  }
+  return myThreadTimers;
+}
+
+void accumulate(TimerRegistry::RegionSummary &summary, const TimerRegistry::Node* node)
+{
+  if (node->calls == 0) return;
+  if (summary.calls == 0)
+  {
+    summary.minTime = node->minTime;
+    summary.maxTime = node->maxTime;
+  }
+  else
+  {
+    summary.minTime = min(summary.minTime, node->minTime);
+    summary.maxTime = max(summary.maxTime, node->maxTime);
+  }
+  summary.calls += node->calls;
+  summary.totalTime += node->totalTime;
+}
+
+void summarize(const TimerRegistry::Node* node, const string &parentPath,
+               map<string, TimerRegistry::RegionSummary> &summaries)
+{
+  for (auto &child : node->children)
+  {
+    string path = (parentPath == "") ? child->name : parentPath + "/" + child->name;
+    accumulate(summaries[path], child.get());
+    summarize(child.get(), path, summaries);
+  }
+}
+
+string jsonString(const string &value)
+{
+  string escaped = "\"";
+  for (char c : value)
+  {
+    if ((c == '"') || (c == '\\')) escaped += '\\';
+    escaped += c;
+  }
+  return escaped + "\"";
+}
+}
+
+void TimerRegistry::setEnabled(bool value)
+{
+  registry().enabled = value;
+}
+
+bool TimerRegistry::enabled()
+{
+  return registry().enabled.load(std::memory_order_relaxed);
+}
+
+void TimerRegistry::setRecordTrace(bool value)
+{
+  registry().recordTrace = value;
+}
+
+bool TimerRegistry::recordTrace()
+{
+  return registry().recordTrace.load(std::memory_order_relaxed);
+}
+
+void TimerRegistry::clear()
+{
+  RegistryState &state = registry();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  for (auto &timers : state.threads)
+  {
+    timers->root.children.clear();
+    timers->current = &timers->root;
+    timers->counters.clear();
+    timers->events.clear();
+  }
+}
+
+void TimerRegistry::count(const char* name, long long increment)
+{
+  if (!enabled()) return;
+  threadTimers()->counters[name] += increment;
+}
+
+TimerRegistry::Node* TimerRegistry::enter(const char* name)
+{
+  ThreadTimers* timers = threadTimers();
+  Node* parent = timers->current;
+  for (auto &child : parent->children)
+  {
+    if ((child->key == name) || (child->name == name))
+    {
+      timers->current = child.get();
+      return child.get();
+    }
+  }
+  Node* node = new Node();
+  node->key = name;
+  node->name = name;
+  node->parent = parent;
+  parent->children.push_back(unique_ptr<Node>(node));
+  timers->current = node;
+  return node;
+}
+
+void TimerRegistry::exit(Node* node, std::chrono::steady_clock::time_point start)
+{
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(end - start).count();
+
+  if (node->calls == 0)
+  {
+    node->minTime = elapsed;
+    node->maxTime = elapsed;
+  }
+  else
+  {
+    node->minTime = min(node->minTime, elapsed);
+    node->maxTime = max(node->maxTime, elapsed);
+  }
+  node->calls++;
+  node->totalTime += elapsed;
+
+  ThreadTimers* timers = threadTimers();
+  timers->current = node->parent;
+  if (recordTrace())
+  {
+    TraceEvent event;
+    event.node = node;
+    event.start = std::chrono::duration<double, std::micro>(start - registry().epoch).count();
+    event.duration = elapsed * 1e6;
+    timers->events.push_back(event);
+  }
+}
+
+map<string, TimerRegistry::RegionSummary> TimerRegistry::regionSummaries()
+{
+  RegistryState &state = registry();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  map<string, RegionSummary> summaries;
+  for (auto &timers : state.threads)
+  {
+    summarize(&timers->root, "", summaries);
+  }
+  return summaries;
+}
+
+map<string, long long> TimerRegistry::counters()
+{
+  RegistryState &state = registry();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  map<string, long long> counters;
+  for (auto &timers : state.threads)
+  {
+    for (auto &entry : timers->counters)
+    {
+      counters[entry.first] += entry.second;
+    }
+  }
+  return counters;
+}
+
+void TimerRegistry::writeJSON(std::ostream &out, const Epetra_Comm &Comm)
+{
+  map<string, RegionSummary> summaries = regionSummaries();
+  map<string, long long> myCounters = counters();
+
+  // gather the union of names across ranks; regions are prefixed by 'R', counters by 'C', and names are 0-terminated
+  Intrepid::FieldContainer<int> myNameChars;
+  vector<int> nameChars;
+  for (auto &entry : summaries)
+  {
+    nameChars.push_back('R');
+    for (char c : entry.first) nameChars.push_back((unsigned char) c);
+    nameChars.push_back(0);
+  }
+  for (auto &entry : myCounters)
+  {
+    nameChars.push_back('C');
+    for (char c : entry.first) nameChars.push_back((unsigned char) c);
+    nameChars.push_back(0);
+  }
+  if (nameChars.size() == 0) nameChars.push_back(0); // allGatherCompact requires a nonempty container
+  myNameChars.resize(nameChars.size());
+  for (int i=0; i<nameChars.size(); i++) myNameChars[i] = nameChars[i];
+
+  Intrepid::FieldContainer<int> allNameChars, offsets;
+  MPIWrapper::allGatherCompact(Comm, allNameChars, myNameChars, offsets);
+
+  set<string> regionPaths, counterNames;
+  string name;
+  for (int i=0; i<allNameChars.size(); i++)
+  {
+    if (allNameChars[i] != 0)
+    {
+      name += (char) allNameChars[i];
+      continue;
+    }
+    if (name.size() > 0)
+    {
+      if (name[0] == 'R') regionPaths.insert(name.substr(1));
+      else counterNames.insert(name.substr(1));
+    }
+    name = "";
+  }
+
+  // per-rank values, in name order: (calls, total time) for each region, then the value of each counter
+  const double noCalls = numeric_limits<double>::max();
+  int numRegions = regionPaths.size(), numCounters = counterNames.size();
+  int numValues = 2 * numRegions + numCounters;
+  vector<double> myValues(numValues,0), myMinCallTimes(numRegions,noCalls), myMaxCallTimes(numRegions,0);
+  int regionOrdinal = 0;
+  for (const string &path : regionPaths)
+  {
+    auto entry = summaries.find(path);
+    if ((entry != summaries.end()) && (entry->second.calls > 0))
+    {
+      myValues[2 * regionOrdinal    ] = entry->second.calls;
+      myValues[2 * regionOrdinal + 1] = entry->second.totalTime;
+      myMinCallTimes[regionOrdinal] = entry->second.minTime;
+      myMaxCallTimes[regionOrdinal] = entry->second.maxTime;
+    }
+    regionOrdinal++;
+  }
+  int counterOrdinal = 0;
+  for (const string &counterName : counterNames)
+  {
+    auto entry = myCounters.find(counterName);
+    if (entry != myCounters.end()) myValues[2 * numRegions + counterOrdinal] = entry->second;
+    counterOrdinal++;
+  }
+
+  vector<double> sumValues(numValues), minValues(numValues), maxValues(numValues);
+  vector<double> minCallTimes(numRegions), maxCallTimes(numRegions);
+  if (numValues > 0)
+  {
+    Comm.SumAll(&myValues[0], &sumValues[0], numValues);
+    Comm.MinAll(&myValues[0], &minValues[0], numValues);
+    Comm.MaxAll(&myValues[0], &maxValues[0], numValues);
+  }
+  if (numRegions > 0)
+  {
+    Comm.MinAll(&myMinCallTimes[0], &minCallTimes[0], numRegions);
+    Comm.MaxAll(&myMaxCallTimes[0], &maxCallTimes[0], numRegions);
+  }
+
+  if (Comm.MyPID() != 0) return;
+
+  int numRanks = Comm.NumProc();
+  std::streamsize oldPrecision = out.precision(12);
+  auto writeStatistics = [&out, numRanks, &sumValues, &minValues, &maxValues] (int valueOrdinal)
+  {
+    out << "{\"min\": " << minValues[valueOrdinal] << ", \"mean\": " << sumValues[valueOrdinal] / numRanks;
+    out << ", \"max\": " << maxValues[valueOrdinal] << "}";
+  };
+
+  out << "{\n  \"numRanks\": " << numRanks << ",\n  \"regions\": [";
+  regionOrdinal = 0;
+  for (const string &path : regionPaths)
+  {
+    out << ((regionOrdinal == 0) ? "\n" : ",\n");
+    out << "    {\"path\": " << jsonString(path) << ", \"calls\": ";
+    writeStatistics(2 * regionOrdinal);
+    out << ", \"time\": ";
+    writeStatistics(2 * regionOrdinal + 1);
+    double minCallTime = (minCallTimes[regionOrdinal] == noCalls) ? 0 : minCallTimes[regionOrdinal];
+    out << ", \"minCallTime\": " << minCallTime << ", \"maxCallTime\": " << maxCallTimes[regionOrdinal] << "}";
+    regionOrdinal++;
+  }
+  out << "\n  ],\n  \"counters\": [";
+  counterOrdinal = 0;
+  for (const string &counterName : counterNames)
+  {
+    out << ((counterOrdinal == 0) ? "\n" : ",\n");
+    out << "    {\"name\": " << jsonString(counterName) << ", \"value\": ";
+    writeStatistics(2 * numRegions + counterOrdinal);
+    out << "}";
+    counterOrdinal++;
+  }
+  out << "\n  ]\n}\n";
+  out.precision(oldPrecision);
+}
+
+void TimerRegistry::writeChromeTrace(std::ostream &out, int rank)
+{
+  RegistryState &state = registry();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  std::streamsize oldPrecision = out.precision(15);
+  out << "{\"traceEvents\": [";
+  bool first = true;
+  for (auto &timers : state.threads)
+  {
+    for (const TraceEvent &event : timers->events)
+    {
+      out << (first ? "\n" : ",\n");
+      out << "  {\"name\": " << jsonString(event.node->name) << ", \"ph\": \"X\", \"ts\": " << event.start;
+      out << ", \"dur\": " << event.duration << ", \"pid\": " << rank << ", \"tid\": " << timers->ordinal << "}";
+      first = false;
+    }
+  }
+  out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+  out.precision(oldPrecision);
+}
@@ -1,6 +1,7 @@
 #include "ConstantScalarFunction.h"
 
 #include "BasisCache.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -43,6 +44,11 @@ void ConstantScalarFunction<Scalar>::values(Intrepid::FieldContainer<Scalar> &va
   }
 }
 template <typename Scalar>
+int ConstantScalarFunction<Scalar>::compile(FunctionProgram &program)
+{
+  return program.constant(_value);
+}
+template <typename Scalar>
 void ConstantScalarFunction<Scalar>::scalarMultiplyFunctionValues(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache)
 {
   if (_value != 1.0)
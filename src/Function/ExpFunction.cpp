@@ -1,6 +1,7 @@
 #include "ExpFunction.h"
 
 #include "BasisCache.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -14,6 +15,11 @@ double Exp_x::value(double x, double y)
 {
   return exp(x);
 }
+int Exp_x::compile(FunctionProgram &program)
+{
+  if (program.spaceDim() < 2) return -1; // value() is unimplemented for fewer arguments
+  return program.unary(FunctionProgram::EXP, program.coordinate(0));
+}
 TFunctionPtr<double> Exp_x::dx()
 {
   return Teuchos::rcp( new Exp_x );
@@ -35,6 +41,10 @@ double Exp_y::value(double x, double y)
 {
   return exp(y);
 }
+int Exp_y::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::EXP, program.coordinate(1));
+}
 TFunctionPtr<double> Exp_y::dx()
 {
   return Function::zero();
@@ -56,6 +66,10 @@ double Exp_z::value(double x, double y, double z)
 {
   return exp(z);
 }
+int Exp_z::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::EXP, program.coordinate(2));
+}
 TFunctionPtr<double> Exp_z::dx()
 {
   return Function::zero();
@@ -77,6 +91,11 @@ double Exp_ax::value(double x, double y)
 {
   return exp( _a * x);
 }
+int Exp_ax::compile(FunctionProgram &program)
+{
+  if (program.spaceDim() < 2) return -1; // value() is unimplemented for fewer arguments
+  return program.unary(FunctionProgram::EXP, program.coordinate(0), _a);
+}
 TFunctionPtr<double> Exp_ax::dx()
 {
   return _a * (TFunctionPtr<double>) Teuchos::rcp(new Exp_ax(_a));
@@ -100,6 +119,10 @@ double Exp_ay::value(double x, double y)
 {
   return exp( _a * y);
 }
+int Exp_ay::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::EXP, program.coordinate(1), _a);
+}
 TFunctionPtr<double> Exp_ay::dx()
 {
   return Function::zero();
@@ -131,6 +154,11 @@ double Exp_at::value(double x, double y, double z, double t)
 {
   return exp( _a * t);
 }
+int Exp_at::compile(FunctionProgram &program)
+{
+  if (program.spaceDim() < 2) return -1; // value() is unimplemented for fewer arguments
+  return program.unary(FunctionProgram::EXP, program.coordinate(program.spaceDim() - 1), _a);
+}
 TFunctionPtr<double> Exp_at::dx()
 {
   return Function::zero();
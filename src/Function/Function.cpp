@@ -13,6 +13,7 @@
 #include "CellCharacteristicFunction.h"
 #include "ConstantScalarFunction.h"
 #include "ConstantVectorFunction.h"
+#include "FunctionProgram.h"
 #include "GlobalDofAssignment.h"
 #include "hFunction.h"
 #include "Mesh.h"
@@ -240,6 +241,42 @@ double TFunction<Scalar>::getTime()
   return _time;
 }
 
+template <typename Scalar>
+int TFunction<Scalar>::compile(FunctionProgram &program)
+{
+  return -1;
+}
+
+template <typename Scalar>
+bool TFunction<Scalar>::compiledValues(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache)
+{
+  if (!FunctionProgram::useCompiledEvaluation() || (_rank != 0) || (basisCache == Teuchos::null)) return false;
+
+  // programs are evaluated at the physical cubature points; fall back to values() if the BasisCache doesn't have them
+  const Intrepid::FieldContainer<double>* points = &basisCache->getPhysicalCubaturePoints();
+  if ((points->rank() != 3) || (points->dimension(0) != values.dimension(0)) || (points->dimension(1) != values.dimension(1)))
+  {
+    return false;
+  }
+  int spaceDim = points->dimension(2);
+  FunctionProgramPtr program;
+  // values() may be called from several threads during local stiffness computation
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaFunctionProgram)
+#endif
+  {
+    auto entryIt = _compiledPrograms.find(spaceDim);
+    if (entryIt == _compiledPrograms.end())
+    {
+      entryIt = _compiledPrograms.insert({spaceDim, FunctionProgram::compile(this, spaceDim)}).first;
+    }
+    program = entryIt->second;
+  }
+  if (program == Teuchos::null) return false;
+  program->evaluate(values, basisCache);
+  return true;
+}
+
 template <typename Scalar>
 void TFunction<Scalar>::values(Intrepid::FieldContainer<Scalar> &values, Camellia::EOperator op, BasisCachePtr basisCache)
 {
@@ -1764,9 +1801,29 @@ public:
     _f = f;
     _arg_g = arg_g;
   }
+  int compile(FunctionProgram &program)
+  {
+    // the components of _arg_g take the place of the coordinates in _f
+    int spaceDim = program.spaceDim();
+    std::vector<int> coordinates(spaceDim);
+    if (spaceDim == 1)
+    {
+      coordinates[0] = program.add(_arg_g);
+    }
+    else
+    {
+      if ((_arg_g->rank() != 1) || (spaceDim > 3)) return -1;
+      for (int d=0; d<spaceDim; d++)
+      {
+        coordinates[d] = program.add(_arg_g->spatialComponent(d+1));
+      }
+    }
+    return program.composed(_f, coordinates);
+  }
   void values(Intrepid::FieldContainer<double> &values, BasisCachePtr basisCache)
   {
     this->CHECK_VALUES_RANK(values);
+    if (this->compiledValues(values, basisCache)) return;
     int numCells = basisCache->getPhysicalCubaturePoints().dimension(0);
     int numPoints = basisCache->getPhysicalCubaturePoints().dimension(1);
     int spaceDim = basisCache->getSpaceDim();
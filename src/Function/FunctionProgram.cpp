@@ -0,0 +1,457 @@
+//
+//  FunctionProgram.cpp
+//  Camellia
+//
+//
+
+#include "FunctionProgram.h"
+
+#include "BasisCache.h"
+#include "Function.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+using namespace Camellia;
+using namespace Intrepid;
+
+namespace
+{
+const int BLOCK_SIZE = 64; // points per pass through the instructions
+
+struct Workspace
+{
+  std::vector<FieldContainer<double>> leafValues;
+  std::vector<double> registers;
+};
+
+// one workspace per nesting level, since a leaf's values() may itself evaluate a FunctionProgram
+thread_local std::vector<std::unique_ptr<Workspace>> workspaces;
+thread_local int workspaceDepth = 0;
+
+class WorkspaceGuard
+{
+  Workspace* _workspace;
+public:
+  WorkspaceGuard()
+  {
+    if (workspaces.size() <= (size_t) workspaceDepth) workspaces.push_back(std::unique_ptr<Workspace>(new Workspace));
+    _workspace = workspaces[workspaceDepth].get();
+    workspaceDepth++;
+  }
+  ~WorkspaceGuard()
+  {
+    workspaceDepth--;
+  }
+  Workspace &workspace()
+  {
+    return *_workspace;
+  }
+};
+
+double applyBinary(FunctionProgram::OpCode op, double x1, double x2)
+{
+  switch (op)
+  {
+    case FunctionProgram::ADD:
+      return x1 + x2;
+    case FunctionProgram::SUBTRACT:
+      return x1 - x2;
+    case FunctionProgram::MULTIPLY:
+      return x1 * x2;
+    case FunctionProgram::DIVIDE:
+      return x1 / x2;
+    case FunctionProgram::MIN:
+      return std::min(x1,x2);
+    case FunctionProgram::MAX:
+      return std::max(x1,x2);
+    default:
+      TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Unsupported binary op");
+  }
+  return 0;
+}
+
+double applyUnary(FunctionProgram::OpCode op, double x, double a, double b)
+{
+  switch (op)
+  {
+    case FunctionProgram::SQRT:
+      return sqrt(x);
+    case FunctionProgram::SIN:
+      return sin(a * x + b);
+    case FunctionProgram::COS:
+      return cos(a * x + b);
+    case FunctionProgram::EXP:
+      return exp(a * x + b);
+    case FunctionProgram::ARCTAN:
+      return atan(a * x + b);
+    default:
+      TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Unsupported unary op");
+  }
+  return 0;
+}
+}
+
+bool FunctionProgram::_useCompiledEvaluation = true;
+
+FunctionProgram::FunctionProgram(int spaceDim)
+{
+  _spaceDim = spaceDim;
+}
+
+int FunctionProgram::spaceDim() const
+{
+  return _spaceDim;
+}
+
+int FunctionProgram::addInstruction(OpCode op, int arg1, int arg2, double a, double b)
+{
+  InstructionKey key(op, arg1, arg2, a, b);
+  auto entryIt = _instructionRegisters.find(key);
+  if (entryIt != _instructionRegisters.end()) return entryIt->second;
+
+  Instruction instruction;
+  instruction.op = op;
+  instruction.arg1 = arg1;
+  instruction.arg2 = arg2;
+  instruction.a = a;
+  instruction.b = b;
+  int reg = _instructions.size();
+  _instructions.push_back(instruction);
+  _instructionRegisters[key] = reg;
+  return reg;
+}
+
+bool FunctionProgram::isConstant(int reg) const
+{
+  return _instructions[reg].op == CONSTANT;
+}
+
+int FunctionProgram::add(TFunctionPtr<double> f)
+{
+  if ((f.get() == NULL) || (f->rank() != 0)) return -1;
+
+  bool substituting = !_coordinateSubstitutions.empty();
+  if (!substituting)
+  {
+    auto entryIt = _functionRegisters.find(f.get());
+    if (entryIt != _functionRegisters.end()) return entryIt->second;
+  }
+
+  int reg = f->compile(*this);
+  if (reg < 0)
+  {
+    if (substituting) return -1;
+    int leafOrdinal = _leaves.size();
+    _leaves.push_back(f);
+    reg = addInstruction(LEAF, leafOrdinal, -1, 0, 0);
+  }
+  if (!substituting)
+  {
+    _functionRegisters[f.get()] = reg;
+    _compiledFunctions.push_back(f); // keeps the address in _functionRegisters from being reused during compilation
+  }
+  return reg;
+}
+
+int FunctionProgram::constant(double value)
+{
+  return addInstruction(CONSTANT, -1, -1, value, 0);
+}
+
+int FunctionProgram::coordinate(int d)
+{
+  if ((d < 0) || (d >= _spaceDim)) return -1;
+  if (!_coordinateSubstitutions.empty()) return _coordinateSubstitutions.back()[d];
+  return addInstruction(COORDINATE, d, -1, 0, 0);
+}
+
+int FunctionProgram::binary(OpCode op, int arg1, int arg2)
+{
+  if ((arg1 < 0) || (arg2 < 0)) return -1;
+  if (isConstant(arg1) && isConstant(arg2))
+  {
+    return constant(applyBinary(op, _instructions[arg1].a, _instructions[arg2].a));
+  }
+  // multiplication and division by one are exact no-ops
+  if (((op == MULTIPLY) || (op == DIVIDE)) && isConstant(arg2) && (_instructions[arg2].a == 1.0)) return arg1;
+  if ((op == MULTIPLY) && isConstant(arg1) && (_instructions[arg1].a == 1.0)) return arg2;
+  if (((op == ADD) || (op == MULTIPLY)) && (arg2 < arg1)) std::swap(arg1, arg2); // so that x + y and y + x are shared
+  return addInstruction(op, arg1, arg2, 0, 0);
+}
+
+int FunctionProgram::power(int arg, int n)
+{
+  if (arg < 0) return -1;
+  if (isConstant(arg)) return constant(pow(_instructions[arg].a, n));
+  if (n == 0) return constant(1.0);
+  if (n == 1) return arg;
+  return addInstruction(POWER, arg, n, 0, 0);
+}
+
+int FunctionProgram::unary(OpCode op, int arg, double a, double b)
+{
+  if (arg < 0) return -1;
+  if (isConstant(arg)) return constant(applyUnary(op, _instructions[arg].a, a, b));
+  if (op == SQRT)
+  {
+    a = 1.0;
+    b = 0.0;
+  }
+  return addInstruction(op, arg, -1, a, b);
+}
+
+int FunctionProgram::composed(TFunctionPtr<double> f, const std::vector<int> &coordinateRegisters)
+{
+  if (coordinateRegisters.size() != _spaceDim) return -1;
+  for (int reg : coordinateRegisters)
+  {
+    if (reg < 0) return -1;
+  }
+  _coordinateSubstitutions.push_back(coordinateRegisters);
+  int reg = add(f);
+  _coordinateSubstitutions.pop_back();
+  return reg;
+}
+
+void FunctionProgram::finalize(int resultRegister)
+{
+  // mark the instructions the result depends on
+  int numInstructions = _instructions.size();
+  std::vector<bool> live(numInstructions, false);
+  live[resultRegister] = true;
+  for (int i=numInstructions-1; i>=0; i--)
+  {
+    if (!live[i]) continue;
+    const Instruction &instruction = _instructions[i];
+    switch (instruction.op)
+    {
+      case CONSTANT:
+      case COORDINATE:
+      case LEAF:
+        break;
+      case POWER:
+      case SQRT:
+      case SIN:
+      case COS:
+      case EXP:
+      case ARCTAN:
+        live[instruction.arg1] = true;
+        break;
+      default:
+        live[instruction.arg1] = true;
+        live[instruction.arg2] = true;
+        break;
+    }
+  }
+
+  // renumber registers and leaves, dropping the rest
+  std::vector<int> newRegister(numInstructions, -1);
+  std::vector<Instruction> instructions;
+  std::vector<TFunctionPtr<double>> leaves;
+  for (int i=0; i<numInstructions; i++)
+  {
+    if (!live[i]) continue;
+    Instruction instruction = _instructions[i];
+    switch (instruction.op)
+    {
+      case CONSTANT:
+      case COORDINATE:
+        break;
+      case LEAF:
+        leaves.push_back(_leaves[instruction.arg1]);
+        instruction.arg1 = leaves.size() - 1;
+        break;
+      case POWER:
+      case SQRT:
+      case SIN:
+      case COS:
+      case EXP:
+      case ARCTAN:
+        instruction.arg1 = newRegister[instruction.arg1];
+        break;
+      default:
+        instruction.arg1 = newRegister[instruction.arg1];
+        instruction.arg2 = newRegister[instruction.arg2];
+        break;
+    }
+    newRegister[i] = instructions.size();
+    instructions.push_back(instruction);
+  }
+  _instructions = instructions;
+  _leaves = leaves;
+  _result = newRegister[resultRegister];
+
+  // construction state is no longer needed
+  _instructionRegisters.clear();
+  _functionRegisters.clear();
+  _compiledFunctions.clear();
+}
+
+void FunctionProgram::evaluate(FieldContainer<double> &values, BasisCachePtr basisCache)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(_result < 0, std::invalid_argument, "FunctionProgram has not been compiled");
+  TEUCHOS_TEST_FOR_EXCEPTION(values.rank() != 2, std::invalid_argument, "values must have shape (C,P)");
+  const FieldContainer<double>* points = &basisCache->getPhysicalCubaturePoints();
+  int numCells = values.dimension(0);
+  int numPoints = values.dimension(1);
+  TEUCHOS_TEST_FOR_EXCEPTION(points->dimension(1) != numPoints, std::invalid_argument,
+                             "numPoints in values container does not match that in BasisCache's physical points.");
+  TEUCHOS_TEST_FOR_EXCEPTION(points->dimension(2) != _spaceDim, std::invalid_argument,
+                             "FunctionProgram was compiled for a different spatial dimension than the BasisCache's.");
+
+  int numValues = numCells * numPoints;
+  if (numValues == 0) return;
+
+  WorkspaceGuard guard;
+  Workspace &workspace = guard.workspace();
+
+  int numLeaves = _leaves.size();
+  if (workspace.leafValues.size() < numLeaves) workspace.leafValues.resize(numLeaves);
+  for (int leafOrdinal=0; leafOrdinal<numLeaves; leafOrdinal++)
+  {
+    FieldContainer<double>* leafValues = &workspace.leafValues[leafOrdinal];
+    if ((leafValues->rank() != 2) || (leafValues->dimension(0) != numCells) || (leafValues->dimension(1) != numPoints))
+    {
+      leafValues->resize(numCells, numPoints);
+    }
+    _leaves[leafOrdinal]->values(*leafValues, basisCache);
+  }
+
+  int numInstructions = _instructions.size();
+  if (workspace.registers.size() < numInstructions * BLOCK_SIZE) workspace.registers.resize(numInstructions * BLOCK_SIZE);
+  double* registers = &workspace.registers[0];
+
+  // constants do not change from block to block
+  for (int i=0; i<numInstructions; i++)
+  {
+    if (_instructions[i].op == CONSTANT)
+    {
+      std::fill(registers + i * BLOCK_SIZE, registers + (i + 1) * BLOCK_SIZE, _instructions[i].a);
+    }
+  }
+
+  const double* pointValues = &(*points)[0];
+  double* resultValues = &values[0];
+  for (int start=0; start<numValues; start += BLOCK_SIZE)
+  {
+    int n = std::min(BLOCK_SIZE, numValues - start);
+    for (int i=0; i<numInstructions; i++)
+    {
+      const Instruction &instruction = _instructions[i];
+      double* r = registers + i * BLOCK_SIZE;
+      switch (instruction.op)
+      {
+        case CONSTANT:
+          break;
+        case COORDINATE:
+        {
+          const double* coordinates = pointValues + start * _spaceDim + instruction.arg1;
+          for (int j=0; j<n; j++) r[j] = coordinates[j * _spaceDim];
+        }
+        break;
+        case LEAF:
+        {
+          const double* leafValues = &workspace.leafValues[instruction.arg1][start];
+          std::copy(leafValues, leafValues + n, r);
+        }
+        break;
+        case ADD:
+        case SUBTRACT:
+        case MULTIPLY:
+        case DIVIDE:
+        case MIN:
+        case MAX:
+        {
+          const double* x1 = registers + instruction.arg1 * BLOCK_SIZE;
+          const double* x2 = registers + instruction.arg2 * BLOCK_SIZE;
+          switch (instruction.op)
+          {
+            case ADD:
+              for (int j=0; j<n; j++) r[j] = x1[j] + x2[j];
+              break;
+            case SUBTRACT:
+              for (int j=0; j<n; j++) r[j] = x1[j] - x2[j];
+              break;
+            case MULTIPLY:
+              for (int j=0; j<n; j++) r[j] = x1[j] * x2[j];
+              break;
+            case DIVIDE:
+              for (int j=0; j<n; j++) r[j] = x1[j] / x2[j];
+              break;
+            case MIN:
+              for (int j=0; j<n; j++) r[j] = std::min(x1[j], x2[j]);
+              break;
+            default: // MAX
+              for (int j=0; j<n; j++) r[j] = std::max(x1[j], x2[j]);
+              break;
+          }
+        }
+        break;
+        default:
+        {
+          const double* x = registers + instruction.arg1 * BLOCK_SIZE;
+          double a = instruction.a, b = instruction.b;
+          switch (instruction.op)
+          {
+            case POWER:
+            {
+              int exponent = instruction.arg2;
+              for (int j=0; j<n; j++) r[j] = pow(x[j], exponent);
+            }
+            break;
+            case SQRT:
+              for (int j=0; j<n; j++) r[j] = sqrt(x[j]);
+              break;
+            case SIN:
+              for (int j=0; j<n; j++) r[j] = sin(a * x[j] + b);
+              break;
+            case COS:
+              for (int j=0; j<n; j++) r[j] = cos(a * x[j] + b);
+              break;
+            case EXP:
+              for (int j=0; j<n; j++) r[j] = exp(a * x[j] + b);
+              break;
+            default: // ARCTAN
+              for (int j=0; j<n; j++) r[j] = atan(a * x[j] + b);
+              break;
+          }
+        }
+        break;
+      }
+    }
+    const double* result = registers + _result * BLOCK_SIZE;
+    std::copy(result, result + n, resultValues + start);
+  }
+}
+
+int FunctionProgram::numInstructions() const
+{
+  return _instructions.size();
+}
+
+int FunctionProgram::numLeaves() const
+{
+  return _leaves.size();
+}
+
+FunctionProgramPtr FunctionProgram::compile(TFunction<double>* f, int spaceDim)
+{
+  if (f->rank() != 0) return Teuchos::null;
+  FunctionProgramPtr program = Teuchos::rcp( new FunctionProgram(spaceDim) );
+  int result = f->compile(*program);
+  if (result < 0) return Teuchos::null;
+  program->finalize(result);
+  return program;
+}
+
+void FunctionProgram::setUseCompiledEvaluation(bool value)
+{
+  _useCompiledEvaluation = value;
+}
+
+bool FunctionProgram::useCompiledEvaluation()
+{
+  return _useCompiledEvaluation;
+}
@@ -1,6 +1,7 @@
 #include "MinMaxFunctions.h"
 
 #include "BasisCache.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -29,6 +30,7 @@ string MinFunction::displayString()
 void MinFunction::values(Intrepid::FieldContainer<double> &values, BasisCachePtr basisCache)
 {
   this->CHECK_VALUES_RANK(values);
+  if (this->compiledValues(values, basisCache)) return;
   Intrepid::FieldContainer<double> values2(values);
   _f1->values(values,basisCache);
   _f2->values(values2,basisCache);
@@ -38,6 +40,12 @@ void MinFunction::values(Intrepid::FieldContainer<double> &values, BasisCachePtr
   }
 }
 
+int MinFunction::compile(FunctionProgram &program)
+{
+  if (this->rank() != 0) return -1;
+  return program.binary(FunctionProgram::MIN, program.add(_f1), program.add(_f2));
+}
+
 TFunctionPtr<double> MinFunction::x()
 {
   if ( (_f1->x().get() == NULL) || (_f2->x().get() == NULL) )
@@ -87,6 +95,7 @@ string MaxFunction::displayString()
 void MaxFunction::values(Intrepid::FieldContainer<double> &values, BasisCachePtr basisCache)
 {
   this->CHECK_VALUES_RANK(values);
+  if (this->compiledValues(values, basisCache)) return;
   Intrepid::FieldContainer<double> values2(values);
   _f1->values(values,basisCache);
   _f2->values(values2,basisCache);
@@ -96,6 +105,12 @@ void MaxFunction::values(Intrepid::FieldContainer<double> &values, BasisCachePtr
   }
 }
 
+int MaxFunction::compile(FunctionProgram &program)
+{
+  if (this->rank() != 0) return -1;
+  return program.binary(FunctionProgram::MAX, program.add(_f1), program.add(_f2));
+}
+
 TFunctionPtr<double> MaxFunction::x()
 {
   if ( (_f1->x().get() == NULL) || (_f2->x().get() == NULL) )
@@ -1,6 +1,7 @@
 #include "MonomialFunctions.h"
 
 #include "BasisCache.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -31,6 +32,10 @@ double Xn::value(double x)
 {
   return pow(x,_n);
 }
+int Xn::compile(FunctionProgram &program)
+{
+  return program.power(program.coordinate(0), _n);
+}
 TFunctionPtr<double> Xn::dx()
 {
   if (_n == 0)
@@ -82,6 +87,10 @@ double Yn::value(double x, double y)
 {
   return pow(y,_n);
 }
+int Yn::compile(FunctionProgram &program)
+{
+  return program.power(program.coordinate(1), _n);
+}
 
 TFunctionPtr<double> Yn::dx()
 {
@@ -134,6 +143,10 @@ double Zn::value(double x, double y, double z)
 {
   return pow(z,_n);
 }
+int Zn::compile(FunctionProgram &program)
+{
+  return program.power(program.coordinate(2), _n);
+}
 
 TFunctionPtr<double> Zn::dx()
 {
@@ -194,6 +207,11 @@ double Tn::value(double x, double y, double z, double t)
 {
   return pow(t,_n);
 }
+int Tn::compile(FunctionProgram &program)
+{
+  if (program.spaceDim() < 2) return -1; // value() is unimplemented for fewer arguments
+  return program.power(program.coordinate(program.spaceDim() - 1), _n);
+}
 
 TFunctionPtr<double> Tn::dx()
 {
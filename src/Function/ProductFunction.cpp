@@ -2,6 +2,7 @@
 
 #include "BasisCache.h"
 #include "ConstantScalarFunction.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -189,6 +190,7 @@ template <typename Scalar>
 void ProductFunction<Scalar>::values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache)
 {
   this->CHECK_VALUES_RANK(values);
+  if (this->compiledValues(values, basisCache)) return;
   if (( _f2->rank() > 0) && (this->rank() == 0))   // tensor product resulting in scalar value
   {
     _f2->valuesDottedWithTensor(values, _f1, basisCache);
@@ -200,6 +202,13 @@ void ProductFunction<Scalar>::values(Intrepid::FieldContainer<Scalar> &values, B
   }
 }
 
+template <typename Scalar>
+int ProductFunction<Scalar>::compile(FunctionProgram &program)
+{
+  if (_f2->rank() != 0) return -1; // then _f1 has rank 0, too
+  return program.binary(FunctionProgram::MULTIPLY, program.add(_f1), program.add(_f2));
+}
+
 namespace Camellia
 {
 template class ProductFunction<double>;
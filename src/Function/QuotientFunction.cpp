@@ -1,6 +1,7 @@
 #include "QuotientFunction.h"
 
 #include "BasisCache.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -38,10 +39,18 @@ template <typename Scalar>
 void QuotientFunction<Scalar>::values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache)
 {
   this->CHECK_VALUES_RANK(values);
+  if (this->compiledValues(values, basisCache)) return;
   _f->values(values,basisCache);
   _scalarDivisor->scalarDivideFunctionValues(values, basisCache);
 }
 
+template <typename Scalar>
+int QuotientFunction<Scalar>::compile(FunctionProgram &program)
+{
+  if (this->rank() != 0) return -1;
+  return program.binary(FunctionProgram::DIVIDE, program.add(_f), program.add(_scalarDivisor));
+}
+
 template <typename Scalar>
 TFunctionPtr<Scalar> QuotientFunction<Scalar>::dx()
 {
@@ -1,6 +1,7 @@
 #include "SumFunction.h"
 
 #include "BasisCache.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -32,10 +33,18 @@ template <typename Scalar>
 void SumFunction<Scalar>::values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache)
 {
   this->CHECK_VALUES_RANK(values);
+  if (this->compiledValues(values, basisCache)) return;
   _f1->values(values,basisCache);
   _f2->addToValues(values,basisCache);
 }
 
+template <typename Scalar>
+int SumFunction<Scalar>::compile(FunctionProgram &program)
+{
+  if (this->rank() != 0) return -1;
+  return program.binary(FunctionProgram::ADD, program.add(_f1), program.add(_f2));
+}
+
 template <typename Scalar>
 TFunctionPtr<Scalar> SumFunction<Scalar>::x()
 {
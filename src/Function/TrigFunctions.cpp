@@ -3,6 +3,7 @@
 // TODO: move this to TrigFunctions.h/cpp
 
 #include "BasisCache.h"
+#include "FunctionProgram.h"
 
 using namespace Camellia;
 using namespace Intrepid;
@@ -17,6 +18,10 @@ double Sin_y::value(double x, double y)
 {
   return sin(y);
 }
+int Sin_y::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::SIN, program.coordinate(1));
+}
 TFunctionPtr<double> Sin_y::dx()
 {
   return TFunction<double>::zero();
@@ -38,6 +43,10 @@ double Cos_y::value(double x, double y)
 {
   return cos(y);
 }
+int Cos_y::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::COS, program.coordinate(1));
+}
 TFunctionPtr<double> Cos_y::dx()
 {
   return TFunction<double>::zero();
@@ -61,6 +70,11 @@ double Sin_x::value(double x, double y)
 {
   return sin(x);
 }
+int Sin_x::compile(FunctionProgram &program)
+{
+  if (program.spaceDim() < 2) return -1; // value() is unimplemented for fewer arguments
+  return program.unary(FunctionProgram::SIN, program.coordinate(0));
+}
 TFunctionPtr<double> Sin_x::dx()
 {
   return Teuchos::rcp( new Cos_x );
@@ -82,6 +96,11 @@ double Cos_x::value(double x, double y)
 {
   return cos(x);
 }
+int Cos_x::compile(FunctionProgram &program)
+{
+  if (program.spaceDim() < 2) return -1; // value() is unimplemented for fewer arguments
+  return program.unary(FunctionProgram::COS, program.coordinate(0));
+}
 TFunctionPtr<double> Cos_x::dx()
 {
   TFunctionPtr<double> sin_x = Teuchos::rcp( new Sin_x );
@@ -105,6 +124,10 @@ double Cos_ax::value(double x)
 {
   return cos( _a * x + _b);
 }
+int Cos_ax::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::COS, program.coordinate(0), _a, _b);
+}
 TFunctionPtr<double> Cos_ax::dx()
 {
   return -_a * (TFunctionPtr<double>) Teuchos::rcp(new Sin_ax(_a,_b));
@@ -129,6 +152,10 @@ double Cos_ay::value(double x, double y)
 {
   return cos( _a * y );
 }
+int Cos_ay::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::COS, program.coordinate(1), _a);
+}
 TFunctionPtr<double> Cos_ay::dx()
 {
   return TFunction<double>::zero();
@@ -155,6 +182,10 @@ double Sin_ax::value(double x)
 {
   return sin( _a * x + _b);
 }
+int Sin_ax::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::SIN, program.coordinate(0), _a, _b);
+}
 TFunctionPtr<double> Sin_ax::dx()
 {
   return _a * (TFunctionPtr<double>) Teuchos::rcp(new Cos_ax(_a,_b));
@@ -178,6 +209,10 @@ double Sin_ay::value(double x, double y)
 {
   return sin( _a * y);
 }
+int Sin_ay::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::SIN, program.coordinate(1), _a);
+}
 TFunctionPtr<double> Sin_ay::dx()
 {
   return TFunction<double>::zero();
@@ -202,6 +237,10 @@ double ArcTan_ax::value(double x)
 {
   return atan( _a * x + _b);
 }
+int ArcTan_ax::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::ARCTAN, program.coordinate(0), _a, _b);
+}
 TFunctionPtr<double> ArcTan_ax::dx()
 {
   TFunctionPtr<double> one = TFunction<double>::constant(1);
@@ -228,6 +267,10 @@ double ArcTan_ay::value(double x, double y)
 {
   return atan( _a * y + _b);
 }
+int ArcTan_ay::compile(FunctionProgram &program)
+{
+  return program.unary(FunctionProgram::ARCTAN, program.coordinate(1), _a, _b);
+}
 TFunctionPtr<double> ArcTan_ay::dx()
 {
   return TFunction<double>::zero();
@@ -0,0 +1,255 @@
+#include "AsyncHDF5Exporter.h"
+
+#include "EpetraExt_ConfigDefs.h"
+#ifdef HAVE_EPETRAEXT_HDF5
+
+#include "Mesh.h"
+#include "Solution.h"
+
+using namespace Camellia;
+
+AsyncHDF5Exporter::AsyncHDF5Exporter(MeshPtr mesh, string outputDirName, string outputDirSuperPath,
+                                     int maxPendingExports, size_t memoryBudgetInBytes)
+  : _exporter(mesh, outputDirName, outputDirSuperPath)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(maxPendingExports < 1, std::invalid_argument, "maxPendingExports must be at least 1");
+  _mesh = mesh.create_weak();
+  _maxPendingExports = maxPendingExports;
+  _memoryBudget = memoryBudgetInBytes;
+  _dropWhenFull = false;
+  _pendingMemory = 0;
+  _stopping = false;
+  _droppedExportCount = 0;
+
+  Teuchos::RCP<RefinementObserver> thisObserver = Teuchos::rcp(this,false); // weak RCP
+  _mesh->registerObserver(thisObserver);
+
+  _writerThread = std::thread(&AsyncHDF5Exporter::writerLoop, this);
+}
+
+AsyncHDF5Exporter::~AsyncHDF5Exporter()
+{
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _jobAvailable.notify_all();
+  _writerThread.join(); // the writer finishes the queued jobs before exiting
+
+  if (_writerError != "")
+  {
+    cout << "WARNING: AsyncHDF5Exporter writer thread failed: " << _writerError << endl;
+  }
+
+  if (_mesh.is_valid_ptr())
+  {
+    _mesh->unregisterObserver(this);
+  }
+}
+
+bool AsyncHDF5Exporter::enqueue(ExportJob &job)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  throwWriterError();
+
+  auto isFull = [this, &job]
+  {
+    if (_queue.size() >= _maxPendingExports) return true;
+    return !_queue.empty() && (_pendingMemory + job.memoryFootprint > _memoryBudget);
+  };
+  if (isFull())
+  {
+    if (_dropWhenFull)
+    {
+      _droppedExportCount++;
+      return false;
+    }
+    _jobFinished.wait(lock, [this, &isFull] { return !isFull() || (_writerError != ""); });
+    throwWriterError();
+  }
+
+  _pendingMemory += job.memoryFootprint;
+  _queue.push_back(std::move(job));
+  _jobAvailable.notify_one();
+  return true;
+}
+
+bool AsyncHDF5Exporter::exportSolution(TSolutionPtr<double> solution, double timeVal, unsigned int defaultNum1DPts,
+                                       HDF5Exporter::map_int_int cellIDToNum1DPts, set<GlobalIndexType> cellIndices)
+{
+  throwPendingWriterError();
+
+  vector<TFunctionPtr<double>> fieldFunctions, traceFunctions;
+  vector<string> fieldFunctionNames, traceFunctionNames;
+  _exporter.getSolutionFunctions(solution, fieldFunctions, fieldFunctionNames, traceFunctions, traceFunctionNames);
+
+  ExportJob job;
+  job.memoryFootprint = 0;
+  if (fieldFunctions.size() > 0)
+  {
+    job.exports.push_back(_exporter.prepareExport(fieldFunctions, fieldFunctionNames, timeVal, defaultNum1DPts,
+                                                  cellIDToNum1DPts, cellIndices));
+    job.memoryFootprint += job.exports.back().memoryFootprint();
+  }
+  if (traceFunctions.size() > 0)
+  {
+    job.exports.push_back(_exporter.prepareExport(traceFunctions, traceFunctionNames, timeVal, defaultNum1DPts,
+                                                  cellIDToNum1DPts, cellIndices));
+    job.memoryFootprint += job.exports.back().memoryFootprint();
+  }
+
+  return enqueue(job);
+}
+
+bool AsyncHDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector<string> functionNames, double timeVal,
+                                       unsigned int defaultNum1DPts, HDF5Exporter::map_int_int cellIDToNum1DPts,
+                                       set<GlobalIndexType> cellIndices)
+{
+  throwPendingWriterError();
+
+  ExportJob job;
+  job.exports.push_back(_exporter.prepareExport(functions, functionNames, timeVal, defaultNum1DPts, cellIDToNum1DPts, cellIndices));
+  job.memoryFootprint = job.exports.back().memoryFootprint();
+
+  return enqueue(job);
+}
+
+void AsyncHDF5Exporter::flush()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _jobFinished.wait(lock, [this] { return _queue.empty() || (_writerError != ""); });
+  throwWriterError();
+}
+
+void AsyncHDF5Exporter::throwPendingWriterError()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  throwWriterError();
+}
+
+void AsyncHDF5Exporter::throwWriterError()
+{
+  if (_writerError != "")
+  {
+    string message = "AsyncHDF5Exporter writer thread failed: " + _writerError;
+    _writerError = "";
+    TEUCHOS_TEST_FOR_EXCEPTION(true, std::runtime_error, message);
+  }
+}
+
+void AsyncHDF5Exporter::writerLoop()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true)
+  {
+    _jobAvailable.wait(lock, [this] { return _stopping || !_queue.empty(); });
+    if (_queue.empty()) break; // stopping, and nothing left to write
+
+    // the job stays at the front of the queue (and counts against the limits) until it has been written
+    ExportJob* job = &_queue.front();
+    lock.unlock();
+    try
+    {
+      for (const HDF5Exporter::ExportData &exportData : job->exports)
+      {
+        _exporter.writeExport(exportData);
+      }
+    }
+    catch (std::exception &e)
+    {
+      lock.lock();
+      if (_writerError == "") _writerError = e.what();
+      lock.unlock();
+    }
+    lock.lock();
+    _pendingMemory -= job->memoryFootprint;
+    _queue.pop_front();
+    _jobFinished.notify_all();
+  }
+}
+
+int AsyncHDF5Exporter::numPendingExports()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _queue.size();
+}
+
+size_t AsyncHDF5Exporter::pendingMemory()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _pendingMemory;
+}
+
+int AsyncHDF5Exporter::droppedExportCount()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _droppedExportCount;
+}
+
+int AsyncHDF5Exporter::maxPendingExports()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _maxPendingExports;
+}
+
+void AsyncHDF5Exporter::setMaxPendingExports(int value)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(value < 1, std::invalid_argument, "maxPendingExports must be at least 1");
+  std::unique_lock<std::mutex> lock(_mutex);
+  _maxPendingExports = value;
+}
+
+size_t AsyncHDF5Exporter::memoryBudget()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _memoryBudget;
+}
+
+void AsyncHDF5Exporter::setMemoryBudget(size_t memoryBudgetInBytes)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _memoryBudget = memoryBudgetInBytes;
+}
+
+void AsyncHDF5Exporter::setDropWhenFull(bool value)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _dropWhenFull = value;
+}
+
+void AsyncHDF5Exporter::setNumThreads(int numThreads)
+{
+  _exporter.setNumThreads(numThreads);
+}
+
+void AsyncHDF5Exporter::setCellBatchSize(int cellBatchSize)
+{
+  _exporter.setCellBatchSize(cellBatchSize);
+}
+
+void AsyncHDF5Exporter::setUseSinglePrecision(bool value)
+{
+  _exporter.setUseSinglePrecision(value);
+}
+
+void AsyncHDF5Exporter::setCompressionLevel(int level)
+{
+  _exporter.setCompressionLevel(level);
+}
+
+void AsyncHDF5Exporter::hRefine(const set<GlobalIndexType> &cellIDs, Teuchos::RCP<RefinementPattern> refPattern)
+{
+  flush();
+}
+
+void AsyncHDF5Exporter::pRefine(const set<GlobalIndexType> &cellIDs)
+{
+  flush();
+}
+
+void AsyncHDF5Exporter::hUnrefine(const set<GlobalIndexType> &cellIDs)
+{
+  flush();
+}
+
+#endif
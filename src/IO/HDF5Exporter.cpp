@@ -14,18 +14,125 @@
 #endif
 
 #include "Epetra_SerialComm.h"
-#include "EpetraExt_HDF5.h"
+#include "hdf5.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
 
 #include "CellTopology.h"
+#include "MPIWrapper.h"
 
 using namespace Camellia;
 
+namespace
+{
+const hsize_t HDF5_CHUNK_SIZE = 64 * 1024; // entries per chunk for compressed datasets
+
+// Writes localSize entries of a 1D dataset, starting at localOffset within a dataset of globalSize entries.  When each
+// rank writes its own file, localOffset = 0 and localSize = globalSize.  When all ranks share a file, each rank must
+// call this for each dataset, in the same order, with collective = true.
+void writeDataset(hid_t fileID, const string &datasetPath, hid_t memType, hid_t fileType, const void* data,
+                  hsize_t localSize, hsize_t localOffset, hsize_t globalSize, int compressionLevel, bool collective)
+{
+  hid_t fileSpace = H5Screate_simple(1, &globalSize, NULL);
+  hid_t createProps = H5Pcreate(H5P_DATASET_CREATE);
+  if ((compressionLevel > 0) && (globalSize > 0))
+  {
+    hsize_t chunkSize = std::min(globalSize, HDF5_CHUNK_SIZE);
+    H5Pset_chunk(createProps, 1, &chunkSize);
+    H5Pset_deflate(createProps, compressionLevel);
+  }
+  hid_t dataset = H5Dcreate2(fileID, datasetPath.c_str(), fileType, fileSpace, H5P_DEFAULT, createProps, H5P_DEFAULT);
+  H5Pclose(createProps);
+  TEUCHOS_TEST_FOR_EXCEPTION(dataset < 0, std::runtime_error, "Failed to create HDF5 dataset " + datasetPath);
+
+  hid_t memSpace = H5Screate_simple(1, &localSize, NULL);
+  if (localSize > 0)
+  {
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &localOffset, NULL, &localSize, NULL);
+  }
+  else
+  {
+    // ranks without data still take part in collective writes
+    H5Sselect_none(fileSpace);
+    H5Sselect_none(memSpace);
+  }
+
+  hid_t transferProps = H5Pcreate(H5P_DATASET_XFER);
+#ifdef H5_HAVE_PARALLEL
+  if (collective)
+    H5Pset_dxpl_mpio(transferProps, H5FD_MPIO_COLLECTIVE);
+#endif
+  static const double dummy = 0; // HDF5 requires a non-null buffer even for empty selections
+  herr_t status = H5Dwrite(dataset, memType, memSpace, fileSpace, transferProps, (localSize > 0) ? data : &dummy);
+
+  H5Pclose(transferProps);
+  H5Sclose(memSpace);
+  H5Sclose(fileSpace);
+  H5Dclose(dataset);
+  TEUCHOS_TEST_FOR_EXCEPTION(status < 0, std::runtime_error, "Failed to write HDF5 dataset " + datasetPath);
+}
+
+// Adds an XDMF DataItem referring to this rank's portion of an HDF5 dataset.  If that portion is the whole dataset,
+// this is a plain Uniform DataItem; otherwise it is a HyperSlab selection from the full dataset.
+void addHDFDataItem(Teuchos::XMLObject &parent, const string &numberType, int precision, hsize_t localSize,
+                    hsize_t localOffset, hsize_t globalSize, const string &h5Path)
+{
+  Teuchos::XMLObject dataItem("DataItem");
+  parent.addChild(dataItem);
+  if ((localOffset == 0) && (localSize == globalSize))
+  {
+    dataItem.addAttribute("ItemType", "Uniform");
+    dataItem.addAttribute("Format", "HDF");
+    dataItem.addAttribute("NumberType", numberType);
+    dataItem.addInt("Precision", precision);
+    dataItem.addInt("Dimensions", localSize);
+    dataItem.addContent(h5Path);
+  }
+  else
+  {
+    dataItem.addAttribute("ItemType", "HyperSlab");
+    dataItem.addAttribute("Type", "HyperSlab");
+    dataItem.addInt("Dimensions", localSize);
+
+    Teuchos::XMLObject selection("DataItem");
+    dataItem.addChild(selection);
+    selection.addAttribute("Dimensions", "3 1");
+    selection.addAttribute("Format", "XML");
+    stringstream startStrideCount;
+    startStrideCount << localOffset << " 1 " << localSize;
+    selection.addContent(startStrideCount.str());
+
+    Teuchos::XMLObject source("DataItem");
+    dataItem.addChild(source);
+    source.addAttribute("Format", "HDF");
+    source.addAttribute("NumberType", numberType);
+    source.addInt("Precision", precision);
+    source.addInt("Dimensions", globalSize);
+    source.addContent(h5Path);
+  }
+}
+
+// copies the cellOrdinal slice of batchValues, with dimensions (C,...), into cellValues, with dimensions (1,...)
+void copyCellValues(Intrepid::FieldContainer<double> &cellValues, const Intrepid::FieldContainer<double> &batchValues,
+                    int cellOrdinal)
+{
+  Teuchos::Array<int> dim;
+  batchValues.dimensions(dim);
+  int valuesPerCell = batchValues.size() / dim[0];
+  dim[0] = 1;
+  cellValues.resize(dim);
+  for (int i=0; i<valuesPerCell; i++)
+  {
+    cellValues[i] = batchValues[cellOrdinal * valuesPerCell + i];
+  }
+}
+}
+
 HDF5Exporter::HDF5Exporter(MeshPtr mesh, string outputDirName, string outputDirSuperPath) : _mesh(mesh), _dirName(outputDirName),
   _dirSuperPath(outputDirSuperPath), _fieldXdmf("Xdmf"), _traceXdmf("Xdmf"),
-  _fieldDomain("Domain"), _traceDomain("Domain"), _fieldGrids("Grid"), _traceGrids("Grid")
+  _fieldDomain("Domain"), _traceDomain("Domain"), _fieldGrids("Grid"), _traceGrids("Grid"),
+  _numThreads(1), _cellBatchSize(64), _useParallelHDF5(false), _useSinglePrecision(false), _compressionLevel(0)
 {
   int commRank = Teuchos::GlobalMPISession::getRank();
 
@@ -76,7 +183,46 @@ HDF5Exporter::~HDF5Exporter()
 {
 }
 
-void HDF5Exporter::exportSolution(TSolutionPtr<double> solution, double timeVal, unsigned int defaultNum1DPts, map<int, int> cellIDToNum1DPts, set<GlobalIndexType> cellIndices)
+void HDF5Exporter::setNumThreads(int numThreads)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(numThreads < 1, std::invalid_argument, "numThreads must be at least 1");
+#ifndef _OPENMP
+  if ((numThreads > 1) && (Teuchos::GlobalMPISession::getRank() == 0))
+  {
+    cout << "WARNING: Camellia was built without OpenMP; HDF5Exporter will evaluate functions serially.\n";
+  }
+#endif
+  _numThreads = numThreads;
+}
+
+void HDF5Exporter::setCellBatchSize(int cellBatchSize)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(cellBatchSize < 1, std::invalid_argument, "cellBatchSize must be at least 1");
+  _cellBatchSize = cellBatchSize;
+}
+
+void HDF5Exporter::setUseParallelHDF5(bool value)
+{
+#if !(defined(HAVE_MPI) && defined(H5_HAVE_PARALLEL))
+  TEUCHOS_TEST_FOR_EXCEPTION(value, std::invalid_argument, "Parallel HDF5 output requires MPI and an HDF5 built with parallel support");
+#endif
+  _useParallelHDF5 = value;
+}
+
+void HDF5Exporter::setUseSinglePrecision(bool value)
+{
+  _useSinglePrecision = value;
+}
+
+void HDF5Exporter::setCompressionLevel(int level)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION((level < 0) || (level > 9), std::invalid_argument, "compression level must be between 0 and 9");
+  _compressionLevel = level;
+}
+
+void HDF5Exporter::getSolutionFunctions(TSolutionPtr<double> solution, vector<TFunctionPtr<double>> &fieldFunctions,
+                                        vector<string> &fieldFunctionNames, vector<TFunctionPtr<double>> &traceFunctions,
+                                        vector<string> &traceFunctionNames)
 {
   // TODO: change this to get VarFactoryPtr from solution
   VarFactoryPtr varFactory = _mesh->bilinearForm()->varFactory();
@@ -86,8 +232,8 @@ void HDF5Exporter::exportSolution(TSolutionPtr<double> solution, double timeVal,
   vector<VarPtr> fieldVars;
   vector<VarPtr> traceVars;
 
-  vector<TFunctionPtr<double>> fieldFunctions;
-  vector<string> fieldFunctionNames;
+  fieldFunctions.clear();
+  fieldFunctionNames.clear();
   for (int i=0; i < fieldTrialIDs.size(); i++)
   {
     fieldVars.push_back(varFactory->trial(fieldTrialIDs[i]));
@@ -96,8 +242,8 @@ void HDF5Exporter::exportSolution(TSolutionPtr<double> solution, double timeVal,
     fieldFunctions.push_back(fieldFunction);
     fieldFunctionNames.push_back(fieldFunctionName);
   }
-  vector<TFunctionPtr<double>> traceFunctions;
-  vector<string> traceFunctionNames;
+  traceFunctions.clear();
+  traceFunctionNames.clear();
   for (int i=0; i < traceTrialIDs.size(); i++)
   {
     traceVars.push_back(varFactory->trial(traceTrialIDs[i]));
@@ -106,6 +252,13 @@ void HDF5Exporter::exportSolution(TSolutionPtr<double> solution, double timeVal,
     traceFunctions.push_back(traceFunction);
     traceFunctionNames.push_back(traceFunctionName);
   }
+}
+
+void HDF5Exporter::exportSolution(TSolutionPtr<double> solution, double timeVal, unsigned int defaultNum1DPts, map<int, int> cellIDToNum1DPts, set<GlobalIndexType> cellIndices)
+{
+  vector<TFunctionPtr<double>> fieldFunctions, traceFunctions;
+  vector<string> fieldFunctionNames, traceFunctionNames;
+  getSolutionFunctions(solution, fieldFunctions, fieldFunctionNames, traceFunctions, traceFunctionNames);
   if (fieldFunctions.size() > 0)
     exportFunction(fieldFunctions, fieldFunctionNames, timeVal, defaultNum1DPts, cellIDToNum1DPts, cellIndices);
   if (traceFunctions.size() > 0)
@@ -129,6 +282,20 @@ void HDF5Exporter::exportFunction(TFunctionPtr<double> function, string function
 }
 
 void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector<string> functionNames, double timeVal, unsigned int defaultNum1DPts, map<int, int> cellIDToNum1DPts, set<GlobalIndexType> cellIndices)
+{
+  writeExport(prepareExport(functions, functionNames, timeVal, defaultNum1DPts, cellIDToNum1DPts, cellIndices));
+}
+
+size_t HDF5Exporter::ExportData::memoryFootprint() const
+{
+  size_t footprint = connArray.size() * sizeof(int) + ptArray.size() * sizeof(double) + xmfContent.size();
+  for (const vector<double> &valArray : valArrays)
+    footprint += valArray.size() * sizeof(double);
+  return footprint;
+}
+
+HDF5Exporter::ExportData HDF5Exporter::prepareExport(vector<TFunctionPtr<double>> functions, vector<string> functionNames, double timeVal,
+                                                     unsigned int defaultNum1DPts, map<int, int> cellIDToNum1DPts, set<GlobalIndexType> cellIndices)
 {
   int commRank = Teuchos::GlobalMPISession::getRank();
   int numProcs = Teuchos::GlobalMPISession::getNProc();
@@ -191,13 +358,11 @@ void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector
         TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Trace collection at timeVal already inserted");
     }
   }
-  ofstream gridFile;
   stringstream partitionFileName;
   if (!exportingBoundaryValues)
     partitionFileName << _dirSuperPath << "/" << _dirName << "/XMF/field" << "-part" << commRank << "-time" << timeVal << ".xmf";
   else
     partitionFileName << _dirSuperPath << "/" << _dirName << "/XMF/trace" << "-part" << commRank << "-time" << timeVal << ".xmf";
-  gridFile.open(partitionFileName.str().c_str());
   Teuchos::XMLObject grid("Grid");
   stringstream gridName;
   gridName << "Time" << timeVal << "Partition" << commRank;
@@ -216,19 +381,12 @@ void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector
       TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Can not export trace and field variables together");
 
   stringstream h5OutRel, h5OutFull, connOutRel2, connOutFull2;//, ptOutRel, ptOutFull;
-  if (!exportingBoundaryValues)
-  {
-    h5OutRel << "HDF5/" << "field-part" << commRank << "-time" << timeVal << ".h5";
-    h5OutFull << _dirSuperPath << "/" << _dirName << "/" << h5OutRel.str();
-  }
+  string h5Prefix = exportingBoundaryValues ? "trace" : "field";
+  if (_useParallelHDF5)
+    h5OutRel << "HDF5/" << h5Prefix << "-time" << timeVal << ".h5";
   else
-  {
-    h5OutRel << "HDF5/" << "trace-part" << commRank << "-time" << timeVal << ".h5";
-    h5OutFull << _dirSuperPath << "/" << _dirName << "/" << h5OutRel.str();
-  }
-  Epetra_SerialComm Comm;
-  EpetraExt::HDF5 hdf5(Comm);
-  hdf5.Create(h5OutFull.str());
+    h5OutRel << "HDF5/" << h5Prefix << "-part" << commRank << "-time" << timeVal << ".h5";
+  h5OutFull << _dirSuperPath << "/" << _dirName << "/" << h5OutRel.str();
 
   unsigned int total_vertices = 0;
 
@@ -506,16 +664,6 @@ void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector
       connDimsf = 5*totalSubQuads + 4*totalSubTriangles;
   }
   vector<int> connArray(connDimsf);
-  Teuchos::XMLObject topoDataItem("DataItem");
-  topology.addChild(topoDataItem);
-  topoDataItem.addAttribute("ItemType", "Uniform");
-  topoDataItem.addAttribute("Format", "HDF");
-  topoDataItem.addAttribute("NumberType", "Int");
-  topoDataItem.addAttribute("Precision", "4");
-  topoDataItem.addInt("Dimensions", connDimsf);
-  stringstream connOutRel;
-  connOutRel << h5OutRel.str() << ":/Data/Conns";
-  topoDataItem.addContent(connOutRel.str());
 
   // Geometry
   Teuchos::XMLObject geometry("Geometry");
@@ -529,18 +677,7 @@ void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector
     ptDimsf = 2 * totalPts;
   else
     ptDimsf = spaceDim * totalPts;
-  double ptArray[ptDimsf];
-
-  Teuchos::XMLObject geoDataItem("DataItem");
-  geometry.addChild(geoDataItem);
-  geoDataItem.addAttribute("ItemType", "Uniform");
-  geoDataItem.addAttribute("Format", "HDF");
-  geoDataItem.addAttribute("NumberType", "Float");
-  geoDataItem.addAttribute("Precision", "8");
-  geoDataItem.addInt("Dimensions", ptDimsf);
-  stringstream ptOutRel;
-  ptOutRel << h5OutRel.str() << ":/Data/Points";
-  geoDataItem.addContent(ptOutRel.str());
+  vector<double> ptArray(ptDimsf);
 
   // Node Data
   vector<Teuchos::XMLObject> vals;
@@ -583,40 +720,65 @@ void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector
       valDimsf[i] = 3*totalPts;
     }
     valArrays[i].resize(valDimsf[i], 0);
-    Teuchos::XMLObject valDataItem("DataItem");
-    vals[i].addChild(valDataItem);
-    valDataItem.addAttribute("ItemType", "Uniform");
-    valDataItem.addAttribute("Format", "HDF");
-    valDataItem.addAttribute("NumberType", "Float");
-    valDataItem.addAttribute("Precision", "8");
-    valDataItem.addInt("Dimensions", valDimsf[i]);
-    stringstream valOutRel;
-    valOutRel << h5OutRel.str() << ":/Data/" << functionNames[i];
-    valDataItem.addContent(valOutRel.str());
   }
 
+  // Dataset sizes, in the order Conns, Points, function values.  When all ranks share one file, each rank's data
+  // occupies a contiguous slab of each dataset, and we determine the slab offsets here.
+  int numDatasets = 2 + nFcns;
+  vector<hsize_t> localSizes(numDatasets), localOffsets(numDatasets, 0), globalSizes(numDatasets);
+  localSizes[0] = connDimsf;
+  localSizes[1] = ptDimsf;
+  for (int i = 0; i < nFcns; i++)
+    localSizes[2+i] = valDimsf[i];
+  globalSizes = localSizes;
+  if (_useParallelHDF5)
+  {
+    // the shared file belongs to the ranks of the mesh's communicator
+    const Epetra_Comm &meshComm = *_mesh->Comm();
+    int meshRank = meshComm.MyPID(), meshNumProcs = meshComm.NumProc();
+    Intrepid::FieldContainer<GlobalIndexType> allSizes(meshNumProcs, numDatasets);
+    for (int datasetOrdinal = 0; datasetOrdinal < numDatasets; datasetOrdinal++)
+      allSizes(meshRank, datasetOrdinal) = localSizes[datasetOrdinal];
+    MPIWrapper::entryWiseSum(meshComm, allSizes);
+    for (int datasetOrdinal = 0; datasetOrdinal < numDatasets; datasetOrdinal++)
+    {
+      globalSizes[datasetOrdinal] = 0;
+      for (int p = 0; p < meshNumProcs; p++)
+      {
+        if (p < meshRank) localOffsets[datasetOrdinal] += allSizes(p, datasetOrdinal);
+        globalSizes[datasetOrdinal] += allSizes(p, datasetOrdinal);
+      }
+    }
+  }
+
+  int floatPrecision = _useSinglePrecision ? 4 : 8;
+  addHDFDataItem(topology, "Int", 4, localSizes[0], localOffsets[0], globalSizes[0], h5OutRel.str() + ":/Data/Conns");
+  addHDFDataItem(geometry, "Float", floatPrecision, localSizes[1], localOffsets[1], globalSizes[1], h5OutRel.str() + ":/Data/Points");
+  for (int i = 0; i < nFcns; i++)
+    addHDFDataItem(vals[i], "Float", floatPrecision, localSizes[2+i], localOffsets[2+i], globalSizes[2+i],
+                   h5OutRel.str() + ":/Data/" + functionNames[i]);
+
+  // Evaluate the functions on all the cells up front; computeExportValues() batches cells of like type.
+  vector<GlobalIndexType> cellIndexVector(cellIndices.begin(), cellIndices.end());
+  vector<CellExportValues> exportValues;
+  computeExportValues(exportValues, functions, cellIndexVector, cellIDToNum1DPts);
+
   int connIndex = 0;
   int ptIndex = 0;
   int valIndex[nFcns];
   for (int i = 0; i < nFcns; i++)
     valIndex[i] = 0;
 
-  for (set<GlobalIndexType>::iterator cellIt = cellIndices.begin(); cellIt != cellIndices.end(); cellIt++)
+  for (int cellOrdinal = 0; cellOrdinal < cellIndexVector.size(); cellOrdinal++)
   {
-    GlobalIndexType cellIndex = *cellIt;
+    GlobalIndexType cellIndex = cellIndexVector[cellOrdinal];
     CellPtr cell = _mesh->getTopology()->getCell(cellIndex);
 
-    Intrepid::FieldContainer<double> physicalCellNodes = _mesh->getTopology()->physicalCellNodesForCell(cellIndex);
-
     CellTopoPtr cellTopoPtr = cell->topology();
     int num1DPts = cellIDToNum1DPts[cell->cellIndex()];
 
-    if (physicalCellNodes.rank() == 2)
-      physicalCellNodes.resize(1,physicalCellNodes.dimension(0), physicalCellNodes.dimension(1));
     bool createSideCache = functions[0]->boundaryValueOnly();
 
-    BasisCachePtr volumeBasisCache = BasisCache::basisCacheForCell(_mesh, cellIndex);
-
     int numSides = createSideCache ? cellTopoPtr->getSideCount() : 1;
 
     int sideDim = spaceDim - 1;
@@ -624,26 +786,11 @@ void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector
     for (int sideOrdinal = 0; sideOrdinal < numSides; sideOrdinal++)
     {
       CellTopoPtr topo = createSideCache ? cellTopoPtr->getSubcell(sideDim, sideOrdinal) : cellTopoPtr;
-      BasisCachePtr basisCache = createSideCache ? volumeBasisCache->getSideBasisCache(sideOrdinal) : volumeBasisCache;
 
-      Intrepid::FieldContainer<double> refPoints;
-      getPoints(refPoints, topo, num1DPts);
-
-      basisCache->setRefCellPoints(refPoints);
-      int numPoints = refPoints.dimension(0);
-      const Intrepid::FieldContainer<double> *physicalPoints = &basisCache->getPhysicalCubaturePoints();
+      const Intrepid::FieldContainer<double> *physicalPoints = &exportValues[cellOrdinal].physicalPoints[sideOrdinal];
+      int numPoints = physicalPoints->dimension(1);
       // Function Values
-      std::vector< Intrepid::FieldContainer<double> > computedValues(nFcns);
-      for (int i = 0; i < nFcns; i++)
-      {
-        if (functions[i]->rank() == 0)
-          computedValues[i].resize(1, numPoints);
-        else if (functions[i]->rank() == 1)
-          computedValues[i].resize(1, numPoints, spaceDim);
-        else
-          TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Unhandled function rank");
-        functions[i]->values(computedValues[i], basisCache);
-      }
+      const std::vector< Intrepid::FieldContainer<double> > &computedValues = exportValues[cellOrdinal].functionValues[sideOrdinal];
 
       unsigned baseCellTopoKey = topo->getKey().first;
       unsigned cellTopoKey;
@@ -1023,40 +1170,98 @@ void HDF5Exporter::exportFunction(vector<TFunctionPtr<double>> functions, vector
         total_vertices++;
       }
     }
+    // release the values for this cell as we go
+    exportValues[cellOrdinal] = CellExportValues();
   }
-  if (connDimsf > 0)
-  {
-    hdf5.Write("Data", "Conns", H5T_NATIVE_INT, connDimsf, &connArray[0]);
-    hdf5.Write("Data", "Points", H5T_NATIVE_DOUBLE, ptDimsf, &ptArray[0]);
-    for (int i = 0; i < nFcns; i++)
-      hdf5.Write("Data", functionNames[i], H5T_NATIVE_DOUBLE, valDimsf[i], &valArrays[i][0]);
-  }
-  hdf5.Close();
 
-  gridFile << grid.toString();
-  gridFile.close();
+  // Everything the files need is now in hand; writeExport() does only file I/O.
+  ExportData exportData;
+  exportData.h5FileName = h5OutFull.str();
+  exportData.xmfFileName = partitionFileName.str();
+  exportData.xmfContent = grid.toString();
+  exportData.datasetPaths.push_back("/Data/Conns");
+  exportData.datasetPaths.push_back("/Data/Points");
+  for (int i = 0; i < nFcns; i++)
+    exportData.datasetPaths.push_back("/Data/" + functionNames[i]);
+  exportData.connArray.swap(connArray);
+  exportData.ptArray.swap(ptArray);
+  exportData.valArrays.swap(valArrays);
+  exportData.localSizes.assign(localSizes.begin(), localSizes.end());
+  exportData.localOffsets.assign(localOffsets.begin(), localOffsets.end());
+  exportData.globalSizes.assign(globalSizes.begin(), globalSizes.end());
+  exportData.useParallelHDF5 = _useParallelHDF5;
+  exportData.useSinglePrecision = _useSinglePrecision;
+  exportData.compressionLevel = _compressionLevel;
 
   if (commRank == 0)
   {
     if (_fieldGrids.numChildren() > 0)
     {
-      ofstream xmfFieldFile;
-      xmfFieldFile.open((_dirSuperPath + "/" + _dirName+"/"+_dirName+"-field.xmf").c_str());
-      xmfFieldFile << "<?xml version=\"1.0\" ?>" << endl
-                   << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>" << endl;
-      xmfFieldFile << _fieldXdmf.toString();
-      xmfFieldFile.close();
+      exportData.fieldXmfFileName = _dirSuperPath + "/" + _dirName+"/"+_dirName+"-field.xmf";
+      exportData.fieldXmfContent = _fieldXdmf.toString();
     }
     if (_traceGrids.numChildren() > 0)
     {
-      ofstream xmfTraceFile;
-      xmfTraceFile.open((_dirSuperPath + "/" + _dirName+"/"+_dirName+"-trace.xmf").c_str());
-      xmfTraceFile << "<?xml version=\"1.0\" ?>" << endl
-                   << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>" << endl;
-      xmfTraceFile << _traceXdmf.toString();
-      xmfTraceFile.close();
+      exportData.traceXmfFileName = _dirSuperPath + "/" + _dirName+"/"+_dirName+"-trace.xmf";
+      exportData.traceXmfContent = _traceXdmf.toString();
     }
   }
+  return exportData;
+}
+
+void HDF5Exporter::writeExport(const ExportData &exportData)
+{
+  hid_t fileAccessProps = H5Pcreate(H5P_FILE_ACCESS);
+#if defined(HAVE_MPI) && defined(H5_HAVE_PARALLEL)
+  if (exportData.useParallelHDF5)
+  {
+    Epetra_MpiComm* mpiComm = dynamic_cast<Epetra_MpiComm*>(_mesh->Comm().get());
+    TEUCHOS_TEST_FOR_EXCEPTION(mpiComm == NULL, std::invalid_argument, "Parallel HDF5 output requires a mesh with an Epetra_MpiComm");
+    H5Pset_fapl_mpio(fileAccessProps, mpiComm->Comm(), MPI_INFO_NULL);
+  }
+#endif
+  hid_t fileID = H5Fcreate(exportData.h5FileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fileAccessProps);
+  H5Pclose(fileAccessProps);
+  TEUCHOS_TEST_FOR_EXCEPTION(fileID < 0, std::runtime_error, "Failed to create HDF5 file " + exportData.h5FileName);
+  if (exportData.globalSizes[0] > 0)
+  {
+    hid_t groupID = H5Gcreate2(fileID, "/Data", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Gclose(groupID);
+
+    hid_t floatFileType = exportData.useSinglePrecision ? H5T_NATIVE_FLOAT : H5T_NATIVE_DOUBLE;
+    bool collective = exportData.useParallelHDF5;
+    int compressionLevel = exportData.compressionLevel;
+    const vector<size_t> &localSizes = exportData.localSizes, &localOffsets = exportData.localOffsets, &globalSizes = exportData.globalSizes;
+    writeDataset(fileID, exportData.datasetPaths[0], H5T_NATIVE_INT, H5T_NATIVE_INT, exportData.connArray.data(),
+                 localSizes[0], localOffsets[0], globalSizes[0], compressionLevel, collective);
+    writeDataset(fileID, exportData.datasetPaths[1], H5T_NATIVE_DOUBLE, floatFileType, exportData.ptArray.data(),
+                 localSizes[1], localOffsets[1], globalSizes[1], compressionLevel, collective);
+    for (int i = 0; i < exportData.valArrays.size(); i++)
+      writeDataset(fileID, exportData.datasetPaths[2+i], H5T_NATIVE_DOUBLE, floatFileType, exportData.valArrays[i].data(),
+                   localSizes[2+i], localOffsets[2+i], globalSizes[2+i], compressionLevel, collective);
+  }
+  H5Fclose(fileID);
+
+  ofstream gridFile(exportData.xmfFileName.c_str());
+  gridFile << exportData.xmfContent;
+  gridFile.close();
+
+  if (exportData.fieldXmfFileName != "")
+  {
+    ofstream xmfFieldFile(exportData.fieldXmfFileName.c_str());
+    xmfFieldFile << "<?xml version=\"1.0\" ?>" << endl
+                 << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>" << endl;
+    xmfFieldFile << exportData.fieldXmfContent;
+    xmfFieldFile.close();
+  }
+  if (exportData.traceXmfFileName != "")
+  {
+    ofstream xmfTraceFile(exportData.traceXmfFileName.c_str());
+    xmfTraceFile << "<?xml version=\"1.0\" ?>" << endl
+                 << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>" << endl;
+    xmfTraceFile << exportData.traceXmfContent;
+    xmfTraceFile.close();
+  }
 }
 
 void HDF5Exporter::exportTimeSlab(TFunctionPtr<double> function, string functionName, double tInit, double tFinal, unsigned int numSlices, unsigned int sliceH1Order, unsigned int defaultNum1DPts)
@@ -1100,6 +1305,139 @@ void HDF5Exporter::exportSolution(std::string superDirectory, std::string solnNa
   exporter.exportSolution(solution, mesh->bilinearForm()->varFactory());
 }
 
+void HDF5Exporter::computeExportValues(vector<CellExportValues> &exportValues, const vector<TFunctionPtr<double>> &functions,
+                                       const vector<GlobalIndexType> &cellIndices, const map<int, int> &cellIDToNum1DPts)
+{
+  int nFcns = functions.size();
+  int spaceDim = _mesh->getTopology()->getDimension();
+  bool exportingBoundaryValues = functions[0]->boundaryValueOnly();
+
+  exportValues.clear();
+  exportValues.resize(cellIndices.size());
+
+  // Group the cells into batches.  Field values on cells with the same element type and number of points are
+  // evaluated together, with one BasisCache for the whole batch.  Trace values, and values on space-time cells
+  // (whose BasisCaches are built from per-cell tensor components), are evaluated one cell at a time.
+  vector< vector<int> > batches; // ordinals into cellIndices
+  vector<int> batchNum1DPts;
+  map< pair<ElementType*,int>, int > openBatches; // (element type, num1DPts) --> ordinal of the batch being filled
+  for (int cellOrdinal = 0; cellOrdinal < cellIndices.size(); cellOrdinal++)
+  {
+    GlobalIndexType cellIndex = cellIndices[cellOrdinal];
+    int num1DPts = cellIDToNum1DPts.find(cellIndex)->second;
+    ElementTypePtr elemType = _mesh->getElementType(cellIndex);
+    bool batchable = !exportingBoundaryValues && (elemType->cellTopoPtr->getTensorialDegree() == 0);
+    if (!batchable)
+    {
+      batches.push_back(vector<int>(1,cellOrdinal));
+      batchNum1DPts.push_back(num1DPts);
+      continue;
+    }
+    pair<ElementType*,int> key = {elemType.get(), num1DPts};
+    if ((openBatches.find(key) == openBatches.end()) || (batches[openBatches[key]].size() >= _cellBatchSize))
+    {
+      openBatches[key] = batches.size();
+      batches.push_back(vector<int>());
+      batchNum1DPts.push_back(num1DPts);
+    }
+    batches[openBatches[key]].push_back(cellOrdinal);
+  }
+
+  int numBatches = batches.size();
+  int numThreads = max(1, min(_numThreads, numBatches));
+
+  // Batches are processed in rounds of numThreads, one batch per thread.
+  for (int roundStartBatch = 0; roundStartBatch < numBatches; roundStartBatch += numThreads)
+  {
+    int roundSize = min(numThreads, numBatches - roundStartBatch);
+
+    // BasisCaches are constructed serially, since construction goes through the (shared) basis and cubature factories
+    vector<BasisCachePtr> basisCaches(roundSize);
+    for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
+    {
+      vector<GlobalIndexType> cellIDs;
+      for (int cellOrdinal : batches[roundStartBatch + batchOrdinal])
+      {
+        cellIDs.push_back(cellIndices[cellOrdinal]);
+      }
+      basisCaches[batchOrdinal] = BasisCache::basisCacheForCells(_mesh, cellIDs);
+    }
+
+    // exceptions may not propagate out of an OpenMP parallel region, so we record the first one and rethrow below
+    string threadErrorMessage = "";
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(roundSize) schedule(static,1) if (roundSize > 1)
+#endif
+    for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
+    {
+      try
+      {
+        const vector<int>* cellOrdinals = &batches[roundStartBatch + batchOrdinal];
+        int num1DPts = batchNum1DPts[roundStartBatch + batchOrdinal];
+        int numCells = cellOrdinals->size();
+        BasisCachePtr volumeBasisCache = basisCaches[batchOrdinal];
+        CellTopoPtr cellTopo = volumeBasisCache->cellTopology();
+
+        int numSides = exportingBoundaryValues ? cellTopo->getSideCount() : 1;
+        int sideDim = spaceDim - 1;
+
+        for (int cellOrdinalInBatch=0; cellOrdinalInBatch<numCells; cellOrdinalInBatch++)
+        {
+          CellExportValues* cellValues = &exportValues[(*cellOrdinals)[cellOrdinalInBatch]];
+          cellValues->physicalPoints.resize(numSides);
+          cellValues->functionValues.resize(numSides, vector< Intrepid::FieldContainer<double> >(nFcns));
+        }
+
+        for (int sideOrdinal = 0; sideOrdinal < numSides; sideOrdinal++)
+        {
+          CellTopoPtr topo = exportingBoundaryValues ? cellTopo->getSubcell(sideDim, sideOrdinal) : cellTopo;
+          BasisCachePtr basisCache = exportingBoundaryValues ? volumeBasisCache->getSideBasisCache(sideOrdinal) : volumeBasisCache;
+
+          Intrepid::FieldContainer<double> refPoints;
+          getPoints(refPoints, topo, num1DPts);
+
+          basisCache->setRefCellPoints(refPoints);
+          int numPoints = refPoints.dimension(0);
+          const Intrepid::FieldContainer<double> *physicalPoints = &basisCache->getPhysicalCubaturePoints();
+          for (int cellOrdinalInBatch=0; cellOrdinalInBatch<numCells; cellOrdinalInBatch++)
+          {
+            CellExportValues* cellValues = &exportValues[(*cellOrdinals)[cellOrdinalInBatch]];
+            copyCellValues(cellValues->physicalPoints[sideOrdinal], *physicalPoints, cellOrdinalInBatch);
+          }
+
+          for (int i = 0; i < nFcns; i++)
+          {
+            Intrepid::FieldContainer<double> values;
+            if (functions[i]->rank() == 0)
+              values.resize(numCells, numPoints);
+            else if (functions[i]->rank() == 1)
+              values.resize(numCells, numPoints, spaceDim);
+            else
+              TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Unhandled function rank");
+            functions[i]->values(values, basisCache);
+
+            for (int cellOrdinalInBatch=0; cellOrdinalInBatch<numCells; cellOrdinalInBatch++)
+            {
+              CellExportValues* cellValues = &exportValues[(*cellOrdinals)[cellOrdinalInBatch]];
+              copyCellValues(cellValues->functionValues[sideOrdinal][i], values, cellOrdinalInBatch);
+            }
+          }
+        }
+      }
+      catch (std::exception &e)
+      {
+#ifdef _OPENMP
+        #pragma omp critical (CamelliaHDF5ExporterThreadError)
+#endif
+        {
+          if (threadErrorMessage == "") threadErrorMessage = e.what();
+        }
+      }
+    }
+    TEUCHOS_TEST_FOR_EXCEPTION(threadErrorMessage != "", std::runtime_error, threadErrorMessage);
+  }
+}
+
 void HDF5Exporter::getPoints(Intrepid::FieldContainer<double> &points, CellTopoPtr cellTopo, int num1DPts)
 {
   int topoDim = cellTopo->getDimension();
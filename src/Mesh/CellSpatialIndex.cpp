@@ -0,0 +1,206 @@
+//
+//  CellSpatialIndex.cpp
+//  Camellia
+//
+//
+
+#include "CellSpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Camellia;
+using namespace Intrepid;
+using namespace std;
+
+CellSpatialIndex::CellSpatialIndex(const vector<double> &domainMin, const vector<double> &domainMax, int cellCountEstimate,
+                                   double targetCellsPerBin)
+{
+  _spaceDim = domainMin.size();
+  TEUCHOS_TEST_FOR_EXCEPTION(domainMax.size() != _spaceDim, std::invalid_argument, "domainMin and domainMax must have the same length");
+  TEUCHOS_TEST_FOR_EXCEPTION(targetCellsPerBin <= 0, std::invalid_argument, "targetCellsPerBin must be positive");
+  
+  _domainMin = domainMin;
+  _binWidth.resize(_spaceDim);
+  _binCounts.resize(_spaceDim);
+  
+  double maxExtent = 0;
+  for (int d=0; d<_spaceDim; d++)
+  {
+    maxExtent = max(maxExtent, domainMax[d] - domainMin[d]);
+  }
+  // pad boxes so that points on cell boundaries are reported for both adjacent cells
+  _padding = (maxExtent > 0) ? 1e-10 * maxExtent : 1e-10;
+  
+  // choose a roughly uniform bin size
+  double targetBinCount = max(1.0, cellCountEstimate / targetCellsPerBin);
+  double domainMeasure = 1.0;
+  int nontrivialDimensions = 0;
+  for (int d=0; d<_spaceDim; d++)
+  {
+    double extent = domainMax[d] - domainMin[d];
+    if (extent > 0)
+    {
+      domainMeasure *= extent;
+      nontrivialDimensions++;
+    }
+  }
+  double binSize = (nontrivialDimensions > 0) ? pow(domainMeasure / targetBinCount, 1.0 / nontrivialDimensions) : 1.0;
+  
+  const int MAX_BINS = 1 << 22; // caps memory for pathological aspect ratios
+  int totalBins = 1;
+  for (int d=0; d<_spaceDim; d++)
+  {
+    double extent = domainMax[d] - domainMin[d];
+    int binCount = (extent > 0) ? max(1, (int) ceil(extent / binSize)) : 1;
+    binCount = min(binCount, max(1, MAX_BINS / totalBins));
+    totalBins *= binCount;
+    _binCounts[d] = binCount;
+    _binWidth[d] = (extent > 0) ? extent / binCount : 1.0;
+  }
+  _bins.resize(totalBins);
+}
+
+int CellSpatialIndex::binCoordinate(double x, int d) const
+{
+  int binCoord = (int) floor((x - _domainMin[d]) / _binWidth[d]);
+  return min(max(binCoord, 0), _binCounts[d] - 1);
+}
+
+void CellSpatialIndex::binRange(const vector<double> &box, vector<int> &binMin, vector<int> &binMax) const
+{
+  binMin.resize(_spaceDim);
+  binMax.resize(_spaceDim);
+  for (int d=0; d<_spaceDim; d++)
+  {
+    binMin[d] = binCoordinate(box[d], d);
+    binMax[d] = binCoordinate(box[_spaceDim + d], d);
+  }
+}
+
+template<class F>
+void CellSpatialIndex::forEachBin(const vector<double> &box, F f)
+{
+  vector<int> binMin, binMax;
+  binRange(box, binMin, binMax);
+  vector<int> binCoord = binMin;
+  while (true)
+  {
+    int binOrdinal = 0;
+    for (int d=_spaceDim-1; d>=0; d--)
+    {
+      binOrdinal = binOrdinal * _binCounts[d] + binCoord[d];
+    }
+    f(_bins[binOrdinal]);
+    
+    // odometer increment
+    int d = 0;
+    while (d < _spaceDim)
+    {
+      binCoord[d]++;
+      if (binCoord[d] <= binMax[d]) break;
+      binCoord[d] = binMin[d];
+      d++;
+    }
+    if (d == _spaceDim) break;
+  }
+}
+
+void CellSpatialIndex::insertCell(IndexType cellID, const FieldContainer<double> &cellVertices)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(cellVertices.dimension(1) != _spaceDim, std::invalid_argument, "cellVertices must have shape (numVertices, spaceDim)");
+  removeCell(cellID);
+  
+  vector<double> box(2 * _spaceDim);
+  for (int d=0; d<_spaceDim; d++)
+  {
+    box[d] = numeric_limits<double>::max();
+    box[_spaceDim + d] = -numeric_limits<double>::max();
+  }
+  int numVertices = cellVertices.dimension(0);
+  for (int vertexOrdinal=0; vertexOrdinal<numVertices; vertexOrdinal++)
+  {
+    for (int d=0; d<_spaceDim; d++)
+    {
+      box[d] = min(box[d], cellVertices(vertexOrdinal,d));
+      box[_spaceDim + d] = max(box[_spaceDim + d], cellVertices(vertexOrdinal,d));
+    }
+  }
+  for (int d=0; d<_spaceDim; d++)
+  {
+    box[d] -= _padding;
+    box[_spaceDim + d] += _padding;
+  }
+  
+  forEachBin(box, [cellID] (vector<IndexType> &bin)
+  {
+    bin.push_back(cellID);
+  });
+  _cellBoxes[cellID] = box;
+}
+
+void CellSpatialIndex::insertUnboundedCell(IndexType cellID)
+{
+  removeCell(cellID);
+  _unboundedCells.push_back(cellID);
+}
+
+void CellSpatialIndex::removeCell(IndexType cellID)
+{
+  auto boxEntry = _cellBoxes.find(cellID);
+  if (boxEntry != _cellBoxes.end())
+  {
+    forEachBin(boxEntry->second, [cellID] (vector<IndexType> &bin)
+    {
+      auto entry = std::find(bin.begin(), bin.end(), cellID);
+      if (entry != bin.end())
+      {
+        *entry = bin.back();
+        bin.pop_back();
+      }
+    });
+    _cellBoxes.erase(boxEntry);
+    return;
+  }
+  auto unboundedEntry = std::find(_unboundedCells.begin(), _unboundedCells.end(), cellID);
+  if (unboundedEntry != _unboundedCells.end())
+  {
+    _unboundedCells.erase(unboundedEntry);
+  }
+}
+
+void CellSpatialIndex::candidateCells(const double* point, vector<IndexType> &candidates) const
+{
+  candidates.clear();
+  int binOrdinal = 0;
+  for (int d=_spaceDim-1; d>=0; d--)
+  {
+    binOrdinal = binOrdinal * _binCounts[d] + binCoordinate(point[d], d);
+  }
+  for (IndexType cellID : _bins[binOrdinal])
+  {
+    const vector<double>* box = &_cellBoxes.find(cellID)->second;
+    bool inBox = true;
+    for (int d=0; d<_spaceDim; d++)
+    {
+      if ((point[d] < (*box)[d]) || (point[d] > (*box)[_spaceDim + d]))
+      {
+        inBox = false;
+        break;
+      }
+    }
+    if (inBox) candidates.push_back(cellID);
+  }
+  candidates.insert(candidates.end(), _unboundedCells.begin(), _unboundedCells.end());
+}
+
+int CellSpatialIndex::binCount() const
+{
+  return _bins.size();
+}
+
+int CellSpatialIndex::cellCount() const
+{
+  return _cellBoxes.size() + _unboundedCells.size();
+}
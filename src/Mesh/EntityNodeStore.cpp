@@ -0,0 +1,139 @@
+//
+//  EntityNodeStore.cpp
+//  Camellia
+//
+//
+
+#include "EntityNodeStore.h"
+
+#include "Teuchos_TestForException.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace Camellia;
+using namespace std;
+
+EntityNodeStore::EntityNodeStore()
+{
+  _nodeOffsets.push_back(0);
+  _indexedCount = 0;
+}
+
+size_t EntityNodeStore::hashNodes(const IndexType* nodes, int nodeCount)
+{
+  // FNV-1a over the node indices, followed by a finalizing mix so that the low bits are well distributed
+  uint64_t h = 14695981039346656037ULL;
+  for (int i=0; i<nodeCount; i++)
+  {
+    h ^= (uint64_t) nodes[i];
+    h *= 1099511628211ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (size_t) h;
+}
+
+bool EntityNodeStore::nodesMatch(IndexType entityIndex, const IndexType* nodes, int nodeCount) const
+{
+  IndexType offset = _nodeOffsets[entityIndex];
+  if (_nodeOffsets[entityIndex+1] - offset != nodeCount) return false;
+  for (int i=0; i<nodeCount; i++)
+  {
+    if (_nodes[offset+i] != nodes[i]) return false;
+  }
+  return true;
+}
+
+void EntityNodeStore::insertIntoSlots(IndexType entityIndex)
+{
+  size_t mask = _slots.size() - 1;
+  size_t slot = hashNodes(this->nodes(entityIndex), nodeCount(entityIndex)) & mask;
+  while (_slots[slot] != (IndexType)-1)
+  {
+    slot = (slot + 1) & mask;
+  }
+  _slots[slot] = entityIndex;
+}
+
+void EntityNodeStore::rehash(size_t slotCount)
+{
+  vector<IndexType> oldSlots(slotCount, -1);
+  oldSlots.swap(_slots);
+  for (IndexType entityIndex : oldSlots)
+  {
+    if (entityIndex != (IndexType)-1) insertIntoSlots(entityIndex);
+  }
+}
+
+IndexType EntityNodeStore::addEntity(const vector<IndexType> &sortedNodes, bool findable)
+{
+  IndexType entityIndex = _nodeOffsets.size() - 1;
+  _nodes.insert(_nodes.end(), sortedNodes.begin(), sortedNodes.end());
+  _nodeOffsets.push_back(_nodes.size());
+  if (findable) makeFindable(entityIndex);
+  return entityIndex;
+}
+
+void EntityNodeStore::makeFindable(IndexType entityIndex)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(entityIndex >= size(), std::invalid_argument, "entityIndex out of bounds");
+  // keep the load factor at or below 1/2, so that probe sequences stay short
+  if (2 * (_indexedCount + 1) > _slots.size())
+  {
+    rehash(max((size_t)16, 2 * _slots.size()));
+  }
+  insertIntoSlots(entityIndex);
+  _indexedCount++;
+}
+
+IndexType EntityNodeStore::find(const vector<IndexType> &sortedNodes) const
+{
+  if (_slots.size() == 0) return -1;
+  int nodeCount = sortedNodes.size();
+  const IndexType* nodes = (nodeCount > 0) ? &sortedNodes[0] : NULL;
+  size_t mask = _slots.size() - 1;
+  size_t slot = hashNodes(nodes, nodeCount) & mask;
+  while (_slots[slot] != (IndexType)-1)
+  {
+    if (nodesMatch(_slots[slot], nodes, nodeCount)) return _slots[slot];
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+IndexType EntityNodeStore::size() const
+{
+  return _nodeOffsets.size() - 1;
+}
+
+IndexType EntityNodeStore::findableCount() const
+{
+  return _indexedCount;
+}
+
+int EntityNodeStore::nodeCount(IndexType entityIndex) const
+{
+  return _nodeOffsets[entityIndex+1] - _nodeOffsets[entityIndex];
+}
+
+const IndexType* EntityNodeStore::nodes(IndexType entityIndex) const
+{
+  return _nodes.data() + _nodeOffsets[entityIndex];
+}
+
+vector<IndexType> EntityNodeStore::nodeVector(IndexType entityIndex) const
+{
+  return vector<IndexType>(nodes(entityIndex), nodes(entityIndex) + nodeCount(entityIndex));
+}
+
+long long EntityNodeStore::approximateNodeStorageFootprint() const
+{
+  return sizeof(_nodeOffsets) + sizeof(_nodes) + sizeof(IndexType) * (_nodeOffsets.capacity() + _nodes.capacity());
+}
+
+long long EntityNodeStore::approximateLookupFootprint() const
+{
+  return sizeof(_slots) + sizeof(_indexedCount) + sizeof(IndexType) * _slots.capacity();
+}
@@ -68,6 +68,7 @@ bool GDAMinimumRule::allowCascadingConstraints() const
 void GDAMinimumRule::setAllowCascadingConstraints(bool value)
 {
   _allowCascadingConstraints = value;
+  clearConstraintsCache();
 }
 
 typedef pair< IndexType, unsigned > CellPair;
@@ -184,6 +185,14 @@ void GDAMinimumRule::didHRefine(const set<GlobalIndexType> &parentCellIDs)
 //    }
 //  }
 
+  set<GlobalIndexType> changedCellIDs = parentCellIDs;
+  for (GlobalIndexType parentCellID : parentCellIDs)
+  {
+    vector<IndexType> childIDs = _meshTopology->getCell(parentCellID)->getChildIndices(_meshTopology);
+    changedCellIDs.insert(childIDs.begin(), childIDs.end());
+  }
+  invalidateConstraints(changedCellIDs);
+
   this->GlobalDofAssignment::didHRefine(parentCellIDs);
 }
 
@@ -192,12 +201,14 @@ void GDAMinimumRule::didPRefine(const set<GlobalIndexType> &cellIDs, int deltaP)
   this->GlobalDofAssignment::didPRefine(cellIDs, deltaP);
 
   // the above assigns _cellH1Orders for active elements; now we take minimums for parents (inactive elements)
+  set<GlobalIndexType> changedCellIDs = cellIDs;
   for (set<GlobalIndexType>::const_iterator cellIDIt = cellIDs.begin(); cellIDIt != cellIDs.end(); cellIDIt++)
   {
     CellPtr cell = _meshTopology->getCell(*cellIDIt);
     CellPtr parent = cell->getParent();
     while (parent.get() != NULL)
     {
+      changedCellIDs.insert(parent->cellIndex());
       vector<IndexType> childIndices = parent->getChildIndices(_meshTopology);
       vector<int> minH1Order = _cellH1Orders[*cellIDIt];
       for (int childOrdinal=0; childOrdinal<childIndices.size(); childOrdinal++)
@@ -232,18 +243,144 @@ void GDAMinimumRule::didPRefine(const set<GlobalIndexType> &cellIDs, int deltaP)
       (*solutionIt)->projectOldCellOntoNewCells(*cellIDIt,oldType,childIDs);
     }
   }
+  invalidateConstraints(changedCellIDs);
 //  rebuildLookups();
 }
 
 void GDAMinimumRule::didHUnrefine(const set<GlobalIndexType> &parentCellIDs)
 {
   this->GlobalDofAssignment::didHUnrefine(parentCellIDs);
+  clearConstraintsCache();
   // TODO: implement this
   cout << "WARNING: GDAMinimumRule::didHUnrefine() unimplemented.\n";
   // will need to treat cell side parities here--probably suffices to redo those in parentCellIDs plus all their neighbors.
 //  rebuildLookups();
 }
 
+const GlobalDofRenumbering & GDAMinimumRule::dofRenumbering() const
+{
+  return _dofRenumbering;
+}
+
+int GDAMinimumRule::dofNumberingVersion() const
+{
+  return _dofNumberingVersion;
+}
+
+void GDAMinimumRule::setElementType(GlobalIndexType cellID, ElementTypePtr elemType)
+{
+  this->GlobalDofAssignment::setElementType(cellID, elemType);
+  invalidateConstraints({cellID});
+}
+
+bool GDAMinimumRule::constraintsReferToCells(const CellConstraints &constraints, const set<GlobalIndexType> &cellIDs)
+{
+  for (const vector<AnnotatedEntity> &constraintsForDimension : constraints.subcellConstraints)
+  {
+    for (const AnnotatedEntity &constrainingEntity : constraintsForDimension)
+    {
+      if (cellIDs.find(constrainingEntity.cellID) != cellIDs.end()) return true;
+    }
+  }
+  for (const vector<OwnershipInfo> &ownershipForDimension : constraints.owningCellIDForSubcell)
+  {
+    for (const OwnershipInfo &ownershipInfo : ownershipForDimension)
+    {
+      if (cellIDs.find(ownershipInfo.cellID) != cellIDs.end()) return true;
+    }
+  }
+  if (constraints.spatialSliceConstraints != Teuchos::null)
+  {
+    return constraintsReferToCells(*constraints.spatialSliceConstraints, cellIDs);
+  }
+  return false;
+}
+
+void GDAMinimumRule::invalidateConstraints(const set<GlobalIndexType> &changedCellIDs)
+{
+  if (_allowCascadingConstraints)
+  {
+    // cascading constraints can reach arbitrarily far from the changed cells; start over
+    clearConstraintsCache();
+    return;
+  }
+  
+  // The constraints for a cell are determined by the cells that contain its subcells (and by the cells that contain the
+  // constraining entities for those subcells).  A cell whose constraints may have changed therefore either shares a vertex
+  // with a changed cell, or has constraints that refer to a cell which does.
+  set<GlobalIndexType> nearbyCellIDs = changedCellIDs;
+  for (GlobalIndexType cellID : changedCellIDs)
+  {
+    CellPtr cell = _meshTopology->getCell(cellID);
+    for (IndexType vertexIndex : cell->vertices())
+    {
+      set< pair<IndexType, unsigned> > cellsForVertex = _meshTopology->getCellsContainingEntity(0, vertexIndex);
+      for (const pair<IndexType, unsigned> &cellEntry : cellsForVertex)
+      {
+        nearbyCellIDs.insert(cellEntry.first);
+      }
+    }
+  }
+  
+  vector<GlobalIndexType> cachedCellIDs = _constraintsCache.cellIDs();
+  for (GlobalIndexType cellID : cachedCellIDs)
+  {
+    if ((nearbyCellIDs.find(cellID) != nearbyCellIDs.end())
+        || constraintsReferToCells(*_constraintsCache.find(cellID), nearbyCellIDs))
+    {
+      _constraintsCache.erase(cellID);
+      _ownedDofLayoutCache.erase(cellID);
+    }
+  }
+  _constraintsCacheUpdatedIncrementally = true;
+}
+
+void GDAMinimumRule::clearConstraintsCache()
+{
+  _constraintsCache.clear();
+  _ownedDofLayoutCache.clear();
+  _constraintsCacheUpdatedIncrementally = false;
+}
+
+Teuchos::RCP<const FieldContainer<double>> GDAMinimumRule::sharedConstraintMatrix(const FieldContainer<double> &constraintMatrix)
+{
+  size_t hash = 0;
+  auto hashCombine = [&hash] (size_t value)
+  {
+    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  };
+  std::hash<double> doubleHash;
+  for (int r=0; r<constraintMatrix.rank(); r++)
+  {
+    hashCombine(constraintMatrix.dimension(r));
+  }
+  for (int i=0; i<constraintMatrix.size(); i++)
+  {
+    hashCombine(doubleHash(constraintMatrix[i]));
+  }
+  
+  auto candidates = _sharedConstraintMatrices.equal_range(hash);
+  for (auto candidateEntry = candidates.first; candidateEntry != candidates.second; candidateEntry++)
+  {
+    const FieldContainer<double>* candidate = candidateEntry->second.get();
+    if ((candidate->rank() != constraintMatrix.rank()) || (candidate->size() != constraintMatrix.size())) continue;
+    bool matches = true;
+    for (int r=0; r<constraintMatrix.rank(); r++)
+    {
+      if (candidate->dimension(r) != constraintMatrix.dimension(r)) matches = false;
+    }
+    for (int i=0; matches && (i<constraintMatrix.size()); i++)
+    {
+      if ((*candidate)[i] != constraintMatrix[i]) matches = false;
+    }
+    if (matches) return candidateEntry->second;
+  }
+  
+  Teuchos::RCP<const FieldContainer<double>> sharedMatrix = Teuchos::rcp( new FieldContainer<double>(constraintMatrix) );
+  _sharedConstraintMatrices.insert({hash, sharedMatrix});
+  return sharedMatrix;
+}
+
 ElementTypePtr GDAMinimumRule::elementType(GlobalIndexType cellID)
 {
   return _elementTypeForCell[cellID];
@@ -261,7 +398,7 @@ set<GlobalIndexType> GDAMinimumRule::globalDofIndicesForCell(GlobalIndexType cel
 {
   set<GlobalIndexType> globalDofIndices;
 
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   LocalDofMapperPtr dofMapper = getDofMapper(cellID, constraints);
   vector<GlobalIndexType> globalIndexVector = dofMapper->globalIndices();
 
@@ -271,7 +408,7 @@ set<GlobalIndexType> GDAMinimumRule::globalDofIndicesForCell(GlobalIndexType cel
 
 set<GlobalIndexType> GDAMinimumRule::globalDofIndicesForVarOnSubcell(int varID, GlobalIndexType cellID, unsigned int dim, unsigned int subcellOrdinal)
 {
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   LocalDofMapperPtr dofMapper = getDofMapper(cellID, constraints);
   set<GlobalIndexType> globalDofIndices = dofMapper->globalIndicesForSubcell(varID, dim, subcellOrdinal);
   
@@ -317,7 +454,7 @@ set<GlobalIndexType> GDAMinimumRule::ownedGlobalDofIndicesForCell(GlobalIndexTyp
 {
   set<GlobalIndexType> globalDofIndices;
 
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   SubCellDofIndexInfo owningCellDofIndexInfo = getOwnedGlobalDofIndices(cellID, constraints);
 
   CellTopoPtr cellTopo = _meshTopology->getCell(cellID)->topology();
@@ -349,7 +486,7 @@ vector<int> GDAMinimumRule::H1Order(GlobalIndexType cellID, unsigned sideOrdinal
 void GDAMinimumRule::interpretGlobalCoefficients(GlobalIndexType cellID, Intrepid::FieldContainer<double> &localCoefficients,
                                                  const Epetra_MultiVector &globalCoefficients)
 {
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   LocalDofMapperPtr dofMapper = getDofMapper(cellID, constraints);
   const vector<GlobalIndexType>* globalIndexVector = &dofMapper->globalIndices();
 
@@ -427,7 +564,7 @@ void GDAMinimumRule::interpretGlobalCoefficients(GlobalIndexType cellID, Intrepi
 template <typename Scalar>
 void GDAMinimumRule::interpretGlobalCoefficients2(GlobalIndexType cellID, Intrepid::FieldContainer<Scalar> &localCoefficients, const TVectorPtr<Scalar> globalCoefficients)
 {
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   LocalDofMapperPtr dofMapper = getDofMapper(cellID, constraints);
   vector<GlobalIndexType> globalIndexVector = dofMapper->globalIndices();
 
@@ -492,7 +629,7 @@ template void GDAMinimumRule::interpretGlobalCoefficients2(GlobalIndexType cellI
 void GDAMinimumRule::interpretLocalData(GlobalIndexType cellID, const Intrepid::FieldContainer<double> &localData,
                                         Intrepid::FieldContainer<double> &globalData, Intrepid::FieldContainer<GlobalIndexType> &globalDofIndices)
 {
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   LocalDofMapperPtr dofMapper = getDofMapper(cellID, constraints);
 
   // DEBUGGING
@@ -556,7 +693,7 @@ void GDAMinimumRule::interpretLocalData(GlobalIndexType cellID, const Intrepid::
 void GDAMinimumRule::interpretLocalBasisCoefficients(GlobalIndexType cellID, int varID, int sideOrdinal, const Intrepid::FieldContainer<double> &basisCoefficients,
     Intrepid::FieldContainer<double> &globalCoefficients, Intrepid::FieldContainer<GlobalIndexType> &globalDofIndices)
 {
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   LocalDofMapperPtr dofMapper = getDofMapper(cellID, constraints, varID, sideOrdinal);
 
   if (dofMapper->isPermutation())
@@ -779,9 +916,9 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
       
       if ((weightsForSubcell.coarseOrdinals.size() > 0) && (weightsForSubcell.fineOrdinals.size() > 0))
       {
-        CellConstraints constrainingCellConstraints = getCellConstraints(subcellConstraint.cellID);
+        CellConstraints &constrainingCellConstraints = getCellConstraints(subcellConstraint.cellID);
         OwnershipInfo ownershipInfo = constrainingCellConstraints.owningCellIDForSubcell[subcellConstraint.dimension][subcellOrdinalInConstrainingCell];
-        CellConstraints owningCellConstraints = getCellConstraints(ownershipInfo.cellID);
+        CellConstraints &owningCellConstraints = getCellConstraints(ownershipInfo.cellID);
         SubCellDofIndexInfo owningCellDofIndexInfo = getOwnedGlobalDofIndices(ownershipInfo.cellID, owningCellConstraints);
         unsigned owningSubcellOrdinal = _meshTopology->getCell(ownershipInfo.cellID)->findSubcellOrdinal(ownershipInfo.dimension, ownershipInfo.owningSubcellEntityIndex);
         vector<GlobalIndexType> globalDofOrdinalsForSubcell = owningCellDofIndexInfo[ownershipInfo.dimension][owningSubcellOrdinal][var->ID()];
@@ -852,7 +989,7 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
                                                                                       subcellOrdinalInConstrainingCell,
                                                                                       subsubcdim, subsubcellOrdinal);
           
-          CellConstraints constrainingCellConstraints = getCellConstraints(subcellConstraint.cellID);
+          CellConstraints &constrainingCellConstraints = getCellConstraints(subcellConstraint.cellID);
           AnnotatedEntity subsubcellConstraints = constrainingCellConstraints.subcellConstraints[subsubcdim][sscOrdInOriginalConstrainingCell];
           CellPtr subsubcellConstrainingCell = _meshTopology->getCell(subsubcellConstraints.cellID);
           int sscOrdInNewConstrainingCell = CamelliaCellTools::subcellOrdinalMap(subsubcellConstrainingCell->topology(), sideDim,
@@ -1157,7 +1294,7 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
       col++;
     }
     vector<GlobalIndexType> globalOrdinals(partition.begin(),partition.end());
-    SubBasisDofMapperPtr subBasisMap = SubBasisDofMapper::subBasisDofMapper(fineOrdinals, globalOrdinals, weights);
+    SubBasisDofMapperPtr subBasisMap = SubBasisDofMapper::subBasisDofMapper(fineOrdinals, globalOrdinals, sharedConstraintMatrix(weights));
     varVolumeMap.push_back(subBasisMap);
   }
   
@@ -1273,7 +1410,7 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
   
   if (! _allowCascadingConstraints)
   {
-    CellConstraints cellConstraints = getCellConstraints(cellID);
+    CellConstraints &cellConstraints = getCellConstraints(cellID);
     bool onlyDefinedOnSpatialSides = !var->isDefinedOnTemporalInterface();
     
     /*
@@ -1631,7 +1768,7 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
                                                                           sideDim, subcellConstraint->sideOrdinal,
                                                                           subsubcdim, sscOrdInOriginalConstrainingSide);
             
-            CellConstraints constrainingCellConstraints = getCellConstraints(subcellConstraint->cellID);
+            CellConstraints &constrainingCellConstraints = getCellConstraints(subcellConstraint->cellID);
             
             AnnotatedEntity* subsubcellConstraints = getConstrainingEntityInfo(subcellConstraint->cellID, constrainingCellConstraints,
                                                                                var, subsubcdim, sscOrdInOriginalConstrainingCell);
@@ -2285,9 +2422,9 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
 
           if ((subcellInteriorWeights.coarseOrdinals.size() > 0) && (subcellInteriorWeights.fineOrdinals.size() > 0))
           {
-            CellConstraints constrainingCellConstraints = getCellConstraints(subcellConstraint.cellID);
+            CellConstraints &constrainingCellConstraints = getCellConstraints(subcellConstraint.cellID);
             OwnershipInfo ownershipInfo = constrainingCellConstraints.owningCellIDForSubcell[subcellConstraint.dimension][subcellOrdinalInConstrainingCell];
-            CellConstraints owningCellConstraints = getCellConstraints(ownershipInfo.cellID);
+            CellConstraints &owningCellConstraints = getCellConstraints(ownershipInfo.cellID);
             SubCellDofIndexInfo owningCellDofIndexInfo = getOwnedGlobalDofIndices(ownershipInfo.cellID, owningCellConstraints);
             unsigned owningSubcellOrdinal = _meshTopology->getCell(ownershipInfo.cellID)->findSubcellOrdinal(ownershipInfo.dimension, ownershipInfo.owningSubcellEntityIndex);
             vector<GlobalIndexType> globalDofOrdinalsForSubcell = owningCellDofIndexInfo[ownershipInfo.dimension][owningSubcellOrdinal][var->ID()];
@@ -2509,7 +2646,7 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
       col++;
     }
     vector<GlobalIndexType> globalOrdinals(partition.begin(),partition.end());
-    SubBasisDofMapperPtr subBasisMap = SubBasisDofMapper::subBasisDofMapper(fineOrdinals, globalOrdinals, weights);
+    SubBasisDofMapperPtr subBasisMap = SubBasisDofMapper::subBasisDofMapper(fineOrdinals, globalOrdinals, sharedConstraintMatrix(weights));
     varSideMap.push_back(subBasisMap);
     
     // DEBUGGING
@@ -2524,9 +2661,9 @@ BasisMap GDAMinimumRule::getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo
   return varSideMap;
 }
 
-CellConstraints GDAMinimumRule::getCellConstraints(GlobalIndexType cellID)
+CellConstraints & GDAMinimumRule::getCellConstraints(GlobalIndexType cellID)
 {
-  if (_constraintsCache.find(cellID) == _constraintsCache.end())
+  if (!_constraintsCache.contains(cellID))
   {
 
 //    cout << "Getting cell constraints for cellID " << cellID << endl;
@@ -2805,14 +2942,14 @@ CellConstraints GDAMinimumRule::getCellConstraints(GlobalIndexType cellID)
 //      }
 //    }
     
-    _constraintsCache[cellID] = cellConstraints;
+    _constraintsCache.insert(cellID, cellConstraints);
 
 //    if (cellID==4) { // DEBUGGING
 //      printConstraintInfo(cellID);
 //    }
   }
 
-  return _constraintsCache[cellID];
+  return *_constraintsCache.find(cellID);
 }
 
 AnnotatedEntity* GDAMinimumRule::getConstrainingEntityInfo(GlobalIndexType cellID, CellConstraints &cellConstraints,
@@ -2876,7 +3013,7 @@ unsigned GDAMinimumRule::getConstraintPermutation(GlobalIndexType cellID, unsign
   unsigned ancestralSubcellDimension = ancestralSubcell.second;
   unsigned ancestralPermutation = ancestralCell->subcellPermutation(ancestralSubcellDimension, ancestralSubcellOrdinal);
 
-  CellConstraints cellConstraints = getCellConstraints(cellID);
+  CellConstraints &cellConstraints = getCellConstraints(cellID);
   GlobalIndexType constrainingCellID = cellConstraints.subcellConstraints[subcdim][subcord].cellID;
   GlobalIndexType constrainingSubcellOrdinal = cellConstraints.subcellConstraints[subcdim][subcord].subcellOrdinal;
   GlobalIndexType constrainingSubcellDimension = cellConstraints.subcellConstraints[subcdim][subcord].dimension;
@@ -2905,10 +3042,15 @@ typedef vector< SubCellOrdinalToMap > SubCellDofIndexInfo; // index to vector: s
 set<GlobalIndexType> GDAMinimumRule::getFittableGlobalDofIndices(GlobalIndexType cellID, CellConstraints &constraints, int sideOrdinal,
                                                                  int varID)
 {
-  pair<GlobalIndexType,pair<int,unsigned>> key = {cellID,{varID,sideOrdinal}};
-  if (_fittableGlobalIndicesCache.find(key) != _fittableGlobalIndicesCache.end())
+  pair<int,unsigned> key = {varID,sideOrdinal};
+  map< pair<int,unsigned>, set<GlobalIndexType> >* fittableIndicesForCell = _fittableGlobalIndicesCache.find(cellID);
+  if (fittableIndicesForCell != NULL)
   {
-    return _fittableGlobalIndicesCache[key];
+    auto fittableEntry = fittableIndicesForCell->find(key);
+    if (fittableEntry != fittableIndicesForCell->end())
+    {
+      return fittableEntry->second;
+    }
   }
   
   // returns the global dof indices for basis functions which have support on the given side.  This is determined by taking the union of the global dof indices defined on all the constraining sides for the given side (the constraining sides are by definition unconstrained).
@@ -2921,7 +3063,7 @@ set<GlobalIndexType> GDAMinimumRule::getFittableGlobalDofIndices(GlobalIndexType
 
   CellPtr constrainingCell = _meshTopology->getCell(constrainingCellID);
 
-  CellConstraints constrainingCellConstraints = getCellConstraints(constrainingCellID);
+  CellConstraints &constrainingCellConstraints = getCellConstraints(constrainingCellID);
 
   SubCellDofIndexInfo constrainingCellDofIndexInfo = getGlobalDofIndices(constrainingCellID, constrainingCellConstraints);
 
@@ -2988,15 +3130,16 @@ set<GlobalIndexType> GDAMinimumRule::getFittableGlobalDofIndices(GlobalIndexType
       }
     }
   }
-  _fittableGlobalIndicesCache[key] = fittableDofIndices;
+  _fittableGlobalIndicesCache[cellID][key] = fittableDofIndices;
   return fittableDofIndices;
 }
 
 SubCellDofIndexInfo & GDAMinimumRule::getOwnedGlobalDofIndices(GlobalIndexType cellID, CellConstraints &constraints)
 {
-  if (_ownedGlobalDofIndicesCache.find(cellID) != _ownedGlobalDofIndicesCache.end())
+  SubCellDofIndexInfo* cachedInfo = _ownedGlobalDofIndicesCache.find(cellID);
+  if (cachedInfo != NULL)
   {
-    return _ownedGlobalDofIndicesCache[cellID];
+    return *cachedInfo;
   }
 
   int spaceDim = _meshTopology->getDimension();
@@ -3135,8 +3278,7 @@ SubCellDofIndexInfo & GDAMinimumRule::getOwnedGlobalDofIndices(GlobalIndexType c
       }
     }
   }
-  _ownedGlobalDofIndicesCache[cellID] = scInfo;
-  return _ownedGlobalDofIndicesCache[cellID];
+  return _ownedGlobalDofIndicesCache.insert(cellID, scInfo);
 }
 
 void printDofIndexInfo(GlobalIndexType cellID, SubCellDofIndexInfo &dofIndexInfo)
@@ -3166,7 +3308,8 @@ void printDofIndexInfo(GlobalIndexType cellID, SubCellDofIndexInfo &dofIndexInfo
 
 SubCellDofIndexInfo& GDAMinimumRule::getGlobalDofIndices(GlobalIndexType cellID, CellConstraints &constraints)
 {
-  if (_globalDofIndicesForCellCache.find(cellID) == _globalDofIndicesForCellCache.end())
+  SubCellDofIndexInfo* cachedInfo = _globalDofIndicesForCellCache.find(cellID);
+  if (cachedInfo == NULL)
   {
     
     /**************** ESTABLISH OWNERSHIP ****************/
@@ -3178,7 +3321,6 @@ SubCellDofIndexInfo& GDAMinimumRule::getGlobalDofIndices(GlobalIndexType cellID,
     int spaceDim = topo->getDimension();
     
     // fill in the other global dof indices (the ones not owned by this cell):
-    map< GlobalIndexType, SubCellDofIndexInfo > otherDofIndexInfoCache; // local lookup, to avoid a bunch of redundant calls to getOwnedGlobalDofIndices
     for (int d=0; d<=spaceDim; d++)
     {
       int scCount = topo->getSubcellCount(d);
@@ -3188,26 +3330,31 @@ SubCellDofIndexInfo& GDAMinimumRule::getGlobalDofIndices(GlobalIndexType cellID,
         {
           OwnershipInfo owningCellInfo = constraints.owningCellIDForSubcell[d][scord];
           GlobalIndexType owningCellID = owningCellInfo.cellID;
-          CellConstraints owningConstraints = getCellConstraints(owningCellID);
+          CellConstraints &owningConstraints = getCellConstraints(owningCellID);
           GlobalIndexType scEntityIndex = owningCellInfo.owningSubcellEntityIndex;
           CellPtr owningCell = _meshTopology->getCell(owningCellID);
           unsigned owningCellScord = owningCell->findSubcellOrdinal(owningCellInfo.dimension, scEntityIndex);
-          if (otherDofIndexInfoCache.find(owningCellID) == otherDofIndexInfoCache.end())
+          SubCellDofIndexInfo &owningDofIndexInfo = getOwnedGlobalDofIndices(owningCellID, owningConstraints);
+          // look up without inserting, so that the cached ownership info is left as it is
+          SubCellOrdinalToMap::iterator owningEntry = owningDofIndexInfo[owningCellInfo.dimension].find(owningCellScord);
+          if (owningEntry != owningDofIndexInfo[owningCellInfo.dimension].end())
           {
-            otherDofIndexInfoCache[owningCellID] = getOwnedGlobalDofIndices(owningCellID, owningConstraints);
+            dofIndexInfo[d][scord] = owningEntry->second;
+          }
+          else
+          {
+            dofIndexInfo[d][scord] = VarIDToDofIndices();
           }
-          SubCellDofIndexInfo owningDofIndexInfo = otherDofIndexInfoCache[owningCellID];
-          dofIndexInfo[d][scord] = owningDofIndexInfo[owningCellInfo.dimension][owningCellScord];
         }
       }
     }
-    _globalDofIndicesForCellCache[cellID] = dofIndexInfo;
+    cachedInfo = &_globalDofIndicesForCellCache.insert(cellID, dofIndexInfo);
   }
   
   // DEBUGGING
 //  printDofIndexInfo(cellID, dofIndexInfo);
 
-  return _globalDofIndicesForCellCache[cellID];
+  return *cachedInfo;
 }
 
 set<GlobalIndexType> GDAMinimumRule::getGlobalDofIndicesForIntegralContribution(GlobalIndexType cellID, int sideOrdinal)   // assuming an integral is being done over the whole mesh skeleton, returns either an empty set or the global dof indices associated with the given side, depending on whether the cell "owns" the side for the purpose of such contributions.
@@ -3219,7 +3366,7 @@ set<GlobalIndexType> GDAMinimumRule::getGlobalDofIndicesForIntegralContribution(
 
   if (ownsSide)
   {
-    CellConstraints cellConstraints = getCellConstraints(cellID);
+    CellConstraints &cellConstraints = getCellConstraints(cellID);
     SubCellDofIndexInfo dofIndexInfo = getGlobalDofIndices(cellID, cellConstraints);
     int spaceDim =  _meshTopology->getDimension();
 
@@ -3255,7 +3402,7 @@ vector<GlobalIndexType> GDAMinimumRule::globalDofIndicesForFieldVariable(GlobalI
   TEUCHOS_TEST_FOR_EXCEPTION(!functionSpaceIsDiscontinuous(fs), std::invalid_argument, "globalDofIndicesForFieldVariable() only supports discontinuous field variables right now");
   TEUCHOS_TEST_FOR_EXCEPTION(trialVar->varType() != FIELD, std::invalid_argument, "globalDofIndicesForFieldVariable() requires a discontinuous field variable");
   
-  CellConstraints constraints = getCellConstraints(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
   SubCellDofIndexInfo dofIndexInfo = getOwnedGlobalDofIndices(cellID, constraints);
   
   int spaceDim = _mesh->getTopology()->getDimension();
@@ -3283,7 +3430,7 @@ vector<GlobalIndexType> GDAMinimumRule::globalDofIndicesForFieldVariable(GlobalI
 
 vector<GlobalIndexType> GDAMinimumRule::getGlobalDofOrdinalsForSubcell(GlobalIndexType cellID, VarPtr var, int d, int scord)
 {
-  CellConstraints cellConstraints = getCellConstraints(cellID);
+  CellConstraints &cellConstraints = getCellConstraints(cellID);
   OwnershipInfo* ownershipInfo;
   if (!var->isDefinedOnTemporalInterface())
   {
@@ -3301,7 +3448,7 @@ vector<GlobalIndexType> GDAMinimumRule::getGlobalDofOrdinalsForSubcell(GlobalInd
   {
     ownershipInfo = &cellConstraints.owningCellIDForSubcell[d][scord];
   }
-  CellConstraints owningCellConstraints = getCellConstraints(ownershipInfo->cellID);
+  CellConstraints &owningCellConstraints = getCellConstraints(ownershipInfo->cellID);
   SubCellDofIndexInfo owningCellDofIndexInfo = getOwnedGlobalDofIndices(ownershipInfo->cellID, owningCellConstraints);
   CellPtr owningCell = _meshTopology->getCell(ownershipInfo->cellID);
   unsigned owningSubcellOrdinal = owningCell->findSubcellOrdinal(ownershipInfo->dimension, ownershipInfo->owningSubcellEntityIndex);
@@ -3321,24 +3468,21 @@ LocalDofMapperPtr GDAMinimumRule::getDofMapper(GlobalIndexType cellID, CellConst
   if ((varIDToMap == -1) && (sideOrdinalToMap == -1))
   {
     // a mapper for the whole dof ordering: we cache these separately...
-    if (_dofMapperCache.find(cellID) != _dofMapperCache.end())
+    LocalDofMapperPtr* cachedMapper = _dofMapperCache.find(cellID);
+    if (cachedMapper != NULL)
     {
-      return _dofMapperCache[cellID];
+      return *cachedMapper;
     }
   }
   else
   {
-    map< GlobalIndexType, map<int, map<int, LocalDofMapperPtr> > >::iterator cellMapEntry = _dofMapperForVariableOnSideCache.find(cellID);
-    if (cellMapEntry != _dofMapperForVariableOnSideCache.end())
+    map< pair<int,int>, LocalDofMapperPtr >* cellMappers = _dofMapperForVariableOnSideCache.find(cellID);
+    if (cellMappers != NULL)
     {
-      map<int, map<int, LocalDofMapperPtr> >::iterator sideMapEntry = cellMapEntry->second.find(sideOrdinalToMap);
-      if (sideMapEntry != cellMapEntry->second.end())
+      map< pair<int,int>, LocalDofMapperPtr >::iterator mapperEntry = cellMappers->find({sideOrdinalToMap,varIDToMap});
+      if (mapperEntry != cellMappers->end())
       {
-        map<int, LocalDofMapperPtr>::iterator varMapEntry = sideMapEntry->second.find(varIDToMap);
-        if (varMapEntry != sideMapEntry->second.end())
-        {
-          return varMapEntry->second;
-        }
+        return mapperEntry->second;
       }
     }
   }
@@ -3472,12 +3616,11 @@ LocalDofMapperPtr GDAMinimumRule::getDofMapper(GlobalIndexType cellID, CellConst
   if ((varIDToMap == -1) && (sideOrdinalToMap == -1))
   {
     // a mapper for the whole dof ordering: we cache these...
-    _dofMapperCache[cellID] = dofMapper;
-    return _dofMapperCache[cellID];
+    return _dofMapperCache.insert(cellID, dofMapper);
   }
   else
   {
-    _dofMapperForVariableOnSideCache[cellID][sideOrdinalToMap][varIDToMap] = dofMapper;
+    _dofMapperForVariableOnSideCache[cellID][{sideOrdinalToMap,varIDToMap}] = dofMapper;
     return dofMapper;
   }
 }
@@ -3528,7 +3671,7 @@ PartitionIndexType GDAMinimumRule::partitionForGlobalDofIndex( GlobalIndexType g
 
 void GDAMinimumRule::printConstraintInfo(GlobalIndexType cellID)
 {
-  CellConstraints cellConstraints = getCellConstraints(cellID);
+  CellConstraints &cellConstraints = getCellConstraints(cellID);
   cout << "***** Constraints for cell " << cellID << " ****** \n";
   CellPtr cell = _meshTopology->getCell(cellID);
   int spaceDim = cell->topology()->getDimension();
@@ -3563,15 +3706,68 @@ void GDAMinimumRule::printGlobalDofInfo()
   {
     GlobalIndexType cellID = *cellIDIt;
 
-    CellConstraints cellConstraints = getCellConstraints(cellID);
+    CellConstraints &cellConstraints = getCellConstraints(cellID);
     SubCellDofIndexInfo dofIndexInfo = getOwnedGlobalDofIndices(cellID, cellConstraints);
     printDofIndexInfo(cellID, dofIndexInfo);
   }
 }
 
+GDAMinimumRule::OwnedDofLayout GDAMinimumRule::computeOwnedDofLayout(GlobalIndexType cellID)
+{
+  OwnedDofLayout layout;
+  
+  // getOwnedGlobalDofIndices() numbers from the cell's global dof offset; using zero gives us the relative numbering
+  _globalCellDofOffsets[cellID] = 0;
+  _ownedGlobalDofIndicesCache.erase(cellID);
+  CellConstraints &constraints = getCellConstraints(cellID);
+  layout.dofIndices = getOwnedGlobalDofIndices(cellID, constraints);
+  
+  int spaceDim = _meshTopology->getDimension();
+  CellTopoPtr topo = _meshTopology->getCell(cellID)->topology();
+  const map<int, VarPtr>* trialVars = &_varFactory->trialVars();
+  for (auto varEntry : *trialVars)
+  {
+    VarPtr var = varEntry.second;
+    set<GlobalIndexType> dofsForVariable; // set to avoid double-counting (do we need this??)
+    for (int d=0; d<=spaceDim; d++)
+    {
+      int scCount = topo->getSubcellCount(d);
+      for (int scord=0; scord<scCount; scord++)
+      {
+        if (layout.dofIndices[d].find(scord) != layout.dofIndices[d].end())
+        {
+          if (layout.dofIndices[d][scord].find(var->ID()) != layout.dofIndices[d][scord].end())
+          {
+            vector<GlobalIndexType>* varDofs = &layout.dofIndices[d][scord][var->ID()];
+            dofsForVariable.insert(varDofs->begin(),varDofs->end());
+          }
+        }
+      }
+    }
+    switch (var->varType()) {
+      case FLUX:
+        layout.fluxDofCount += dofsForVariable.size();
+        break;
+      case TRACE:
+        layout.traceDofCount += dofsForVariable.size();
+        break;
+      default:
+        layout.fieldDofCount += dofsForVariable.size();
+        break;
+    }
+  }
+  return layout;
+}
+
 void GDAMinimumRule::rebuildLookups()
 {
-  _constraintsCache.clear(); // to free up memory, could clear this again after the lookups are rebuilt.  Having the cache is most important during the construction below.
+  // constraints do not depend on the dof numbering; if refinements have invalidated just the affected entries, keep the rest.
+  if (!_constraintsCacheUpdatedIncrementally)
+  {
+    clearConstraintsCache(); // to free up memory, could clear this again after the lookups are rebuilt.  Having the cache is most important during the construction below.
+  }
+  _constraintsCacheUpdatedIncrementally = false;
+  _sharedConstraintMatrices.clear();
   _dofMapperCache.clear();
   _dofMapperForVariableOnSideCache.clear();
   _ownedGlobalDofIndicesCache.clear();
@@ -3586,8 +3782,6 @@ void GDAMinimumRule::rebuildLookups()
 //  cout << "GDAMinimumRule: Rebuilding lookups on rank " << rank << endl;
   set<GlobalIndexType>* myCellIDs = &_partitions[rank];
 
-  map<int, VarPtr> trialVars = _varFactory->trialVars();
-
   _cellDofOffsets.clear(); // within the partition, offsets for the owned dofs in cell
 
   // TODO: add some sort of check here, and warning if mesh must be 1-irregular but isn't.
@@ -3607,51 +3801,20 @@ void GDAMinimumRule::rebuildLookups()
   
   int spaceDim = _meshTopology->getDimension();
 
+  // only cells without a layout -- those near refinements -- need their owned dofs worked out afresh
   _partitionDofCount = 0; // how many dofs we own locally
   for (GlobalIndexType cellID : *myCellIDs)
   {
     _cellDofOffsets[cellID] = _partitionDofCount;
-    CellPtr cell = _meshTopology->getCell(cellID);
-    CellTopoPtr topo = cell->topology();
-    CellConstraints constraints = getCellConstraints(cellID);
-
-    // getOwnedGlobalDofIndices will use the cell's global dof offset, which we still have to compute
-    // We use zero for now, and adjust below
-    _globalCellDofOffsets[cellID] = 0;
-    SubCellDofIndexInfo* ownedGlobalDofIndices = &getOwnedGlobalDofIndices(cellID, constraints);
-    
-    for (map<int, VarPtr>::iterator varIt = trialVars.begin(); varIt != trialVars.end(); varIt++)
+    OwnedDofLayout* layout = _ownedDofLayoutCache.find(cellID);
+    if (layout == NULL)
     {
-      VarPtr var = varIt->second;
-      set<GlobalIndexType> dofsForVariable; // set to avoid double-counting (do we need this??)
-      for (int d=0; d<=spaceDim; d++)
-      {
-        int scCount = topo->getSubcellCount(d);
-        for (int scord=0; scord<scCount; scord++)
-        {
-          if ((*ownedGlobalDofIndices)[d].find(scord) != (*ownedGlobalDofIndices)[d].end())
-          {
-            if ((*ownedGlobalDofIndices)[d][scord].find(var->ID()) != (*ownedGlobalDofIndices)[d][scord].end())
-            {
-              vector<GlobalIndexType>* varDofs = &(*ownedGlobalDofIndices)[d][scord][var->ID()];
-              dofsForVariable.insert(varDofs->begin(),varDofs->end());
-            }
-          }
-        }
-      }
-      switch (var->varType()) {
-        case FLUX:
-          _partitionFluxDofCount += dofsForVariable.size();
-          break;
-        case TRACE:
-          _partitionTraceDofCount += dofsForVariable.size();
-          break;
-        default:
-          _partitionFieldDofCount += dofsForVariable.size();
-          break;
-      }
-      _partitionDofCount += dofsForVariable.size();
+      layout = &_ownedDofLayoutCache.insert(cellID, computeOwnedDofLayout(cellID));
     }
+    _partitionFieldDofCount += layout->fieldDofCount;
+    _partitionFluxDofCount += layout->fluxDofCount;
+    _partitionTraceDofCount += layout->traceDofCount;
+    _partitionDofCount += layout->fieldDofCount + layout->fluxDofCount + layout->traceDofCount;
   }
   int numRanks = _partitionPolicy->Comm()->NumProc();
   _partitionDofCounts.resize(numRanks);
@@ -3703,38 +3866,46 @@ void GDAMinimumRule::rebuildLookups()
     }
   }
 
-  // Now that we have the global dof offsets for our cells, we adjust the ownedGlobalDofIndices container accordingly
+  // Now that we have the global dof offsets for our cells, we fill in the ownedGlobalDofIndices container, and record the renumbering
+  int previousNumberingVersion = _dofNumberingVersion;
+  _dofNumberingVersion++;
+  _dofRenumbering = GlobalDofRenumbering();
+  _dofRenumbering.oldNumberingVersion = previousNumberingVersion;
+  _dofRenumbering.newNumberingVersion = _dofNumberingVersion;
   for (GlobalIndexType cellID : *myCellIDs)
   {
-    CellConstraints constraints = getCellConstraints(cellID);
-    SubCellDofIndexInfo* ownedGlobalDofIndices = &getOwnedGlobalDofIndices(cellID, constraints);
-
-    CellTopoPtr topo = _meshTopology->getCell(cellID)->topology();
+    OwnedDofLayout* layout = _ownedDofLayoutCache.find(cellID);
+    SubCellDofIndexInfo ownedGlobalDofIndices = layout->dofIndices;
 
     GlobalIndexType globalCellDofOffset = _globalCellDofOffsets[cellID];
     
-    for (map<int, VarPtr>::iterator varIt = trialVars.begin(); varIt != trialVars.end(); varIt++)
+    for (int d=0; d<=spaceDim; d++)
     {
-      VarPtr var = varIt->second;
-      for (int d=0; d<=spaceDim; d++)
+      for (auto &scordEntry : ownedGlobalDofIndices[d])
       {
-        int scCount = topo->getSubcellCount(d);
-        for (int scord=0; scord<scCount; scord++)
+        for (auto &varEntry : scordEntry.second)
         {
-          if ((*ownedGlobalDofIndices)[d].find(scord) != (*ownedGlobalDofIndices)[d].end())
+          for (GlobalIndexType &globalDofIndex : varEntry.second)
           {
-            if ((*ownedGlobalDofIndices)[d][scord].find(var->ID()) != (*ownedGlobalDofIndices)[d][scord].end())
-            {
-              vector<GlobalIndexType>* varDofs = &(*ownedGlobalDofIndices)[d][scord][var->ID()];
-              for (vector<GlobalIndexType>::iterator varDofIt = varDofs->begin(); varDofIt != varDofs->end(); varDofIt++)
-              {
-                *varDofIt += globalCellDofOffset;
-              }
-            }
+            globalDofIndex += globalCellDofOffset;
           }
         }
       }
     }
+    _ownedGlobalDofIndicesCache.insert(cellID, ownedGlobalDofIndices);
+    
+    if (layout->numberingVersion == previousNumberingVersion)
+    {
+      _dofRenumbering.oldOffsets.push_back(layout->globalDofOffset);
+      _dofRenumbering.newOffsets.push_back(globalCellDofOffset);
+      _dofRenumbering.dofCounts.push_back(layout->fieldDofCount + layout->fluxDofCount + layout->traceDofCount);
+    }
+    else
+    {
+      _dofRenumbering.cellsWithNewDofs.insert(cellID);
+    }
+    layout->numberingVersion = _dofNumberingVersion;
+    layout->globalDofOffset = globalCellDofOffset;
   }
   
   _cellIDsForElementType = vector< map< ElementType*, vector<GlobalIndexType> > >(numRanks);
@@ -28,8 +28,7 @@ void MeshTopology::init(unsigned spaceDim)
   // for nontrivial mesh topology, we store entities with dimension sideDim down to vertices, so _spaceDim total possibilities
   // for trivial mesh topology (just a node), we allow storage of 0-dimensional (vertex) entity
   int numEntityDimensions = (_spaceDim > 0) ? _spaceDim : 1;
-  _entities = vector< vector< vector< unsigned > > >(numEntityDimensions);
-  _knownEntities = vector< map< vector<unsigned>, unsigned > >(numEntityDimensions); // map keys are sets of vertices, values are entity indices in _entities[d]
+  _entities = vector< EntityNodeStore >(numEntityDimensions); // node lists, with lookup from sets of vertices to entity indices
   _canonicalEntityOrdering = vector< vector< vector<unsigned> > >(numEntityDimensions);
   _activeCellsForEntities = vector< vector< vector< pair<unsigned, unsigned> > > >(numEntityDimensions); // pair entries are (cellIndex, entityIndexInCell) (entityIndexInCell aka subcord)
   _sidesForEntities = vector< vector< vector< unsigned > > >(numEntityDimensions);
@@ -37,6 +36,7 @@ void MeshTopology::init(unsigned spaceDim)
   _generalizedParentEntities = vector< map<unsigned, pair<unsigned,unsigned> > >(numEntityDimensions);
   _childEntities = vector< map< unsigned, vector< pair<RefinementPatternPtr, vector<unsigned> > > > >(numEntityDimensions);
   _entityCellTopologyKeys = vector< vector< CellTopologyKey > >(numEntityDimensions);
+  _knownCellCount = 0;
 
   _gda = NULL;
 }
@@ -175,29 +175,15 @@ map<string, long long> MeshTopology::approximateMemoryCosts()
 
   variableCost["_equivalentNodeViaPeriodicBC"] = approximateMapSizeLLVM(_equivalentNodeViaPeriodicBC); // for map _equivalentNodeViaPeriodicBC
 
+  // _entities holds both the entity node lists and the lookup from nodes to entity index; the latter we report as "_knownEntities"
   variableCost["_entities"] = VECTOR_OVERHEAD; // for outer vector _entities
-  for (vector< vector< vector<IndexType> > >::iterator entryIt = _entities.begin(); entryIt != _entities.end(); entryIt++)
+  variableCost["_knownEntities"] = 0;
+  for (const EntityNodeStore &entityStore : _entities)
   {
-    variableCost["_entities"] += VECTOR_OVERHEAD; //
-    for (vector< vector<IndexType> >::iterator entry2It = entryIt->begin(); entry2It != entryIt->end(); entry2It++)
-    {
-      variableCost["_entities"] += approximateVectorSizeLLVM(*entry2It);
-    }
-    variableCost["_entities"] += VECTOR_OVERHEAD * (entryIt->capacity() - entryIt->size());
+    variableCost["_entities"] += entityStore.approximateNodeStorageFootprint();
+    variableCost["_knownEntities"] += entityStore.approximateLookupFootprint();
   }
-  variableCost["_entities"] += VECTOR_OVERHEAD * (_entities.capacity() - _entities.size());
-
-  variableCost["_knownEntities"] = VECTOR_OVERHEAD; // for outer vector _knownEntities
-  for (vector< map< vector<IndexType>, IndexType > >::iterator entryIt = _knownEntities.begin(); entryIt != _knownEntities.end(); entryIt++)
-  {
-    variableCost["_knownEntities"] += MAP_OVERHEAD; // for inner map
-    for (map< vector<IndexType>, IndexType >::iterator entry2It = entryIt->begin(); entry2It != entryIt->end(); entry2It++)
-    {
-      vector<IndexType> entryVector = entry2It->first;
-      variableCost["_knownEntities"] += approximateVectorSizeLLVM(entryVector) + sizeof(IndexType);
-    }
-  }
-  variableCost["_knownEntities"] += MAP_OVERHEAD * (_knownEntities.capacity() - _knownEntities.size());
+  variableCost["_entities"] += sizeof(EntityNodeStore) * (_entities.capacity() - _entities.size());
 
   variableCost["_canonicalEntityOrdering"] = VECTOR_OVERHEAD; // for outer vector _canonicalEntityOrdering
   for (vector< vector< vector<IndexType> > >::iterator entryIt = _canonicalEntityOrdering.begin(); entryIt != _canonicalEntityOrdering.end(); entryIt++)
@@ -236,7 +222,7 @@ map<string, long long> MeshTopology::approximateMemoryCosts()
   }
   variableCost["_sidesForEntities"] += VECTOR_OVERHEAD * (_sidesForEntities.capacity() - _sidesForEntities.size());
 
-  variableCost["_cellsForSideEntities"] = approximateMapSizeLLVM(_cellsForSideEntities);
+  variableCost["_cellsForSideEntities"] = approximateVectorSizeLLVM(_cellsForSideEntities);
 
   variableCost["_boundarySides"] = approximateSetSizeLLVM(_boundarySides);
 
@@ -287,10 +273,10 @@ map<string, long long> MeshTopology::approximateMemoryCosts()
   }
   variableCost["_entityCellTopologyKeys"] += VECTOR_OVERHEAD * (_entityCellTopologyKeys.capacity() - _entityCellTopologyKeys.size());
 
-  variableCost["_cells"] = approximateMapSizeLLVM(_cells); // _cells map
-  for (auto cellEntry = _cells.begin(); cellEntry != _cells.end(); cellEntry++)
+  variableCost["_cells"] = approximateVectorSizeLLVM(_cells); // _cells vector
+  for (CellPtr cell : _cells)
   {
-    variableCost["_cells"] += cellEntry->second->approximateMemoryFootprint();
+    if (cell != Teuchos::null) variableCost["_cells"] += cell->approximateMemoryFootprint();
   }
 
   variableCost["_activeCells"] = approximateSetSizeLLVM(_activeCells);
@@ -363,7 +349,7 @@ unsigned MeshTopology::addCell(IndexType cellIndex, CellTopoPtrLegacy shardsTopo
 
 unsigned MeshTopology::addCell(IndexType cellIndex, CellTopoPtr cellTopo, const vector<unsigned> &cellVertices, unsigned parentCellIndex)
 {
-  TEUCHOS_TEST_FOR_EXCEPTION(_cells.find(cellIndex) != _cells.end(), std::invalid_argument, "addCell: cell with specified cellIndex already exists!");
+  TEUCHOS_TEST_FOR_EXCEPTION((cellIndex < _cells.size()) && (_cells[cellIndex] != Teuchos::null), std::invalid_argument, "addCell: cell with specified cellIndex already exists!");
   
   vector< vector< unsigned > > cellEntityPermutations;
   
@@ -376,7 +362,7 @@ unsigned MeshTopology::addCell(IndexType cellIndex, CellTopoPtr cellTopo, const
     cellEntityIndices[d] = vector<unsigned>(entityCount);
     for (int j=0; j<entityCount; j++)
     {
-      // for now, we treat vertices just like all the others--could save a bit of memory, etc. by not storing in _knownEntities[0], etc.
+      // for now, we treat vertices just like all the others--could save a bit of memory, etc. by not storing in _entities[0], etc.
       unsigned entityIndex, entityPermutation;
       vector< unsigned > nodes;
       if (d != 0)
@@ -427,13 +413,19 @@ unsigned MeshTopology::addCell(IndexType cellIndex, CellTopoPtr cellTopo, const
     }
   }
   CellPtr cell = Teuchos::rcp( new Cell(cellTopo, cellVertices, cellEntityPermutations, cellIndex, this) );
+  if (cellIndex >= _cells.size()) _cells.resize(cellIndex + 1);
   _cells[cellIndex] = cell;
+  _knownCellCount++;
   _activeCells.insert(cellIndex);
   _rootCells.insert(cellIndex); // will remove if a parent relationship is established
   if (parentCellIndex != -1)
   {
     cell->setParent(getCell(parentCellIndex));
   }
+  else
+  {
+    _cellSpatialIndex = Teuchos::null; // the domain may have changed
+  }
 
   // set neighbors:
   unsigned sideDim = _spaceDim - 1;
@@ -554,7 +546,12 @@ unsigned MeshTopology::addCell(IndexType cellIndex, CellTopoPtr cellTopo, const
 
 void MeshTopology::addCellForSide(unsigned int cellIndex, unsigned int sideOrdinal, unsigned int sideEntityIndex)
 {
-  if (_cellsForSideEntities.find(sideEntityIndex) == _cellsForSideEntities.end())
+  if (sideEntityIndex >= _cellsForSideEntities.size())
+  {
+    pair< unsigned, unsigned > noCell = {-1,-1};
+    _cellsForSideEntities.resize(sideEntityIndex + 1, make_pair(noCell, noCell));
+  }
+  if (_cellsForSideEntities[sideEntityIndex].first.first == -1)
   {
     pair< unsigned, unsigned > cell1 = make_pair(cellIndex, sideOrdinal);
     pair< unsigned, unsigned > cell2 = {-1,-1};
@@ -611,11 +608,11 @@ void MeshTopology::addEdgeCurve(pair<unsigned,unsigned> edge, ParametricCurvePtr
 
   std::sort(edgeNodes.begin(), edgeNodes.end());
 
-  if (_knownEntities[edgeDim].find(edgeNodes) == _knownEntities[edgeDim].end() )
+  unsigned edgeIndex = _entities[edgeDim].find(edgeNodes);
+  if (edgeIndex == -1)
   {
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "edge not found.");
   }
-  unsigned edgeIndex = _knownEntities[edgeDim][edgeNodes];
   if (getChildEntities(edgeDim, edgeIndex).size() > 0)
   {
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "setting curves along broken edges not supported.  Should set for each piece separately.");
@@ -650,6 +647,7 @@ void MeshTopology::addEdgeCurve(pair<unsigned,unsigned> edge, ParametricCurvePtr
   _edgeToCurveMap[edge] = curve;
   pair<IndexType,IndexType> reverseEdge = {edge.second,edge.first};
   _edgeToCurveMap[reverseEdge] = ParametricCurve::reverse(curve);
+  _cellSpatialIndex = Teuchos::null; // the cells along the edge may no longer lie within their vertices' bounding boxes
 
   vector< pair<IndexType, unsigned> > cellsForEdge = _activeCellsForEntities[edgeDim][edgeIndex];
   //  (cellIndex, entityOrdinalInCell)
@@ -747,9 +745,7 @@ unsigned MeshTopology::addEntity(CellTopoPtr entityTopo, const vector<unsigned>
   if ( entityIndex == -1 )
   {
     // new entity
-    entityIndex = _entities[d].size();
-    _entities[d].push_back(sortedVertices);
-    _knownEntities[d].insert(make_pair(sortedVertices, entityIndex));
+    entityIndex = _entities[d].addEntity(sortedVertices);
     if (d != 0) _canonicalEntityOrdering[d].push_back(entityVertices);
     entityPermutation = 0;
     if (_knownTopologies.find(entityTopo->getKey()) == _knownTopologies.end())
@@ -830,7 +826,7 @@ vector<IndexType> MeshTopology::getCanonicalEntityNodesViaPeriodicBCs(unsigned d
   vector<IndexType> sortedNodes(myEntityNodes.begin(),myEntityNodes.end());
   std::sort(sortedNodes.begin(), sortedNodes.end());
   
-  if (_knownEntities[d].find(sortedNodes) != _knownEntities[d].end())
+  if (_entities[d].find(sortedNodes) != -1)
   {
     return myEntityNodes;
   }
@@ -893,7 +889,7 @@ vector<IndexType> MeshTopology::getCanonicalEntityNodesViaPeriodicBCs(unsigned d
       vector<IndexType> sortedEquivalentNodeVector = equivalentNodeVector;
       std::sort(sortedEquivalentNodeVector.begin(), sortedEquivalentNodeVector.end());
 
-      if (_knownEntities[d].find(sortedEquivalentNodeVector) != _knownEntities[d].end())
+      if (_entities[d].find(sortedEquivalentNodeVector) != -1)
       {
         return equivalentNodeVector;
       }
@@ -949,75 +945,263 @@ bool MeshTopology::cellContainsPoint(GlobalIndexType cellID, const vector<double
 
 IndexType MeshTopology::cellCount()
 {
-  return _cells.size();
+  return _knownCellCount;
+}
+
+void MeshTopology::addCellToSpatialIndex(IndexType cellIndex)
+{
+  if (cellIsBoundedByVertices(cellIndex))
+  {
+    CellPtr cell = getCell(cellIndex);
+    FieldContainer<double> cellVertices(cell->vertices().size(), _spaceDim);
+    verticesForCell(cellVertices, cellIndex);
+    _cellSpatialIndex->insertCell(cellIndex, cellVertices);
+  }
+  else
+  {
+    _cellSpatialIndex->insertUnboundedCell(cellIndex);
+  }
+}
+
+void MeshTopology::buildCellSpatialIndex()
+{
+  vector<double> domainMin(_spaceDim, numeric_limits<double>::max());
+  vector<double> domainMax(_spaceDim, -numeric_limits<double>::max());
+  for (IndexType rootCellIndex : _rootCells)
+  {
+    for (IndexType vertexIndex : getCell(rootCellIndex)->vertices())
+    {
+      for (int d=0; d<_spaceDim; d++)
+      {
+        domainMin[d] = min(domainMin[d], _vertices[vertexIndex][d]);
+        domainMax[d] = max(domainMax[d], _vertices[vertexIndex][d]);
+      }
+    }
+  }
+  if (_rootCells.size() == 0)
+  {
+    domainMin = vector<double>(_spaceDim, 0.0);
+    domainMax = vector<double>(_spaceDim, 0.0);
+  }
+  _cellSpatialIndex = Teuchos::rcp( new CellSpatialIndex(domainMin, domainMax, _activeCells.size()) );
+  for (IndexType cellIndex : _activeCells)
+  {
+    addCellToSpatialIndex(cellIndex);
+  }
+}
+
+bool MeshTopology::cellIsBoundedByVertices(IndexType cellIndex)
+{
+  // straight-sided cells lie within the convex hull of their vertices; we are conservative about curvilinear cells and their descendants
+  if (_transformationFunction == Teuchos::null) return true;
+  CellPtr cell = getCell(cellIndex);
+  while (cell != Teuchos::null)
+  {
+    if (_cellIDsWithCurves.find(cell->cellIndex()) != _cellIDsWithCurves.end()) return false;
+    if (cellHasCurvedEdges(cell->cellIndex())) return false;
+    cell = cell->getParent();
+  }
+  return true;
 }
 
 vector<IndexType> MeshTopology::cellIDsForPoints(const FieldContainer<double> &physicalPoints)
 {
   // returns a vector of an active element per point, or null if there is no element including that point
-  vector<GlobalIndexType> cellIDs;
-  //  cout << "entered elementsForPoints: \n" << physicalPoints;
+  vector<IndexType> cellIDs;
+  FieldContainer<double> refPoints;
+  cellIDsAndReferencePointsForPoints(physicalPoints, cellIDs, refPoints);
+  return cellIDs;
+}
+
+void MeshTopology::cellIDsAndReferencePointsForPoints(const FieldContainer<double> &physicalPoints, vector<IndexType> &cellIDs,
+                                                      FieldContainer<double> &refPoints)
+{
   int numPoints = physicalPoints.dimension(0);
+  int spaceDim = this->getDimension();
+  
+  cellIDs.assign(numPoints, -1);
+  if (numPoints == 0) return;
+  refPoints.resize(numPoints, spaceDim);
+  
+  if (_cellSpatialIndex == Teuchos::null)
+  {
+    buildCellSpatialIndex();
+  }
+  
+  // first pass: gather candidate active cells for each point, grouping the points by candidate
+  vector<bool> hasCandidates(numPoints, false);
+  map<IndexType, vector<int> > pointsForCandidateCell;
+  vector<IndexType> candidates;
+  for (int pointOrdinal=0; pointOrdinal<numPoints; pointOrdinal++)
+  {
+    _cellSpatialIndex->candidateCells(&physicalPoints(pointOrdinal,0), candidates);
+    hasCandidates[pointOrdinal] = (candidates.size() > 0);
+    for (IndexType cellID : candidates)
+    {
+      pointsForCandidateCell[cellID].push_back(pointOrdinal);
+    }
+  }
+  
+  // when a point lies on the boundary between cells, we select the same cell that descent from the root cells would:
+  // the one with the lexicographically least (rootCellIndex, childOrdinal, childOrdinal, ...) ancestry
+  auto ancestry = [this] (IndexType cellID) -> vector<IndexType>
+  {
+    vector<IndexType> path;
+    CellPtr cell = getCell(cellID);
+    while (cell->getParent() != Teuchos::null)
+    {
+      CellPtr parent = cell->getParent();
+      const vector<CellPtr>* children = &parent->children();
+      IndexType childOrdinal = 0;
+      while ((*children)[childOrdinal]->cellIndex() != cell->cellIndex()) childOrdinal++;
+      path.push_back(childOrdinal);
+      cell = parent;
+    }
+    path.push_back(cell->cellIndex());
+    std::reverse(path.begin(), path.end());
+    return path;
+  };
+  
+  // second pass: map each candidate cell's points to its reference frame together, and test for inclusion
+  MeshTopologyPtr thisPtr = Teuchos::rcp(this,false);
+  for (auto &candidateEntry : pointsForCandidateCell)
+  {
+    IndexType cellID = candidateEntry.first;
+    const vector<int>* pointOrdinals = &candidateEntry.second;
+    int numCellPoints = pointOrdinals->size();
+    
+    FieldContainer<double> cellPhysicalPoints(1,numCellPoints,spaceDim);
+    for (int i=0; i<numCellPoints; i++)
+    {
+      for (int d=0; d<spaceDim; d++)
+      {
+        cellPhysicalPoints(0,i,d) = physicalPoints((*pointOrdinals)[i],d);
+      }
+    }
+    int cubatureDegreeForCell = 1;
+    if (_gda != NULL)
+    {
+      cubatureDegreeForCell = _gda->getCubatureDegree(cellID);
+    }
+    FieldContainer<double> cellRefPoints(1,numCellPoints,spaceDim);
+    CamelliaCellTools::mapToReferenceFrame(cellRefPoints, cellPhysicalPoints, thisPtr, cellID, cubatureDegreeForCell);
+    
+    CellTopoPtr cellTopo = getCell(cellID)->topology();
+    for (int i=0; i<numCellPoints; i++)
+    {
+      if (CamelliaCellTools::checkPointInclusion(&cellRefPoints(0,i,0), spaceDim, cellTopo) != 1) continue;
+      int pointOrdinal = (*pointOrdinals)[i];
+      if ((cellIDs[pointOrdinal] != -1) && (ancestry(cellIDs[pointOrdinal]) < ancestry(cellID))) continue;
+      cellIDs[pointOrdinal] = cellID;
+      for (int d=0; d<spaceDim; d++)
+      {
+        refPoints(pointOrdinal,d) = cellRefPoints(0,i,d);
+      }
+    }
+  }
+  
+  // finally, for points near the mesh that no active cell claimed (possible with inexact inverse maps), fall back on descent from the root cells
+  for (int pointOrdinal=0; pointOrdinal<numPoints; pointOrdinal++)
+  {
+    if ((cellIDs[pointOrdinal] != -1) || !hasCandidates[pointOrdinal]) continue;
+    vector<double> point(spaceDim);
+    for (int d=0; d<spaceDim; d++)
+    {
+      point[d] = physicalPoints(pointOrdinal,d);
+    }
+    IndexType cellID = cellIDForPointByDescent(point);
+    if (cellID == -1) continue;
+    
+    int cubatureDegreeForCell = 1;
+    if (_gda != NULL)
+    {
+      cubatureDegreeForCell = _gda->getCubatureDegree(cellID);
+    }
+    FieldContainer<double> cellPhysicalPoints(1,1,spaceDim), cellRefPoints(1,1,spaceDim);
+    for (int d=0; d<spaceDim; d++)
+    {
+      cellPhysicalPoints(0,0,d) = point[d];
+    }
+    CamelliaCellTools::mapToReferenceFrame(cellRefPoints, cellPhysicalPoints, thisPtr, cellID, cubatureDegreeForCell);
+    cellIDs[pointOrdinal] = cellID;
+    for (int d=0; d<spaceDim; d++)
+    {
+      refPoints(pointOrdinal,d) = cellRefPoints(0,0,d);
+    }
+  }
+}
 
+IndexType MeshTopology::cellIDForPointByDescent(const vector<double> &point)
+{
   int spaceDim = this->getDimension();
 
-  set<GlobalIndexType> rootCellIndices = this->getRootCellIndices();
+  const set<IndexType>* rootCellIndices = &this->getRootCellIndices();
 
   // NOTE: the above does depend on the domain of the mesh remaining fixed after refinements begin.
 
-  for (int pointIndex=0; pointIndex<numPoints; pointIndex++)
+  // find the element from the original mesh that contains this point
+  CellPtr cell;
+  for (set<IndexType>::const_iterator cellIt = rootCellIndices->begin(); cellIt != rootCellIndices->end(); cellIt++)
   {
-    vector<double> point;
-
-    for (int d=0; d<spaceDim; d++)
+    IndexType cellID = *cellIt;
+    int cubatureDegreeForCell = 1;
+    if (_gda != NULL)
     {
-      point.push_back(physicalPoints(pointIndex,d));
+      cubatureDegreeForCell = _gda->getCubatureDegree(cellID);
     }
-
-    // find the element from the original mesh that contains this point
-    CellPtr cell;
-    for (set<GlobalIndexType>::iterator cellIt = rootCellIndices.begin(); cellIt != rootCellIndices.end(); cellIt++)
+    if (cellContainsPoint(cellID,point,cubatureDegreeForCell))
     {
-      GlobalIndexType cellID = *cellIt;
-      int cubatureDegreeForCell = 1;
-      if (_gda != NULL)
-      {
-        cubatureDegreeForCell = _gda->getCubatureDegree(cellID);
-      }
-      if (cellContainsPoint(cellID,point,cubatureDegreeForCell))
-      {
-        cell = getCell(cellID);
-        break;
-      }
+      cell = getCell(cellID);
+      break;
     }
-    if (cell.get() != NULL)
+  }
+  if (cell.get() != NULL)
+  {
+    MeshTopologyPtr thisPtr = Teuchos::rcp(this,false);
+    while ( cell->isParent(thisPtr) )
     {
-      MeshTopologyPtr thisPtr = Teuchos::rcp(this,false);
-      while ( cell->isParent(thisPtr) )
+      int numChildren = cell->numChildren();
+      bool foundMatchingChild = false;
+      for (int childOrdinal = 0; childOrdinal < numChildren; childOrdinal++)
       {
-        int numChildren = cell->numChildren();
-        bool foundMatchingChild = false;
-        for (int childOrdinal = 0; childOrdinal < numChildren; childOrdinal++)
+        CellPtr child = cell->children()[childOrdinal];
+        int cubatureDegreeForCell = 1;
+        if (_gda != NULL)
         {
-          CellPtr child = cell->children()[childOrdinal];
-          int cubatureDegreeForCell = 1;
-          if (_gda != NULL)
-          {
-            cubatureDegreeForCell = _gda->getCubatureDegree(child->cellIndex());
-          }
-          if ( cellContainsPoint(child->cellIndex(),point,cubatureDegreeForCell) )
+          cubatureDegreeForCell = _gda->getCubatureDegree(child->cellIndex());
+        }
+        if ( cellContainsPoint(child->cellIndex(),point,cubatureDegreeForCell) )
+        {
+          cell = child;
+          foundMatchingChild = true;
+          break;
+        }
+      }
+      if (!foundMatchingChild)
+      {
+        cout << "parent matches, but none of its children do... will return nearest cell centroid\n";
+        int numVertices = cell->vertices().size();
+        FieldContainer<double> vertices(numVertices,spaceDim);
+        vector<unsigned> vertexIndices = cell->vertices();
+
+        //vertices.resize(numVertices,dimension);
+        for (unsigned vertexOrdinal = 0; vertexOrdinal < numVertices; vertexOrdinal++)
+        {
+          for (int d=0; d<spaceDim; d++)
           {
-            cell = child;
-            foundMatchingChild = true;
-            break;
+            vertices(vertexOrdinal,d) = getVertex(vertexIndices[vertexOrdinal])[d];
           }
         }
-        if (!foundMatchingChild)
+
+        cout << "parent vertices:\n" << vertices;
+        double minDistance = numeric_limits<double>::max();
+        int childSelected = -1;
+        for (int childIndex = 0; childIndex < numChildren; childIndex++)
         {
-          cout << "parent matches, but none of its children do... will return nearest cell centroid\n";
-          int numVertices = cell->vertices().size();
+          CellPtr child = cell->children()[childIndex];
+          int numVertices = child->vertices().size();
           FieldContainer<double> vertices(numVertices,spaceDim);
-          vector<unsigned> vertexIndices = cell->vertices();
+          vector<unsigned> vertexIndices = child->vertices();
 
           //vertices.resize(numVertices,dimension);
           for (unsigned vertexOrdinal = 0; vertexOrdinal < numVertices; vertexOrdinal++)
@@ -1027,52 +1211,31 @@ vector<IndexType> MeshTopology::cellIDsForPoints(const FieldContainer<double> &p
               vertices(vertexOrdinal,d) = getVertex(vertexIndices[vertexOrdinal])[d];
             }
           }
-
-          cout << "parent vertices:\n" << vertices;
-          double minDistance = numeric_limits<double>::max();
-          int childSelected = -1;
-          for (int childIndex = 0; childIndex < numChildren; childIndex++)
+          cout << "child " << childIndex << ", vertices:\n" << vertices;
+          vector<double> cellCentroid = getCellCentroid(child->cellIndex());
+          double squaredDistance = 0;
+          for (int d=0; d<spaceDim; d++)
           {
-            CellPtr child = cell->children()[childIndex];
-            int numVertices = child->vertices().size();
-            FieldContainer<double> vertices(numVertices,spaceDim);
-            vector<unsigned> vertexIndices = child->vertices();
-
-            //vertices.resize(numVertices,dimension);
-            for (unsigned vertexOrdinal = 0; vertexOrdinal < numVertices; vertexOrdinal++)
-            {
-              for (int d=0; d<spaceDim; d++)
-              {
-                vertices(vertexOrdinal,d) = getVertex(vertexIndices[vertexOrdinal])[d];
-              }
-            }
-            cout << "child " << childIndex << ", vertices:\n" << vertices;
-            vector<double> cellCentroid = getCellCentroid(child->cellIndex());
-            double squaredDistance = 0;
-            for (int d=0; d<spaceDim; d++)
-            {
-              squaredDistance += (cellCentroid[d] - physicalPoints(pointIndex,d)) * (cellCentroid[d] - physicalPoints(pointIndex,d));
-            }
+            squaredDistance += (cellCentroid[d] - point[d]) * (cellCentroid[d] - point[d]);
+          }
 
-            double distance = sqrt(squaredDistance);
-            if (distance < minDistance)
-            {
-              minDistance = distance;
-              childSelected = childIndex;
-            }
+          double distance = sqrt(squaredDistance);
+          if (distance < minDistance)
+          {
+            minDistance = distance;
+            childSelected = childIndex;
           }
-          cell = cell->children()[childSelected];
         }
+        cell = cell->children()[childSelected];
       }
     }
-    GlobalIndexType cellID = -1;
-    if (cell.get() != NULL)
-    {
-      cellID = cell->cellIndex();
-    }
-    cellIDs.push_back(cellID);
   }
-  return cellIDs;
+  IndexType cellID = -1;
+  if (cell.get() != NULL)
+  {
+    cellID = cell->cellIndex();
+  }
+  return cellID;
 }
 
 EntitySetPtr MeshTopology::createEntitySet()
@@ -1193,7 +1356,7 @@ vector<double> MeshTopology::getCellCentroid(IndexType cellIndex)
 
 unsigned MeshTopology::getCellCountForSide(IndexType sideEntityIndex)
 {
-  if (_cellsForSideEntities.find(sideEntityIndex) == _cellsForSideEntities.end())
+  if ((sideEntityIndex >= _cellsForSideEntities.size()) || (_cellsForSideEntities[sideEntityIndex].first.first == -1))
   {
     return 0;
   }
@@ -1244,13 +1407,13 @@ EntitySetPtr MeshTopology::getEntitySetInitialTime() const
 
 pair<IndexType, unsigned> MeshTopology::getFirstCellForSide(IndexType sideEntityIndex)
 {
-  if (_cellsForSideEntities.find(sideEntityIndex) == _cellsForSideEntities.end()) return {-1,-1};
+  if (sideEntityIndex >= _cellsForSideEntities.size()) return {-1,-1};
   return _cellsForSideEntities[sideEntityIndex].first;
 }
 
 pair<IndexType, unsigned> MeshTopology::getSecondCellForSide(IndexType sideEntityIndex)
 {
-  if (_cellsForSideEntities.find(sideEntityIndex) == _cellsForSideEntities.end()) return {-1,-1};
+  if (sideEntityIndex >= _cellsForSideEntities.size()) return {-1,-1};
   return _cellsForSideEntities[sideEntityIndex].second;
 }
 
@@ -1260,10 +1423,12 @@ vector<IndexType> MeshTopology::getBoundarySidesThatMatch(SpatialFilterPtr spati
   vector<IndexType> matchingSides;
   for (IndexType sideEntityIndex : _boundarySides)
   {
-    const vector<IndexType>* nodesForSide = &_entities[sideDim][sideEntityIndex];
+    const IndexType* nodesForSide = _entities[sideDim].nodes(sideEntityIndex);
+    int nodeCount = _entities[sideDim].nodeCount(sideEntityIndex);
     bool allMatch = true;
-    for (IndexType vertexIndex : *nodesForSide)
+    for (int nodeOrdinal=0; nodeOrdinal<nodeCount; nodeOrdinal++)
     {
+      IndexType vertexIndex = nodesForSide[nodeOrdinal];
       if (! spatialFilter->matchesPoint(_vertices[vertexIndex]) )
       {
         allMatch = false;
@@ -1284,7 +1449,7 @@ void MeshTopology::deactivateCell(CellPtr cell)
     int entityCount = cellTopo->getSubcellCount(d);
     for (int j=0; j<entityCount; j++)
     {
-      // for now, we treat vertices just like all the others--could save a bit of memory, etc. by not storing in _knownEntities[0], etc.
+      // for now, we treat vertices just like all the others--could save a bit of memory, etc. by not storing in _entities[0], etc.
       int entityNodeCount = cellTopo->getNodeCount(d, j);
       set< unsigned > nodeSet;
       if (d != 0)
@@ -1397,20 +1562,21 @@ MeshTopologyPtr MeshTopology::deepCopy()
 {
   MeshTopologyPtr meshTopoCopy = Teuchos::rcp( new MeshTopology(*this) );
   meshTopoCopy->deepCopyCells();
+  meshTopoCopy->_cellSpatialIndex = Teuchos::null; // the copy will build its own
   return meshTopoCopy;
 }
 
 void MeshTopology::deepCopyCells()
 {
-  map<IndexType, CellPtr> oldCells = _cells;
+  vector<CellPtr> oldCells = _cells;
   
   Teuchos::RCP<MeshTopology> thisPtr = Teuchos::rcp(this,false);
 
   // first pass: construct cells
-  for (auto oldCellEntry : oldCells)
+  for (IndexType oldCellIndex=0; oldCellIndex<oldCells.size(); oldCellIndex++)
   {
-    CellPtr oldCell = oldCellEntry.second;
-    IndexType oldCellIndex = oldCellEntry.first;
+    CellPtr oldCell = oldCells[oldCellIndex];
+    if (oldCell == Teuchos::null) continue;
     _cells[oldCellIndex] = Teuchos::rcp( new Cell(oldCell->topology(), oldCell->vertices(), oldCell->subcellPermutations(), oldCell->cellIndex(), this) );
     for (int sideOrdinal=0; sideOrdinal<oldCell->getSideCount(); sideOrdinal++)
     {
@@ -1420,10 +1586,10 @@ void MeshTopology::deepCopyCells()
   }
 
   // second pass: establish parent-child relationships
-  for (auto oldCellEntry : oldCells)
+  for (IndexType oldCellIndex=0; oldCellIndex<oldCells.size(); oldCellIndex++)
   {
-    IndexType oldCellIndex = oldCellEntry.first;
-    CellPtr oldCell = oldCellEntry.second;
+    CellPtr oldCell = oldCells[oldCellIndex];
+    if (oldCell == Teuchos::null) continue;
 
     CellPtr oldParent = oldCell->getParent();
     if (oldParent != Teuchos::null)
@@ -1543,7 +1709,7 @@ vector< pair<unsigned,unsigned> > MeshTopology::getActiveCellIndices(unsigned d,
 
 CellPtr MeshTopology::getCell(unsigned cellIndex)
 {
-  if (cellIndex > _cells.size())
+  if (cellIndex >= _cells.size())
   {
     cout << "MeshTopology::getCell: cellIndex " << cellIndex << " out of bounds (0, " << _cells.size() - 1 << ").\n";
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "cellIndex out of bounds.\n");
@@ -1633,9 +1799,10 @@ unsigned MeshTopology::getEntityIndex(unsigned d, const set<unsigned> &nodeSet)
     }
   }
   vector<unsigned> sortedNodes(nodeSet.begin(),nodeSet.end());
-  if (_knownEntities[d].find(sortedNodes) != _knownEntities[d].end())
+  IndexType entityIndex = _entities[d].find(sortedNodes);
+  if (entityIndex != -1)
   {
-    return _knownEntities[d][sortedNodes];
+    return entityIndex;
   }
   else if (_periodicBCs.size() > 0)
   {
@@ -1649,9 +1816,10 @@ unsigned MeshTopology::getEntityIndex(unsigned d, const set<unsigned> &nodeSet)
       std::sort(sortedEquivalentNodeVector.begin(), sortedEquivalentNodeVector.end());
 
 //      set<IndexType> equivalentNodeSet(equivalentNodeVector.begin(),equivalentNodeVector.end());
-      if (_knownEntities[d].find(sortedEquivalentNodeVector) != _knownEntities[d].end())
+      IndexType equivalentEntityIndex = _entities[d].find(sortedEquivalentNodeVector);
+      if (equivalentEntityIndex != -1)
       {
-        return _knownEntities[d][sortedEquivalentNodeVector];
+        return equivalentEntityIndex;
       }
     }
   }
@@ -1935,7 +2103,7 @@ unsigned MeshTopology::getVertexIndexAdding(const vector<double> &vertex, double
   // update the various entity containers
   int vertexDim = 0;
   vector<IndexType> nodeVector(1,vertexIndex);
-  _entities[vertexDim].push_back(nodeVector);
+  _entities[vertexDim].addEntity(nodeVector, false); // made findable below, unless periodic BCs identify it with an existing vertex
   vector<IndexType> entityVertices;
   entityVertices.push_back(vertexIndex);
   //_canonicalEntityOrdering[vertexDim][vertexIndex] = entityVertices;
@@ -1946,7 +2114,7 @@ unsigned MeshTopology::getVertexIndexAdding(const vector<double> &vertex, double
   }
   _entityCellTopologyKeys[vertexDim].push_back(nodeTopo->getKey());
   
-  // new 2-11-16: when using periodic BCs, only add vertex to _knownEntities if it is the original matching point
+  // new 2-11-16: when using periodic BCs, only make vertex findable if it is the original matching point
   bool matchFound = false;
   for (int i=0; i<_periodicBCs.size(); i++)
   {
@@ -1980,7 +2148,7 @@ unsigned MeshTopology::getVertexIndexAdding(const vector<double> &vertex, double
   }
   if (!matchFound)
   {
-    _knownEntities[vertexDim][nodeVector] = vertexIndex;
+    _entities[vertexDim].makeFindable(vertexIndex);
   }
 
   return vertexIndex;
@@ -2377,7 +2545,7 @@ bool MeshTopology::isBoundarySide(IndexType sideEntityIndex)
 
 bool MeshTopology::isValidCellIndex(IndexType cellIndex)
 {
-  return cellIndex < _cells.size();
+  return (cellIndex < _cells.size()) && (_cells[cellIndex] != Teuchos::null);
 }
 
 pair<IndexType,IndexType> MeshTopology::owningCellIndexForConstrainingEntity(unsigned d, IndexType constrainingEntityIndex)
@@ -2736,6 +2904,7 @@ void MeshTopology::printAllEntities()
   for (int cellIndex=0; cellIndex<numCells; cellIndex++)
   {
     CellPtr cell = getCell(cellIndex);
+    if (cell == Teuchos::null) continue;
     cout << "Cell " << cellIndex << ":\n";
     int vertexCount = cell->vertices().size();
     for (int vertexOrdinal=0; vertexOrdinal<vertexCount; vertexOrdinal++)
@@ -2910,6 +3079,24 @@ void MeshTopology::refineCell(IndexType cellIndex, RefinementPatternPtr refPatte
     //      _transformationFunction->updateCells(childrenWithCurvedEdges);
     //    }
   }
+  
+  if (_cellSpatialIndex != Teuchos::null)
+  {
+    // once the grid becomes crowded, discard it; it will be rebuilt at a finer resolution when next needed
+    const int MAX_CELLS_PER_BIN = 8;
+    if (_cellSpatialIndex->cellCount() + numChildren - 1 > MAX_CELLS_PER_BIN * _cellSpatialIndex->binCount())
+    {
+      _cellSpatialIndex = Teuchos::null;
+    }
+    else
+    {
+      _cellSpatialIndex->removeCell(cellIndex);
+      for (int childOrdinal=0; childOrdinal<numChildren; childOrdinal++)
+      {
+        addCellToSpatialIndex(firstChildCellIndex + childOrdinal);
+      }
+    }
+  }
 }
 
 void MeshTopology::refineCellEntities(CellPtr cell, RefinementPatternPtr refPattern)
@@ -3136,6 +3323,7 @@ void MeshTopology::setEdgeToCurveMap(const map< pair<IndexType, IndexType>, Para
   _edgeToCurveMap.clear();
   map< pair<IndexType, IndexType>, ParametricCurvePtr >::const_iterator edgeIt;
   _cellIDsWithCurves.clear();
+  _cellSpatialIndex = Teuchos::null;
 
   for (edgeIt = edgeToCurveMap.begin(); edgeIt != edgeToCurveMap.end(); edgeIt++)
   {
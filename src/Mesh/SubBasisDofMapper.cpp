@@ -32,7 +32,8 @@ SubBasisDofMapperPtr SubBasisDofMapper::subBasisDofMapper(const set<int> &dofOrd
   return Teuchos::rcp(new SubBasisDofPermutationMapper(dofOrdinalFilter, globalDofOrdinals));
 }
 
-SubBasisDofMapperPtr SubBasisDofMapper::subBasisDofMapper(const set<int> &dofOrdinalFilter, const vector<GlobalIndexType> &globalDofOrdinals, const FieldContainer<double> &constraintMatrix)
+// ! returns a permutation mapper if the constraint matrix is a permutation matrix, and null otherwise
+static SubBasisDofMapperPtr permutationMapper(const set<int> &dofOrdinalFilter, const vector<GlobalIndexType> &globalDofOrdinals, const FieldContainer<double> &constraintMatrix)
 {
   bool checkForPermutation = true;
 
@@ -131,6 +132,21 @@ SubBasisDofMapperPtr SubBasisDofMapper::subBasisDofMapper(const set<int> &dofOrd
       }
     }
   }
+  return Teuchos::null;
+}
+
+SubBasisDofMapperPtr SubBasisDofMapper::subBasisDofMapper(const set<int> &dofOrdinalFilter, const vector<GlobalIndexType> &globalDofOrdinals, const FieldContainer<double> &constraintMatrix)
+{
+  SubBasisDofMapperPtr mapper = permutationMapper(dofOrdinalFilter, globalDofOrdinals, constraintMatrix);
+  if (mapper != Teuchos::null) return mapper;
+  return Teuchos::rcp(new SubBasisDofMatrixMapper(dofOrdinalFilter, globalDofOrdinals, constraintMatrix));
+}
+
+SubBasisDofMapperPtr SubBasisDofMapper::subBasisDofMapper(const set<int> &dofOrdinalFilter, const vector<GlobalIndexType> &globalDofOrdinals,
+                                                          Teuchos::RCP<const FieldContainer<double>> constraintMatrix)
+{
+  SubBasisDofMapperPtr mapper = permutationMapper(dofOrdinalFilter, globalDofOrdinals, *constraintMatrix);
+  if (mapper != Teuchos::null) return mapper;
   return Teuchos::rcp(new SubBasisDofMatrixMapper(dofOrdinalFilter, globalDofOrdinals, constraintMatrix));
 }
 
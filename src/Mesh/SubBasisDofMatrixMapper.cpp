@@ -17,18 +17,24 @@ using namespace Intrepid;
 using namespace Camellia;
 
 SubBasisDofMatrixMapper::SubBasisDofMatrixMapper(const set<int> &basisDofOrdinalFilter, const vector<GlobalIndexType> &mappedGlobalDofOrdinals, const FieldContainer<double> &constraintMatrix)
+  : SubBasisDofMatrixMapper(basisDofOrdinalFilter, mappedGlobalDofOrdinals, Teuchos::rcp( new FieldContainer<double>(constraintMatrix) ))
+{
+}
+
+SubBasisDofMatrixMapper::SubBasisDofMatrixMapper(const set<int> &basisDofOrdinalFilter, const vector<GlobalIndexType> &mappedGlobalDofOrdinals,
+                                                 Teuchos::RCP<const FieldContainer<double>> constraintMatrix)
 {
   _basisDofOrdinalFilter = basisDofOrdinalFilter;
   _mappedGlobalDofOrdinals = mappedGlobalDofOrdinals;
   _constraintMatrix = constraintMatrix;
 
   // The constraint matrix should have size (fine,coarse) -- which is to say (local, global)
-  if (_constraintMatrix.dimension(0) != basisDofOrdinalFilter.size())
+  if (_constraintMatrix->dimension(0) != basisDofOrdinalFilter.size())
   {
     cout << "ERROR: constraint matrix row dimension must match the local sub-basis size.\n";
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "constraint matrix row dimension must match the local sub-basis size");
   }
-  if (_constraintMatrix.dimension(1) != mappedGlobalDofOrdinals.size())
+  if (_constraintMatrix->dimension(1) != mappedGlobalDofOrdinals.size())
   {
     cout << "ERROR: constraint matrix column dimension must match the number of mapped global dof ordinals.\n";
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "constraint matrix column dimension must match the number of mapped global dof ordinals");
@@ -132,12 +138,12 @@ const set<int> & SubBasisDofMatrixMapper::basisDofOrdinalFilter()
 
 const FieldContainer<double> &SubBasisDofMatrixMapper::constraintMatrix()
 {
-  return _constraintMatrix;
+  return *_constraintMatrix;
 }
 
 FieldContainer<double> SubBasisDofMatrixMapper::getConstraintMatrix()
 {
-  return _constraintMatrix;
+  return *_constraintMatrix;
 }
 
 bool SubBasisDofMatrixMapper::isNegatedPermutation()
@@ -165,8 +171,8 @@ FieldContainer<double> SubBasisDofMatrixMapper::mapData(bool transposeConstraint
     cout << "localData must have rank 1 or 2.\n";
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "localData must have rank 1 or 2");
   }
-  int constraintRows = transposeConstraint ? _constraintMatrix.dimension(1) : _constraintMatrix.dimension(0);
-  int constraintCols = transposeConstraint ? _constraintMatrix.dimension(0) : _constraintMatrix.dimension(1);
+  int constraintRows = transposeConstraint ? _constraintMatrix->dimension(1) : _constraintMatrix->dimension(0);
+  int constraintCols = transposeConstraint ? _constraintMatrix->dimension(0) : _constraintMatrix->dimension(1);
   int dataCols = localData.dimension(1);
   int dataRows = localData.dimension(0);
 
@@ -188,7 +194,7 @@ FieldContainer<double> SubBasisDofMatrixMapper::mapData(bool transposeConstraint
   char constraintTransposeFlag = transposeConstraint ? 'T' : 'N';
   char dataTransposeFlag = 'N';
 
-  SerialDenseWrapper::multiply(result1,_constraintMatrix,localData,constraintTransposeFlag,dataTransposeFlag);
+  SerialDenseWrapper::multiply(result1,*_constraintMatrix,localData,constraintTransposeFlag,dataTransposeFlag);
 
   if (didReshape)   // change the shape of localData back, and return result
   {
@@ -209,7 +215,7 @@ FieldContainer<double> SubBasisDofMatrixMapper::mapData(bool transposeConstraint
   char resultTransposeFlag = 'N';
 
   FieldContainer<double> result(constraintRows,constraintRows);
-  SerialDenseWrapper::multiply(result,result1,_constraintMatrix,resultTransposeFlag,constraintTransposeFlag);
+  SerialDenseWrapper::multiply(result,result1,*_constraintMatrix,resultTransposeFlag,constraintTransposeFlag);
 
   return result;
 }
@@ -274,8 +280,8 @@ void SubBasisDofMatrixMapper::mapSubBasisDataIntoGlobalContainer(const FieldCont
 {
   // like calling mapData, above, with transposeConstraint = true
   
-  int constraintRows = _constraintMatrix.dimension(1);
-  int constraintCols = _constraintMatrix.dimension(0);
+  int constraintRows = _constraintMatrix->dimension(1);
+  int constraintCols = _constraintMatrix->dimension(0);
   int dataCols = subBasisData.dimension(1);
   int dataRows = subBasisData.dimension(0);
   
@@ -297,7 +303,7 @@ void SubBasisDofMatrixMapper::mapSubBasisDataIntoGlobalContainer(const FieldCont
   char constraintTransposeFlag = 'T';
   char dataTransposeFlag = 'N';
   
-  SerialDenseWrapper::multiply(result1,_constraintMatrix,subBasisData,constraintTransposeFlag,dataTransposeFlag);
+  SerialDenseWrapper::multiply(result1,*_constraintMatrix,subBasisData,constraintTransposeFlag,dataTransposeFlag);
   
   for (int i=0; i<result1.size(); i++)
   {
@@ -323,9 +329,9 @@ set<GlobalIndexType> SubBasisDofMatrixMapper::mappedGlobalDofOrdinalsForBasisOrd
     {
       // then examine the constraint matrix entries corresponding to the dof ordinal; nonzero entries should be recorded
       double tol = 1e-15;
-      for (int j=0; j<_constraintMatrix.dimension(1); j++)
+      for (int j=0; j<_constraintMatrix->dimension(1); j++)
       {
-        if (abs(_constraintMatrix(i,j)) > tol)
+        if (abs((*_constraintMatrix)(i,j)) > tol)
         {
           globalIndices.insert(_mappedGlobalDofOrdinals[j]);
         }
@@ -338,7 +344,7 @@ set<GlobalIndexType> SubBasisDofMatrixMapper::mappedGlobalDofOrdinalsForBasisOrd
 
 SubBasisDofMapperPtr SubBasisDofMatrixMapper::negatedDofMapper()
 {
-  FieldContainer<double> negatedConstraintMatrix = _constraintMatrix;
+  FieldContainer<double> negatedConstraintMatrix = *_constraintMatrix;
   SerialDenseWrapper::multiplyFCByWeight(negatedConstraintMatrix, -1);
   return Teuchos::rcp( new SubBasisDofMatrixMapper(_basisDofOrdinalFilter, _mappedGlobalDofOrdinals, negatedConstraintMatrix) );
 }
@@ -356,9 +362,9 @@ SubBasisDofMapperPtr SubBasisDofMatrixMapper::restrictDofOrdinalFilter(const set
       rowsToKeep.push_back(i);
       restrictedDofOrdinalFilter.insert(basisDofOrdinal);
       double tol = 1e-15;
-      for (int j=0; j<_constraintMatrix.dimension(1); j++)
+      for (int j=0; j<_constraintMatrix->dimension(1); j++)
       {
-        if (abs(_constraintMatrix(i,j)) > tol)
+        if (abs((*_constraintMatrix)(i,j)) > tol)
         {
           colsToKeep.insert(j);
         }
@@ -381,7 +387,7 @@ SubBasisDofMapperPtr SubBasisDofMatrixMapper::restrictDofOrdinalFilter(const set
     int restricted_j = 0;
     for (int j : colsToKeep)
     {
-      restrictedConstraintMatrix(restricted_i, restricted_j) = _constraintMatrix(i,j);
+      restrictedConstraintMatrix(restricted_i, restricted_j) = (*_constraintMatrix)(i,j);
       restricted_j++;
     }
     restricted_i++;
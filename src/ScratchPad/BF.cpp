@@ -10,9 +10,13 @@
 
 #include "BilinearFormUtility.h"
 #include "Function.h"
+#include "GramMatrixCache.h"
+#include "IntegrationKernels.h"
+#include "ReferenceIntegralCache.h"
 #include "PreviousSolutionFunction.h"
 #include "LinearTerm.h"
 #include "SerialDenseWrapper.h"
+#include "TimerRegistry.h"
 #include "VarFactory.h"
 
 #include "Intrepid_FunctionSpaceTools.hpp"
@@ -47,6 +51,7 @@ namespace Camellia
 //    _warnAboutZeroRowsAndColumns = true;
     
     _isLegacySubclass = true;
+    _referenceIntegralCache = ReferenceIntegralCache::referenceIntegralCache();
   }
   
   template <typename Scalar>
@@ -57,6 +62,7 @@ namespace Camellia
     _trialIDs = _varFactory->trialIDs();
     _testIDs = _varFactory->testIDs();
     _isLegacySubclass = false;
+    _referenceIntegralCache = ReferenceIntegralCache::referenceIntegralCache();
     
 //    _useQRSolveForOptimalTestFunctions = true;
 //    _useSPDSolveForOptimalTestFunctions = false;
@@ -71,6 +77,7 @@ namespace Camellia
     _trialIDs = _varFactory->trialIDs();
     _testIDs = _varFactory->testIDs();
     _isLegacySubclass = false;
+    _referenceIntegralCache = ReferenceIntegralCache::referenceIntegralCache();
   }
   
   template <typename Scalar>
@@ -540,15 +547,18 @@ namespace Camellia
       TBilinearTerm<Scalar> bt = *btIt;
       TLinearTermPtr<Scalar> trialTerm = btIt->first;
       TLinearTermPtr<Scalar> testTerm = btIt->second;
+      bool forceBoundaryTerm = false, sumInto = true;
       if (rowMajor)
       {
         testTerm->integrate(stiffness, elemType->testOrderPtr,
-                            trialTerm,  elemType->trialOrderPtr, basisCache);
+                            trialTerm,  elemType->trialOrderPtr, basisCache,
+                            forceBoundaryTerm, sumInto, _referenceIntegralCache.get());
       }
       else
       {
         trialTerm->integrate(stiffness, elemType->trialOrderPtr,
-                             testTerm,  elemType->testOrderPtr, basisCache);
+                             testTerm,  elemType->testOrderPtr, basisCache,
+                             forceBoundaryTerm, sumInto, _referenceIntegralCache.get());
       }
     }
     if (checkForZeroCols)
@@ -695,20 +705,8 @@ namespace Camellia
             //cout << "testValuesTransformed for test " << this->testName(testID) << ": \n" << testValuesTransformed;
             //cout << "weightedMeasure:\n" << weightedMeasure;
             
-            // there may be a more efficient way to do this copying:
-            // (one strategy would be to reimplement fst::integrate to support offsets, so that no copying needs to be done...)
-            for (int i=0; i < testBasis->getCardinality(); i++)
-            {
-              int testDofIndex = testOrdering->getDofIndex(testID,i);
-              for (int j=0; j < trialBasis->getCardinality(); j++)
-              {
-                int trialDofIndex = trialOrdering->getDofIndex(trialID,j);
-                for (unsigned k=0; k < numCells; k++)
-                {
-                  stiffness(k,testDofIndex,trialDofIndex) += miniStiffness(k,i,j);
-                }
-              }
-            }
+            IntegrationKernels::sumInto(stiffness, miniStiffness, testOrdering->getDofIndices(testID),
+                                        trialOrdering->getDofIndices(trialID));
           }
           else      // boundary integral
           {
@@ -786,18 +784,8 @@ namespace Camellia
               //cout << "miniStiffness for side " << sideOrdinal << "\n:" << miniStiffness;
               // place in the appropriate spot in the element-stiffness matrix
               // copy goes from (cell,trial_basis_dof,test_basis_dof) to (cell,element_trial_dof,element_test_dof)
-              for (int i=0; i < testBasis->getCardinality(); i++)
-              {
-                int testDofIndex = testOrdering->getDofIndex(testID,i);
-                for (int j=0; j < trialBasis->getCardinality(); j++)
-                {
-                  int trialDofIndex = trialOrdering->getDofIndex(trialID,j,sideOrdinal);
-                  for (unsigned k=0; k < numCells; k++)
-                  {
-                    stiffness(k,testDofIndex,trialDofIndex) += miniStiffness(k,i,j);
-                  }
-                }
-              }
+              IntegrationKernels::sumInto(stiffness, miniStiffness, testOrdering->getDofIndices(testID),
+                                          trialOrdering->getDofIndices(trialID,sideOrdinal));
             }
           }
           testOpIt++;
@@ -832,8 +820,10 @@ namespace Camellia
       TBilinearTerm<Scalar> bt = *btIt;
       TLinearTermPtr<Scalar> trialTerm = btIt->first;
       TLinearTermPtr<Scalar> testTerm = btIt->second;
+      bool forceBoundaryTerm = false, sumInto = true;
       trialTerm->integrate(stiffness, elemType->trialOrderPtr,
-                           testTerm,  elemType->trialOrderPtr, basisCache);
+                           testTerm,  elemType->trialOrderPtr, basisCache,
+                           forceBoundaryTerm, sumInto, _referenceIntegralCache.get());
     }
     
   }
@@ -854,7 +844,6 @@ namespace Camellia
     int INFO;
     
     Teuchos::LAPACK<int, double> lapack;
-    Teuchos::BLAS<int, double> blas;
     
     lapack.POTRF(UPLO, N, &ipMatrix[0], N, &INFO);
     
@@ -864,8 +853,24 @@ namespace Camellia
       result = INFO;
     }
     
+    choleskyFactorSolve(ipMatrix, stiffnessEnriched, rhsEnriched, stiffness, rhs);
+    return result;
+  }
+  
+  template <typename Scalar>
+  void TBF<Scalar>::choleskyFactorSolve(const FieldContainer<Scalar> &choleskyFactor, FieldContainer<Scalar> &stiffnessEnriched,
+                                        FieldContainer<Scalar> &rhsEnriched, FieldContainer<Scalar> &stiffness,
+                                        FieldContainer<Scalar> &rhs)
+  {
+    int N = choleskyFactor.dimension(0);
+    TEUCHOS_TEST_FOR_EXCEPTION(N != choleskyFactor.dimension(1), std::invalid_argument, "choleskyFactor must be square");
+    int M = stiffnessEnriched.dimension(0);
+    TEUCHOS_TEST_FOR_EXCEPTION(N != stiffnessEnriched.dimension(1), std::invalid_argument, "stiffnessEnriched must be have one dimension equal to test ipMatrix dimension");
+    
+    Teuchos::BLAS<int, double> blas;
+    
     double ALPHA = 1.0;
-    blas.TRSM(Teuchos::LEFT_SIDE, Teuchos::LOWER_TRI, Teuchos::NO_TRANS, Teuchos::NON_UNIT_DIAG, N, M, ALPHA, &ipMatrix[0], N,
+    blas.TRSM(Teuchos::LEFT_SIDE, Teuchos::LOWER_TRI, Teuchos::NO_TRANS, Teuchos::NON_UNIT_DIAG, N, M, ALPHA, &choleskyFactor[0], N,
               &stiffnessEnriched[0], N);
 
     double BETA = 0.0;
@@ -887,13 +892,222 @@ namespace Camellia
     // cellOptimalWeights
     int oneColumn = 1;
 
-    blas.TRSM(Teuchos::LEFT_SIDE, Teuchos::LOWER_TRI, Teuchos::NO_TRANS, Teuchos::NON_UNIT_DIAG, N, oneColumn, ALPHA, &ipMatrix[0], N,
+    blas.TRSM(Teuchos::LEFT_SIDE, Teuchos::LOWER_TRI, Teuchos::NO_TRANS, Teuchos::NON_UNIT_DIAG, N, oneColumn, ALPHA, &choleskyFactor[0], N,
               &rhsEnriched[0], N);
 
     SerialDenseWrapper::multiply(rhs, stiffnessEnriched, rhsEnriched, 'N', 'N');
-    return result;
   }
   
+  template <typename Scalar>
+  int TBF<Scalar>::factoredCholeskySolveBatched(FieldContainer<Scalar> &ipMatrix, FieldContainer<Scalar> &stiffnessEnriched,
+                                                FieldContainer<Scalar> &rhsEnriched, FieldContainer<Scalar> &stiffness,
+                                                FieldContainer<Scalar> &rhs)
+  {
+    // Same math as factoredCholeskySolve(), applied to every cell in the batch.  Each group of W cells is copied into
+    // cell-interleaved storage, so that every innermost loop below runs over the W cells of the group with unit stride.
+    int numCells = ipMatrix.dimension(0);
+    int N = ipMatrix.dimension(1);
+    int M = stiffnessEnriched.dimension(1);
+    TEUCHOS_TEST_FOR_EXCEPTION(N != ipMatrix.dimension(2), std::invalid_argument, "ipMatrix must be square");
+    TEUCHOS_TEST_FOR_EXCEPTION(N != stiffnessEnriched.dimension(2), std::invalid_argument, "stiffnessEnriched must be have one dimension equal to test ipMatrix dimension");
+    TEUCHOS_TEST_FOR_EXCEPTION(numCells != stiffnessEnriched.dimension(0), std::invalid_argument, "stiffnessEnriched must have the same cell count as ipMatrix");
+    TEUCHOS_TEST_FOR_EXCEPTION(N != rhsEnriched.dimension(1), std::invalid_argument, "rhsEnriched must have the same test dimension as ipMatrix");
+    TEUCHOS_TEST_FOR_EXCEPTION((M != stiffness.dimension(1)) || (M != stiffness.dimension(2)), std::invalid_argument, "stiffness must have dimensions (C,M,M)");
+    TEUCHOS_TEST_FOR_EXCEPTION(M != rhs.dimension(1), std::invalid_argument, "rhs must have dimensions (C,M)");
+
+    const int W = 8; // cells per interleaved group -- a multiple of the SIMD width for doubles on current hardware
+    const int numRHS = M + 1; // the columns of B, plus the enriched RHS
+
+    // G: lower triangle, packed by rows; entry (i,j), j <= i, for lane l is at G[(i*(i+1)/2 + j) * W + l]
+    // Y: N x numRHS right-hand sides (overwritten with L^{-1} [B l]); entry (i,k) for lane l is at Y[(i*numRHS + k) * W + l]
+    // K: numRHS x numRHS products Y^T Y (upper triangle only)
+    vector<Scalar> G(N*(N+1)/2 * W), Y(N*numRHS*W), K(numRHS*numRHS*W);
+    vector<Scalar> sum(W);
+    vector<bool> factorizationFailed(W);
+
+    int result = 0;
+
+    for (int groupStart=0; groupStart<numCells; groupStart += W)
+    {
+      int groupSize = min(W, numCells - groupStart);
+
+      // pack; lanes beyond groupSize are padded with identity Gram matrices and zero right-hand sides
+      for (int i=0; i<N; i++)
+      {
+        for (int j=0; j<=i; j++)
+        {
+          Scalar* G_ij = &G[(i*(i+1)/2 + j) * W];
+          for (int lane=0; lane<W; lane++)
+          {
+            G_ij[lane] = (lane < groupSize) ? ipMatrix(groupStart+lane,i,j) : ((i==j) ? 1.0 : 0.0);
+          }
+        }
+        for (int k=0; k<numRHS; k++)
+        {
+          Scalar* Y_ik = &Y[(i*numRHS + k) * W];
+          for (int lane=0; lane<W; lane++)
+          {
+            if (lane >= groupSize)
+              Y_ik[lane] = 0.0;
+            else if (k < M)
+              Y_ik[lane] = stiffnessEnriched(groupStart+lane,k,i);
+            else
+              Y_ik[lane] = rhsEnriched(groupStart+lane,i);
+          }
+        }
+      }
+      factorizationFailed.assign(W, false);
+
+      // Cholesky factorization, G = L L^T (row-oriented, left-looking)
+      for (int i=0; i<N; i++)
+      {
+        const Scalar* G_i = &G[(i*(i+1)/2) * W];
+        for (int j=0; j<=i; j++)
+        {
+          const Scalar* G_j = &G[(j*(j+1)/2) * W];
+          Scalar* G_ij = &G[(i*(i+1)/2 + j) * W];
+          for (int lane=0; lane<W; lane++)
+          {
+            sum[lane] = G_ij[lane];
+          }
+          for (int k=0; k<j; k++)
+          {
+            const Scalar* G_ik = &G_i[k*W];
+            const Scalar* G_jk = &G_j[k*W];
+            for (int lane=0; lane<W; lane++)
+            {
+              sum[lane] -= G_ik[lane] * G_jk[lane];
+            }
+          }
+          if (j < i)
+          {
+            const Scalar* G_jj = &G_j[j*W];
+            for (int lane=0; lane<W; lane++)
+            {
+              G_ij[lane] = sum[lane] / G_jj[lane];
+            }
+          }
+          else
+          {
+            for (int lane=0; lane<W; lane++)
+            {
+              if (sum[lane] <= 0.0)
+              {
+                // not numerically SPD; this cell will be redone by the per-cell path below.  Continue with a benign pivot.
+                factorizationFailed[lane] = true;
+                sum[lane] = 1.0;
+              }
+              G_ij[lane] = sqrt(sum[lane]);
+            }
+          }
+        }
+      }
+
+      // forward substitution, L Y = [B l]
+      for (int i=0; i<N; i++)
+      {
+        const Scalar* G_i = &G[(i*(i+1)/2) * W];
+        Scalar* Y_i = &Y[i*numRHS*W];
+        for (int k=0; k<i; k++)
+        {
+          const Scalar* G_ik = &G_i[k*W];
+          const Scalar* Y_k = &Y[k*numRHS*W];
+          for (int rhsOrdinal=0; rhsOrdinal<numRHS; rhsOrdinal++)
+          {
+            for (int lane=0; lane<W; lane++)
+            {
+              Y_i[rhsOrdinal*W + lane] -= G_ik[lane] * Y_k[rhsOrdinal*W + lane];
+            }
+          }
+        }
+        const Scalar* G_ii = &G_i[i*W];
+        for (int rhsOrdinal=0; rhsOrdinal<numRHS; rhsOrdinal++)
+        {
+          for (int lane=0; lane<W; lane++)
+          {
+            Y_i[rhsOrdinal*W + lane] /= G_ii[lane];
+          }
+        }
+      }
+
+      // K = Y^T Y; the last column of K holds B^T G^{-1} l
+      K.assign(K.size(), 0.0);
+      for (int i=0; i<N; i++)
+      {
+        const Scalar* Y_i = &Y[i*numRHS*W];
+        for (int a=0; a<M; a++)
+        {
+          const Scalar* Y_ia = &Y_i[a*W];
+          for (int b=a; b<numRHS; b++)
+          {
+            const Scalar* Y_ib = &Y_i[b*W];
+            Scalar* K_ab = &K[(a*numRHS + b) * W];
+            for (int lane=0; lane<W; lane++)
+            {
+              K_ab[lane] += Y_ia[lane] * Y_ib[lane];
+            }
+          }
+        }
+      }
+
+      // unpack
+      for (int lane=0; lane<groupSize; lane++)
+      {
+        int cellOrdinal = groupStart + lane;
+        if (factorizationFailed[lane]) continue;
+        for (int a=0; a<M; a++)
+        {
+          for (int b=a; b<M; b++)
+          {
+            stiffness(cellOrdinal,a,b) = K[(a*numRHS + b) * W + lane];
+            stiffness(cellOrdinal,b,a) = K[(a*numRHS + b) * W + lane];
+          }
+          rhs(cellOrdinal,a) = K[(a*numRHS + M) * W + lane];
+        }
+      }
+
+      // per-cell fallback for any cells whose Gram matrices the batched factorization rejected
+      for (int lane=0; lane<groupSize; lane++)
+      {
+        if (!factorizationFailed[lane]) continue;
+        int cellOrdinal = groupStart + lane;
+        Teuchos::Array<int> ipDim(2), stiffnessEnrichedDim(2), stiffnessDim(2), rhsEnrichedDim(2), rhsDim(2);
+        ipDim[0] = N;                 ipDim[1] = N;
+        stiffnessEnrichedDim[0] = M;  stiffnessEnrichedDim[1] = N;
+        stiffnessDim[0] = M;          stiffnessDim[1] = M;
+        rhsEnrichedDim[0] = N;        rhsEnrichedDim[1] = 1;
+        rhsDim[0] = M;                rhsDim[1] = 1;
+        // factoredCholeskySolve() overwrites its inputs, so we hand it copies
+        FieldContainer<Scalar> cellIPMatrix(ipDim), cellStiffnessEnriched(stiffnessEnrichedDim), cellRHSEnriched(rhsEnrichedDim);
+        for (int i=0; i<N; i++)
+        {
+          for (int j=0; j<N; j++)
+          {
+            cellIPMatrix(i,j) = ipMatrix(cellOrdinal,i,j);
+          }
+          for (int a=0; a<M; a++)
+          {
+            cellStiffnessEnriched(a,i) = stiffnessEnriched(cellOrdinal,a,i);
+          }
+          cellRHSEnriched(i,0) = rhsEnriched(cellOrdinal,i);
+        }
+        FieldContainer<Scalar> cellStiffness(stiffnessDim);
+        FieldContainer<Scalar> cellRHS(rhsDim);
+        int cellResult = factoredCholeskySolve(cellIPMatrix, cellStiffnessEnriched, cellRHSEnriched, cellStiffness, cellRHS);
+        if (cellResult != 0) result = cellResult;
+        for (int a=0; a<M; a++)
+        {
+          for (int b=0; b<M; b++)
+          {
+            stiffness(cellOrdinal,a,b) = cellStiffness(a,b);
+          }
+          rhs(cellOrdinal,a) = cellRHS(a,0);
+        }
+      }
+    }
+    return result;
+  }
+
   template <typename Scalar>
   TIPPtr<Scalar> TBF<Scalar>::graphNorm(double weightForL2TestTerms)
   {
@@ -1018,6 +1232,11 @@ namespace Camellia
     Epetra_Time timer(*MPIWrapper::CommSerial());
     bool printTimings = false;
 
+    // Function values the caches retained (see BasisCache::setMemoizeFunctionValues()) may date from an earlier pass,
+    // since which, e.g., a Solution that a weight depends on may have changed
+    basisCache->discardFunctionValues();
+    if (ipBasisCache != Teuchos::null) ipBasisCache->discardFunctionValues();
+
     if (! _useSubgridMeshForOptimalTestSolve)
     {
       // localStiffness should have dim. (numCells, numTrialFields, numTrialFields)
@@ -1056,11 +1275,38 @@ namespace Camellia
       timer.ResetStartTime();
       FieldContainer<double> cellSideParities = basisCache->getCellSideParities();
 
+      // With the FACTORED_CHOLESKY solver, retained Gram factors (see GramMatrixCache) stand in for Gram matrix integration
+      // and factorization on the cells that hit.  A batch with no hits, whose factors the cache has no room to retain, goes
+      // through the batched solve instead.
+      bool useGramMatrixCache = false;
+      vector< FieldContainer<Scalar> > cachedFactors;
+      vector<bool> factorIsCached;
+      int gramCubatureDegree = -1;
+      if ((ip != Teuchos::null) && (_optimalTestSolver == FACTORED_CHOLESKY) && (_gramMatrixCache != Teuchos::null)
+          && (_gramMatrixCache->mesh() == mesh.get()))
+      {
+        gramCubatureDegree = ipBasisCache->cubatureDegree(); // includes any cubature enrichment
+        cachedFactors.resize(numCells);
+        factorIsCached.resize(numCells);
+        int numHits = 0;
+        for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+        {
+          factorIsCached[cellOrdinal] = _gramMatrixCache->getCholeskyFactor((*cellIDs)[cellOrdinal], ip.get(), testOrder,
+                                                                            gramCubatureDegree, cachedFactors[cellOrdinal]);
+          if (factorIsCached[cellOrdinal]) numHits++;
+        }
+        size_t batchFactorSize = (size_t) numCells * numTestDofs * numTestDofs * sizeof(Scalar);
+        useGramMatrixCache = (numHits > 0) || (numCells == 1) || _gramMatrixCache->hasRoomFor(batchFactorSize);
+      }
+
       if (ip == Teuchos::null)
       {
         // can we interpret as a Bubnov-Galerkin setting?
         TEUCHOS_TEST_FOR_EXCEPTION(numTestDofs != numTrialDofs, std::invalid_argument, "BF: ip is null, but the number of test dofs is different from the number of trial dofs (can't do Bubnov-Galerkin).");
-        this->stiffnessMatrix(localStiffness, elemType, cellSideParities, basisCache);
+        {
+          CAMELLIA_TIMED_REGION("stiffness");
+          this->stiffnessMatrix(localStiffness, elemType, cellSideParities, basisCache);
+        }
         
         // the above stores in (trial, test) order; we want (test, trial) -- so we transpose cell-wise:
         Teuchos::Array<int> dim;
@@ -1081,9 +1327,101 @@ namespace Camellia
         }
         
         timer.ResetStartTime();
-        rhs->integrateAgainstStandardBasis(rhsVector, testOrder, basisCache);
+        {
+          CAMELLIA_TIMED_REGION("RHS");
+          rhs->integrateAgainstStandardBasis(rhsVector, testOrder, basisCache);
+        }
         rhsDeterminationTime += timer.ElapsedTime();
       }
+      else if (useGramMatrixCache)
+      {
+        // same formulation as FACTORED_CHOLESKY, but Gram matrices are only integrated and factored for cells that miss in the cache
+        double timeG = 0, timeB, timeT, timeK = 0;
+        
+        FieldContainer<Scalar> stiffnessEnriched(numCells,numTrialDofs,numTestDofs);
+        
+        timer.ResetStartTime();
+        {
+          CAMELLIA_TIMED_REGION("stiffness");
+          this->stiffnessMatrix(stiffnessEnriched, elemType, cellSideParities, basisCache, true, true);
+        }
+        timeB = timer.ElapsedTime();
+        
+        FieldContainer<Scalar> rhsEnriched(numCells,numTestDofs);
+        {
+          CAMELLIA_TIMED_REGION("RHS");
+          rhs->integrateAgainstStandardBasis(rhsEnriched,testOrder,basisCache);
+        }
+        
+        bool allCellsHit = true;
+        for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+        {
+          if (!factorIsCached[cellOrdinal]) allCellsHit = false;
+        }
+        
+        FieldContainer<Scalar> ipMatrix;
+        if (!allCellsHit)
+        {
+          timer.ResetStartTime();
+          ipMatrix.resize(numCells,numTestDofs,numTestDofs);
+          CAMELLIA_TIMED_REGION("IP matrix");
+          ip->computeInnerProductMatrix(ipMatrix, testOrder, ipBasisCache);
+          timeG = timer.ElapsedTime();
+        }
+        
+        Teuchos::Array<int> localIPDim(2), localStiffnessEnrichedDim(2), localStiffnessDim(2), localRHSEnrichedDim(2), localRHSDim(2);
+        localIPDim[0] = numTestDofs;
+        localIPDim[1] = numTestDofs;
+        localStiffnessEnrichedDim[0] = numTrialDofs;
+        localStiffnessEnrichedDim[1] = numTestDofs;
+        localStiffnessDim[0] = numTrialDofs;
+        localStiffnessDim[1] = numTrialDofs;
+        localRHSEnrichedDim[0] = numTestDofs;
+        localRHSEnrichedDim[1] = 1;
+        localRHSDim[0] = numTrialDofs;
+        localRHSDim[1] = 1;
+        
+        Teuchos::LAPACK<int, double> lapack;
+        int result = 0;
+        timer.ResetStartTime();
+        for (int cellOrdinal=0; cellOrdinal < numCells; cellOrdinal++)
+        {
+          CAMELLIA_TIMED_REGION("Cholesky");
+          FieldContainer<Scalar> cellStiffnessEnriched(localStiffnessEnrichedDim, &stiffnessEnriched(cellOrdinal,0,0));
+          FieldContainer<Scalar> cellStiffness(localStiffnessDim, &localStiffness(cellOrdinal,0,0));
+          FieldContainer<Scalar> cellRHSEnriched(localRHSEnrichedDim, &rhsEnriched(cellOrdinal,0));
+          FieldContainer<Scalar> cellRHS(localRHSDim, &rhsVector(cellOrdinal,0));
+          
+          if (!factorIsCached[cellOrdinal])
+          {
+            FieldContainer<Scalar> cellIPMatrix(localIPDim, &ipMatrix(cellOrdinal,0,0));
+            int INFO;
+            lapack.POTRF('L', numTestDofs, &cellIPMatrix[0], numTestDofs, &INFO);
+            if (INFO != 0)
+            {
+              result = INFO;
+            }
+            else
+            {
+              _gramMatrixCache->storeCholeskyFactor((*cellIDs)[cellOrdinal], ip.get(), testOrder, gramCubatureDegree, cellIPMatrix);
+            }
+            choleskyFactorSolve(cellIPMatrix, cellStiffnessEnriched, cellRHSEnriched, cellStiffness, cellRHS);
+          }
+          else
+          {
+            choleskyFactorSolve(cachedFactors[cellOrdinal], cellStiffnessEnriched, cellRHSEnriched, cellStiffness, cellRHS);
+          }
+        }
+        timeT = timer.ElapsedTime();
+        if (result != 0)
+        {
+          cout << "**** WARNING: in BilinearForm::localStiffnessMatrixAndRHS(), Cholesky factorization of Gram matrix failed with error code " << result << ". ****\n";
+        }
+        if (_optimalTestTimingCallback)
+        {
+          _optimalTestTimingCallback(numCells,timeG,timeB,timeT,timeK,elemType);
+        }
+      }
       else if (_optimalTestSolver == FACTORED_CHOLESKY)
       {
         int numCells = basisCache->getPhysicalCubaturePoints().dimension(0);
@@ -1098,7 +1436,10 @@ namespace Camellia
         
         timer.ResetStartTime();
         // RHS:
-        this->stiffnessMatrix(stiffnessEnriched, elemType, cellSideParities, basisCache, true, true);
+        {
+          CAMELLIA_TIMED_REGION("stiffness");
+          this->stiffnessMatrix(stiffnessEnriched, elemType, cellSideParities, basisCache, true, true);
+        }
         timeB = timer.ElapsedTime();
         
         Teuchos::Array<int> localIPDim(2);
@@ -1114,11 +1455,17 @@ namespace Camellia
         FieldContainer<Scalar> ipMatrix(numCells,numTestDofs,numTestDofs);
         DofOrderingPtr testOrder = elemType->testOrderPtr;
         timer.ResetStartTime();
-        ip->computeInnerProductMatrix(ipMatrix, testOrder, ipBasisCache);
+        {
+          CAMELLIA_TIMED_REGION("IP matrix");
+          ip->computeInnerProductMatrix(ipMatrix, testOrder, ipBasisCache);
+        }
         timeG = timer.ElapsedTime();
         
         FieldContainer<Scalar> rhsEnriched(numCells,numTestDofs);
-        rhs->integrateAgainstStandardBasis(rhsEnriched,testOrder,basisCache);
+        {
+          CAMELLIA_TIMED_REGION("RHS");
+          rhs->integrateAgainstStandardBasis(rhsEnriched,testOrder,basisCache);
+        }
         
         Teuchos::Array<int> localRHSEnrichedDim(2);
         localRHSEnrichedDim[0] = rhsEnriched.dimension(1);
@@ -1130,17 +1477,34 @@ namespace Camellia
         
         timeT = 0;
         timeK = 0;
-        for (int cellIndex=0; cellIndex < numCells; cellIndex++)
+        timer.ResetStartTime();
+        int result = 0;
+        CAMELLIA_TIMED_REGION("Cholesky");
+        if (numCells > 1)
         {
-          timer.ResetStartTime();
-          int result = 0;
-          FieldContainer<Scalar> cellIPMatrix(localIPDim, &ipMatrix(cellIndex,0,0));
-          FieldContainer<Scalar> cellStiffnessEnriched(localStiffnessEnrichedDim, &stiffnessEnriched(cellIndex,0,0));
-          FieldContainer<Scalar> cellStiffness(localStiffnessDim, &localStiffness(cellIndex,0,0));
-          FieldContainer<Scalar> cellRHSEnriched(localRHSEnrichedDim, &rhsEnriched(cellIndex,0));
-          FieldContainer<Scalar> cellRHS(localRHSDim, &rhsVector(cellIndex,0));
+          result = factoredCholeskySolveBatched(ipMatrix, stiffnessEnriched, rhsEnriched, localStiffness, rhsVector);
+        }
+        else
+        {
+          for (int cellIndex=0; cellIndex < numCells; cellIndex++)
+          {
+            FieldContainer<Scalar> cellIPMatrix(localIPDim, &ipMatrix(cellIndex,0,0));
+            FieldContainer<Scalar> cellStiffnessEnriched(localStiffnessEnrichedDim, &stiffnessEnriched(cellIndex,0,0));
+            FieldContainer<Scalar> cellStiffness(localStiffnessDim, &localStiffness(cellIndex,0,0));
+            FieldContainer<Scalar> cellRHSEnriched(localRHSEnrichedDim, &rhsEnriched(cellIndex,0));
+            FieldContainer<Scalar> cellRHS(localRHSDim, &rhsVector(cellIndex,0));
 
-          result = factoredCholeskySolve(cellIPMatrix, cellStiffnessEnriched, cellRHSEnriched, cellStiffness, cellRHS);
+            result = factoredCholeskySolve(cellIPMatrix, cellStiffnessEnriched, cellRHSEnriched, cellStiffness, cellRHS);
+          }
+        }
+        timeT = timer.ElapsedTime(); // includes the computation of K, which is fused with the solve here
+        if (result != 0)
+        {
+          cout << "**** WARNING: in BilinearForm::localStiffnessMatrixAndRHS(), factored Cholesky solve failed with error code " << result << ". ****\n";
+        }
+        if (_optimalTestTimingCallback)
+        {
+          _optimalTestTimingCallback(numCells,timeG,timeB,timeT,timeK,elemType);
         }
       }
       else
@@ -1162,7 +1526,10 @@ namespace Camellia
         }
         
         timer.ResetStartTime();
-        rhs->integrateAgainstOptimalTests(rhsVector, optTestCoeffs, testOrder, basisCache);
+        {
+          CAMELLIA_TIMED_REGION("RHS");
+          rhs->integrateAgainstOptimalTests(rhsVector, optTestCoeffs, testOrder, basisCache);
+        }
         rhsDeterminationTime += timer.ElapsedTime();
       }
       
@@ -1265,11 +1632,13 @@ namespace Camellia
     // RHS:
     if (_optimalTestSolver != FACTORED_CHOLESKY)
     {
+      CAMELLIA_TIMED_REGION("stiffness");
       this->stiffnessMatrix(rectangularStiffnessMatrix, elemType, cellSideParities, stiffnessBasisCache);
     }
     else
     {
       // row-major order
+      CAMELLIA_TIMED_REGION("stiffness");
       rectangularStiffnessMatrix.resize(numCells,numTrialDofs,numTestDofs);
       this->stiffnessMatrix(rectangularStiffnessMatrix, elemType, cellSideParities, stiffnessBasisCache, true, true);
     }
@@ -1292,13 +1661,17 @@ namespace Camellia
     FieldContainer<Scalar> ipMatrix(numCells,numTestDofs,numTestDofs);
     DofOrderingPtr testOrder = elemType->testOrderPtr;
     timer.ResetStartTime();
-    ip->computeInnerProductMatrix(ipMatrix, testOrder, ipBasisCache);
+    {
+      CAMELLIA_TIMED_REGION("IP matrix");
+      ip->computeInnerProductMatrix(ipMatrix, testOrder, ipBasisCache);
+    }
     timeG = timer.ElapsedTime();
     
     timeT = 0;
     timeK = 0;
     for (int cellIndex=0; cellIndex < numCells; cellIndex++)
     {
+      CAMELLIA_TIMED_REGION("Gram solve");
       timer.ResetStartTime();
       int result = 0;
       FieldContainer<Scalar> cellIPMatrix(localIPDim, &ipMatrix(cellIndex,0,0));
@@ -1372,6 +1745,30 @@ namespace Camellia
     _rhsTimingCallback = rhsTimingCallback;
   }
   
+  template <typename Scalar>
+  GramMatrixCachePtr TBF<Scalar>::gramMatrixCache() const
+  {
+    return _gramMatrixCache;
+  }
+  
+  template <typename Scalar>
+  void TBF<Scalar>::setGramMatrixCache(GramMatrixCachePtr gramMatrixCache)
+  {
+    _gramMatrixCache = gramMatrixCache;
+  }
+  
+  template <typename Scalar>
+  ReferenceIntegralCachePtr TBF<Scalar>::referenceIntegralCache() const
+  {
+    return _referenceIntegralCache;
+  }
+  
+  template <typename Scalar>
+  void TBF<Scalar>::setReferenceIntegralCache(ReferenceIntegralCachePtr referenceIntegralCache)
+  {
+    _referenceIntegralCache = referenceIntegralCache;
+  }
+  
   template <typename Scalar>
   typename TBF<Scalar>::OptimalTestSolver TBF<Scalar>::optimalTestSolver() const
   {
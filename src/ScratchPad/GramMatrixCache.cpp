@@ -0,0 +1,232 @@
+//
+//  GramMatrixCache.cpp
+//  Camellia
+//
+//
+
+#include "GramMatrixCache.h"
+
+#include "DofOrdering.h"
+#include "GlobalDofAssignment.h"
+#include "Mesh.h"
+
+using namespace Camellia;
+using namespace Intrepid;
+
+GramMatrixCachePtr GramMatrixCache::gramMatrixCache(MeshPtr mesh, size_t memoryBudgetInBytes)
+{
+  return Teuchos::rcp( new GramMatrixCache(mesh, memoryBudgetInBytes) );
+}
+
+GramMatrixCache::GramMatrixCache(MeshPtr mesh, size_t memoryBudgetInBytes)
+{
+  _mesh = mesh.create_weak();
+  _memoryBudget = memoryBudgetInBytes;
+  
+  Teuchos::RCP<RefinementObserver> thisObserver = Teuchos::rcp(this,false); // weak RCP
+  _mesh->registerObserver(thisObserver);
+}
+
+GramMatrixCache::~GramMatrixCache()
+{
+  if (_mesh.is_valid_ptr())
+  {
+    _mesh->unregisterObserver(this);
+  }
+}
+
+bool GramMatrixCache::getCholeskyFactor(GlobalIndexType cellID, const IP* ip, DofOrderingPtr testOrdering, int cubatureDegree,
+                                        FieldContainer<double> &choleskyFactor)
+{
+  bool found = false;
+  // lookups may come from several threads during local stiffness computation (see Solution::setNumThreadsForLocalStiffness())
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaGramMatrixCache)
+#endif
+  {
+    if (ip != _ip)
+    {
+      clearEntries();
+      _ip = ip;
+    }
+    auto entryIt = _entries.find(cellID);
+    if ((entryIt != _entries.end()) && (entryIt->second.testOrdering == testOrdering.get())
+        && (entryIt->second.cubatureDegree == cubatureDegree))
+    {
+      const FieldContainer<double>* factor = &entryIt->second.choleskyFactor;
+      choleskyFactor.resize(factor->dimension(0), factor->dimension(1));
+      for (int i=0; i<factor->size(); i++)
+      {
+        choleskyFactor[i] = (*factor)[i];
+      }
+      found = true;
+      _hitCount++;
+    }
+    else
+    {
+      _missCount++;
+    }
+  }
+  return found;
+}
+
+void GramMatrixCache::storeCholeskyFactor(GlobalIndexType cellID, const IP* ip, DofOrderingPtr testOrdering, int cubatureDegree,
+                                          const FieldContainer<double> &choleskyFactor)
+{
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaGramMatrixCache)
+#endif
+  {
+    if (ip != _ip)
+    {
+      clearEntries();
+      _ip = ip;
+    }
+    eraseEntry(cellID);
+    size_t entrySize = choleskyFactor.size() * sizeof(double);
+    if (_memoryUsed + entrySize <= _memoryBudget)
+    {
+      Entry* entry = &_entries[cellID];
+      entry->testOrdering = testOrdering.get();
+      entry->cubatureDegree = cubatureDegree;
+      entry->choleskyFactor.resize(choleskyFactor.dimension(0), choleskyFactor.dimension(1));
+      for (int i=0; i<choleskyFactor.size(); i++)
+      {
+        entry->choleskyFactor[i] = choleskyFactor[i];
+      }
+      _memoryUsed += entrySize;
+    }
+  }
+}
+
+void GramMatrixCache::clear()
+{
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaGramMatrixCache)
+#endif
+  clearEntries();
+}
+
+void GramMatrixCache::clearEntries()
+{
+  _entries.clear();
+  _memoryUsed = 0;
+}
+
+void GramMatrixCache::eraseEntry(GlobalIndexType cellID)
+{
+  auto entryIt = _entries.find(cellID);
+  if (entryIt == _entries.end()) return;
+  _memoryUsed -= entryIt->second.choleskyFactor.size() * sizeof(double);
+  _entries.erase(entryIt);
+}
+
+int GramMatrixCache::ipDependencyFingerprint() const
+{
+  return _fingerprint;
+}
+
+void GramMatrixCache::setIPDependencyFingerprint(int value)
+{
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaGramMatrixCache)
+#endif
+  if (value != _fingerprint)
+  {
+    clearEntries();
+    _fingerprint = value;
+  }
+}
+
+Mesh* GramMatrixCache::mesh() const
+{
+  return _mesh.get();
+}
+
+size_t GramMatrixCache::memoryBudget() const
+{
+  return _memoryBudget;
+}
+
+size_t GramMatrixCache::memoryUsed() const
+{
+  return _memoryUsed;
+}
+
+bool GramMatrixCache::hasRoomFor(size_t bytes)
+{
+  bool hasRoom;
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaGramMatrixCache)
+#endif
+  hasRoom = (_memoryUsed + bytes <= _memoryBudget);
+  return hasRoom;
+}
+
+void GramMatrixCache::setMemoryBudget(size_t memoryBudgetInBytes)
+{
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaGramMatrixCache)
+#endif
+  {
+    _memoryBudget = memoryBudgetInBytes;
+    if (_memoryUsed > _memoryBudget)
+    {
+      clearEntries();
+    }
+  }
+}
+
+long long GramMatrixCache::hitCount() const
+{
+  return _hitCount;
+}
+
+long long GramMatrixCache::missCount() const
+{
+  return _missCount;
+}
+
+void GramMatrixCache::didHRefine(MeshTopologyPtr meshToRefine, const set<GlobalIndexType> &cellIDs, RefinementPatternPtr refPattern)
+{
+  // parents are no longer active; children have fresh cellIDs, so will simply miss
+  for (GlobalIndexType cellID : cellIDs)
+  {
+    eraseEntry(cellID);
+  }
+}
+
+void GramMatrixCache::didHUnrefine(MeshTopologyPtr meshToRefine, const set<GlobalIndexType> &cellIDs)
+{
+  // the parents become active again; their geometry is unchanged, but we may as well be conservative
+  for (GlobalIndexType cellID : cellIDs)
+  {
+    eraseEntry(cellID);
+  }
+}
+
+void GramMatrixCache::pRefine(const set<GlobalIndexType> &cellIDs)
+{
+  for (GlobalIndexType cellID : cellIDs)
+  {
+    eraseEntry(cellID);
+  }
+}
+
+void GramMatrixCache::didRepartition(MeshTopologyPtr meshTopo)
+{
+  // drop entries for cells that are no longer rank-local (including any that became inactive)
+  const set<GlobalIndexType>* myCellIDs = &_mesh->cellIDsInPartition();
+  vector<GlobalIndexType> cellIDsToErase;
+  for (auto &entry : _entries)
+  {
+    if (myCellIDs->find(entry.first) == myCellIDs->end())
+    {
+      cellIDsToErase.push_back(entry.first);
+    }
+  }
+  for (GlobalIndexType cellID : cellIDsToErase)
+  {
+    eraseEntry(cellID);
+  }
+}
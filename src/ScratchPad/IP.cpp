@@ -9,11 +9,13 @@
 #include "Intrepid_FunctionSpaceTools.hpp"
 
 #include "IP.h"
+#include "IntegrationKernels.h"
 #include "SerialDenseMatrixUtility.h"
 #include "SerialDenseWrapper.h"
 #include "VarFactory.h"
 #include "BasisCache.h"
 #include "CellTopology.h"
+#include "ReferenceIntegralCache.h"
 
 using namespace Intrepid;
 using namespace Camellia;
@@ -22,6 +24,7 @@ template <typename Scalar>
 TIP<Scalar>::TIP()
 {
   _isLegacySubclass = false;
+  _referenceIntegralCache = ReferenceIntegralCache::referenceIntegralCache();
 }
 // if the terms are a1, a2, ..., then the inner product is (a1,a1) + (a2,a2) + ...
 
@@ -30,6 +33,7 @@ TIP<Scalar>::TIP(TBFPtr<Scalar> bfs)
 {
   _bilinearForm = bfs;
   _isLegacySubclass = true;
+  _referenceIntegralCache = ReferenceIntegralCache::referenceIntegralCache();
 }
 
 // added by Nate
@@ -194,20 +198,8 @@ void TIP<Scalar>::computeInnerProductMatrix(FieldContainer<Scalar> &innerProduct
           Intrepid::FunctionSpaceTools::integrate<Scalar>(miniMatrix,innerProductDataAppliedToTest1,
               innerProductDataAppliedToTest2,COMP_BLAS);
 
-          int test1DofOffset = dofOrdering->getDofIndex(testID1,0);
-          int test2DofOffset = dofOrdering->getDofIndex(testID2,0);
-
-          // there may be a more efficient way to do this copying:
-          for (int i=0; i < numDofs1; i++)
-          {
-            for (int j=0; j < numDofs2; j++)
-            {
-              for (unsigned k=0; k < numCells; k++)
-              {
-                innerProduct(k,i+test1DofOffset,j+test2DofOffset) += miniMatrix(k,i,j);
-              }
-            }
-          }
+          IntegrationKernels::sumInto(innerProduct, miniMatrix, dofOrdering->getDofIndices(testID1),
+                                      dofOrdering->getDofIndices(testID2));
 
           op2It++;
           operatorIndex++;
@@ -244,7 +236,9 @@ void TIP<Scalar>::computeInnerProductMatrix(FieldContainer<Scalar> &innerProduct
     {
       TLinearTermPtr<Scalar> lt = *ltIt;
       // integrate lt against itself
-      lt->integrate(innerProduct,dofOrdering,lt,dofOrdering,basisCache,basisCache->isSideCache());
+      bool sumInto = true;
+      lt->integrate(innerProduct,dofOrdering,lt,dofOrdering,basisCache,basisCache->isSideCache(),sumInto,
+                    _referenceIntegralCache.get());
     }
 //    }
 
@@ -316,6 +310,18 @@ double TIP<Scalar>::computeMaxConditionNumber(DofOrderingPtr testSpace, BasisCac
   return maxConditionNumber;
 }
 
+template <typename Scalar>
+ReferenceIntegralCachePtr TIP<Scalar>::referenceIntegralCache() const
+{
+  return _referenceIntegralCache;
+}
+
+template <typename Scalar>
+void TIP<Scalar>::setReferenceIntegralCache(ReferenceIntegralCachePtr referenceIntegralCache)
+{
+  _referenceIntegralCache = referenceIntegralCache;
+}
+
 // compute TIP vector when var==fxn
 template <typename Scalar>
 void TIP<Scalar>::computeInnerProductVector(FieldContainer<Scalar> &ipVector,
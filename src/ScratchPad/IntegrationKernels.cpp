@@ -0,0 +1,129 @@
+//
+//  IntegrationKernels.cpp
+//  Camellia
+//
+//
+
+#include "IntegrationKernels.h"
+
+#include "Teuchos_BLAS.hpp"
+#include "Teuchos_TestForException.hpp"
+
+using namespace Camellia;
+using namespace Intrepid;
+using namespace std;
+
+void IntegrationKernels::integrate(FieldContainer<double> &values, const FieldContainer<double> &fieldValues,
+                                   const FieldContainer<double> &weights, const vector<int> &dofIndices)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(fieldValues.rank() != 3, std::invalid_argument, "fieldValues must have shape (C,F,P)");
+  int numCells = fieldValues.dimension(0);
+  int numFields = fieldValues.dimension(1);
+  int numPoints = fieldValues.dimension(2);
+  TEUCHOS_TEST_FOR_EXCEPTION(values.rank() != 2, std::invalid_argument, "values must have shape (C,N)");
+  TEUCHOS_TEST_FOR_EXCEPTION(values.dimension(0) != numCells, std::invalid_argument, "values and fieldValues differ in cell count");
+  TEUCHOS_TEST_FOR_EXCEPTION((weights.dimension(0) != numCells) || (weights.dimension(1) != numPoints),
+                             std::invalid_argument, "weights must have shape (C,P)");
+  TEUCHOS_TEST_FOR_EXCEPTION(dofIndices.size() != numFields, std::invalid_argument, "dofIndices must have one entry per field");
+  if (fieldValues.size() == 0) return;
+
+  int numDofs = values.dimension(1);
+  const double* fieldValue = &fieldValues[0];
+  for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+  {
+    const double* weight = &weights[cellIndex * numPoints];
+    double* cellValues = &values[cellIndex * numDofs];
+    for (int fieldOrdinal=0; fieldOrdinal<numFields; fieldOrdinal++, fieldValue += numPoints)
+    {
+      double sum = 0.0;
+      for (int ptIndex=0; ptIndex<numPoints; ptIndex++)
+      {
+        sum += weight[ptIndex] * fieldValue[ptIndex];
+      }
+      cellValues[dofIndices[fieldOrdinal]] += sum;
+    }
+  }
+}
+
+void IntegrationKernels::integrate(FieldContainer<double> &miniMatrix, const FieldContainer<double> &values1,
+                                   const FieldContainer<double> &values2, const FieldContainer<double> &weights)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(values1.rank() != values2.rank(), std::invalid_argument, "values1 and values2 must have the same rank");
+  TEUCHOS_TEST_FOR_EXCEPTION(values1.rank() < 3, std::invalid_argument, "values must have shape (C,F,P,...)");
+  int numCells = values1.dimension(0);
+  int numFields1 = values1.dimension(1);
+  int numFields2 = values2.dimension(1);
+  int numPoints = values1.dimension(2);
+  int entriesPerPoint = 1;
+  for (int r=3; r<values1.rank(); r++)
+  {
+    TEUCHOS_TEST_FOR_EXCEPTION(values1.dimension(r) != values2.dimension(r), std::invalid_argument, "values1 and values2 differ in shape");
+    entriesPerPoint *= values1.dimension(r);
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION((values2.dimension(0) != numCells) || (values2.dimension(2) != numPoints),
+                             std::invalid_argument, "values1 and values2 differ in shape");
+  TEUCHOS_TEST_FOR_EXCEPTION((weights.dimension(0) != numCells) || (weights.dimension(1) != numPoints),
+                             std::invalid_argument, "weights must have shape (C,P)");
+  TEUCHOS_TEST_FOR_EXCEPTION((miniMatrix.dimension(0) != numCells) || (miniMatrix.dimension(1) != numFields1)
+                             || (miniMatrix.dimension(2) != numFields2), std::invalid_argument, "miniMatrix must have shape (C,F1,F2)");
+  if (miniMatrix.size() == 0) return;
+  if (values1.size() == 0)
+  {
+    miniMatrix.initialize(0.0);
+    return;
+  }
+
+  // each cell's values are a row-major (F,K) matrix, with K = P * entriesPerPoint; we scale values1 by the weights as we
+  // copy it, and then miniMatrix = values1 * values2^T.  Column-major, that is miniMatrix^T = values2 * values1^T.
+  int K = numPoints * entriesPerPoint;
+  vector<double> weightedValues1(numFields1 * K);
+  Teuchos::BLAS<int, double> blas;
+  for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+  {
+    const double* weight = &weights[cellIndex * numPoints];
+    const double* cellValues1 = &values1[cellIndex * numFields1 * K];
+    const double* cellValues2 = &values2[cellIndex * numFields2 * K];
+    double* weightedValue = &weightedValues1[0];
+    for (int fieldOrdinal=0; fieldOrdinal<numFields1; fieldOrdinal++)
+    {
+      for (int ptIndex=0; ptIndex<numPoints; ptIndex++)
+      {
+        for (int entry=0; entry<entriesPerPoint; entry++)
+        {
+          *weightedValue++ = weight[ptIndex] * *cellValues1++;
+        }
+      }
+    }
+    blas.GEMM(Teuchos::TRANS, Teuchos::NO_TRANS, numFields2, numFields1, K, 1.0, cellValues2, K,
+              &weightedValues1[0], K, 0.0, &miniMatrix[cellIndex * numFields1 * numFields2], numFields2);
+  }
+}
+
+void IntegrationKernels::sumInto(FieldContainer<double> &values, const FieldContainer<double> &miniMatrix,
+                                 const vector<int> &rowDofIndices, const vector<int> &colDofIndices)
+{
+  int numCells = miniMatrix.dimension(0);
+  int numRows = miniMatrix.dimension(1);
+  int numCols = miniMatrix.dimension(2);
+  TEUCHOS_TEST_FOR_EXCEPTION((values.rank() != 3) || (values.dimension(0) != numCells), std::invalid_argument,
+                             "values must have shape (C,N1,N2)");
+  TEUCHOS_TEST_FOR_EXCEPTION((rowDofIndices.size() != numRows) || (colDofIndices.size() != numCols), std::invalid_argument,
+                             "dof index vectors must match miniMatrix dimensions");
+  if (miniMatrix.size() == 0) return;
+
+  int valuesRows = values.dimension(1), valuesCols = values.dimension(2);
+  const double* miniMatrixValue = &miniMatrix[0];
+  const int* colDofIndex = &colDofIndices[0];
+  for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+  {
+    double* cellValues = &values[cellIndex * valuesRows * valuesCols];
+    for (int i=0; i<numRows; i++, miniMatrixValue += numCols)
+    {
+      double* valuesRow = cellValues + rowDofIndices[i] * valuesCols;
+      for (int j=0; j<numCols; j++)
+      {
+        valuesRow[colDofIndex[j]] += miniMatrixValue[j];
+      }
+    }
+  }
+}
@@ -10,12 +10,15 @@
 #include "ConstantScalarFunction.h"
 #include "ConstantVectorFunction.h"
 #include "Function.h"
+#include "IntegrationKernels.h"
 #include "LinearTerm.h"
 #include "Mesh.h"
 #include "MPIWrapper.h"
+#include "ReferenceIntegralCache.h"
 #include "RieszRep.h"
 #include "SerialDenseWrapper.h"
 #include "Solution.h"
+#include "SpaceTimeBasisCache.h"
 #include "TensorBasis.h"
 
 #include "Epetra_CrsMatrix.h"
@@ -38,6 +41,159 @@ bool linearSummandIsBoundaryValueOnly(TLinearSummand<Scalar> &ls)
   return boundaryOnlyFunction || (ls.second->varType()==FLUX) || (ls.second->varType()==TRACE) || opInvolvesNormal;
 }
 
+namespace
+{
+// On an affine cell, each supported op(basis) is a linear combination, with coefficients constant on the cell, of spaceDim+1
+// reference fields: for H^1 and L^2 bases, the reference value followed by its reference derivatives; for H(div) bases,
+// the components of the reference value followed by the reference divergence.
+bool isAffineHDIVSpace(Camellia::EFunctionSpace fs)
+{
+  return (fs == Camellia::FUNCTION_SPACE_HDIV) || (fs == Camellia::FUNCTION_SPACE_HDIV_DISC);
+}
+
+// returns the number of components of op(basis) (1 for scalar-valued ops), or -1 if the combination isn't supported
+int affineComponentCount(Camellia::EFunctionSpace fs, Camellia::EOperator op, int spaceDim)
+{
+  bool hgrad = (fs == Camellia::FUNCTION_SPACE_HGRAD) || (fs == Camellia::FUNCTION_SPACE_HGRAD_DISC)
+               || (fs == Camellia::FUNCTION_SPACE_HVOL);
+  if (hgrad)
+  {
+    if (op == Camellia::OP_VALUE) return 1;
+    if (op == Camellia::OP_GRAD) return spaceDim;
+    if ((op >= Camellia::OP_DX) && (op < Camellia::OP_DX + spaceDim) && (op <= Camellia::OP_DZ)) return 1;
+    return -1;
+  }
+  if (isAffineHDIVSpace(fs))
+  {
+    if (op == Camellia::OP_VALUE) return spaceDim;
+    if (op == Camellia::OP_DIV) return 1;
+    if ((op >= Camellia::OP_X) && (op < Camellia::OP_X + spaceDim) && (op <= Camellia::OP_Z)) return 1;
+    return -1;
+  }
+  return -1;
+}
+
+// adds coefficient times the map from reference fields to the components of op(basis) to T, which has dimensions
+// (components, spaceDim+1).  J and Jinv are the cell's (row-major) Jacobian and its inverse.
+void addAffineReferenceMap(vector<double> &T, Camellia::EFunctionSpace fs, Camellia::EOperator op, int spaceDim,
+                           const double* J, const double* Jinv, double detJ, double coefficient)
+{
+  int numFields = spaceDim + 1;
+  if (!isAffineHDIVSpace(fs))
+  {
+    // the physical gradient is J^{-T} times the reference gradient
+    if (op == Camellia::OP_VALUE)
+    {
+      T[0] += coefficient;
+    }
+    else if (op == Camellia::OP_GRAD)
+    {
+      for (int i=0; i<spaceDim; i++)
+      {
+        for (int a=0; a<spaceDim; a++)
+        {
+          T[i * numFields + 1 + a] += coefficient * Jinv[a * spaceDim + i];
+        }
+      }
+    }
+    else
+    {
+      int i = op - Camellia::OP_DX;
+      for (int a=0; a<spaceDim; a++)
+      {
+        T[1 + a] += coefficient * Jinv[a * spaceDim + i];
+      }
+    }
+  }
+  else
+  {
+    // Piola transform: the physical value is J / det J times the reference value, and the divergence is divided by det J
+    if (op == Camellia::OP_VALUE)
+    {
+      for (int i=0; i<spaceDim; i++)
+      {
+        for (int a=0; a<spaceDim; a++)
+        {
+          T[i * numFields + a] += coefficient * J[i * spaceDim + a] / detJ;
+        }
+      }
+    }
+    else if (op == Camellia::OP_DIV)
+    {
+      T[spaceDim] += coefficient / detJ;
+    }
+    else
+    {
+      int i = op - Camellia::OP_X;
+      for (int a=0; a<spaceDim; a++)
+      {
+        T[a] += coefficient * J[i * spaceDim + a] / detJ;
+      }
+    }
+  }
+}
+
+// values of the reference field with the given ordinal at the cubature points, with dimensions (1,F,P); if cubWeights
+// is not NULL, these are multiplied in
+void getAffineReferenceFieldValues(Intrepid::FieldContainer<double> &fieldValues, BasisPtr basis, int fieldOrdinal,
+                                   BasisCachePtr basisCache, const Intrepid::FieldContainer<double>* cubWeights)
+{
+  int spaceDim = basisCache->cellTopology()->getDimension();
+  bool hdiv = isAffineHDIVSpace(basis->functionSpace());
+  Camellia::EOperator op;
+  int component = -1; // -1: the values are scalar
+  if (hdiv)
+  {
+    op = (fieldOrdinal < spaceDim) ? Camellia::OP_VALUE : Camellia::OP_DIV;
+    if (fieldOrdinal < spaceDim) component = fieldOrdinal;
+  }
+  else
+  {
+    op = (fieldOrdinal == 0) ? Camellia::OP_VALUE : Camellia::OP_GRAD;
+    if (fieldOrdinal > 0) component = fieldOrdinal - 1;
+  }
+  Teuchos::RCP< const Intrepid::FieldContainer<double> > refValues = basisCache->getValues(basis, op);
+  int cardinality = refValues->dimension(0);
+  int numPoints = refValues->dimension(1);
+  fieldValues.resize(1, cardinality, numPoints);
+  for (int basisOrdinal=0; basisOrdinal<cardinality; basisOrdinal++)
+  {
+    for (int pointOrdinal=0; pointOrdinal<numPoints; pointOrdinal++)
+    {
+      double value = (component == -1) ? (*refValues)(basisOrdinal,pointOrdinal)
+                                       : (*refValues)(basisOrdinal,pointOrdinal,component);
+      if (cubWeights != NULL) value *= (*cubWeights)(pointOrdinal);
+      fieldValues(0,basisOrdinal,pointOrdinal) = value;
+    }
+  }
+}
+
+// multiplies basisValues, with dimensions (C,F,P,...), by the values (C,P) of a scalar function
+void scalarMultiplyBasisValues(Intrepid::FieldContainer<double> &basisValues, const Intrepid::FieldContainer<double> &scalarValues)
+{
+  if (basisValues.size() == 0) return;
+  int numCells = basisValues.dimension(0);
+  int numFields = basisValues.dimension(1);
+  int numPoints = basisValues.dimension(2);
+  int entriesPerPoint = basisValues.size() / (numCells * numFields * numPoints);
+  double* value = &basisValues[0];
+  for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+  {
+    for (int fieldIndex=0; fieldIndex<numFields; fieldIndex++)
+    {
+      for (int ptIndex=0; ptIndex<numPoints; ptIndex++)
+      {
+        double scalarValue = scalarValues(cellIndex,ptIndex);
+        for (int entryIndex=0; entryIndex<entriesPerPoint; entryIndex++)
+        {
+          *value++ *= scalarValue;
+        }
+      }
+    }
+  }
+}
+}
+
 template<typename Scalar>
 const vector< TLinearSummand<Scalar> > & TLinearTerm<Scalar>::summands() const
 {
@@ -242,7 +398,7 @@ void TLinearTerm<Scalar>::integrate(Intrepid::FieldContainer<Scalar> &values, Do
 
       const vector<int>* sidesForVar = &thisOrdering->getSidesForVarID(varID);
 
-      bool applyCubatureWeights = true;
+      bool applyCubatureWeights = false; // IntegrationKernels::integrate() applies them
       int basisCardinality = -1;
       vector<int> varDofIndices;
       
@@ -258,17 +414,7 @@ void TLinearTerm<Scalar>::integrate(Intrepid::FieldContainer<Scalar> &values, Do
         this->values(ltValues, varID, basis, basisCache, applyCubatureWeights);
 
         // compute integrals:
-        for (int cellIndex = 0; cellIndex<numCells; cellIndex++)
-        {
-          for (int basisOrdinal = 0; basisOrdinal < basisCardinality; basisOrdinal++)
-          {
-            int varDofIndex = varDofIndices[basisOrdinal];
-            for (int ptIndex = 0; ptIndex < numPoints; ptIndex++)
-            {
-              values(cellIndex,varDofIndex) += ltValues(cellIndex,basisOrdinal,ptIndex);
-            }
-          }
-        }
+        IntegrationKernels::integrate(values, ltValues, basisCache->getWeightedMeasures(), varDofIndices);
       }
 
       // now, compute boundary integrals
@@ -291,17 +437,7 @@ void TLinearTerm<Scalar>::integrate(Intrepid::FieldContainer<Scalar> &values, Do
           bool naturalBoundaryValuesOnly = true; // don't restrict volume summands to boundary
           this->values(ltValues, varID, basis, sideBasisCache, applyCubatureWeights, naturalBoundaryValuesOnly);
           // compute integrals:
-          for (int cellIndex = 0; cellIndex<numCells; cellIndex++)
-          {
-            for (int basisOrdinal = 0; basisOrdinal < basisCardinality; basisOrdinal++)
-            {
-              int varDofIndex = varDofIndices[basisOrdinal];
-              for (int ptIndex = 0; ptIndex < numPoints; ptIndex++)
-              {
-                values(cellIndex,varDofIndex) += ltValues(cellIndex,basisOrdinal,ptIndex);
-              }
-            }
-          }
+          IntegrationKernels::integrate(values, ltValues, sideBasisCache->getWeightedMeasures(), varDofIndices);
 
 //          bool DEBUGGING = true;
 //          if (DEBUGGING) {
@@ -372,7 +508,7 @@ void TLinearTerm<Scalar>::integrate(Intrepid::FieldContainer<Scalar> &values, Do
         ltValueDim[2] = numPoints;
         ltValues.resize(ltValueDim);
         BasisCachePtr sideBasisCache = volumeCache->getSideBasisCache(sideOrdinal);
-        bool applyCubatureWeights = true;
+        bool applyCubatureWeights = false; // IntegrationKernels::integrate() applies them
         bool naturalBoundaryValuesOnly = false; // DO include volume summands restricted to boundary
         this->values(ltValues, varID, basis, sideBasisCache, applyCubatureWeights, naturalBoundaryValuesOnly);
         if ( this->termType() == FLUX )
@@ -382,17 +518,7 @@ void TLinearTerm<Scalar>::integrate(Intrepid::FieldContainer<Scalar> &values, Do
         vector<int> varDofIndices = thisFluxOrTrace ? thisOrdering->getDofIndices(varID,sideOrdinal)
                                     : thisOrdering->getDofIndices(varID);
         // compute integrals:
-        for (int cellIndex = 0; cellIndex<numCells; cellIndex++)
-        {
-          for (int basisOrdinal = 0; basisOrdinal < basisCardinality; basisOrdinal++)
-          {
-            int varDofIndex = varDofIndices[basisOrdinal];
-            for (int ptIndex = 0; ptIndex < numPoints; ptIndex++)
-            {
-              values(cellIndex,varDofIndex) += ltValues(cellIndex,basisOrdinal,ptIndex);
-            }
-          }
-        }
+        IntegrationKernels::integrate(values, ltValues, sideBasisCache->getWeightedMeasures(), varDofIndices);
         //        bool DEBUGGING = true;
         //        if (DEBUGGING) {
         //          if (basisCache->cellIDs().size() > 0) {
@@ -432,7 +558,7 @@ template<typename Scalar>
 void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix* valuesCrsMatrix, Intrepid::FieldContainer<double> &valuesFC,
                                     TLinearTermPtr<double> u, DofOrderingPtr uOrdering,
                                     TLinearTermPtr<double> v, DofOrderingPtr vOrdering,
-                                    BasisCachePtr basisCache, bool sumInto)
+                                    BasisCachePtr basisCache, bool sumInto, ReferenceIntegralCache* refIntegralCache)
 {
   if (!sumInto) valuesFC.initialize();
   if (u->isZero() || v->isZero()) return;
@@ -507,25 +633,9 @@ void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix* valuesCrsMatrix, Intrepid:
     }
     BasisPtr uBasis = uOrdering->getBasis(uID,uSideIndex);
     int uBasisCardinality = uBasis->getCardinality();
-    ltValueDim[1] = uBasisCardinality;
-    Intrepid::FieldContainer<double> uValues(ltValueDim);
-    bool applyCubatureWeights = true, dontApplyCubatureWeights = false;
-    u->values(uValues,uID,uBasis,basisCache,applyCubatureWeights);
-
-
-    //    double debugSum = 0.0;
-    //    for (int i=0; i<uValues.size(); i++) {
-    //      debugSum += uValues[i];
-    //    }
-    //    cout << "uValues debug sum for u = " << u->displayString() << ": " << debugSum << endl;
-
-    if ( u->termType() == FLUX )
-    {
-      // we need to multiply uValues' entries by the parity of the normal, since
-      // the trial implicitly contains an outward normal, and we need to adjust for the fact
-      // that the neighboring cells have opposite normal...
-      multiplyFluxValuesByParity(uValues, basisCache); // basisCache had better be a side cache!
-    }
+    Intrepid::FieldContainer<double> uValues;
+    bool uValuesComputed = false; // computed on first use below; sum-factorized blocks don't need them
+    bool dontApplyCubatureWeights = false; // IntegrationKernels::integrate() applies them
 
     int vStartOrdinal = symmetric ? uOrdinal : 0;
 
@@ -562,22 +672,43 @@ void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix* valuesCrsMatrix, Intrepid:
 
       BasisPtr vBasis = vOrdering->getBasis(vID,vSideIndex);
       int vBasisCardinality = vBasis->getCardinality();
-      ltValueDim[1] = vBasisCardinality;
-      Intrepid::FieldContainer<double> vValues(ltValueDim);
-      v->values(vValues, vID, vBasis, basisCache, dontApplyCubatureWeights);
 
-      //      cout << "vValues (without cubature weights applied) for v = " << v->displayString() << ":" << endl;
-      //      cout << vValues;
+      Intrepid::FieldContainer<double> miniMatrix( numCells, uBasisCardinality, vBasisCardinality );
 
-      // same flux consideration, for the vValues
-      if ( v->termType() == FLUX )
+      if (!integrateSumFactorized(miniMatrix, u, uID, uBasis, v, vID, vBasis, basisCache) &&
+          !integrateAffine(miniMatrix, u, uID, uBasis, v, vID, vBasis, basisCache, refIntegralCache))
       {
-        multiplyFluxValuesByParity(vValues, basisCache);
-      }
+        if (!uValuesComputed)
+        {
+          ltValueDim[1] = uBasisCardinality;
+          uValues.resize(ltValueDim);
+          u->values(uValues,uID,uBasis,basisCache,dontApplyCubatureWeights);
 
-      Intrepid::FieldContainer<double> miniMatrix( numCells, uBasisCardinality, vBasisCardinality );
+          if ( u->termType() == FLUX )
+          {
+            // we need to multiply uValues' entries by the parity of the normal, since
+            // the trial implicitly contains an outward normal, and we need to adjust for the fact
+            // that the neighboring cells have opposite normal...
+            multiplyFluxValuesByParity(uValues, basisCache); // basisCache had better be a side cache!
+          }
+          uValuesComputed = true;
+        }
 
-      Intrepid::FunctionSpaceTools::integrate<double>(miniMatrix,uValues,vValues,Intrepid::COMP_BLAS);
+        ltValueDim[1] = vBasisCardinality;
+        Intrepid::FieldContainer<double> vValues(ltValueDim);
+        v->values(vValues, vID, vBasis, basisCache, dontApplyCubatureWeights);
+
+        //      cout << "vValues (without cubature weights applied) for v = " << v->displayString() << ":" << endl;
+        //      cout << vValues;
+
+        // same flux consideration, for the vValues
+        if ( v->termType() == FLUX )
+        {
+          multiplyFluxValuesByParity(vValues, basisCache);
+        }
+
+        IntegrationKernels::integrate(miniMatrix, uValues, vValues, basisCache->getWeightedMeasures());
+      }
 
       //      cout << "uValues:" << endl << uValues;
       //      cout << "vValues:" << endl << vValues;
@@ -588,22 +719,17 @@ void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix* valuesCrsMatrix, Intrepid:
 
       if (valuesCrsMatrix==NULL)
       {
-        // there may be a more efficient way to do this copying:
-        for (unsigned k=0; k < numCells; k++)
+        IntegrationKernels::sumInto(valuesFC, miniMatrix, uDofIndices, vDofIndices);
+        if ((symmetric) && (uOrdinal != vOrdinal))    // pretty sure this point is where the bug in symmetric accumulation comes in.  Pretty sure we'll get some double-accumulation.  I'm not sure how to fix it just yet, though.
         {
-          for (int i=0; i < uBasisCardinality; i++)
+          for (unsigned k=0; k < numCells; k++)
           {
-            int uDofIndex = uDofIndices[i];
-            for (int j=0; j < vBasisCardinality; j++)
+            for (int i=0; i < uBasisCardinality; i++)
             {
-              int vDofIndex = vDofIndices[j];
-              double value = miniMatrix(k,i,j); // separate line for debugger inspection
-              valuesFC(k,uDofIndex,vDofIndex) += value;
-              if ((symmetric) && (uOrdinal != vOrdinal))    // pretty sure this point is where the bug in symmetric accumulation comes in.  Pretty sure we'll get some double-accumulation.  I'm not sure how to fix it just yet, though.
+              for (int j=0; j < vBasisCardinality; j++)
               {
-                valuesFC(k,vDofIndex,uDofIndex) += value;
+                valuesFC(k,vDofIndices[j],uDofIndices[i]) += miniMatrix(k,i,j);
               }
-              //            cout << "values(" << k << ", " << uDofIndex << ", " << vDofIndex << ") += " << value << endl;
             }
           }
         }
@@ -630,6 +756,290 @@ void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix* valuesCrsMatrix, Intrepid:
   //  cout << "Integrate complete.\n";
 }
 
+template<typename Scalar>
+bool TLinearTerm<Scalar>::integrateSumFactorized(Intrepid::FieldContainer<double> &miniMatrix,
+                                                 TLinearTermPtr<double> u, int uID, BasisPtr uBasis,
+                                                 TLinearTermPtr<double> v, int vID, BasisPtr vBasis,
+                                                 BasisCachePtr basisCache)
+{
+  // The (u,v) block factors when each summand involving uID (resp. vID) is a scalar function times an operator
+  // applied to a TensorBasis, and the basisCache supplies the spatial and temporal values separately.  Then the
+  // integrand for each pair of summands is (fu * fv * measure) times a product of spatial and temporal values.
+  if (!SpaceTimeBasisCache::useSumFactorization()) return false;
+  if (basisCache->isSideCache()) return false;
+  SpaceTimeBasisCache* spaceTimeCache = dynamic_cast<SpaceTimeBasisCache*>(basisCache.get());
+  if (spaceTimeCache == NULL) return false;
+  if ((u->termType() == FLUX) || (v->termType() == FLUX)) return false;
+
+  typedef Teuchos::RCP< const Intrepid::FieldContainer<double> > constFCPtr;
+  struct FactoredSummand
+  {
+    TFunctionPtr<double> weight;
+    constFCPtr spatialValues, temporalValues;
+  };
+
+  vector<FactoredSummand> factoredSummands[2];
+  TLinearTermPtr<double> terms[2] = {u, v};
+  int varIDs[2] = {uID, vID};
+  BasisPtr bases[2] = {uBasis, vBasis};
+  for (int termOrdinal=0; termOrdinal<2; termOrdinal++)
+  {
+    const vector< TLinearSummand<double> > *summands = &terms[termOrdinal]->summands();
+    for (int i=0; i<summands->size(); i++)
+    {
+      TLinearSummand<double> ls = (*summands)[i];
+      if (ls.second->ID() != varIDs[termOrdinal]) continue;
+      if (linearSummandIsBoundaryValueOnly(ls)) continue; // skipped by values() in volume integration, too
+      if (ls.first->isZero(basisCache)) continue;
+      if (ls.first->rank() != 0) return false;
+
+      FactoredSummand factoredSummand;
+      factoredSummand.weight = ls.first;
+      if (!spaceTimeCache->getTransformedComponentValues(bases[termOrdinal], ls.second->op(),
+          factoredSummand.spatialValues, factoredSummand.temporalValues))
+      {
+        return false;
+      }
+      factoredSummands[termOrdinal].push_back(factoredSummand);
+    }
+  }
+
+  miniMatrix.initialize(0.0);
+  if ((factoredSummands[0].size() == 0) || (factoredSummands[1].size() == 0)) return true;
+
+  // check that the values are shaped as integrateSumFactorized() requires, with matching pointwise shapes
+  int numCells = miniMatrix.dimension(0);
+  int numPoints = basisCache->getPhysicalCubaturePoints().dimension(1);
+  const Intrepid::FieldContainer<double>* firstSpatialValues = factoredSummands[0][0].spatialValues.get();
+  for (int termOrdinal=0; termOrdinal<2; termOrdinal++)
+  {
+    for (int i=0; i<factoredSummands[termOrdinal].size(); i++)
+    {
+      const FactoredSummand* summand = &factoredSummands[termOrdinal][i];
+      if ((summand->spatialValues->rank() < 3) || (summand->temporalValues->rank() != 3)) return false;
+      int numTensorPoints = summand->spatialValues->dimension(2) * summand->temporalValues->dimension(2);
+      if (numTensorPoints != numPoints) return false;
+      if (summand->spatialValues->rank() != firstSpatialValues->rank()) return false;
+      for (int r=3; r<firstSpatialValues->rank(); r++)
+      {
+        if (summand->spatialValues->dimension(r) != firstSpatialValues->dimension(r)) return false;
+      }
+    }
+  }
+
+  const Intrepid::FieldContainer<double>* measures = &basisCache->getWeightedMeasures();
+  Intrepid::FieldContainer<double> uWeightValues(numCells,numPoints), vWeightValues(numCells,numPoints);
+  Intrepid::FieldContainer<double> weights(numCells,numPoints);
+  bool memoize = BasisCache::memoizeFunctionValues();
+  constFCPtr uMemoValues, vMemoValues;
+  for (int i=0; i<factoredSummands[0].size(); i++)
+  {
+    const FactoredSummand* uSummand = &factoredSummands[0][i];
+    const Intrepid::FieldContainer<double>* uWeights = &uWeightValues;
+    if (memoize)
+    {
+      uMemoValues = basisCache->getFunctionValues(uSummand->weight);
+      uWeights = uMemoValues.get();
+    }
+    else
+    {
+      uSummand->weight->values(uWeightValues, basisCache);
+    }
+    for (int j=0; j<factoredSummands[1].size(); j++)
+    {
+      const FactoredSummand* vSummand = &factoredSummands[1][j];
+      const Intrepid::FieldContainer<double>* vWeights = &vWeightValues;
+      if (memoize)
+      {
+        vMemoValues = basisCache->getFunctionValues(vSummand->weight);
+        vWeights = vMemoValues.get();
+      }
+      else
+      {
+        vSummand->weight->values(vWeightValues, basisCache);
+      }
+      for (int pointEnumeration=0; pointEnumeration<weights.size(); pointEnumeration++)
+      {
+        weights[pointEnumeration] = (*uWeights)[pointEnumeration] * (*vWeights)[pointEnumeration] * (*measures)[pointEnumeration];
+      }
+      bool sumInto = true;
+      TensorBasis<double>::integrateSumFactorized(miniMatrix, *uSummand->spatialValues, *uSummand->temporalValues,
+                                                  *vSummand->spatialValues, *vSummand->temporalValues, weights, sumInto);
+    }
+  }
+  return true;
+}
+
+template<typename Scalar>
+bool TLinearTerm<Scalar>::integrateAffine(Intrepid::FieldContainer<double> &miniMatrix,
+                                          TLinearTermPtr<double> u, int uID, BasisPtr uBasis,
+                                          TLinearTermPtr<double> v, int vID, BasisPtr vBasis,
+                                          BasisCachePtr basisCache, ReferenceIntegralCache* refIntegralCache)
+{
+  // When the Jacobian is constant on each cell and the weights are constant, u = Tu * (reference fields of uBasis) and
+  // v = Tv * (reference fields of vBasis), with Tu and Tv constant per cell.  The block is then
+  //   |det J| * sum_{a,b} (Tu^T Tv)(a,b) * R(a,b),
+  // where R(a,b) is the reference-cell integral of reference field a of uBasis times reference field b of vBasis.  Each
+  // R(a,b) is integrated once for the whole batch of cells -- or, with a refIntegralCache, once for the element type.
+  if (!BasisCache::useAffineIntegration()) return false;
+  if (basisCache->isSideCache()) return false;
+  if (dynamic_cast<SpaceTimeBasisCache*>(basisCache.get()) != NULL) return false;
+  if ((u->termType() == FLUX) || (v->termType() == FLUX)) return false;
+
+  int spaceDim = basisCache->cellTopology()->getDimension();
+  struct AffineSummand
+  {
+    double weight;
+    Camellia::EOperator op;
+  };
+  vector<AffineSummand> affineSummands[2];
+  TLinearTermPtr<double> terms[2] = {u, v};
+  int varIDs[2] = {uID, vID};
+  BasisPtr bases[2] = {uBasis, vBasis};
+  int numComponents = -1;
+  for (int termOrdinal=0; termOrdinal<2; termOrdinal++)
+  {
+    Camellia::EFunctionSpace fs = bases[termOrdinal]->functionSpace();
+    const vector< TLinearSummand<double> > *summands = &terms[termOrdinal]->summands();
+    for (int i=0; i<summands->size(); i++)
+    {
+      TLinearSummand<double> ls = (*summands)[i];
+      if (ls.second->ID() != varIDs[termOrdinal]) continue;
+      if (linearSummandIsBoundaryValueOnly(ls)) continue; // skipped by values() in volume integration, too
+      if (ls.first->isZero(basisCache)) continue;
+      ConstantScalarFunction<double>* constantWeight = dynamic_cast<ConstantScalarFunction<double>*>(ls.first.get());
+      if (constantWeight == NULL) return false;
+
+      int summandComponents = affineComponentCount(fs, ls.second->op(), spaceDim);
+      if (summandComponents == -1) return false;
+      if (numComponents == -1) numComponents = summandComponents;
+      if (summandComponents != numComponents) return false;
+
+      AffineSummand affineSummand;
+      affineSummand.weight = constantWeight->value();
+      affineSummand.op = ls.second->op();
+      affineSummands[termOrdinal].push_back(affineSummand);
+    }
+  }
+  if (!basisCache->cellsAreAffine()) return false;
+
+  int numCells = miniMatrix.dimension(0);
+  if ((affineSummands[0].size() == 0) || (affineSummands[1].size() == 0))
+  {
+    miniMatrix.initialize(0.0);
+    return true;
+  }
+
+  // per-cell coefficients of each pair of reference fields, including the measure |det J|
+  int numRefFields = spaceDim + 1;
+  const Intrepid::FieldContainer<double>* J = &basisCache->getAffineCellJacobian();
+  const Intrepid::FieldContainer<double>* Jinv = &basisCache->getAffineCellJacobianInv();
+  const Intrepid::FieldContainer<double>* detJ = &basisCache->getAffineCellJacobianDet();
+  Intrepid::FieldContainer<double> pairCoefficients(numCells,numRefFields,numRefFields);
+  vector<double> maps[2] = {vector<double>(numComponents * numRefFields), vector<double>(numComponents * numRefFields)};
+  int matrixSize = spaceDim * spaceDim;
+  for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+  {
+    for (int termOrdinal=0; termOrdinal<2; termOrdinal++)
+    {
+      maps[termOrdinal].assign(maps[termOrdinal].size(), 0.0);
+      for (const AffineSummand &summand : affineSummands[termOrdinal])
+      {
+        addAffineReferenceMap(maps[termOrdinal], bases[termOrdinal]->functionSpace(), summand.op, spaceDim,
+                              &(*J)[cellOrdinal * matrixSize], &(*Jinv)[cellOrdinal * matrixSize], (*detJ)(cellOrdinal),
+                              summand.weight);
+      }
+    }
+    double measure = fabs((*detJ)(cellOrdinal));
+    for (int a=0; a<numRefFields; a++)
+    {
+      for (int b=0; b<numRefFields; b++)
+      {
+        double coefficient = 0;
+        for (int k=0; k<numComponents; k++)
+        {
+          coefficient += maps[0][k * numRefFields + a] * maps[1][k * numRefFields + b];
+        }
+        pairCoefficients(cellOrdinal,a,b) = measure * coefficient;
+      }
+    }
+  }
+
+  vector< pair<int,int> > activePairs;
+  for (int a=0; a<numRefFields; a++)
+  {
+    for (int b=0; b<numRefFields; b++)
+    {
+      for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+      {
+        if (pairCoefficients(cellOrdinal,a,b) != 0.0)
+        {
+          activePairs.push_back({a,b});
+          break;
+        }
+      }
+    }
+  }
+
+  // reference integrals already computed for this element type, if any
+  vector<const Intrepid::FieldContainer<double>*> cachedIntegrals(activePairs.size(), NULL);
+  int numPairsToIntegrate = activePairs.size();
+  ReferenceIntegralCache::Key refIntegralKey;
+  if (refIntegralCache != NULL)
+  {
+    refIntegralKey = ReferenceIntegralCache::key(uBasis, 0, vBasis, 0, basisCache);
+    for (int pairOrdinal=0; pairOrdinal<activePairs.size(); pairOrdinal++)
+    {
+      refIntegralKey.uField = activePairs[pairOrdinal].first;
+      refIntegralKey.vField = activePairs[pairOrdinal].second;
+      cachedIntegrals[pairOrdinal] = refIntegralCache->integrals(refIntegralKey);
+      if (cachedIntegrals[pairOrdinal] != NULL) numPairsToIntegrate--;
+    }
+  }
+
+  // compare (up to the common factor uCardinality * vCardinality) with the cost of integrating the transformed values
+  const Intrepid::FieldContainer<double>* cubWeights = &basisCache->getCubatureWeights();
+  int numPoints = cubWeights->size();
+  double quadratureCost = double(numCells) * numPoints * numComponents;
+  double affineCost = double(activePairs.size()) * numCells + double(numPairsToIntegrate) * numPoints;
+  if (affineCost >= quadratureCost) return false;
+
+  int uCardinality = miniMatrix.dimension(1), vCardinality = miniMatrix.dimension(2);
+  miniMatrix.initialize(0.0);
+  Intrepid::FieldContainer<double> uFieldValues, vFieldValues, computedIntegrals(1,uCardinality,vCardinality);
+  for (int pairOrdinal=0; pairOrdinal<activePairs.size(); pairOrdinal++)
+  {
+    int uField = activePairs[pairOrdinal].first, vField = activePairs[pairOrdinal].second;
+    const Intrepid::FieldContainer<double>* refIntegrals = cachedIntegrals[pairOrdinal];
+    if (refIntegrals == NULL)
+    {
+      getAffineReferenceFieldValues(uFieldValues, uBasis, uField, basisCache, cubWeights);
+      getAffineReferenceFieldValues(vFieldValues, vBasis, vField, basisCache, NULL);
+      Intrepid::FunctionSpaceTools::integrate<double>(computedIntegrals,uFieldValues,vFieldValues,Intrepid::COMP_BLAS);
+      refIntegrals = &computedIntegrals;
+      if (refIntegralCache != NULL)
+      {
+        refIntegralKey.uField = uField;
+        refIntegralKey.vField = vField;
+        refIntegrals = refIntegralCache->storeIntegrals(refIntegralKey, computedIntegrals);
+      }
+    }
+    int numEntries = refIntegrals->size();
+    const double* refValues = &(*refIntegrals)[0];
+    for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+    {
+      double coefficient = pairCoefficients(cellOrdinal,uField,vField);
+      if (coefficient == 0.0) continue;
+      double* cellValues = &miniMatrix(cellOrdinal,0,0);
+      for (int i=0; i<numEntries; i++)
+      {
+        cellValues[i] += coefficient * refValues[i];
+      }
+    }
+  }
+  return true;
+}
+
 template<typename Scalar>
 void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix *values, DofOrderingPtr thisOrdering,
                                     TLinearTermPtr<double> otherTerm, DofOrderingPtr otherOrdering,
@@ -642,15 +1052,17 @@ void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix *values, DofOrderingPtr thi
 template<typename Scalar>
 void TLinearTerm<Scalar>::integrate(Intrepid::FieldContainer<Scalar> &values, DofOrderingPtr thisOrdering,
                                     TLinearTermPtr<Scalar> otherTerm, DofOrderingPtr otherOrdering,
-                                    BasisCachePtr basisCache, bool forceBoundaryTerm, bool sumInto)
+                                    BasisCachePtr basisCache, bool forceBoundaryTerm, bool sumInto,
+                                    ReferenceIntegralCache* refIntegralCache)
 {
-  integrate(NULL, values, thisOrdering, otherTerm, otherOrdering, basisCache, forceBoundaryTerm, sumInto);
+  integrate(NULL, values, thisOrdering, otherTerm, otherOrdering, basisCache, forceBoundaryTerm, sumInto, refIntegralCache);
 }
 
 template<typename Scalar>
 void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix *valuesCrsMatrix, Intrepid::FieldContainer<double> &valuesFC, DofOrderingPtr thisOrdering,
                                     TLinearTermPtr<double> otherTerm, DofOrderingPtr otherOrdering,
-                                    BasisCachePtr basisCache, bool forceBoundaryTerm, bool sumInto)
+                                    BasisCachePtr basisCache, bool forceBoundaryTerm, bool sumInto,
+                                    ReferenceIntegralCache* refIntegralCache)
 {
   // values has dimensions (numCells, otherFields, thisFields)
   // note that this means when we call the private integrate, we need to use otherTerm as the first TLinearTerm argument
@@ -710,7 +1122,9 @@ void TLinearTerm<Scalar>::integrate(Epetra_CrsMatrix *valuesCrsMatrix, Intrepid:
     }
 
     // volume integration first:  ( (u,v) from above )
-    integrate(valuesCrsMatrix, valuesFC, otherNonBoundaryOnly, otherOrdering, thisNonBoundaryOnly, thisOrdering, basisCache);
+    bool sumIntoVolume = true;
+    integrate(valuesCrsMatrix, valuesFC, otherNonBoundaryOnly, otherOrdering, thisNonBoundaryOnly, thisOrdering, basisCache,
+              sumIntoVolume, refIntegralCache);
 
     // sides:
     // (u + du, v + dv) - (u,v) = (u + du, dv) + (du, v)
@@ -1171,7 +1585,16 @@ void TLinearTerm<Scalar>::values(Intrepid::FieldContainer<Scalar> &values, int v
       {
         // E.g. ConstantTFunction<double>::scalarMultiplyBasisValues() knows not to do anything at all if its value is 1.0...
         Intrepid::FieldContainer<double> weightedBasisValues = *basisValues; // weighted by the scalar function
-        ls.first->scalarMultiplyBasisValues(weightedBasisValues,basisCache);
+        bool isConstant = dynamic_cast<ConstantScalarFunction<Scalar>*>(ls.first.get()) != NULL;
+        if (BasisCache::memoizeFunctionValues() && !isConstant)
+        {
+          // the same weight often appears in several summands (and terms): use values retained by basisCache
+          scalarMultiplyBasisValues(weightedBasisValues, *basisCache->getFunctionValues(ls.first));
+        }
+        else
+        {
+          ls.first->scalarMultiplyBasisValues(weightedBasisValues,basisCache);
+        }
         // bounds check so we can safely do pointer arithmetic below:
         int size = values.size();
         TEUCHOS_TEST_FOR_EXCEPTION(weightedBasisValues.size() != size, std::invalid_argument, "Error: values containers are different sizes");
@@ -1206,7 +1629,14 @@ void TLinearTerm<Scalar>::values(Intrepid::FieldContainer<Scalar> &values, int v
         fValues.resize(fDim);
       }
 
-      ls.first->values(fValues,basisCache);
+      if (BasisCache::memoizeFunctionValues())
+      {
+        fValues = *basisCache->getFunctionValues(ls.first);
+      }
+      else
+      {
+        ls.first->values(fValues,basisCache);
+      }
 
       int numFields = basis->getCardinality();
 
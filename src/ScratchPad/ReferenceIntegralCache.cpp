@@ -0,0 +1,135 @@
+//
+//  ReferenceIntegralCache.cpp
+//  Camellia
+//
+//
+
+#include "ReferenceIntegralCache.h"
+
+#include "BasisCache.h"
+
+#include <cstring>
+
+using namespace Camellia;
+using namespace Intrepid;
+
+namespace
+{
+// FNV-1a over the bytes of the values
+void hashValues(size_t &hash, const FieldContainer<double> &values)
+{
+  const size_t fnvPrime = 1099511628211ULL;
+  for (int i=0; i<values.size(); i++)
+  {
+    unsigned long long bits;
+    double value = values[i];
+    memcpy(&bits, &value, sizeof(bits));
+    for (int byte=0; byte<sizeof(bits); byte++)
+    {
+      hash ^= (bits >> (8 * byte)) & 0xff;
+      hash *= fnvPrime;
+    }
+  }
+}
+}
+
+bool ReferenceIntegralCache::Key::operator<(const Key &other) const
+{
+  if (uBasis.get() != other.uBasis.get()) return uBasis.get() < other.uBasis.get();
+  if (vBasis.get() != other.vBasis.get()) return vBasis.get() < other.vBasis.get();
+  if (uField != other.uField) return uField < other.uField;
+  if (vField != other.vField) return vField < other.vField;
+  if (numPoints != other.numPoints) return numPoints < other.numPoints;
+  return cubatureFingerprint < other.cubatureFingerprint;
+}
+
+Teuchos::RCP<ReferenceIntegralCache> ReferenceIntegralCache::referenceIntegralCache()
+{
+  return Teuchos::rcp( new ReferenceIntegralCache );
+}
+
+ReferenceIntegralCache::Key ReferenceIntegralCache::key(BasisPtr uBasis, int uField, BasisPtr vBasis, int vField,
+                                                        BasisCachePtr basisCache)
+{
+  Key key;
+  key.uBasis = uBasis;
+  key.vBasis = vBasis;
+  key.uField = uField;
+  key.vField = vField;
+  key.numPoints = basisCache->getRefCellPoints().dimension(0);
+  key.cubatureFingerprint = 14695981039346656037ULL; // FNV offset basis
+  hashValues(key.cubatureFingerprint, basisCache->getRefCellPoints());
+  hashValues(key.cubatureFingerprint, basisCache->getCubatureWeights());
+  return key;
+}
+
+const FieldContainer<double>* ReferenceIntegralCache::integrals(const Key &key)
+{
+  const FieldContainer<double>* integrals = NULL;
+  // lookups may come from several threads during local stiffness computation (see Solution::setNumThreadsForLocalStiffness())
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaReferenceIntegralCache)
+#endif
+  {
+    auto entryIt = _entries.find(key);
+    if (entryIt != _entries.end())
+    {
+      integrals = &entryIt->second;
+      _hitCount++;
+    }
+    else
+    {
+      _missCount++;
+    }
+  }
+  return integrals;
+}
+
+const FieldContainer<double>* ReferenceIntegralCache::storeIntegrals(const Key &key, const FieldContainer<double> &integrals)
+{
+  const FieldContainer<double>* storedIntegrals = NULL;
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaReferenceIntegralCache)
+#endif
+  {
+    auto entryIt = _entries.find(key);
+    if (entryIt == _entries.end())
+    {
+      entryIt = _entries.insert({key, integrals}).first;
+      _memoryUsed += integrals.size() * sizeof(double);
+    }
+    storedIntegrals = &entryIt->second;
+  }
+  return storedIntegrals;
+}
+
+void ReferenceIntegralCache::clear()
+{
+#ifdef _OPENMP
+  #pragma omp critical (CamelliaReferenceIntegralCache)
+#endif
+  {
+    _entries.clear();
+    _memoryUsed = 0;
+  }
+}
+
+int ReferenceIntegralCache::numEntries() const
+{
+  return _entries.size();
+}
+
+size_t ReferenceIntegralCache::memoryUsed() const
+{
+  return _memoryUsed;
+}
+
+long long ReferenceIntegralCache::hitCount() const
+{
+  return _hitCount;
+}
+
+long long ReferenceIntegralCache::missCount() const
+{
+  return _missCount;
+}
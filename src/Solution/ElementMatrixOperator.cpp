@@ -0,0 +1,390 @@
+//
+//  ElementMatrixOperator.cpp
+//  Camellia
+//
+//
+
+#include "ElementMatrixOperator.h"
+
+#include "Epetra_FECrsMatrix.h"
+
+#include "Teuchos_BLAS.hpp"
+
+#include <algorithm>
+#include <set>
+
+using namespace Camellia;
+using namespace std;
+
+ElementMatrixOperator::ElementMatrixOperator(const Epetra_Map &rowMap) : _rowMap(rowMap) {}
+
+void ElementMatrixOperator::checkFilled(bool expected) const
+{
+  if (expected)
+  {
+    TEUCHOS_TEST_FOR_EXCEPTION(!_filled, std::invalid_argument, "ElementMatrixOperator: fillComplete() has not been called");
+  }
+  else
+  {
+    TEUCHOS_TEST_FOR_EXCEPTION(_filled, std::invalid_argument, "ElementMatrixOperator: fillComplete() has already been called");
+  }
+}
+
+void ElementMatrixOperator::sumIntoGlobalValues(int numRows, const GlobalIndexTypeToCast* rows, int numCols,
+                                                const GlobalIndexTypeToCast* cols, const double* values)
+{
+  checkFilled(false);
+  if ((numRows == 0) || (numCols == 0)) return;
+
+  Block block;
+  block.numRows = numRows;
+  block.numCols = numCols;
+  block.rowOffset = _indices.size();
+  _indices.insert(_indices.end(), rows, rows + numRows);
+  block.colOffset = _indices.size();
+  _indices.insert(_indices.end(), cols, cols + numCols);
+  block.valueOffset = _values.size();
+  _values.insert(_values.end(), values, values + numRows * numCols);
+  _blocks.push_back(block);
+}
+
+void ElementMatrixOperator::fillComplete()
+{
+  checkFilled(false);
+
+  // owned indices come first, in row-map order, so that the owned part of an overlapped vector has the row map's LIDs
+  int numMyRows = _rowMap.NumMyElements();
+  vector<GlobalIndexTypeToCast> overlapGIDs(numMyRows);
+  if (numMyRows > 0) _rowMap.MyGlobalElements(&overlapGIDs[0]);
+  set<GlobalIndexTypeToCast> offRankGIDs;
+  for (GlobalIndexTypeToCast index : _indices)
+  {
+    if (!_rowMap.MyGID(index)) offRankGIDs.insert(index);
+  }
+  overlapGIDs.insert(overlapGIDs.end(), offRankGIDs.begin(), offRankGIDs.end());
+
+  GlobalIndexTypeToCast* overlapGIDsPtr = (overlapGIDs.size() > 0) ? &overlapGIDs[0] : NULL;
+  _overlapMap = Teuchos::rcp( new Epetra_Map(-1, overlapGIDs.size(), overlapGIDsPtr, _rowMap.IndexBase(), _rowMap.Comm()) );
+  _importer = Teuchos::rcp( new Epetra_Import(*_overlapMap, _rowMap) );
+
+  for (GlobalIndexTypeToCast &index : _indices)
+  {
+    index = _overlapMap->LID(index);
+  }
+  _filled = true;
+}
+
+bool ElementMatrixOperator::filled() const
+{
+  return _filled;
+}
+
+void ElementMatrixOperator::setDirichletRows(int numRows, const GlobalIndexTypeToCast* rows)
+{
+  checkFilled(true);
+
+  // mark the Dirichlet rows, and share the marks with the ranks that reference them
+  Epetra_Vector rowMarks(_rowMap);
+  for (int LID : _dirichletRowLIDs)
+  {
+    rowMarks[LID] = 1.0;
+  }
+  for (int i=0; i<numRows; i++)
+  {
+    int LID = _rowMap.LID(rows[i]);
+    TEUCHOS_TEST_FOR_EXCEPTION(LID == -1, std::invalid_argument, "Dirichlet rows must be owned by this rank");
+    rowMarks[LID] = 1.0;
+  }
+  Epetra_Vector overlapMarks(*_overlapMap);
+  overlapMarks.Import(rowMarks, *_importer, Insert);
+
+  _dirichletRowLIDs.clear();
+  for (int LID=0; LID<rowMarks.MyLength(); LID++)
+  {
+    if (rowMarks[LID] != 0.0) _dirichletRowLIDs.push_back(LID);
+  }
+  _dirichletOverlapLIDs.clear();
+  for (int LID=0; LID<overlapMarks.MyLength(); LID++)
+  {
+    if (overlapMarks[LID] != 0.0) _dirichletOverlapLIDs.push_back(LID);
+  }
+}
+
+int ElementMatrixOperator::Apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
+{
+  checkFilled(true);
+  int numVectors = X.NumVectors();
+  if ((_overlapX == Teuchos::null) || (_overlapX->NumVectors() != numVectors))
+  {
+    _overlapX = Teuchos::rcp( new Epetra_MultiVector(*_overlapMap, numVectors, false) );
+    _overlapY = Teuchos::rcp( new Epetra_MultiVector(*_overlapMap, numVectors, false) );
+  }
+  int err = _overlapX->Import(X, *_importer, Insert);
+  if (err != 0) return err;
+
+  // Dirichlet rows of Y take the values of X (a unit diagonal); save those before zeroing the Dirichlet columns.
+  // (Reading them from the overlapped copy lets X and Y be the same vector.)
+  int numDirichletRows = _dirichletRowLIDs.size();
+  vector<double> dirichletValues(numDirichletRows * numVectors);
+  for (int vectorOrdinal=0; vectorOrdinal<numVectors; vectorOrdinal++)
+  {
+    for (int i=0; i<numDirichletRows; i++)
+    {
+      dirichletValues[vectorOrdinal * numDirichletRows + i] = (*_overlapX)[vectorOrdinal][_dirichletRowLIDs[i]];
+    }
+    for (int LID : _dirichletOverlapLIDs)
+    {
+      (*_overlapX)[vectorOrdinal][LID] = 0.0;
+    }
+  }
+
+  _overlapY->PutScalar(0.0);
+  for (int vectorOrdinal=0; vectorOrdinal<numVectors; vectorOrdinal++)
+  {
+    const double* x = (*_overlapX)[vectorOrdinal];
+    double* y = (*_overlapY)[vectorOrdinal];
+    for (const Block &block : _blocks)
+    {
+      const GlobalIndexTypeToCast* rowLIDs = &_indices[block.rowOffset];
+      const GlobalIndexTypeToCast* colLIDs = &_indices[block.colOffset];
+      const double* values = &_values[block.valueOffset];
+      if (!_useTranspose)
+      {
+        for (int i=0; i<block.numRows; i++)
+        {
+          const double* row = values + i * block.numCols;
+          double sum = 0.0;
+          for (int j=0; j<block.numCols; j++)
+          {
+            sum += row[j] * x[colLIDs[j]];
+          }
+          y[rowLIDs[i]] += sum;
+        }
+      }
+      else
+      {
+        for (int i=0; i<block.numRows; i++)
+        {
+          const double* row = values + i * block.numCols;
+          double x_i = x[rowLIDs[i]];
+          if (x_i == 0.0) continue;
+          for (int j=0; j<block.numCols; j++)
+          {
+            y[colLIDs[j]] += row[j] * x_i;
+          }
+        }
+      }
+    }
+    for (int LID : _dirichletOverlapLIDs)
+    {
+      y[LID] = 0.0;
+    }
+  }
+
+  Y.PutScalar(0.0);
+  err = Y.Export(*_overlapY, *_importer, Add);
+  if (err != 0) return err;
+
+  for (int vectorOrdinal=0; vectorOrdinal<numVectors; vectorOrdinal++)
+  {
+    for (int i=0; i<numDirichletRows; i++)
+    {
+      Y[vectorOrdinal][_dirichletRowLIDs[i]] = dirichletValues[vectorOrdinal * numDirichletRows + i];
+    }
+  }
+  return 0;
+}
+
+int ElementMatrixOperator::ApplyInverse(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
+{
+  return -1; // not supported
+}
+
+int ElementMatrixOperator::ExtractDiagonalCopy(Epetra_Vector &diagonal) const
+{
+  checkFilled(true);
+  Epetra_Vector overlapDiagonal(*_overlapMap);
+  for (const Block &block : _blocks)
+  {
+    const GlobalIndexTypeToCast* rowLIDs = &_indices[block.rowOffset];
+    const GlobalIndexTypeToCast* colLIDs = &_indices[block.colOffset];
+    const double* values = &_values[block.valueOffset];
+    for (int i=0; i<block.numRows; i++)
+    {
+      for (int j=0; j<block.numCols; j++)
+      {
+        if (rowLIDs[i] == colLIDs[j]) overlapDiagonal[rowLIDs[i]] += values[i * block.numCols + j];
+      }
+    }
+  }
+  diagonal.PutScalar(0.0);
+  int err = diagonal.Export(overlapDiagonal, *_importer, Add);
+  for (int LID : _dirichletRowLIDs)
+  {
+    diagonal[LID] = 1.0;
+  }
+  return err;
+}
+
+Teuchos::RCP<Epetra_CrsMatrix> ElementMatrixOperator::galerkinProduct(const Epetra_CrsMatrix &P) const
+{
+  checkFilled(true);
+  TEUCHOS_TEST_FOR_EXCEPTION(!P.RowMap().SameAs(_rowMap), std::invalid_argument, "P's row map must match the operator's row map");
+
+  // bring in the rows of P for every index referenced on this rank, and copy them into compressed rows by overlap LID
+  Epetra_Import rowImporter(*_overlapMap, P.RowMap());
+  Epetra_CrsMatrix overlapP(::Copy, *_overlapMap, 0);
+  int err = overlapP.Import(P, rowImporter, ::Insert);
+  TEUCHOS_TEST_FOR_EXCEPTION(err != 0, std::runtime_error, "Import of the rows of P failed");
+
+  int numOverlap = _overlapMap->NumMyElements();
+  vector<int> rowStart(numOverlap+1, 0);
+  vector<GlobalIndexTypeToCast> P_cols;
+  vector<double> P_values;
+  for (int LID=0; LID<numOverlap; LID++)
+  {
+    GlobalIndexTypeToCast GID = _overlapMap->GID(LID);
+    int numEntries = overlapP.NumGlobalEntries(GID);
+    if (numEntries > 0)
+    {
+      P_cols.resize(rowStart[LID] + numEntries);
+      P_values.resize(rowStart[LID] + numEntries);
+      overlapP.ExtractGlobalRowCopy(GID, numEntries, numEntries, &P_values[rowStart[LID]], &P_cols[rowStart[LID]]);
+    }
+    rowStart[LID+1] = rowStart[LID] + max(numEntries,0);
+  }
+
+  vector<bool> isDirichlet(numOverlap, false);
+  for (int LID : _dirichletOverlapLIDs)
+  {
+    isDirichlet[LID] = true;
+  }
+
+  Teuchos::RCP<Epetra_FECrsMatrix> PT_A_P = Teuchos::rcp( new Epetra_FECrsMatrix(::Copy, P.DomainMap(), 0) );
+
+  // the coarse indices reached through the P rows of the given LIDs, sorted; the dense restriction of P to those rows
+  // (column-major, with the LIDs as rows) goes in P_dense.  Dirichlet rows are left zero.
+  auto restrictP = [&rowStart, &P_cols, &P_values, &isDirichlet] (const GlobalIndexTypeToCast* LIDs, int numLIDs,
+                                                                   vector<GlobalIndexTypeToCast> &coarseIndices, vector<double> &P_dense)
+  {
+    coarseIndices.clear();
+    for (int i=0; i<numLIDs; i++)
+    {
+      if (isDirichlet[LIDs[i]]) continue;
+      coarseIndices.insert(coarseIndices.end(), P_cols.data() + rowStart[LIDs[i]], P_cols.data() + rowStart[LIDs[i]+1]);
+    }
+    sort(coarseIndices.begin(), coarseIndices.end());
+    coarseIndices.erase(unique(coarseIndices.begin(), coarseIndices.end()), coarseIndices.end());
+
+    P_dense.assign(numLIDs * coarseIndices.size(), 0.0);
+    for (int i=0; i<numLIDs; i++)
+    {
+      if (isDirichlet[LIDs[i]]) continue;
+      for (int entry=rowStart[LIDs[i]]; entry<rowStart[LIDs[i]+1]; entry++)
+      {
+        int coarseOrdinal = lower_bound(coarseIndices.begin(), coarseIndices.end(), P_cols[entry]) - coarseIndices.begin();
+        P_dense[coarseOrdinal * numLIDs + i] += P_values[entry];
+      }
+    }
+  };
+
+  Teuchos::BLAS<int, double> blas;
+  vector<GlobalIndexTypeToCast> leftIndices, rightIndices;
+  vector<double> P_left, P_right, A_P, PT_A_P_block;
+  for (const Block &block : _blocks)
+  {
+    restrictP(&_indices[block.rowOffset], block.numRows, leftIndices, P_left);
+    restrictP(&_indices[block.colOffset], block.numCols, rightIndices, P_right);
+    int numLeft = leftIndices.size(), numRight = rightIndices.size();
+    if ((numLeft == 0) || (numRight == 0)) continue;
+
+    // the row-major block is, column-major, its transpose (leading dimension numCols)
+    A_P.resize(block.numRows * numRight);
+    blas.GEMM(Teuchos::TRANS, Teuchos::NO_TRANS, block.numRows, numRight, block.numCols, 1.0,
+              &_values[block.valueOffset], block.numCols, &P_right[0], block.numCols, 0.0, &A_P[0], block.numRows);
+    PT_A_P_block.resize(numLeft * numRight);
+    blas.GEMM(Teuchos::TRANS, Teuchos::NO_TRANS, numLeft, numRight, block.numRows, 1.0,
+              &P_left[0], block.numRows, &A_P[0], block.numRows, 0.0, &PT_A_P_block[0], numLeft);
+    PT_A_P->InsertGlobalValues(numLeft, &leftIndices[0], numRight, &rightIndices[0], &PT_A_P_block[0],
+                               Epetra_FECrsMatrix::COLUMN_MAJOR);
+  }
+
+  // unit diagonal for Dirichlet rows: P_r^T P_r
+  for (int LID : _dirichletRowLIDs)
+  {
+    int numEntries = rowStart[LID+1] - rowStart[LID];
+    if (numEntries == 0) continue;
+    const GlobalIndexTypeToCast* cols = &P_cols[rowStart[LID]];
+    const double* values = &P_values[rowStart[LID]];
+    vector<double> outerProduct(numEntries * numEntries);
+    for (int i=0; i<numEntries; i++)
+    {
+      for (int j=0; j<numEntries; j++)
+      {
+        outerProduct[i * numEntries + j] = values[i] * values[j];
+      }
+    }
+    PT_A_P->InsertGlobalValues(numEntries, cols, numEntries, cols, &outerProduct[0]);
+  }
+
+  err = PT_A_P->GlobalAssemble();
+  TEUCHOS_TEST_FOR_EXCEPTION(err != 0, std::runtime_error, "GlobalAssemble() of P^T A P failed");
+  return PT_A_P;
+}
+
+int ElementMatrixOperator::numBlocks() const
+{
+  return _blocks.size();
+}
+
+size_t ElementMatrixOperator::memoryUsed() const
+{
+  size_t bytes = _values.size() * sizeof(double) + _indices.size() * sizeof(GlobalIndexTypeToCast) + _blocks.size() * sizeof(Block);
+  bytes += (_dirichletRowLIDs.size() + _dirichletOverlapLIDs.size()) * sizeof(int);
+  if (_overlapX != Teuchos::null)
+  {
+    bytes += 2 * _overlapX->MyLength() * _overlapX->NumVectors() * sizeof(double);
+  }
+  return bytes;
+}
+
+int ElementMatrixOperator::SetUseTranspose(bool UseTranspose)
+{
+  _useTranspose = UseTranspose;
+  return 0;
+}
+
+double ElementMatrixOperator::NormInf() const
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Unsupported method.");
+}
+
+const char * ElementMatrixOperator::Label() const
+{
+  return "Camellia Element Matrix Operator";
+}
+
+bool ElementMatrixOperator::UseTranspose() const
+{
+  return _useTranspose;
+}
+
+bool ElementMatrixOperator::HasNormInf() const
+{
+  return false;
+}
+
+const Epetra_Comm & ElementMatrixOperator::Comm() const
+{
+  return _rowMap.Comm();
+}
+
+const Epetra_Map & ElementMatrixOperator::OperatorDomainMap() const
+{
+  return _rowMap;
+}
+
+const Epetra_Map & ElementMatrixOperator::OperatorRangeMap() const
+{
+  return _rowMap;
+}
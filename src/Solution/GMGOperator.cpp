@@ -16,8 +16,10 @@
 #include "CamelliaCellTools.h"
 #include "CondensedDofInterpreter.h"
 #include "CubatureFactory.h"
+#include "ElementMatrixOperator.h"
 #include "GDAMinimumRule.h"
 #include "SerialDenseWrapper.h"
+#include "TimerRegistry.h"
 
 // EpetraExt includes
 #include "EpetraExt_MatrixMatrix.h"
@@ -27,6 +29,7 @@
 #include "Epetra_SerialComm.h"
 
 #include "Ifpack_BlockRelaxation.h"
+#include "Ifpack_Chebyshev.h"
 #include "Ifpack_SparseContainer.h"
 #include "Ifpack_AdditiveSchwarz.h"
 #include "Ifpack_PointRelaxation.h"
@@ -87,6 +90,11 @@ _finePartitionMap(finePartitionMap), _br(true)
   _fillRatio = 5.0;
   _smootherWeight = 1.0;
 
+  _chebyshevDegree = 3;
+  _chebyshevPowerIterations = 10;
+  _chebyshevEigenvalueRatio = 30.0;
+  _chebyshevMaxEigenvalue = -1.0;
+
   clearTimings();
 
 #ifdef HAVE_MPI
@@ -247,35 +255,7 @@ void GMGOperator::computeCoarseStiffnessMatrix(Epetra_CrsMatrix *fineStiffnessMa
     //  cout << "Writing P to disk at " << P_path << endl;
     //  EpetraExt::RowMatrixToMatrixMarketFile(P_path.c_str(),*_P, NULL, NULL, false); // false: don't write header
     
-    Epetra_Map coarsePartitionMap = _coarseSolution->getPartitionMap();
-    Epetra_Import  coarseImporter(coarsePartitionMap, PT_A_P->RowMap());
-//    { // DEBUGGING
-//      Camellia::printMapSummary(coarsePartitionMap, "coarsePartitionMap");
-//      Camellia::printMapSummary(PT_A_P->RowMap(), "PT_A_P->RowMap()");
-//    }
-    
-    Teuchos::RCP<Epetra_CrsMatrix> coarseStiffness;
-    if (_coarseSolution->getZMCsAsGlobalLagrange() &&
-        (prolongationColCount() > _coarseSolution->getDofInterpreter()->globalDofCount()))
-    {
-      // essentially: there are some lagrange constraints applied in coarse solve --> we shouldn't use the fused import,
-      //              since this will call FillComplete()
-      
-      int numEntriesPerRow = 0; // sub-optimal, but easy
-      coarseStiffness = Teuchos::rcp( new Epetra_CrsMatrix(::Copy, coarsePartitionMap, numEntriesPerRow) );
-      coarseStiffness->Import(*PT_A_P,coarseImporter,::Insert);
-      _coarseSolution->setStiffnessMatrix(coarseStiffness);
-      _coarseSolution->imposeZMCsUsingLagrange(); // fills in the augmented matrix -- the ZMC rows that are at the end.
-      // now can call FillComplete()
-      coarseStiffness->FillComplete();
-    }
-    else
-    {
-      coarseStiffness = Teuchos::rcp( new Epetra_CrsMatrix(*PT_A_P, coarseImporter) );
-      
-      _coarseSolution->setStiffnessMatrix(coarseStiffness);
-      _coarseSolution->imposeZMCsUsingLagrange(); // fills in the augmented matrix -- the ZMC rows that are at the end.
-    }
+    setCoarseStiffnessFromGalerkinProduct(PT_A_P);
   }
   else // _fineCoarseRolesSwapped == true
   {
@@ -350,14 +330,49 @@ void GMGOperator::computeCoarseStiffnessMatrix(Epetra_CrsMatrix *fineStiffnessMa
   _haveSolvedOnCoarseMesh = false; // having recomputed coarseStiffness, any existing factorization is invalid
 }
 
+void GMGOperator::setCoarseStiffnessFromGalerkinProduct(Teuchos::RCP<Epetra_CrsMatrix> PT_A_P)
+{
+  Epetra_Map coarsePartitionMap = _coarseSolution->getPartitionMap();
+  Epetra_Import  coarseImporter(coarsePartitionMap, PT_A_P->RowMap());
+//    { // DEBUGGING
+//      Camellia::printMapSummary(coarsePartitionMap, "coarsePartitionMap");
+//      Camellia::printMapSummary(PT_A_P->RowMap(), "PT_A_P->RowMap()");
+//    }
+  
+  Teuchos::RCP<Epetra_CrsMatrix> coarseStiffness;
+  if (_coarseSolution->getZMCsAsGlobalLagrange() &&
+      (prolongationColCount() > _coarseSolution->getDofInterpreter()->globalDofCount()))
+  {
+    // essentially: there are some lagrange constraints applied in coarse solve --> we shouldn't use the fused import,
+    //              since this will call FillComplete()
+    
+    int numEntriesPerRow = 0; // sub-optimal, but easy
+    coarseStiffness = Teuchos::rcp( new Epetra_CrsMatrix(::Copy, coarsePartitionMap, numEntriesPerRow) );
+    coarseStiffness->Import(*PT_A_P,coarseImporter,::Insert);
+    _coarseSolution->setStiffnessMatrix(coarseStiffness);
+    _coarseSolution->imposeZMCsUsingLagrange(); // fills in the augmented matrix -- the ZMC rows that are at the end.
+    // now can call FillComplete()
+    coarseStiffness->FillComplete();
+  }
+  else
+  {
+    coarseStiffness = Teuchos::rcp( new Epetra_CrsMatrix(*PT_A_P, coarseImporter) );
+    
+    _coarseSolution->setStiffnessMatrix(coarseStiffness);
+    _coarseSolution->imposeZMCsUsingLagrange(); // fills in the augmented matrix -- the ZMC rows that are at the end.
+  }
+}
+
 // res should hold the RHS on entry
 void GMGOperator::computeResidual(const Epetra_MultiVector& Y, Epetra_MultiVector& res, Epetra_MultiVector& A_Y) const
 {
   Epetra_Time timer(Comm());
-  int err = _fineStiffnessMatrix->Apply(Y, A_Y);
+  const Epetra_Operator* fineStiffness = _fineStiffnessMatrix;
+  if (fineStiffness == NULL) fineStiffness = _fineStiffnessOperator.get();
+  int err = fineStiffness->Apply(Y, A_Y);
   if (err != 0)
   {
-    cout << "_fineStiffnessMatrix->Apply returned non-zero error code " << err << endl;
+    cout << "fine stiffness Apply returned non-zero error code " << err << endl;
   }
   res.Update(-1.0, A_Y, 1.0);
   _timeApplyFineStiffness += timer.ElapsedTime();
@@ -1542,6 +1557,11 @@ int GMGOperator::getSmootherApplicationCount() const
   return _smootherApplicationCount;
 }
 
+double GMGOperator::getChebyshevMaxEigenvalueEstimate() const
+{
+  return _chebyshevMaxEigenvalue;
+}
+
 GMGOperator::SmootherChoice GMGOperator::getSmootherType()
 {
   return _smootherType;
@@ -1562,6 +1582,7 @@ int GMGOperator::Apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const
 int GMGOperator::ApplyInverse(const Epetra_MultiVector& X_in, Epetra_MultiVector& Y) const
 {
   narrate("ApplyInverse");
+  CAMELLIA_TIMED_REGION("GMGOperator::ApplyInverse");
   //  cout << "GMGOperator::ApplyInverse.\n";
   int rank = Teuchos::GlobalMPISession::getRank();
   bool printVerboseOutput = (rank==0) && _debugMode;
@@ -1575,17 +1596,20 @@ int GMGOperator::ApplyInverse(const Epetra_MultiVector& X_in, Epetra_MultiVector
     cout << X_in;
   }
   
-  Epetra_MultiVector res(X_in); // Res: residual.  Starting with Y = 0, then this is just the RHS
-  Epetra_MultiVector f(X_in);   // f: the RHS.  Don't change this.
+  int numVectors = X_in.NumVectors();
+  Epetra_MultiVector &res = workspaceVector(_workspace.res, X_in.Map(), numVectors); // Res: residual.  Starting with Y = 0, then this is just the RHS
+  Epetra_MultiVector &f = workspaceVector(_workspace.f, X_in.Map(), numVectors);     // f: the RHS.  Don't change this.
+  res = X_in;
+  f = X_in;
   
   // initialize Y (important to do this only after X_in has been copied--X and Y can be in the same location)
   Y.PutScalar(0.0);
-  Epetra_MultiVector A_Y(Y.Map(), Y.NumVectors());
+  Epetra_MultiVector &A_Y = workspaceVector(_workspace.A_Y, Y.Map(), numVectors);
+  Epetra_MultiVector &Y2 = workspaceVector(_workspace.Y2, Y.Map(), numVectors);
   
   if ((_multigridStrategy == FULL_MULTIGRID_V) || (_multigridStrategy == FULL_MULTIGRID_W))
   {
     // full multigrid takes the coarse operator applied to the RHS as its initial guess
-    Epetra_MultiVector Y2(Y.Map(), Y.NumVectors());
     this->ApplyInverseCoarseOperator(res, Y2);
     Y.Update(1.0, Y2, 1.0);
     // recompute residual:
@@ -1605,7 +1629,8 @@ int GMGOperator::ApplyInverse(const Epetra_MultiVector& X_in, Epetra_MultiVector
   
   if (_smootherType != NONE)
   {
-    Epetra_MultiVector B1_res(Y.Map(), Y.NumVectors()); // B1_res: the smoother applied to res.
+    Epetra_MultiVector &B1_res = workspaceVector(_workspace.B1_res, Y.Map(), numVectors); // B1_res: the smoother applied to res.
+    B1_res.PutScalar(0.0);
     for (int i=0; i<_smootherApplicationCount; i++)
     {
       // if we have a smoother S, set Y = S^-1 f =: B1 * f
@@ -1639,13 +1664,13 @@ int GMGOperator::ApplyInverse(const Epetra_MultiVector& X_in, Epetra_MultiVector
   
   for (int applicationOrdinal = 0; applicationOrdinal < numApplications; applicationOrdinal++)
   {
-    Epetra_MultiVector Y2(Y.Map(), Y.NumVectors());
     this->ApplyInverseCoarseOperator(res, Y2);
     Y.Update(1.0, Y2, 1.0);
     
     if ((_smootherType != NONE) && (_multigridStrategy != TWO_LEVEL))
     {
-      Epetra_MultiVector B1_res(Y.Map(), Y.NumVectors());
+      Epetra_MultiVector &B1_res = workspaceVector(_workspace.B1_res, Y.Map(), numVectors);
+      B1_res.PutScalar(0.0);
       
       for (int i=0; i<_smootherApplicationCount; i++)
       {
@@ -1704,7 +1729,10 @@ int GMGOperator::ApplyInverse(const Epetra_MultiVector& X_in, Epetra_MultiVector
     int LID = Y.Map().LID(fineRowIndex);
     if (LID != -1)
     {
-      Y[0][LID] = 0.0;
+      for (int vectorOrdinal=0; vectorOrdinal<numVectors; vectorOrdinal++)
+      {
+        Y[vectorOrdinal][LID] = 0.0;
+      }
     }
   }
   
@@ -1714,6 +1742,20 @@ int GMGOperator::ApplyInverse(const Epetra_MultiVector& X_in, Epetra_MultiVector
 
 int GMGOperator::ApplyInverseCoarseOperator(const Epetra_MultiVector &res, Epetra_MultiVector &Y) const
 {
+  CAMELLIA_TIMED_REGION("coarse solve");
+  if (res.NumVectors() > 1)
+  {
+    // the coarse solution has a single RHS/LHS vector, so block solves go through the coarse level one vector at a time
+    for (int vectorOrdinal=0; vectorOrdinal<res.NumVectors(); vectorOrdinal++)
+    {
+      const Epetra_MultiVector resVector(View, res, vectorOrdinal, 1);
+      Epetra_MultiVector YVector(View, Y, vectorOrdinal, 1);
+      int err = ApplyInverseCoarseOperator(resVector, YVector);
+      if (err != 0) return err;
+    }
+    return 0;
+  }
+
   int rank = Teuchos::GlobalMPISession::getRank();
   bool printVerboseOutput = (rank==0) && _debugMode;
 
@@ -1806,10 +1848,31 @@ int GMGOperator::ApplyInverseCoarseOperator(const Epetra_MultiVector &res, Epetr
   return 0;
 }
 
+void GMGOperator::sizeWorkspace(const Epetra_Map &fineMap)
+{
+  // size the workspace for the usual single-vector application
+  for (Teuchos::RCP<Epetra_MultiVector>* vector : {&_workspace.res, &_workspace.f, &_workspace.A_Y, &_workspace.B1_res, &_workspace.Y2})
+  {
+    workspaceVector(*vector, fineMap, 1);
+  }
+  if (_smootherType != NONE) workspaceVector(_workspace.smootherTemp, fineMap, 1);
+}
+
+Epetra_MultiVector &GMGOperator::workspaceVector(Teuchos::RCP<Epetra_MultiVector> &vector, const Epetra_BlockMap &map, int numVectors)
+{
+  // comparing map data (rather than using SameAs()) avoids communication; vectors built on copies of one map share it
+  if ((vector == Teuchos::null) || (vector->Map().DataPtr() != map.DataPtr()) || (vector->NumVectors() != numVectors))
+  {
+    vector = Teuchos::rcp( new Epetra_MultiVector(map, numVectors, false) ); // false: no need to zero-initialize
+  }
+  return *vector;
+}
+
 int GMGOperator::ApplySmoother(const Epetra_MultiVector &res, Epetra_MultiVector &Y, bool weightOnLeft) const
 {
   
   narrate("ApplySmoother()");
+  CAMELLIA_TIMED_REGION("smoother application");
   Epetra_Time timer(Comm());
   
   int err;
@@ -1826,7 +1889,7 @@ int GMGOperator::ApplySmoother(const Epetra_MultiVector &res, Epetra_MultiVector
 //    Comm().Barrier();
 //    cout << "res:\n";
 //    cout << res;
-    Epetra_MultiVector temp(res.Map(),res.NumVectors());
+    Epetra_MultiVector &temp = workspaceVector(_workspace.smootherTemp, res.Map(), res.NumVectors());
     if (!weightOnLeft)
       temp.Multiply(1.0, res, *_smootherDiagonalWeight, 0.0);
     else
@@ -2087,6 +2150,10 @@ void GMGOperator::setFineCoarseRolesSwapped(bool value)
 void GMGOperator::setFineStiffnessMatrix(Epetra_CrsMatrix *fineStiffness)
 {
   _fineStiffnessMatrix = fineStiffness;
+  _fineStiffnessOperator = Teuchos::null;
+
+  if (fineStiffness != NULL) sizeWorkspace(fineStiffness->OperatorRangeMap());
+
   computeCoarseStiffnessMatrix(fineStiffness);
   setUpSmoother(fineStiffness);
   
@@ -2099,6 +2166,54 @@ void GMGOperator::setFineStiffnessMatrix(Epetra_CrsMatrix *fineStiffness)
   }
 }
 
+void GMGOperator::setFineStiffnessOperator(ElementMatrixOperatorPtr fineStiffness)
+{
+  narrate("setFineStiffnessOperator");
+  TEUCHOS_TEST_FOR_EXCEPTION((_smootherType != CHEBYSHEV) && (_smootherType != NONE), std::invalid_argument,
+                             "a matrix-free fine stiffness requires a CHEBYSHEV or NONE smoother");
+  TEUCHOS_TEST_FOR_EXCEPTION(_fineCoarseRolesSwapped, std::invalid_argument,
+                             "a matrix-free fine stiffness is not supported when fine and coarse roles are swapped");
+  TEUCHOS_TEST_FOR_EXCEPTION(!fineStiffness->filled(), std::invalid_argument, "fineStiffness must be filled");
+
+  _fineStiffnessMatrix = NULL;
+  _fineStiffnessOperator = fineStiffness;
+
+  sizeWorkspace(fineStiffness->OperatorRangeMap());
+
+  Epetra_Time coarseStiffnessTimer(Comm());
+  if ((_P.get() == NULL) || (prolongationRowCount() != fineStiffness->OperatorRangeMap().NumGlobalElements()))
+  {
+    constructProlongationOperator();
+  }
+  setCoarseStiffnessFromGalerkinProduct(fineStiffness->galerkinProduct(*_P));
+  _timeComputeCoarseStiffnessMatrix = coarseStiffnessTimer.ElapsedTime();
+  _haveSolvedOnCoarseMesh = false; // having recomputed coarseStiffness, any existing factorization is invalid
+
+  Epetra_Time smootherSetupTimer(Comm());
+  if (_smootherType == NONE)
+  {
+    _smoother = Teuchos::null;
+  }
+  else
+  {
+    Epetra_Vector diagonal(fineStiffness->OperatorRangeMap());
+    fineStiffness->ExtractDiagonalCopy(diagonal);
+    Teuchos::RCP<Ifpack_Preconditioner> smoother = chebyshevSmoother(fineStiffness.get(), diagonal);
+    int err = smoother->Initialize();
+    if (err == 0) err = smoother->Compute();
+    TEUCHOS_TEST_FOR_EXCEPTION(err != 0, std::runtime_error, "Chebyshev smoother setup failed");
+    _smoother = smoother;
+  }
+  _timeSetUpSmoother = smootherSetupTimer.ElapsedTime();
+
+  if (_coarseOperator != Teuchos::null)
+  {
+    Epetra_Time coarseOperatorTimer(Comm());
+    _coarseOperator->setFineStiffnessMatrix(getCoarseStiffnessMatrix().get());
+    _timeUpdateCoarseOperator += coarseOperatorTimer.ElapsedTime();
+  }
+}
+
 void GMGOperator::setFillRatio(double fillRatio)
 {
   _fillRatio = fillRatio;
@@ -2150,6 +2265,24 @@ void GMGOperator::setSmootherApplicationType(SmootherApplicationType application
     _multigridStrategy = V_CYCLE;
 }
 
+void GMGOperator::setChebyshevDegree(int degree)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(degree < 1, std::invalid_argument, "Chebyshev degree must be at least 1");
+  _chebyshevDegree = degree;
+}
+
+void GMGOperator::setChebyshevEigenvalueRatio(double ratio)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(ratio <= 1.0, std::invalid_argument, "Chebyshev eigenvalue ratio must be greater than 1");
+  _chebyshevEigenvalueRatio = ratio;
+}
+
+void GMGOperator::setChebyshevPowerIterations(int iterations)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(iterations < 1, std::invalid_argument, "Chebyshev power iteration count must be at least 1");
+  _chebyshevPowerIterations = iterations;
+}
+
 void GMGOperator::setSmootherOverlap(int overlap)
 {
   _smootherOverlap = overlap;
@@ -2176,6 +2309,45 @@ void GMGOperator::setSmootherWeight(double weight)
   }
 }
 
+Teuchos::RCP<Ifpack_Preconditioner> GMGOperator::chebyshevSmoother(const Epetra_Operator* fineOperator, const Epetra_Vector &diagonal)
+{
+  // rows with zero diagonal (e.g. Lagrange constraints) are left unsmoothed
+  _chebyshevInverseDiagonal = Teuchos::rcp( new Epetra_Vector(diagonal) );
+  Epetra_Vector &inverseDiagonal = *_chebyshevInverseDiagonal;
+  for (int LID=0; LID < inverseDiagonal.MyLength(); LID++)
+  {
+    double diagValue = inverseDiagonal[LID];
+    inverseDiagonal[LID] = (diagValue == 0.0) ? 0.0 : 1.0 / diagValue;
+  }
+
+  // the power method estimate approaches lambdaMax from below; pad it so that the top of the spectrum is damped, not amplified
+  double lambdaMax;
+  int err = Ifpack_Chebyshev::PowerMethod(*fineOperator, inverseDiagonal, _chebyshevPowerIterations, lambdaMax);
+  TEUCHOS_TEST_FOR_EXCEPTION(err != 0, std::runtime_error, "Power method for Chebyshev eigenvalue estimate failed");
+  _chebyshevMaxEigenvalue = 1.1 * lambdaMax;
+
+  Teuchos::RCP<Ifpack_Chebyshev> smoother;
+  const Epetra_RowMatrix* fineMatrix = dynamic_cast<const Epetra_RowMatrix*>(fineOperator);
+  if (fineMatrix != NULL)
+    smoother = Teuchos::rcp( new Ifpack_Chebyshev(fineMatrix) );
+  else
+    smoother = Teuchos::rcp( new Ifpack_Chebyshev(fineOperator) );
+
+  Teuchos::ParameterList List;
+  List.set("chebyshev: degree", _chebyshevDegree);
+  List.set("chebyshev: max eigenvalue", _chebyshevMaxEigenvalue);
+  List.set("chebyshev: ratio eigenvalue", _chebyshevEigenvalueRatio);
+  List.set("chebyshev: min eigenvalue", _chebyshevMaxEigenvalue / _chebyshevEigenvalueRatio);
+  List.set("chebyshev: operator inv diagonal", &inverseDiagonal);
+  List.set("chebyshev: zero starting solution", true);
+  err = smoother->SetParameters(List);
+  if (err != 0)
+  {
+    cout << "WARNING: In GMGOperator, Chebyshev smoother->SetParameters() returned with err " << err << endl;
+  }
+  return smoother;
+}
+
 void GMGOperator::setUpSmoother(Epetra_CrsMatrix *fineStiffnessMatrix)
 {
   narrate("setUpSmoother()");
@@ -2332,6 +2504,16 @@ void GMGOperator::setUpSmoother(Epetra_CrsMatrix *fineStiffnessMatrix)
     List.set("schwarz: combine mode", "Add"); // The PDF doc says to use "Insert" to maintain symmetry, but the HTML docs (which are more recent) say to use "Add".  http://trilinos.org/docs/r11.10/packages/ifpack/doc/html/index.html
   }
   break;
+  case CHEBYSHEV:
+  {
+    // Chebyshev polynomial in D^-1 A: only matrix-vector products and a diagonal scaling, so no sequential sweeps or local
+    // factorizations, and one halo exchange per degree.  Parameters are set within chebyshevSmoother(); the (empty) List
+    // below leaves them unchanged.
+    Epetra_Vector diagonal(fineStiffnessMatrix->RowMap());
+    fineStiffnessMatrix->ExtractDiagonalCopy(diagonal);
+    smoother = chebyshevSmoother(fineStiffnessMatrix, diagonal);
+  }
+  break;
 
   default:
     break;
@@ -2466,6 +2648,8 @@ std::string GMGOperator::smootherString(SmootherChoice choice)
       return "Ifpack additive Schwarz";
     case CAMELLIA_ADDITIVE_SCHWARZ:
       return "Camellia additive Schwarz";
+    case CHEBYSHEV:
+      return "Chebyshev";
     case NONE:
       return "None";
     case BLOCK_JACOBI:
@@ -6,6 +6,7 @@
 //
 //
 
+#include "ElementMatrixOperator.h"
 #include "GDAMinimumRule.h"
 #include "GMGSolver.h"
 #include "MPIWrapper.h"
@@ -400,14 +401,22 @@ int GMGSolver::solve(bool buildCoarseStiffness)
     typedef Epetra_Operator OP;
     typedef Belos::LinearProblem<Scalar, MV, OP> BelosProblem;
     typedef RCP<BelosProblem> BelosProblemPtr;
-    BelosProblemPtr problem = rcp( new BelosProblem(_stiffnessMatrix, _lhs, _rhs) );
+    RCP<OP> stiffnessOperator;
+    if (_stiffnessMatrix != Teuchos::null)
+      stiffnessOperator = _stiffnessMatrix;
+    else
+      stiffnessOperator = _matrixFreeStiffness;
+    BelosProblemPtr problem = rcp( new BelosProblem(stiffnessOperator, _lhs, _rhs) );
     
     Belos::SolverFactory<Scalar, MV, OP> factory;
     RCP<Belos::SolverManager<Scalar, MV, OP> > solver;
     
     if (buildCoarseStiffness)
     {
-      _gmgOperator->setFineStiffnessMatrix(_stiffnessMatrix.get());
+      if (_stiffnessMatrix != Teuchos::null)
+        _gmgOperator->setFineStiffnessMatrix(_stiffnessMatrix.get());
+      else
+        _gmgOperator->setFineStiffnessOperator(_matrixFreeStiffness);
     }
     
     RCP<ParameterList> solverParams = parameterList();
@@ -451,7 +460,7 @@ int GMGSolver::solve(bool buildCoarseStiffness)
     problem->setProblem();
     solver->setProblem(problem);
 
-    if (_exportFullOperators)
+    if (_exportFullOperators && (_stiffnessMatrix != Teuchos::null))
     {
       ostringstream path;
       path << _pathForExport << "M.dat";
@@ -494,12 +503,19 @@ int GMGSolver::solve(bool buildCoarseStiffness)
   }
   else
   {
-    Epetra_LinearProblem problem(_stiffnessMatrix.get(), _lhs.get(), _rhs.get());
+    bool matrixFree = (_stiffnessMatrix == Teuchos::null) && (_matrixFreeStiffness != Teuchos::null);
+    Epetra_LinearProblem problem;
+    if (matrixFree)
+      problem.SetOperator(_matrixFreeStiffness.get());
+    else
+      problem.SetOperator(_stiffnessMatrix.get()); // as an Epetra_RowMatrix, so that GetMatrix() returns it
+    problem.SetLHS(_lhs.get());
+    problem.SetRHS(_rhs.get());
     AztecOO solver(problem);
 
     Epetra_CrsMatrix *A = dynamic_cast<Epetra_CrsMatrix *>( problem.GetMatrix() );
 
-    if (A == NULL)
+    if ((A == NULL) && !matrixFree)
     {
       cout << "Error: GMGSolver requires an Epetra_CrsMatrix.\n";
       TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Error: GMGSolver requires an Epetra_CrsMatrix.\n");
@@ -517,7 +533,10 @@ int GMGSolver::solve(bool buildCoarseStiffness)
 
     if (buildCoarseStiffness)
     {
-      _gmgOperator->setFineStiffnessMatrix(A);
+      if (matrixFree)
+        _gmgOperator->setFineStiffnessOperator(_matrixFreeStiffness);
+      else
+        _gmgOperator->setFineStiffnessMatrix(A);
     }
 
     solver.SetAztecOption(AZ_scaling, AZ_none);
@@ -642,6 +661,11 @@ void GMGSolver::setReturnErrorIfMaxItersReached(bool value)
   _returnErrorIfMaxItersReached = value;
 }
 
+void GMGSolver::setMatrixFreeStiffness(ElementMatrixOperatorPtr stiffness)
+{
+  _matrixFreeStiffness = stiffness;
+}
+
 void GMGSolver::setSmootherType(GMGOperator::SmootherChoice smootherType)
 {
   Teuchos::RCP<GMGOperator> op = _gmgOperator;
@@ -70,6 +70,9 @@
 #include "Epetra_SerialSpdDenseSolver.h"
 #include "Epetra_DataAccess.h"
 
+#include "Teuchos_BLAS.hpp"
+#include "Teuchos_LAPACK.hpp"
+
 // Shards includes
 #include "Shards_CellTopology.hpp"
 
@@ -88,7 +91,10 @@
 #include "CamelliaCellTools.h"
 #include "CondensedDofInterpreter.h"
 #include "CubatureFactory.h"
+#include "ElementMatrixOperator.h"
 #include "Function.h"
+#include "GDAMinimumRule.h"
+#include "GramMatrixCache.h"
 #include "IP.h"
 #include "GlobalDofAssignment.h"
 #include "LagrangeConstraints.h"
@@ -100,6 +106,7 @@
 #include "RHS.h"
 #include "SerialDenseWrapper.h"
 #include "Solver.h"
+#include "TimerRegistry.h"
 #include "Var.h"
 
 #include "AztecOO_ConditionNumber.h"
@@ -141,9 +148,48 @@ void TSolution<Scalar>::setCubatureEnrichmentDegree(int value)
   _cubatureEnrichmentDegree = value;
 }
 
+template <typename Scalar>
+int TSolution<Scalar>::numThreadsForLocalStiffness() const
+{
+  return _numThreadsForLocalStiffness;
+}
+
+template <typename Scalar>
+void TSolution<Scalar>::setNumThreadsForLocalStiffness(int value)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(value < 1, std::invalid_argument, "numThreadsForLocalStiffness must be at least 1");
+#ifndef _OPENMP
+  if ((value > 1) && (_mesh->Comm()->MyPID() == 0))
+  {
+    cout << "WARNING: Camellia was built without OpenMP; local stiffness matrices will be computed serially.\n";
+  }
+#endif
+  _numThreadsForLocalStiffness = value;
+}
+
+template <typename Scalar>
+int TSolution<Scalar>::maxBatchSizeInBytes() const
+{
+  return _maxBatchSizeInBytes;
+}
+
+template <typename Scalar>
+void TSolution<Scalar>::setMaxBatchSizeInBytes(int value)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(value < 1, std::invalid_argument, "maxBatchSizeInBytes must be positive");
+  _maxBatchSizeInBytes = value;
+}
+
 static const int MAX_BATCH_SIZE_IN_BYTES = 3*1024*1024; // 3 MB
 static const int MIN_BATCH_SIZE_IN_CELLS = 1; // overrides the above, if it results in too-small batches
 
+// the GDAMinimumRule dof numbering version for the mesh, or -1 if the mesh does not use GDAMinimumRule
+static int currentDofNumberingVersion(MeshPtr mesh)
+{
+  GDAMinimumRule* minRule = dynamic_cast<GDAMinimumRule*>(mesh->globalDofAssignment().get());
+  return (minRule == NULL) ? -1 : minRule->dofNumberingVersion();
+}
+
 // copy constructor:
 template <typename Scalar>
 TSolution<Scalar>::TSolution(const TSolution<Scalar> &soln) : Narrator("Solution")
@@ -163,6 +209,8 @@ TSolution<Scalar>::TSolution(const TSolution<Scalar> &soln) : Narrator("Solution
   _writeMatrixToMatrixMarketFile = false;
   _writeRHSToMatrixMarketFile = false;
   _cubatureEnrichmentDegree = soln.cubatureEnrichmentDegree();
+  _numThreadsForLocalStiffness = soln.numThreadsForLocalStiffness();
+  _maxBatchSizeInBytes = soln.maxBatchSizeInBytes();
   _zmcsAsLagrangeMultipliers = soln.getZMCsAsGlobalLagrange();
 }
 
@@ -201,6 +249,7 @@ void TSolution<Scalar>::clear()
 {
   // clears all solution values.  Leaves everything else intact.
   _solutionForCellIDGlobal.clear();
+  _lhsVectorDofNumberingVersion = -1;
 }
 
 template <typename Scalar>
@@ -219,6 +268,8 @@ void TSolution<Scalar>::initialize()
   _reportTimingResults = false;
   _globalSystemConditionEstimate = -1;
   _cubatureEnrichmentDegree = 0;
+  _numThreadsForLocalStiffness = 1;
+  _maxBatchSizeInBytes = MAX_BATCH_SIZE_IN_BYTES;
   
   _zmcsAsLagrangeMultipliers = true; // default -- when false, it's user's / Solver's responsibility to enforce ZMCs
   _zmcsAsRankOneUpdate = false; // I believe this works, but it's slow!
@@ -494,6 +545,8 @@ void TSolution<Scalar>::applyDGJumpTerms()
   map<CellTopologyKey,BasisCachePtr> basisCacheForReferenceCellTopo;
 
   const vector< TBilinearTerm<Scalar> >* bilinearTerms = &_mesh->bilinearForm()->getJumpTerms();
+  TEUCHOS_TEST_FOR_EXCEPTION((bilinearTerms->size() > 0) && (_matrixFreeStiffness != Teuchos::null), std::invalid_argument,
+                             "DG jump terms are not supported with matrix-free stiffness");
   
   for (GlobalIndexType cellID : myCellIDs)
   {
@@ -986,6 +1039,7 @@ void TSolution<Scalar>::setSolution(Teuchos::RCP< TSolution<Scalar> > otherSoln)
 {
   _solutionForCellIDGlobal = otherSoln->solutionForCellIDGlobal();
   _lhsVector = Teuchos::rcp( new Epetra_FEVector(*otherSoln->getLHSVector()) );
+  _lhsVectorDofNumberingVersion = -1;
   clearComputedResiduals();
 }
 
@@ -1000,6 +1054,59 @@ void TSolution<Scalar>::initializeLHSVector()
   clearComputedResiduals();
 }
 
+template <typename Scalar>
+void TSolution<Scalar>::initializeLHSVectorForSolve()
+{
+  // After a local refinement, the owned dofs of cells away from the refinement keep their relative numbering, and
+  // GDAMinimumRule reports how their runs of global dofs moved.  We carry those entries over from the previous
+  // _lhsVector, and interpret the local coefficients only on the cells with new dofs.
+  GDAMinimumRule* minRule = dynamic_cast<GDAMinimumRule*>(_mesh->globalDofAssignment().get());
+  bool canRenumber = (minRule != NULL) && (_dofInterpreter.get() == _mesh.get()) && (_lhsVector != Teuchos::null);
+  if (canRenumber)
+  {
+    const GlobalDofRenumbering* renumbering = &minRule->dofRenumbering();
+    canRenumber = (_lhsVectorDofNumberingVersion != -1)
+                  && (renumbering->oldNumberingVersion == _lhsVectorDofNumberingVersion)
+                  && (renumbering->newNumberingVersion == minRule->dofNumberingVersion());
+  }
+  if (!canRenumber)
+  {
+    initializeLHSVector();
+    return;
+  }
+  
+  const GlobalDofRenumbering* renumbering = &minRule->dofRenumbering();
+  Teuchos::RCP<Epetra_FEVector> oldLHSVector = _lhsVector;
+  const Epetra_BlockMap* oldMap = &oldLHSVector->Map();
+  Epetra_Map partMap = getPartitionMap();
+  _lhsVector = Teuchos::rcp(new Epetra_FEVector(partMap,1,true));
+  
+  for (int run=0; run<renumbering->dofCounts.size(); run++)
+  {
+    for (GlobalIndexType i=0; i<renumbering->dofCounts[run]; i++)
+    {
+      int oldLID = oldMap->LID((GlobalIndexTypeToCast)(renumbering->oldOffsets[run] + i));
+      int newLID = partMap.LID((GlobalIndexTypeToCast)(renumbering->newOffsets[run] + i));
+      if ((oldLID == -1) || (newLID == -1)) continue;
+      (*_lhsVector)[0][newLID] = (*oldLHSVector)[0][oldLID];
+    }
+  }
+  
+  for (GlobalIndexType cellID : renumbering->cellsWithNewDofs)
+  {
+    if (_solutionForCellIDGlobal.find(cellID) != _solutionForCellIDGlobal.end())
+    {
+      int localTrialDofCount = _mesh->getElementType(cellID)->trialOrderPtr->totalDofs();
+      if (localTrialDofCount==_solutionForCellIDGlobal[cellID].size())   // see setGlobalSolutionFromCellLocalCoefficients()
+      {
+        _dofInterpreter->interpretLocalCoefficients(cellID, _solutionForCellIDGlobal[cellID], *_lhsVector);
+      }
+    }
+  }
+  _lhsVectorDofNumberingVersion = renumbering->newNumberingVersion;
+  clearComputedResiduals();
+}
+
 template <typename Scalar>
 void TSolution<Scalar>::initializeLoad()
 {
@@ -1014,25 +1121,90 @@ void TSolution<Scalar>::initializeStiffnessAndLoad()
 {
   narrate("initializeStiffnessAndLoad");
   Epetra_Map partMap = getPartitionMap();
+
+  if (_useMatrixFreeStiffness)
+  {
+    _globalStiffMatrix = Teuchos::null;
+    _matrixFreeStiffness = Teuchos::rcp( new ElementMatrixOperator(partMap) );
+    _stiffnessGraphIsStatic = false;
+    _stiffnessGraphMismatch = false;
+    _rhsVector = Teuchos::rcp(new Epetra_FEVector(partMap));
+    return;
+  }
+  _matrixFreeStiffness = Teuchos::null;
   
+  int dofNumberingVersion = currentDofNumberingVersion(_mesh);
+  _stiffnessGraphIsStatic = _reuseStiffnessGraph && (_stiffnessGraph != Teuchos::null) && (dofNumberingVersion != -1)
+                            && (_stiffnessGraphDofNumberingVersion == dofNumberingVersion)
+                            && (_stiffnessGraphDofInterpreter == _dofInterpreter.get())
+                            && _stiffnessGraph->RowMap().SameAs(partMap);
+  _stiffnessGraphMismatch = false;
+  
+  if (_stiffnessGraphIsStatic)
+  {
+    // entries are summed into the existing profile, and GlobalAssemble() need not allocate or sort anything
+    _globalStiffMatrix = Teuchos::rcp(new Epetra_FECrsMatrix(::Copy, *_stiffnessGraph));
+  }
+  else
+  {
+    _stiffnessGraph = Teuchos::null;
 //  int maxRowSize = _mesh->rowSizeUpperBound();
-  int maxRowSize = 0; // will cause more mallocs during insertion into the CrsMatrix, but will minimize the amount of memory allocated now.
+    int maxRowSize = 0; // will cause more mallocs during insertion into the CrsMatrix, but will minimize the amount of memory allocated now.
   
-  _globalStiffMatrix = Teuchos::rcp(new Epetra_FECrsMatrix(::Copy, partMap, maxRowSize));
+    _globalStiffMatrix = Teuchos::rcp(new Epetra_FECrsMatrix(::Copy, partMap, maxRowSize));
+  }
   _rhsVector = Teuchos::rcp(new Epetra_FEVector(partMap));
 }
 
+template <typename Scalar>
+void TSolution<Scalar>::addToGlobalStiffness(Epetra_FECrsMatrix* globalStiffness, int numRows, const GlobalIndexTypeToCast* rows,
+                                             int numCols, const GlobalIndexTypeToCast* cols, const Scalar* values)
+{
+  if (_matrixFreeStiffness != Teuchos::null)
+  {
+    _matrixFreeStiffness->sumIntoGlobalValues(numRows, rows, numCols, cols, values);
+  }
+  else if (_stiffnessGraphIsStatic)
+  {
+    int err = globalStiffness->SumIntoGlobalValues(numRows, rows, numCols, cols, values);
+    if (err != 0) _stiffnessGraphMismatch = true;
+  }
+  else
+  {
+    globalStiffness->InsertGlobalValues(numRows, rows, numCols, cols, values);
+  }
+}
+
+template <typename Scalar>
+void TSolution<Scalar>::addToGlobalStiffnessRow(GlobalIndexTypeToCast row, int numEntries, Scalar* values, GlobalIndexTypeToCast* cols)
+{
+  if (_matrixFreeStiffness != Teuchos::null)
+  {
+    _matrixFreeStiffness->sumIntoGlobalValues(1, &row, numEntries, cols, values);
+  }
+  else if (_stiffnessGraphIsStatic)
+  {
+    int err = _globalStiffMatrix->SumIntoGlobalValues(row, numEntries, values, cols);
+    if (err != 0) _stiffnessGraphMismatch = true;
+  }
+  else
+  {
+    _globalStiffMatrix->InsertGlobalValues(row, numEntries, values, cols);
+  }
+}
+
 template <typename Scalar>
 void TSolution<Scalar>::populateStiffnessAndLoad()
 {
   narrate("populateStiffnessAndLoad()");
+  CAMELLIA_TIMED_REGION("Solution::populateStiffnessAndLoad");
   Epetra_CommPtr Comm = _mesh->Comm();
   int rank = Comm->MyPID();
   int numProcs = Comm->NumProc();
 
   Epetra_FECrsMatrix* globalStiffness = dynamic_cast<Epetra_FECrsMatrix*>(_globalStiffMatrix.get());
 
-  if (globalStiffness == NULL)
+  if ((globalStiffness == NULL) && (_matrixFreeStiffness == Teuchos::null))
   {
     cout << "Error: Solutio::populateStiffnessAndLoad() requires that _globalStiffMatrix be an Epetra_FECrsMatrix\n";
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "populateStiffnessAndLoad() requires that _globalStiffMatrix be an Epetra_FECrsMatrix");
@@ -1065,109 +1237,176 @@ void TSolution<Scalar>::populateStiffnessAndLoad()
     int startCellIndexForBatch = 0;
 
     if (totalCellsForType == 0) continue;
-    // if we get here, there is at least one, so we find a sample cellID to help us set up prototype BasisCaches:
-    GlobalIndexType sampleCellID = _mesh->cellID(elemTypePtr, 0, rank);
-    BasisCachePtr basisCache = BasisCache::basisCacheForCell(_mesh,sampleCellID,false,_cubatureEnrichmentDegree);
-    BasisCachePtr ipBasisCache = BasisCache::basisCacheForCell(_mesh,sampleCellID,true,_cubatureEnrichmentDegree);
 
     DofOrderingPtr trialOrderingPtr = elemTypePtr->trialOrderPtr;
     DofOrderingPtr testOrderingPtr = elemTypePtr->testOrderPtr;
     int numTrialDofs = trialOrderingPtr->totalDofs();
     int numTestDofs = testOrderingPtr->totalDofs();
-    int maxCellBatch = MAX_BATCH_SIZE_IN_BYTES / 8 / (numTestDofs*numTestDofs + numTestDofs*numTrialDofs + numTrialDofs*numTrialDofs);
+    int maxCellBatch = _maxBatchSizeInBytes / 8 / (numTestDofs*numTestDofs + numTestDofs*numTrialDofs + numTrialDofs*numTrialDofs);
     maxCellBatch = max( maxCellBatch, MIN_BATCH_SIZE_IN_CELLS );
     //cout << "numTestDofs^2:" << numTestDofs*numTestDofs << endl;
     //cout << "maxCellBatch: " << maxCellBatch << endl;
 
-    Teuchos::Array<int> nodeDimensions, parityDimensions;
-    myPhysicalCellNodesForType.dimensions(nodeDimensions);
-    myCellSideParitiesForType.dimensions(parityDimensions);
+    // determine the batches up front, so that they can be distributed among threads
+    vector< pair<int,int> > batches; // (startCellIndexForBatch, numCells)
     while (startCellIndexForBatch < totalCellsForType)
     {
       int cellsLeft = totalCellsForType - startCellIndexForBatch;
       int numCells = min(maxCellBatch,cellsLeft);
+      batches.push_back({startCellIndexForBatch, numCells});
+      startCellIndexForBatch += numCells;
+    }
+    int numBatches = batches.size();
+    int numThreads = max(1, min(numThreadsForLocalStiffness(), numBatches));
 
-      // determine cellIDs
-      vector<GlobalIndexType> cellIDs;
-      for (int cellIndex=0; cellIndex<numCells; cellIndex++)
-      {
-        GlobalIndexType cellID = _mesh->cellID(elemTypePtr, cellIndex+startCellIndexForBatch, rank);
-        cellIDs.push_back(cellID);
-      }
-
-      //cout << "testDofOrdering: " << *testOrderingPtr;
-      //cout << "trialDofOrdering: " << *trialOrderingPtr;
-      nodeDimensions[0] = numCells;
-      parityDimensions[0] = numCells;
-      Intrepid::FieldContainer<double> physicalCellNodes(nodeDimensions,&myPhysicalCellNodesForType(startCellIndexForBatch,0,0));
-      Intrepid::FieldContainer<double> cellSideParities(parityDimensions,&myCellSideParitiesForType(startCellIndexForBatch,0));
+    // if we get here, there is at least one, so we find a sample cellID to help us set up prototype BasisCaches.
+    // Each thread gets its own pair of BasisCaches; we construct these serially, since construction goes through
+    // the (shared) basis and cubature factories.
+    GlobalIndexType sampleCellID = _mesh->cellID(elemTypePtr, 0, rank);
+    vector<BasisCachePtr> basisCaches(numThreads), ipBasisCaches(numThreads);
+    for (int threadOrdinal=0; threadOrdinal<numThreads; threadOrdinal++)
+    {
+      basisCaches[threadOrdinal] = BasisCache::basisCacheForCell(_mesh,sampleCellID,false,_cubatureEnrichmentDegree);
+      ipBasisCaches[threadOrdinal] = BasisCache::basisCacheForCell(_mesh,sampleCellID,true,_cubatureEnrichmentDegree);
+    }
 
-      bool createSideCacheToo = true;
-      basisCache->setPhysicalCellNodes(physicalCellNodes,cellIDs,createSideCacheToo);
-      basisCache->setCellSideParities(cellSideParities);
+    TBFPtr<Scalar> bf = (_bf != Teuchos::null) ? _bf : _mesh->bilinearForm();
 
-      // hard-coding creating side cache for IP for now, since _ip->hasBoundaryTerms() only recognizes terms explicitly passed in as boundary terms:
-      ipBasisCache->setPhysicalCellNodes(physicalCellNodes,cellIDs,true);//_ip->hasBoundaryTerms()); // create side cache if ip has boundary values
-      ipBasisCache->setCellSideParities(cellSideParities); // I don't anticipate these being needed, though
+    Teuchos::Array<int> nodeDimensions, parityDimensions;
+    myPhysicalCellNodesForType.dimensions(nodeDimensions);
+    myCellSideParitiesForType.dimensions(parityDimensions);
 
-      Intrepid::FieldContainer<Scalar> localStiffness(numCells,numTrialDofs,numTrialDofs);
-      Intrepid::FieldContainer<Scalar> localRHSVector(numCells,numTrialDofs);
+    Intrepid::FieldContainer<GlobalIndexType> globalDofIndices;
+    Intrepid::FieldContainer<GlobalIndexTypeToCast> globalDofIndicesCast;
 
-      if (_bf != Teuchos::null)
-        _bf->localStiffnessMatrixAndRHS(localStiffness, localRHSVector, _ip, ipBasisCache, _rhs, basisCache);
-      else
-        _mesh->bilinearForm()->localStiffnessMatrixAndRHS(localStiffness, localRHSVector, _ip, ipBasisCache, _rhs, basisCache);
+    Teuchos::Array<int> localStiffnessDim(2,numTrialDofs);
+    Teuchos::Array<int> localRHSDim(1,numTrialDofs);
 
-      // apply filter(s) (e.g. penalty method, preconditioners, etc.)
-      if (_filter.get())
-      {
-        subTimer.ResetStartTime();
-        _filter->filter(localStiffness,localRHSVector,basisCache,_mesh,_bc);
-        filterApplicationTime += subTimer.ElapsedTime();
-        //        _filter->filter(localRHSVector,physicalCellNodes,cellIDs,_mesh,_bc);
-      }
+    Intrepid::FieldContainer<Scalar> interpretedStiffness;
+    Intrepid::FieldContainer<Scalar> interpretedRHS;
 
-//      cout << "local stiffness matrices:\n" << localStiffness;
-//      cout << "local loads:\n" << localRHSVector;
+    Teuchos::Array<int> dim;
 
-      subTimer.ResetStartTime();
+    // Batches are processed in rounds of numThreads.  Within a round, the local stiffness matrices and RHS vectors are
+    // computed concurrently, one batch per thread.  Filtering, interpretation, and insertion into the global matrix then
+    // happen serially in batch order, so that the assembled system does not depend on thread scheduling.
+    // (The DofInterpreter lazily populates its caches, so interpretLocalData() is not safe to call concurrently.)
+    for (int roundStartBatch = 0; roundStartBatch < numBatches; roundStartBatch += numThreads)
+    {
+      int roundSize = min(numThreads, numBatches - roundStartBatch);
 
-      Intrepid::FieldContainer<GlobalIndexType> globalDofIndices;
+      vector< vector<GlobalIndexType> > cellIDsForBatch(roundSize);
+      vector< Intrepid::FieldContainer<Scalar> > localStiffnessForBatch(roundSize);
+      vector< Intrepid::FieldContainer<Scalar> > localRHSForBatch(roundSize);
+      vector< Intrepid::FieldContainer<double> > physicalCellNodesForBatch(roundSize);
+      vector< Intrepid::FieldContainer<double> > cellSideParitiesForBatch(roundSize);
 
-      Intrepid::FieldContainer<GlobalIndexTypeToCast> globalDofIndicesCast;
+      for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
+      {
+        int startCellIndex = batches[roundStartBatch + batchOrdinal].first;
+        int numCells = batches[roundStartBatch + batchOrdinal].second;
 
-      Teuchos::Array<int> localStiffnessDim(2,numTrialDofs);
-      Teuchos::Array<int> localRHSDim(1,numTrialDofs);
+        // determine cellIDs
+        for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+        {
+          GlobalIndexType cellID = _mesh->cellID(elemTypePtr, cellIndex+startCellIndex, rank);
+          cellIDsForBatch[batchOrdinal].push_back(cellID);
+        }
 
-      Intrepid::FieldContainer<Scalar> interpretedStiffness;
-      Intrepid::FieldContainer<Scalar> interpretedRHS;
+        nodeDimensions[0] = numCells;
+        parityDimensions[0] = numCells;
+        physicalCellNodesForBatch[batchOrdinal] = Intrepid::FieldContainer<double>(nodeDimensions,&myPhysicalCellNodesForType(startCellIndex,0,0));
+        cellSideParitiesForBatch[batchOrdinal] = Intrepid::FieldContainer<double>(parityDimensions,&myCellSideParitiesForType(startCellIndex,0));
 
-      Teuchos::Array<int> dim;
+        localStiffnessForBatch[batchOrdinal].resize(numCells,numTrialDofs,numTrialDofs);
+        localRHSForBatch[batchOrdinal].resize(numCells,numTrialDofs);
+      }
 
-      for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+      // exceptions may not propagate out of an OpenMP parallel region, so we record the first one and rethrow below
+      string threadErrorMessage = "";
+#ifdef _OPENMP
+      #pragma omp parallel for num_threads(roundSize) schedule(static,1) if (roundSize > 1)
+#endif
+      for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
       {
-        GlobalIndexType cellID = _mesh->cellID(elemTypePtr,cellIndex+startCellIndexForBatch,rank);
-        Intrepid::FieldContainer<Scalar> cellStiffness(localStiffnessDim,&localStiffness(cellIndex,0,0)); // shallow copy
-        Intrepid::FieldContainer<Scalar> cellRHS(localRHSDim,&localRHSVector(cellIndex,0)); // shallow copy
+        try
+        {
+          BasisCachePtr basisCache = basisCaches[batchOrdinal];
+          BasisCachePtr ipBasisCache = ipBasisCaches[batchOrdinal];
 
-        _dofInterpreter->interpretLocalData(cellID, cellStiffness, cellRHS, interpretedStiffness, interpretedRHS, globalDofIndices);
+          {
+            CAMELLIA_TIMED_REGION("BasisCache setup");
+            bool createSideCacheToo = true;
+            basisCache->setPhysicalCellNodes(physicalCellNodesForBatch[batchOrdinal],cellIDsForBatch[batchOrdinal],createSideCacheToo);
+            basisCache->setCellSideParities(cellSideParitiesForBatch[batchOrdinal]);
+
+            // hard-coding creating side cache for IP for now, since _ip->hasBoundaryTerms() only recognizes terms explicitly passed in as boundary terms:
+            ipBasisCache->setPhysicalCellNodes(physicalCellNodesForBatch[batchOrdinal],cellIDsForBatch[batchOrdinal],true);//_ip->hasBoundaryTerms()); // create side cache if ip has boundary values
+            ipBasisCache->setCellSideParities(cellSideParitiesForBatch[batchOrdinal]); // I don't anticipate these being needed, though
+          }
 
-        // cast whatever the global index type is to a type that Epetra supports
-        globalDofIndices.dimensions(dim);
-        globalDofIndicesCast.resize(dim);
+          CAMELLIA_TIMED_REGION("local stiffness");
+          bf->localStiffnessMatrixAndRHS(localStiffnessForBatch[batchOrdinal], localRHSForBatch[batchOrdinal], _ip, ipBasisCache, _rhs, basisCache);
+        }
+        catch (std::exception &e)
+        {
+#ifdef _OPENMP
+          #pragma omp critical (CamelliaSolutionThreadError)
+#endif
+          {
+            if (threadErrorMessage == "") threadErrorMessage = e.what();
+          }
+        }
+      }
+      TEUCHOS_TEST_FOR_EXCEPTION(threadErrorMessage != "", std::runtime_error, threadErrorMessage);
 
-        for (int dofOrdinal = 0; dofOrdinal < globalDofIndices.size(); dofOrdinal++)
+      for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
+      {
+        Intrepid::FieldContainer<Scalar>* localStiffness = &localStiffnessForBatch[batchOrdinal];
+        Intrepid::FieldContainer<Scalar>* localRHSVector = &localRHSForBatch[batchOrdinal];
+        const vector<GlobalIndexType>* cellIDs = &cellIDsForBatch[batchOrdinal];
+
+        // apply filter(s) (e.g. penalty method, preconditioners, etc.)
+        if (_filter.get())
         {
-          globalDofIndicesCast[dofOrdinal] = globalDofIndices[dofOrdinal];
+          subTimer.ResetStartTime();
+          _filter->filter(*localStiffness,*localRHSVector,basisCaches[batchOrdinal],_mesh,_bc);
+          filterApplicationTime += subTimer.ElapsedTime();
+          //        _filter->filter(localRHSVector,physicalCellNodes,cellIDs,_mesh,_bc);
         }
 
-        globalStiffness->InsertGlobalValues(globalDofIndices.size(),&globalDofIndicesCast(0),
-                                            globalDofIndices.size(),&globalDofIndicesCast(0),&interpretedStiffness[0]);
-        _rhsVector->SumIntoGlobalValues(globalDofIndices.size(),&globalDofIndicesCast(0),&interpretedRHS[0]);
-      }
-      localStiffnessInterpretationTime += subTimer.ElapsedTime();
+//        cout << "local stiffness matrices:\n" << *localStiffness;
+//        cout << "local loads:\n" << *localRHSVector;
 
-      startCellIndexForBatch += numCells;
+        subTimer.ResetStartTime();
+
+        for (int cellIndex=0; cellIndex<cellIDs->size(); cellIndex++)
+        {
+          GlobalIndexType cellID = (*cellIDs)[cellIndex];
+          Intrepid::FieldContainer<Scalar> cellStiffness(localStiffnessDim,&(*localStiffness)(cellIndex,0,0)); // shallow copy
+          Intrepid::FieldContainer<Scalar> cellRHS(localRHSDim,&(*localRHSVector)(cellIndex,0)); // shallow copy
+
+          {
+            CAMELLIA_TIMED_REGION("DOF interpretation");
+            _dofInterpreter->interpretLocalData(cellID, cellStiffness, cellRHS, interpretedStiffness, interpretedRHS, globalDofIndices);
+          }
+
+          CAMELLIA_TIMED_REGION("insertion");
+          // cast whatever the global index type is to a type that Epetra supports
+          globalDofIndices.dimensions(dim);
+          globalDofIndicesCast.resize(dim);
+
+          for (int dofOrdinal = 0; dofOrdinal < globalDofIndices.size(); dofOrdinal++)
+          {
+            globalDofIndicesCast[dofOrdinal] = globalDofIndices[dofOrdinal];
+          }
+
+          addToGlobalStiffness(globalStiffness, globalDofIndices.size(),&globalDofIndicesCast(0),
+                               globalDofIndices.size(),&globalDofIndicesCast(0),&interpretedStiffness[0]);
+          _rhsVector->SumIntoGlobalValues(globalDofIndices.size(),&globalDofIndicesCast(0),&interpretedRHS[0]);
+        }
+        localStiffnessInterpretationTime += subTimer.ElapsedTime();
+      }
     }
   }
   {
@@ -1255,11 +1494,11 @@ void TSolution<Scalar>::populateStiffnessAndLoad()
           nonzeroValues(nnz) = 1.0; // just put a 1 in the diagonal to avoid singular matrix
         }
         // insert row:
-        globalStiffness->InsertGlobalValues(1,&globalRowIndex,nnz+1,&globalDofIndices(0),
-                                            &nonzeroValues(0));
+        addToGlobalStiffness(globalStiffness,1,&globalRowIndex,nnz+1,&globalDofIndices(0),
+                             &nonzeroValues(0));
         // insert column:
-        globalStiffness->InsertGlobalValues(nnz+1,&globalDofIndices(0),1,&globalRowIndex,
-                                            &nonzeroValues(0));
+        addToGlobalStiffness(globalStiffness,nnz+1,&globalDofIndices(0),1,&globalRowIndex,
+                             &nonzeroValues(0));
         _rhsVector->ReplaceGlobalValues(1,&globalRowIndex,&rhs(cellIndex));
 
         localRowIndex++;
@@ -1318,6 +1557,8 @@ void TSolution<Scalar>::populateStiffnessAndLoad()
   }
   else
   {
+    TEUCHOS_TEST_FOR_EXCEPTION(_matrixFreeStiffness != Teuchos::null, std::invalid_argument,
+                               "zero-mean constraints as a rank-one update are not supported with matrix-free stiffness");
     // NOTE: this code remains here as reference only; it's quite inefficient because it creates a lot of fill-in for A
     // we may want to implement the same idea, but with a separate Epetra_Operator that simply stores the vector and the weight
     for (vector< int >::iterator trialIt = zeroMeanConstraints.begin(); trialIt != zeroMeanConstraints.end(); trialIt++)
@@ -1370,11 +1611,46 @@ void TSolution<Scalar>::populateStiffnessAndLoad()
   Comm->Barrier();  // for cleaner time measurements, let everyone else catch up before calling ResetStartTime() and GlobalAssemble()
   timer.ResetStartTime();
 
-  _rhsVector->GlobalAssemble();
+  {
+    CAMELLIA_TIMED_REGION("global assembly");
+    _rhsVector->GlobalAssemble();
+
+    //  EpetraExt::MultiVectorToMatrixMarketFile("rhs_vector_before_bcs.dat",rhsVector,0,0,false);
 
-  //  EpetraExt::MultiVectorToMatrixMarketFile("rhs_vector_before_bcs.dat",rhsVector,0,0,false);
+    int assemblyErr = 0;
+    if (_matrixFreeStiffness != Teuchos::null)
+    {
+      _matrixFreeStiffness->fillComplete();
+    }
+    else
+    {
+      assemblyErr = globalStiffness->GlobalAssemble(); // will call globalStiffMatrix.FillComplete();
+    }
 
-  globalStiffness->GlobalAssemble(); // will call globalStiffMatrix.FillComplete();
+    if (_matrixFreeStiffness != Teuchos::null)
+    {
+      // no graph to keep
+    }
+    else if (_stiffnessGraphIsStatic)
+    {
+      // if the sparsity pattern has changed (e.g. because Lagrange constraint weights that were zero no longer are), start over
+      int mismatchCount = (_stiffnessGraphMismatch || (assemblyErr != 0)) ? 1 : 0;
+      mismatchCount = MPIWrapper::sum(*Comm, mismatchCount);
+      if (mismatchCount > 0)
+      {
+        _stiffnessGraph = Teuchos::null;
+        initializeStiffnessAndLoad();
+        populateStiffnessAndLoad();
+        return;
+      }
+    }
+    else if (_reuseStiffnessGraph)
+    {
+      _stiffnessGraph = Teuchos::rcp( new Epetra_CrsGraph(globalStiffness->Graph()) );
+      _stiffnessGraphDofInterpreter = _dofInterpreter.get();
+      _stiffnessGraphDofNumberingVersion = currentDofNumberingVersion(_mesh);
+    }
+  }
 
   double timeGlobalAssembly = timer.ElapsedTime();
   Epetra_Vector timeGlobalAssemblyVector(timeMap);
@@ -1387,7 +1663,10 @@ void TSolution<Scalar>::populateStiffnessAndLoad()
 
   timer.ResetStartTime();
 
-  imposeBCs();
+  {
+    CAMELLIA_TIMED_REGION("BC imposition");
+    imposeBCs();
+  }
 
   double timeBCImposition = timer.ElapsedTime();
   Epetra_Vector timeBCImpositionVector(timeMap);
@@ -1407,6 +1686,8 @@ void TSolution<Scalar>::populateStiffnessAndLoad()
   }
 
   // Dump matrices to disk
+  TEUCHOS_TEST_FOR_EXCEPTION((_writeMatrixToMatlabFile || _writeMatrixToMatrixMarketFile) && (_matrixFreeStiffness != Teuchos::null),
+                             std::invalid_argument, "there is no matrix to write when matrix-free stiffness is in use");
   if (_writeMatrixToMatlabFile)
   {
     //    EpetraExt::MultiVectorToMatrixMarketFile("rhs_vector.dat",rhsVector,0,0,false);
@@ -1440,6 +1721,7 @@ void TSolution<Scalar>::setProblem(TSolverPtr<Scalar> solver)
 {
   // Teuchos::RCP<Epetra_LinearProblem> problem = Teuchos::rcp( new Epetra_LinearProblem(&*_globalStiffMatrix, &*_lhsVector, &*_rhsVector));
   solver->setProblem(_globalStiffMatrix, _lhsVector, _rhsVector);
+  solver->setMatrixFreeStiffness(_matrixFreeStiffness);
 }
 
 template <typename Scalar>
@@ -1455,7 +1737,7 @@ int TSolution<Scalar>::solveWithPrepopulatedStiffnessAndLoad(TSolverPtr<Scalar>
   Epetra_Map timeMap(numProcs,indexBase,*Comm);
   Epetra_Time timer(*Comm);
 
-  if (_reportConditionNumber)
+  if (_reportConditionNumber && (_globalStiffMatrix != Teuchos::null))
   {
     //    double oneNorm = globalStiffMatrix.NormOne();
     Teuchos::RCP<Epetra_LinearProblem> problem = Teuchos::rcp( new Epetra_LinearProblem(&*_globalStiffMatrix, &*_lhsVector, &*_rhsVector));
@@ -1471,13 +1753,16 @@ int TSolution<Scalar>::solveWithPrepopulatedStiffnessAndLoad(TSolverPtr<Scalar>
   timer.ResetStartTime();
 
   int solveSuccess;
-  if (!callResolveInsteadOfSolve)
-  {
-    solveSuccess = solver->solve();
-  }
-  else
   {
-    solveSuccess = solver->resolve();
+    CAMELLIA_TIMED_REGION("Solution::solve");
+    if (!callResolveInsteadOfSolve)
+    {
+      solveSuccess = solver->solve();
+    }
+    else
+    {
+      solveSuccess = solver->resolve();
+    }
   }
 
   if (solveSuccess != 0 )
@@ -1515,7 +1800,7 @@ int TSolution<Scalar>::solve(TSolverPtr<Scalar> solver)
     }
   }
 
-  initializeLHSVector();
+  initializeLHSVectorForSolve();
   initializeStiffnessAndLoad();
   setProblem(solver);
   applyDGJumpTerms();
@@ -1523,6 +1808,7 @@ int TSolution<Scalar>::solve(TSolverPtr<Scalar> solver)
   int solveSuccess = solveWithPrepopulatedStiffnessAndLoad(solver);
 //  cout << "about to call importSolution on rank " << rank << endl;
   importSolution();
+  _lhsVectorDofNumberingVersion = currentDofNumberingVersion(_mesh);
 //  cout << "calling importGlobalSolution (this doesn't scale well, especially in its current form).\n";
 //  importGlobalSolution();
 //  cout << "about to call clearComputedResiduals on rank " << rank << endl;
@@ -1605,6 +1891,7 @@ TRHSPtr<Scalar> TSolution<Scalar>::rhs() const
 template <typename Scalar>
 void TSolution<Scalar>::importSolution()
 {
+  CAMELLIA_TIMED_REGION("Solution::distributeSolution");
   Epetra_CommPtr Comm = _mesh->Comm();
   int rank = Comm->MyPID();
 
@@ -1886,7 +2173,10 @@ void TSolution<Scalar>::imposeBCs()
   }
 
   Epetra_MultiVector rhsDirichlet(partMap,1);
-  _globalStiffMatrix->Apply(v,rhsDirichlet);
+  if (_matrixFreeStiffness != Teuchos::null)
+    _matrixFreeStiffness->Apply(v,rhsDirichlet);
+  else
+    _globalStiffMatrix->Apply(v,rhsDirichlet);
 
   // Update right-hand side
   _rhsVector->Update(-1.0,rhsDirichlet,1.0);
@@ -1910,6 +2200,11 @@ void TSolution<Scalar>::imposeBCs()
   }
   // Zero out rows and columns of stiffness matrix corresponding to Dirichlet edges
   //  and add one to diagonal.
+  if (_matrixFreeStiffness != Teuchos::null)
+  {
+    _matrixFreeStiffness->setDirichletRows(numBCs, (numBCs > 0) ? &bcGlobalIndicesCast(0) : NULL);
+    return;
+  }
   Intrepid::FieldContainer<int> bcLocalIndices(bcGlobalIndices.dimension(0));
   for (int i=0; i<bcGlobalIndices.dimension(0); i++)
   {
@@ -1994,7 +2289,7 @@ void TSolution<Scalar>::imposeZMCsUsingLagrange()
       if ((rank == 0) && (allBasisIntegrals.size() > 0))
       {
         // insert the row at zmcIndex with the gathered basis integrals
-        _globalStiffMatrix->InsertGlobalValues(zmcIndex,allBasisIntegrals.size(),&allBasisIntegrals(0),&allGlobalIndices(0));
+        addToGlobalStiffnessRow(zmcIndex,allBasisIntegrals.size(),&allBasisIntegrals(0),&allGlobalIndices(0));
 //        cout << "Inserted globalValues for row " << zmcIndex << "; values:\n" << allBasisIntegrals << "indices:\n" << allGlobalIndices;
       }
 
@@ -2005,7 +2300,7 @@ void TSolution<Scalar>::imposeZMCsUsingLagrange()
         for (int valueOrdinal=0; valueOrdinal<basisIntegrals.size(); valueOrdinal++)
         {
 //          cout << "Inserting globalValues for (" << globalIndices(valueOrdinal)  << "," << zmcIndex << ") = " << basisIntegrals(valueOrdinal) << endl;
-          _globalStiffMatrix->InsertGlobalValues(globalIndices(valueOrdinal),1,&basisIntegrals(valueOrdinal),&zmcIndex);
+          addToGlobalStiffnessRow(globalIndices(valueOrdinal),1,&basisIntegrals(valueOrdinal),&zmcIndex);
         }
 
         // old, FECrsMatrix version below:
@@ -2019,7 +2314,7 @@ void TSolution<Scalar>::imposeZMCsUsingLagrange()
       if (rank==0)   // insert the diagonal entry on rank 0; other ranks insert basis integrals according to which cells they own
       {
         Scalar rho_entry = - 1.0 / _zmcRho;
-        _globalStiffMatrix->InsertGlobalValues(zmcIndex,1,&rho_entry,&zmcIndex);
+        addToGlobalStiffnessRow(zmcIndex,1,&rho_entry,&zmcIndex);
       }
     }
     else
@@ -2028,7 +2323,7 @@ void TSolution<Scalar>::imposeZMCsUsingLagrange()
       if (rank==0)   // insert the diagonal entry on rank 0; other ranks insert basis integrals according to which cells they own
       {
         Scalar one = 1.0;
-        _globalStiffMatrix->InsertGlobalValues(zmcIndex,1,&one,&zmcIndex);
+        addToGlobalStiffnessRow(zmcIndex,1,&one,&zmcIndex);
       }
     }
     if (rank==0) localRowIndex++;
@@ -2481,156 +2776,287 @@ const map<GlobalIndexType,double> & TSolution<Scalar>::rankLocalEnergyError()
 
   computeErrorRepresentation();
 
-  set<GlobalIndexType> rankLocalCells = _mesh->cellIDsInPartition();
-  for (set<GlobalIndexType>::iterator cellIDIt = rankLocalCells.begin(); cellIDIt != rankLocalCells.end(); cellIDIt++)
+  const set<GlobalIndexType>* rankLocalCells = &_mesh->cellIDsInPartition();
+  for (GlobalIndexType cellID : *rankLocalCells)
   {
-    GlobalIndexType cellID = *cellIDIt;
-
     // for error rep v_e, residual res, energyError = sqrt ( ve_^T * res)
-    Intrepid::FieldContainer<double> residual = _residualForCell[cellID];
-    Intrepid::FieldContainer<double> errorRep = _errorRepresentationForCell[cellID];
-    int numTestDofs = residual.dimension(1);
-    int numCells = residual.dimension(0);
+    const Intrepid::FieldContainer<double>* residual = &_residualForCell[cellID];
+    const Intrepid::FieldContainer<double>* errorRep = &_errorRepresentationForCell[cellID];
+    int numTestDofs = residual->dimension(1);
+    int numCells = residual->dimension(0);
     TEUCHOS_TEST_FOR_EXCEPTION( numCells!=1, std::invalid_argument, "In energyError::numCells != 1.");
 
     double errorSquared = 0.0;
     for (int i=0; i<numTestDofs; i++)
     {
-      errorSquared += residual(0,i) * errorRep(0,i);
+      errorSquared += (*residual)(0,i) * (*errorRep)(0,i);
     }
     _energyErrorForCell[cellID] = sqrt(errorSquared);
-  } // end of loop thru element types
+  }
 
   _rankLocalEnergyErrorComputed = true;
 
   return _energyErrorForCell;
 }
 
+template <typename Scalar>
+void TSolution<Scalar>::computeTestValuesForCellBatches(map< GlobalIndexType, Intrepid::FieldContainer<double> > &valuesForCell,
+                                                        bool testVsTest, int cubatureEnrichment,
+                                                        std::function<void(Intrepid::FieldContainer<double> &values,
+                                                                           ElementTypePtr elemType,
+                                                                           BasisCachePtr basisCache)> computeBatch)
+{
+  // batches and threads are arranged as in populateStiffnessAndLoad()
+  int rank = _mesh->Comm()->MyPID();
+  vector< ElementTypePtr > elementTypes = _mesh->elementTypes(rank);
+  for (ElementTypePtr elemType : elementTypes)
+  {
+    Intrepid::FieldContainer<double> physicalCellNodesForType = _mesh->physicalCellNodes(elemType);
+    Intrepid::FieldContainer<double> cellSideParitiesForType = _mesh->cellSideParities(elemType);
+    int totalCellsForType = physicalCellNodesForType.dimension(0);
+    if (totalCellsForType == 0) continue;
+
+    int numTrialDofs = elemType->trialOrderPtr->totalDofs();
+    int numTestDofs = elemType->testOrderPtr->totalDofs();
+    int maxCellBatch = _maxBatchSizeInBytes / 8 / (numTestDofs*numTestDofs + numTestDofs*numTrialDofs + numTestDofs);
+    maxCellBatch = max( maxCellBatch, MIN_BATCH_SIZE_IN_CELLS );
+
+    vector< pair<int,int> > batches; // (startCellIndexForBatch, numCells)
+    for (int startCellIndex = 0; startCellIndex < totalCellsForType; startCellIndex += maxCellBatch)
+    {
+      batches.push_back({startCellIndex, min(maxCellBatch, totalCellsForType - startCellIndex)});
+    }
+    int numBatches = batches.size();
+    int numThreads = max(1, min(numThreadsForLocalStiffness(), numBatches));
+
+    GlobalIndexType sampleCellID = _mesh->cellID(elemType, 0, rank);
+    vector<BasisCachePtr> basisCaches(numThreads);
+    for (int threadOrdinal=0; threadOrdinal<numThreads; threadOrdinal++)
+    {
+      basisCaches[threadOrdinal] = BasisCache::basisCacheForCell(_mesh,sampleCellID,testVsTest,cubatureEnrichment);
+    }
+
+    Teuchos::Array<int> nodeDimensions, parityDimensions;
+    physicalCellNodesForType.dimensions(nodeDimensions);
+    cellSideParitiesForType.dimensions(parityDimensions);
+
+    for (int roundStartBatch = 0; roundStartBatch < numBatches; roundStartBatch += numThreads)
+    {
+      int roundSize = min(numThreads, numBatches - roundStartBatch);
+
+      vector< vector<GlobalIndexType> > cellIDsForBatch(roundSize);
+      vector< Intrepid::FieldContainer<double> > valuesForBatch(roundSize);
+      vector< Intrepid::FieldContainer<double> > physicalCellNodesForBatch(roundSize);
+      vector< Intrepid::FieldContainer<double> > cellSideParitiesForBatch(roundSize);
+      for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
+      {
+        int startCellIndex = batches[roundStartBatch + batchOrdinal].first;
+        int numCells = batches[roundStartBatch + batchOrdinal].second;
+        for (int cellIndex=0; cellIndex<numCells; cellIndex++)
+        {
+          cellIDsForBatch[batchOrdinal].push_back(_mesh->cellID(elemType, cellIndex+startCellIndex, rank));
+        }
+        nodeDimensions[0] = numCells;
+        parityDimensions[0] = numCells;
+        physicalCellNodesForBatch[batchOrdinal] = Intrepid::FieldContainer<double>(nodeDimensions,&physicalCellNodesForType(startCellIndex,0,0));
+        cellSideParitiesForBatch[batchOrdinal] = Intrepid::FieldContainer<double>(parityDimensions,&cellSideParitiesForType(startCellIndex,0));
+        valuesForBatch[batchOrdinal].resize(numCells,numTestDofs);
+      }
+
+      // exceptions may not propagate out of an OpenMP parallel region, so we record the first one and rethrow below
+      string threadErrorMessage = "";
+#ifdef _OPENMP
+      #pragma omp parallel for num_threads(roundSize) schedule(static,1) if (roundSize > 1)
+#endif
+      for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
+      {
+        try
+        {
+          BasisCachePtr basisCache = basisCaches[batchOrdinal];
+          bool createSideCacheToo = true;
+          basisCache->setPhysicalCellNodes(physicalCellNodesForBatch[batchOrdinal],cellIDsForBatch[batchOrdinal],createSideCacheToo);
+          basisCache->setCellSideParities(cellSideParitiesForBatch[batchOrdinal]);
+
+          computeBatch(valuesForBatch[batchOrdinal], elemType, basisCache);
+        }
+        catch (std::exception &e)
+        {
+#ifdef _OPENMP
+          #pragma omp critical (CamelliaSolutionThreadError)
+#endif
+          {
+            if (threadErrorMessage == "") threadErrorMessage = e.what();
+          }
+        }
+      }
+      TEUCHOS_TEST_FOR_EXCEPTION(threadErrorMessage != "", std::runtime_error, threadErrorMessage);
+
+      for (int batchOrdinal=0; batchOrdinal<roundSize; batchOrdinal++)
+      {
+        const vector<GlobalIndexType>* cellIDs = &cellIDsForBatch[batchOrdinal];
+        for (int cellOrdinal=0; cellOrdinal<cellIDs->size(); cellOrdinal++)
+        {
+          Intrepid::FieldContainer<double>* cellValues = &valuesForCell[(*cellIDs)[cellOrdinal]];
+          cellValues->resize(1,numTestDofs);
+          for (int i=0; i<numTestDofs; i++)
+          {
+            (*cellValues)(0,i) = valuesForBatch[batchOrdinal](cellOrdinal,i);
+          }
+        }
+      }
+    }
+  }
+}
+
 template <typename Scalar>
 void TSolution<Scalar>::computeErrorRepresentation()
 {
   narrate("computeErrorRepresentation()");
+  CAMELLIA_TIMED_REGION("Solution::computeErrorRepresentation");
   if (!_residualsComputed)
   {
     computeResiduals();
   }
-  set<GlobalIndexType> rankLocalCells = _mesh->cellIDsInPartition();
-  for (set<GlobalIndexType>::iterator cellIDIt = rankLocalCells.begin(); cellIDIt != rankLocalCells.end(); cellIDIt++)
-  {
-    GlobalIndexType cellID = *cellIDIt;
-
-    BasisCachePtr ipBasisCache = BasisCache::basisCacheForCell(_mesh, cellID, true);
 
-    ElementTypePtr elemTypePtr = _mesh->getElementType(cellID);
-
-    Teuchos::RCP<DofOrdering> testOrdering = elemTypePtr->testOrderPtr;
-    CellTopoPtr cellTopo = elemTypePtr->cellTopoPtr;
+  // If this Solution retains Gram factors (setRetainGramFactorizations()), we back-substitute with those, and store any
+  // factors we compute here.  Otherwise, we solve with QR.  Either way, the Gram matrices are integrated with the solve's
+  // cubature enrichment, so that the error representation does not depend on whether factors are retained.
+  GramMatrixCachePtr gramMatrixCache = _gramMatrixCache;
 
-    int numCells = 1;
+  computeTestValuesForCellBatches(_errorRepresentationForCell, true, _cubatureEnrichmentDegree,
+                                  [this, gramMatrixCache] (Intrepid::FieldContainer<double> &errorRepresentation,
+                                                           ElementTypePtr elemType, BasisCachePtr ipBasisCache)
+  {
+    DofOrderingPtr testOrdering = elemType->testOrderPtr;
+    const vector<GlobalIndexType>* cellIDs = &ipBasisCache->cellIDs();
+    int numCells = cellIDs->size();
     int numTestDofs = testOrdering->totalDofs();
 
-    Intrepid::FieldContainer<double> representationMatrix(numTestDofs, 1);
-    Intrepid::FieldContainer<double> errorRepresentation(numCells,numTestDofs);
-
-    Intrepid::FieldContainer<Scalar> ipMatrix(1,numTestDofs,numTestDofs);
-    _ip->computeInnerProductMatrix(ipMatrix,testOrdering, ipBasisCache);
-    Intrepid::FieldContainer<Scalar> rhsMatrix = _residualForCell[cellID];
-    // transpose residual :
-    rhsMatrix.resize(numTestDofs, 1);
-
-    // strip cell dimension:
-    ipMatrix.resize(ipMatrix.dimension(1),ipMatrix.dimension(2));
-
+    // factors are copied out of the cache, since other threads may discard its entries while we use them
+    vector< Intrepid::FieldContainer<double> > cachedFactors(numCells);
+    vector<bool> factorIsCached(numCells, false);
+    int gramCubatureDegree = ipBasisCache->cubatureDegree();
+    bool allCellsHit = (gramMatrixCache != Teuchos::null);
+    if (gramMatrixCache != Teuchos::null)
     {
-      // DEBUGGING
-//      cout << "\nIn computeErrorRepresentation, ipMatrix 2-norm condition number: " << SerialDenseWrapper::getMatrixConditionNumber2Norm(ipMatrix);
-
-//      cout << "In computeErrorRepresentation, ipMatrix:\n" << ipMatrix;
-//      cout << "In computeErrorRepresentation, rhsMatrix:\n" << rhsMatrix;
+      for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+      {
+        factorIsCached[cellOrdinal] = gramMatrixCache->getCholeskyFactor((*cellIDs)[cellOrdinal], _ip.get(), testOrdering,
+                                                                         gramCubatureDegree, cachedFactors[cellOrdinal]);
+        if (!factorIsCached[cellOrdinal]) allCellsHit = false;
+      }
     }
 
-    int result = SerialDenseWrapper::solveSystemUsingQR(representationMatrix, ipMatrix, rhsMatrix);
-    if (result != 0)
+    Intrepid::FieldContainer<Scalar> ipMatrix;
+    if (!allCellsHit)
     {
-      cout << "WARNING: computeErrorRepresentation: call to solveSystemUsingQR failed with error code " << result << endl;
+      CAMELLIA_TIMED_REGION("IP matrix");
+      ipMatrix.resize(numCells,numTestDofs,numTestDofs);
+      _ip->computeInnerProductMatrix(ipMatrix,testOrdering, ipBasisCache);
     }
-    for (int i=0; i<numTestDofs; i++)
+
+    CAMELLIA_TIMED_REGION("Gram solve");
+    Teuchos::LAPACK<int, double> lapack;
+    Teuchos::Array<int> ipDim(2,numTestDofs);
+    Intrepid::FieldContainer<double> representationMatrix(numTestDofs, 1);
+    Intrepid::FieldContainer<Scalar> rhsMatrix(numTestDofs, 1);
+    Intrepid::FieldContainer<double> factor;
+    for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
     {
-      errorRepresentation(0,i) = representationMatrix(i,0);
+      GlobalIndexType cellID = (*cellIDs)[cellOrdinal];
+      // _residualForCell is only read while batches are being computed
+      const Intrepid::FieldContainer<double>* residual = &_residualForCell.find(cellID)->second;
+      for (int i=0; i<numTestDofs; i++)
+      {
+        rhsMatrix(i,0) = (*residual)(0,i);
+      }
+
+      const Intrepid::FieldContainer<double>* cholesky = factorIsCached[cellOrdinal] ? &cachedFactors[cellOrdinal] : NULL;
+      if ((cholesky == NULL) && (gramMatrixCache != Teuchos::null))
+      {
+        // factor a copy, so that QR can still be used if the factorization fails
+        factor = Intrepid::FieldContainer<double>(ipDim, &ipMatrix(cellOrdinal,0,0), true);
+        int INFO;
+        lapack.POTRF('L', numTestDofs, &factor[0], numTestDofs, &INFO);
+        if (INFO == 0)
+        {
+          gramMatrixCache->storeCholeskyFactor(cellID, _ip.get(), testOrdering, gramCubatureDegree, factor); // provided that it fits in the budget
+          cholesky = &factor;
+        }
+      }
+
+      int result;
+      if (cholesky != NULL)
+      {
+        lapack.POTRS('L', numTestDofs, 1, &(*cholesky)[0], numTestDofs, &rhsMatrix[0], numTestDofs, &result);
+        for (int i=0; i<numTestDofs; i++)
+        {
+          representationMatrix(i,0) = rhsMatrix(i,0);
+        }
+      }
+      else
+      {
+        Intrepid::FieldContainer<Scalar> cellIPMatrix(ipDim, &ipMatrix(cellOrdinal,0,0));
+        result = SerialDenseWrapper::solveSystemUsingQR(representationMatrix, cellIPMatrix, rhsMatrix);
+      }
+      if (result != 0)
+      {
+        cout << "WARNING: computeErrorRepresentation: Gram matrix solve failed with error code " << result << endl;
+      }
+      for (int i=0; i<numTestDofs; i++)
+      {
+        errorRepresentation(cellOrdinal,i) = representationMatrix(i,0);
+      }
     }
-    _errorRepresentationForCell[cellID] = errorRepresentation;
-  }
+  });
 }
 
 template <typename Scalar>
 void TSolution<Scalar>::computeResiduals()
 {
   narrate("computeResiduals()");
-  set<GlobalIndexType> rankLocalCells = _mesh->cellIDsInPartition();
-  for (set<GlobalIndexType>::iterator cellIDIt = rankLocalCells.begin(); cellIDIt != rankLocalCells.end(); cellIDIt++)
-  {
-    GlobalIndexType cellID = *cellIDIt;
-
-    ElementTypePtr elemTypePtr = _mesh->getElementType(cellID);
-
-    Teuchos::RCP<DofOrdering> trialOrdering = elemTypePtr->trialOrderPtr;
-    Teuchos::RCP<DofOrdering> testOrdering = elemTypePtr->testOrderPtr;
+  CAMELLIA_TIMED_REGION("Solution::computeResiduals");
+  TBFPtr<Scalar> bf = (_bf != Teuchos::null) ? _bf : _mesh->bilinearForm();
 
-    int numCells = 1;
+  computeTestValuesForCellBatches(_residualForCell, false, _cubatureEnrichmentDegree,
+                                  [this, bf] (Intrepid::FieldContainer<double> &residual, ElementTypePtr elemType,
+                                              BasisCachePtr basisCache)
+  {
+    DofOrderingPtr trialOrdering = elemType->trialOrderPtr;
+    DofOrderingPtr testOrdering = elemType->testOrderPtr;
+    const vector<GlobalIndexType>* cellIDs = &basisCache->cellIDs();
+    int numCells = cellIDs->size();
     int numTrialDofs = trialOrdering->totalDofs();
     int numTestDofs  = testOrdering->totalDofs();
 
     // compute l(v) and store in residuals:
-    Intrepid::FieldContainer<double> residual(1,numTestDofs);
-
-    Teuchos::Array<int> oneCellDim(2);
-    oneCellDim[0] = 1;
-    oneCellDim[1] = numTestDofs;
-
-    Intrepid::FieldContainer<Scalar> localCoefficients;
-    if (_solutionForCellIDGlobal.find(cellID) != _solutionForCellIDGlobal.end())
-    {
-      localCoefficients = _solutionForCellIDGlobal[cellID];
-    }
-    else
     {
-      localCoefficients.resize(numTrialDofs);
+      CAMELLIA_TIMED_REGION("RHS");
+      _rhs->integrateAgainstStandardBasis(residual, testOrdering, basisCache);
     }
 
-    BasisCachePtr basisCache = BasisCache::basisCacheForCell(_mesh, cellID, false, _cubatureEnrichmentDegree);
-    _rhs->integrateAgainstStandardBasis(residual, testOrdering, basisCache);
-
-//    cout << "computeResiduals(): testOrdering:\n" << *testOrdering;
-
-//    cout << "computeResiduals(): RHS values:\n" << residual;
-
     // compute b(u, v):
-    Intrepid::FieldContainer<Scalar> preStiffness(1,numTestDofs,numTrialDofs );
-    Intrepid::FieldContainer<double> cellSideParitiesForCell = _mesh->cellSideParitiesForCell(cellID);
-    if (_bf != Teuchos::null)
-      _bf->stiffnessMatrix(preStiffness, elemTypePtr, cellSideParitiesForCell, basisCache);
-    else
-      _mesh->bilinearForm()->stiffnessMatrix(preStiffness, elemTypePtr, cellSideParitiesForCell, basisCache);
-
-    for (int i=0; i<numTestDofs; i++)
+    Intrepid::FieldContainer<Scalar> preStiffness(numCells,numTestDofs,numTrialDofs);
+    Intrepid::FieldContainer<double> cellSideParities = basisCache->getCellSideParities();
     {
-      for (int j=0; j<numTrialDofs; j++)
-      {
-        residual(0,i) -= localCoefficients(j) * preStiffness(0,i,j);
-      }
+      CAMELLIA_TIMED_REGION("stiffness");
+      bf->stiffnessMatrix(preStiffness, elemType, cellSideParities, basisCache);
     }
 
-//    cout << "computeResiduals(): residual values:\n" << residual;
-
-    _residualForCell[cellID] = residual;
-//    cout << "computed residual vector for cell " << cellID << "; nonzeros:\n";
-//    double tol = 1e-15;
-//    for (int i=0; i< _residualForCell[cellID].size(); i++) {
-//      if (abs(_residualForCell[cellID][i]) > tol) {
-//        cout << setw(10) << i << setw(25) << _residualForCell[cellID][i] << endl;
-//      }
-//    }
-  }
+    // residual -= preStiffness * coefficients, cell by cell.  preStiffness(cellOrdinal,:,:) is row-major (test, trial),
+    // which BLAS sees as its column-major transpose, so we ask for the transpose back.
+    Teuchos::BLAS<int, Scalar> blas;
+    for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+    {
+      // _solutionForCellIDGlobal is only read while batches are being computed
+      auto coefficientsEntry = _solutionForCellIDGlobal.find((*cellIDs)[cellOrdinal]);
+      if (coefficientsEntry == _solutionForCellIDGlobal.end()) continue; // zero coefficients
+      const Intrepid::FieldContainer<Scalar>* coefficients = &coefficientsEntry->second;
+      if (coefficients->size() == 0) continue;
+      blas.GEMV(Teuchos::TRANS, numTrialDofs, numTestDofs, -1.0, &preStiffness(cellOrdinal,0,0), numTrialDofs,
+                &(*coefficients)[0], 1, 1.0, &residual(cellOrdinal,0), 1);
+    }
+  });
   _residualsComputed = true;
 }
 
@@ -2672,6 +3098,12 @@ Teuchos::RCP<Epetra_CrsMatrix> TSolution<Scalar>::getStiffnessMatrix()
   return _globalStiffMatrix;
 }
 
+template <typename Scalar>
+ElementMatrixOperatorPtr TSolution<Scalar>::getMatrixFreeStiffness()
+{
+  return _matrixFreeStiffness;
+}
+
 template <typename Scalar>
 TMatrixPtr<Scalar> TSolution<Scalar>::getStiffnessMatrix2()
 {
@@ -2684,6 +3116,7 @@ void TSolution<Scalar>::setStiffnessMatrix(Teuchos::RCP<Epetra_CrsMatrix> stiffn
   narrate("setStiffnessMatrix()");
 //  Epetra_FECrsMatrix* stiffnessFEMatrix = dynamic_cast<Epetra_FECrsMatrix*>(_globalStiffMatrix.get());
   _globalStiffMatrix = stiffness;
+  _stiffnessGraphIsStatic = false; // the new matrix is not one we built on _stiffnessGraph
 }
 
 template <typename Scalar>
@@ -3393,6 +3826,7 @@ void TSolution<Scalar>::setLocalCoefficientsForCell(GlobalIndexType cellID, cons
     TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "coefficients container doesn't have the right shape; should be rank 1");
   }
   _solutionForCellIDGlobal[cellID] = coefficients;
+  _lhsVectorDofNumberingVersion = -1; // _lhsVector no longer agrees with the cell coefficients
 }
 
 template <typename Scalar>
@@ -3401,6 +3835,47 @@ void TSolution<Scalar>::setReportTimingResults(bool value)
   _reportTimingResults = value;
 }
 
+template <typename Scalar>
+void TSolution<Scalar>::setReuseStiffnessGraph(bool value)
+{
+  _reuseStiffnessGraph = value;
+  if (!value) _stiffnessGraph = Teuchos::null;
+}
+
+template <typename Scalar>
+void TSolution<Scalar>::setUseMatrixFreeStiffness(bool value)
+{
+  _useMatrixFreeStiffness = value;
+}
+
+template <typename Scalar>
+void TSolution<Scalar>::setRetainGramFactorizations(bool value, size_t memoryBudgetInBytes)
+{
+  TBFPtr<Scalar> bf = (_bf != Teuchos::null) ? _bf : _mesh->bilinearForm();
+  if (value)
+  {
+    GramMatrixCachePtr bfCache = bf->gramMatrixCache();
+    if ((bfCache != Teuchos::null) && (bfCache->mesh() == _mesh.get()))
+    {
+      bfCache->setMemoryBudget(memoryBudgetInBytes);
+      _gramMatrixCache = bfCache;
+    }
+    else
+    {
+      _gramMatrixCache = GramMatrixCache::gramMatrixCache(_mesh, memoryBudgetInBytes);
+      bf->setGramMatrixCache(_gramMatrixCache);
+    }
+  }
+  else
+  {
+    if ((_gramMatrixCache != Teuchos::null) && (bf->gramMatrixCache().get() == _gramMatrixCache.get()))
+    {
+      bf->setGramMatrixCache(Teuchos::null);
+    }
+    _gramMatrixCache = Teuchos::null;
+  }
+}
+
 template <typename Scalar>
 void TSolution<Scalar>::setRHS( TRHSPtr<Scalar> rhs)
 {
@@ -4449,6 +4924,7 @@ void TSolution<Scalar>::readFromFile(const string &filePath)
     }
   }
   fin.close();
+  _lhsVectorDofNumberingVersion = -1;
 }
 
 template <typename Scalar>
@@ -4595,6 +5071,7 @@ void TSolution<Scalar>::setGlobalSolutionFromCellLocalCoefficients()
       }
     }
   }
+  _lhsVectorDofNumberingVersion = currentDofNumberingVersion(_mesh);
 }
 
 template <typename Scalar>
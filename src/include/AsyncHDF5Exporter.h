@@ -0,0 +1,123 @@
+#ifndef ASYNCHDF5EXPORTER_H
+#define ASYNCHDF5EXPORTER_H
+
+/*
+ *  AsyncHDF5Exporter.h
+ *
+ */
+
+#include "EpetraExt_ConfigDefs.h"
+#ifdef HAVE_EPETRAEXT_HDF5
+
+#include "TypeDefs.h"
+
+#include "HDF5Exporter.h"
+#include "RefinementObserver.h"
+
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Camellia
+{
+//! AsyncHDF5Exporter: writes HDF5Exporter output on a background thread.
+/*!
+ Each export call evaluates the exported functions on the calling thread (HDF5Exporter::prepareExport()), and queues
+ the resulting point, connectivity and value arrays; a writer thread then writes the HDF5 and XMF files
+ (HDF5Exporter::writeExport()), while the caller goes on to the next time step.  The writer thread does only file
+ I/O: it does not touch the mesh, the functions, or any of Camellia's shared caches.  The output is identical to that
+ of an HDF5Exporter receiving the same sequence of calls.
+
+ With the default of two pending exports, the exporter is double-buffered: one export may be written while the
+ next waits.  When the queue is full -- or when a new export would push the memory held by pending exports past
+ the memory budget -- the export call blocks until the writer catches up, unless setDropWhenFull(true) has been
+ called, in which case the export is skipped.  (An export larger than the whole budget is still accepted once the
+ queue is empty.)
+
+ The exporter registers as a RefinementObserver, and finishes pending exports before any refinement takes place, so
+ that the output for a mesh is complete before the mesh changes.  Parallel (shared-file) HDF5 output is not
+ supported, since it would require MPI calls from the writer thread.  The HDF5 library may not be thread-safe, so
+ callers should not write other HDF5 files while exports are pending (flush() first).
+
+ Errors in the writer thread are reported by the next call to an export method or to flush().
+ */
+class AsyncHDF5Exporter : public RefinementObserver
+{
+  struct ExportJob
+  {
+    std::vector<HDF5Exporter::ExportData> exports; // one entry per HDF5Exporter::exportFunction() call
+    size_t memoryFootprint; // in bytes
+  };
+
+  MeshPtr _mesh; // weak RCP
+  HDF5Exporter _exporter; // prepareExport() is called on the calling thread, writeExport() on the writer thread
+
+  int _maxPendingExports;
+  size_t _memoryBudget;
+  bool _dropWhenFull;
+
+  std::deque<ExportJob> _queue; // the front job is the one being written
+  size_t _pendingMemory;
+  bool _stopping;
+  std::string _writerError;
+  int _droppedExportCount;
+
+  std::mutex _mutex;
+  std::condition_variable _jobAvailable, _jobFinished;
+  std::thread _writerThread;
+
+  bool enqueue(ExportJob &job); // moves the job into the queue
+  void throwWriterError(); // call with _mutex locked
+  void throwPendingWriterError(); // locks _mutex
+  void writerLoop();
+public:
+  AsyncHDF5Exporter(MeshPtr mesh, std::string outputDirName="output", std::string outputDirSuperPath = ".",
+                    int maxPendingExports = 2, size_t memoryBudgetInBytes = std::numeric_limits<size_t>::max());
+  ~AsyncHDF5Exporter(); // finishes any pending exports
+
+  // ! Evaluates the solution's field and trace variables (as in HDF5Exporter::exportSolution()) and queues them for writing.
+  // ! Returns false if the export was dropped (see setDropWhenFull()).
+  bool exportSolution(TSolutionPtr<double> solution, double timeVal=0, unsigned int defaultNum1DPts=4,
+                      HDF5Exporter::map_int_int cellIDToNum1DPts=HDF5Exporter::map_int_int(),
+                      std::set<GlobalIndexType> cellIndices=std::set<GlobalIndexType>());
+
+  // ! Evaluates the functions (as in HDF5Exporter::exportFunction()) and queues them for writing.
+  // ! Returns false if the export was dropped (see setDropWhenFull()).
+  bool exportFunction(std::vector<TFunctionPtr<double>> functions, std::vector<std::string> functionNames, double timeVal=0,
+                      unsigned int defaultNum1DPts=4, HDF5Exporter::map_int_int cellIDToNum1DPts=HDF5Exporter::map_int_int(),
+                      std::set<GlobalIndexType> cellIndices=std::set<GlobalIndexType>());
+
+  // ! Blocks until all queued exports have been written.
+  void flush();
+
+  int numPendingExports();
+  size_t pendingMemory(); // bytes held by pending exports
+  int droppedExportCount();
+
+  int maxPendingExports();
+  void setMaxPendingExports(int value);
+  size_t memoryBudget();
+  void setMemoryBudget(size_t memoryBudgetInBytes);
+  // ! When true, exports requested while the queue is full are skipped, rather than waiting for the writer.  Default: false.
+  void setDropWhenFull(bool value);
+
+  // HDF5Exporter settings; these apply to exports requested after the call (pending exports are unaffected)
+  void setNumThreads(int numThreads);
+  void setCellBatchSize(int cellBatchSize);
+  void setUseSinglePrecision(bool value);
+  void setCompressionLevel(int level);
+
+  // RefinementObserver methods: each finishes pending exports before the mesh changes
+  using RefinementObserver::hRefine; // avoid hiding the other hRefine() overloads
+  void hRefine(const std::set<GlobalIndexType> &cellIDs, Teuchos::RCP<RefinementPattern> refPattern);
+  void pRefine(const std::set<GlobalIndexType> &cellIDs);
+  void hUnrefine(const std::set<GlobalIndexType> &cellIDs);
+};
+}
+
+#endif
+#endif // ASYNCHDF5EXPORTER_H
@@ -51,6 +51,9 @@ protected:
   bool _warnAboutZeroRowsAndColumns = true;
   bool _useSubgridMeshForOptimalTestSolve = false;
   
+  GramMatrixCachePtr _gramMatrixCache;
+  ReferenceIntegralCachePtr _referenceIntegralCache;
+  
   bool checkSymmetry(Intrepid::FieldContainer<Scalar> &innerProductMatrix);
 public:
   TBF( bool isLegacySubclass ); // legacy version; new code should use a VarFactory version of the constructor
@@ -105,6 +108,19 @@ public:
   static int factoredCholeskySolve(Intrepid::FieldContainer<Scalar> &ipMatrix, Intrepid::FieldContainer<Scalar> &stiffnessEnriched,
                                    Intrepid::FieldContainer<Scalar> &rhsEnriched, Intrepid::FieldContainer<Scalar> &stiffness,
                                    Intrepid::FieldContainer<Scalar> &rhs);
+
+  // ! Completes the solve in factoredCholeskySolve() given the lower-triangular Cholesky factor of the Gram matrix (column-major, as produced by POTRF).
+  static void choleskyFactorSolve(const Intrepid::FieldContainer<Scalar> &choleskyFactor, Intrepid::FieldContainer<Scalar> &stiffnessEnriched,
+                                  Intrepid::FieldContainer<Scalar> &rhsEnriched, Intrepid::FieldContainer<Scalar> &stiffness,
+                                  Intrepid::FieldContainer<Scalar> &rhs);
+
+  // ! Batched version of factoredCholeskySolve(): ipMatrix is (C,N,N), stiffnessEnriched is (C,M,N), rhsEnriched is (C,N),
+  // ! stiffness is (C,M,M), and rhs is (C,M).  Cells are factored and solved in interleaved groups, so that the inner loops
+  // ! vectorize across cells.  Inputs are left unmodified.  Any cell whose Gram matrix is not numerically SPD is handed off
+  // ! to factoredCholeskySolve(); the return value is the last nonzero error code from such cells (0 if none).
+  static int factoredCholeskySolveBatched(Intrepid::FieldContainer<Scalar> &ipMatrix, Intrepid::FieldContainer<Scalar> &stiffnessEnriched,
+                                          Intrepid::FieldContainer<Scalar> &rhsEnriched, Intrepid::FieldContainer<Scalar> &stiffness,
+                                          Intrepid::FieldContainer<Scalar> &rhs);
   
   virtual void localStiffnessMatrixAndRHS(Intrepid::FieldContainer<Scalar> &localStiffness, Intrepid::FieldContainer<Scalar> &rhsVector,
                                           TIPPtr<Scalar> ip, BasisCachePtr ipBasisCache,
@@ -161,6 +177,16 @@ public:
   void setOptimalTestTimingCallback(std::function<void(int numElements, double timeG, double timeB, double timeT, double timeK, ElementTypePtr elemType)> &optimalTestTimingCallback);
   void setRHSTimingCallback(std::function<void(int numElements, double timeRHS, ElementTypePtr elemType)> &rhsTimingCallback);
 
+  GramMatrixCachePtr gramMatrixCache() const;
+  // ! When set, factored Gram matrices for cells of the cache's mesh are retained and reused across calls to localStiffnessMatrixAndRHS();
+  // ! such cells use the FACTORED_CHOLESKY formulation regardless of optimalTestSolver().  Set to Teuchos::null to disable.
+  void setGramMatrixCache(GramMatrixCachePtr gramMatrixCache);
+
+  ReferenceIntegralCachePtr referenceIntegralCache() const;
+  // ! Reference-cell integrals used for constant-coefficient terms on affine cells are retained here across calls to
+  // ! stiffnessMatrix(); each TBF creates one on construction.  Set to Teuchos::null to integrate them for each batch.
+  void setReferenceIntegralCache(ReferenceIntegralCachePtr referenceIntegralCache);
+
   OptimalTestSolver optimalTestSolver() const;
   void setOptimalTestSolver(OptimalTestSolver choice);
   void setUseIterativeRefinementsWithSPDSolve(bool value);
@@ -65,6 +65,9 @@ namespace Camellia
 class BasisCache
 {
 private:
+  static bool _useAffineIntegration; // whether integration may use per-cell Jacobians on affine cells (see static setter, below)
+  static bool _memoizeFunctionValues; // whether getFunctionValues() retains what it computes (see static setter, below)
+
   IndexType _numCells;
   int _spaceDim;
   bool _isSideCache;
@@ -88,10 +91,20 @@ private:
   Intrepid::FieldContainer<double> _physicalCellNodes;
 
   bool _cellJacobianIsValid, _cellJacobianInverseIsValid, _cellJacobianDeterminantIsValid;
+
+  // set by determineJacobian(): when every cell's reference-to-physical map is affine, the Jacobian is computed once per
+  // cell (at the reference centroid) and the per-point containers above are filled by copying.
+  bool _cellsAreAffine = false;
+  Intrepid::FieldContainer<double> _affineCellJacobian, _affineCellJacobInv; // (C,D,D)
+  Intrepid::FieldContainer<double> _affineCellJacobDet; // (C)
   bool _sideNormalsIsValid, _weightedMeasureIsValid, _physCubPointsIsValid;
   
   TFunctionPtr<double> _transformationFxn;
   bool _composeTransformationFxnWithMeshTransformation;
+
+  // values computed by getFunctionValues(), when memoizing; the TFunctionPtr keeps the Function address in the key from being reused
+  map< pair< TFunction<double>*, Camellia::EOperator >,
+       pair< TFunctionPtr<double>, Teuchos::RCP< const Intrepid::FieldContainer<double> > > > _knownFunctionValues;
   // bool: compose with existing ref-to-mesh-cell transformation. (false means that the function goes from ref to the physical geometry;
   //                                                                true means it goes from the straight-edge mesh to the curvilinear one)
 
@@ -118,6 +131,7 @@ private:
 
   void determineJacobian();
   void determineJacobianInverseAndDeterminant();
+  bool determineAffineCellJacobians();
   void determinePhysicalPoints();
 
   int maxTestDegree();
@@ -197,6 +211,23 @@ public:
   // ! Returns true if the operator given is supported by getTransformedValues().
   // ! Right now, we can compute transformations for any first-order operators, and for d^2/{dx_i dx_j} second-order operators when i==j, but not when i!=j.
   static bool canComputeTransformedValues(Camellia::EOperator op);
+
+  // ! When true (the default), TLinearTerm::integrate() uses reference-cell integrals, mapped with the per-cell Jacobians,
+  // ! for the constant-coefficient volume terms it can handle on affine cells.
+  static void setUseAffineIntegration(bool value);
+  static bool useAffineIntegration();
+
+  // ! When true (default: false), getFunctionValues() retains the values it computes, so that a weight Function that
+  // ! appears in several summands of a bilinear form is evaluated once per cell batch.  Retained values are discarded when
+  // ! the cells, the points, or the transformation function change; they are assumed not to change otherwise -- call
+  // ! discardFunctionValues() after, e.g., updating a Solution that a weight depends on, or changing a Function's time.
+  static void setMemoizeFunctionValues(bool value);
+  static bool memoizeFunctionValues();
+
+  // ! Values of f (with op applied) at the physical cubature points: (C,P), (C,P,D), etc., according to the rank.
+  Teuchos::RCP< const Intrepid::FieldContainer<double> > getFunctionValues(TFunctionPtr<double> f, Camellia::EOperator op = Camellia::OP_VALUE);
+  // ! Discards the values retained by getFunctionValues(), here and in the side caches.
+  void discardFunctionValues();
   
   Intrepid::FieldContainer<double> & getWeightedMeasures();
   Intrepid::FieldContainer<double> getCellMeasures();
@@ -234,6 +265,15 @@ public:
   const Intrepid::FieldContainer<double> & getJacobianDet();
   const Intrepid::FieldContainer<double> & getJacobianInv();
 
+  // ! Returns true if every cell's reference-to-physical map is affine (straight-sided simplices, parallelograms,
+  // ! parallelepipeds, and their tensor products), so that the Jacobian is constant on each cell.  Always false for side
+  // ! caches and when a transformation function is set.
+  bool cellsAreAffine();
+  // ! Per-cell Jacobian, inverse, and determinant, with dimensions (C,D,D), (C,D,D), and (C).  Require cellsAreAffine().
+  const Intrepid::FieldContainer<double> & getAffineCellJacobian();
+  const Intrepid::FieldContainer<double> & getAffineCellJacobianInv();
+  const Intrepid::FieldContainer<double> & getAffineCellJacobianDet();
+
   // ! Returns true if the second-order derivatives of the reference-to-physical transformation may be ignored.
   bool neglectHessian() const;
   
@@ -289,6 +329,9 @@ public:
   static BasisCachePtr basisCache1D(double x0, double x1, int cubatureDegree); // x0 and x1: physical space endpoints
   static BasisCachePtr basisCacheForCell(MeshPtr mesh, GlobalIndexType cellID, bool testVsTest = false,
                                          int cubatureDegreeEnrichment = 0, bool tensorProductTopologyMeansSpaceTime=true);
+  // ! as basisCacheForCell(), for several cells of one element type; space-time cells are supported only one at a time
+  static BasisCachePtr basisCacheForCells(MeshPtr mesh, const std::vector<GlobalIndexType> &cellIDs, bool testVsTest = false,
+                                          int cubatureDegreeEnrichment = 0, bool tensorProductTopologyMeansSpaceTime=true);
   static BasisCachePtr basisCacheForCellType(MeshPtr mesh, ElementTypePtr elemType, bool testVsTest = false,
       int cubatureDegreeEnrichment = 0, bool tensorProductTopologyMeansSpaceTime=true); // for cells on the local MPI node
   static BasisCachePtr basisCacheForReferenceCell(shards::CellTopology &cellTopo, int cubatureDegree, bool createSideCacheToo=false);
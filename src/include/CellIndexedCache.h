@@ -0,0 +1,113 @@
+//
+//  CellIndexedCache.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_CellIndexedCache_h
+#define Camellia_CellIndexedCache_h
+
+#include <deque>
+#include <vector>
+
+#include "TypeDefs.h"
+
+namespace Camellia
+{
+//! CellIndexedCache: per-cell storage of values, indexed directly by cellID.
+/*!
+ Cell IDs in a MeshTopology are dense, so a lookup is an index into a flat array of slots rather than a search
+ through a tree of cellIDs.  Values are stored contiguously in a std::deque, so that references to stored values
+ remain valid as other cells are added.  The slots of erased cells are reused by subsequent insertions.
+ */
+template<class T>
+class CellIndexedCache
+{
+  std::vector<int> _slotForCell; // -1 for cells without an entry
+  std::deque<T> _values;
+  std::vector<int> _freeSlots;
+  int _size = 0;
+public:
+  // ! returns a pointer to the value for the cell, or NULL if there is none
+  T* find(GlobalIndexType cellID)
+  {
+    if (cellID >= _slotForCell.size()) return NULL;
+    int slot = _slotForCell[cellID];
+    return (slot == -1) ? NULL : &_values[slot];
+  }
+
+  bool contains(GlobalIndexType cellID) const
+  {
+    return (cellID < _slotForCell.size()) && (_slotForCell[cellID] != -1);
+  }
+
+  // ! returns the value for the cell, inserting a default-constructed value if there is none
+  T& operator[](GlobalIndexType cellID)
+  {
+    T* value = find(cellID);
+    if (value != NULL) return *value;
+
+    if (cellID >= _slotForCell.size()) _slotForCell.resize(cellID + 1, -1);
+    int slot;
+    if (_freeSlots.size() > 0)
+    {
+      slot = _freeSlots.back();
+      _freeSlots.pop_back();
+    }
+    else
+    {
+      slot = _values.size();
+      _values.push_back(T());
+    }
+    _slotForCell[cellID] = slot;
+    _size++;
+    return _values[slot];
+  }
+
+  // ! stores a copy of value for the cell, replacing any existing value; returns a reference to the stored value
+  T& insert(GlobalIndexType cellID, const T &value)
+  {
+    T* storedValue = &(*this)[cellID];
+    *storedValue = value;
+    return *storedValue;
+  }
+
+  void erase(GlobalIndexType cellID)
+  {
+    if (!contains(cellID)) return;
+    int slot = _slotForCell[cellID];
+    _values[slot] = T(); // release the value's storage now
+    _freeSlots.push_back(slot);
+    _slotForCell[cellID] = -1;
+    _size--;
+  }
+
+  void clear()
+  {
+    _slotForCell.clear();
+    _values.clear();
+    _freeSlots.clear();
+    _size = 0;
+  }
+
+  // ! the number of cells with entries
+  int size() const
+  {
+    return _size;
+  }
+
+  // ! the cells with entries, in increasing order
+  std::vector<GlobalIndexType> cellIDs() const
+  {
+    std::vector<GlobalIndexType> cellIDs;
+    cellIDs.reserve(_size);
+    for (GlobalIndexType cellID=0; cellID<_slotForCell.size(); cellID++)
+    {
+      if (_slotForCell[cellID] != -1) cellIDs.push_back(cellID);
+    }
+    return cellIDs;
+  }
+};
+}
+
+#endif
@@ -0,0 +1,64 @@
+//
+//  CellSpatialIndex.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_CellSpatialIndex_h
+#define Camellia_CellSpatialIndex_h
+
+#include "TypeDefs.h"
+
+#include "Intrepid_FieldContainer.hpp"
+
+#include <map>
+#include <vector>
+
+namespace Camellia
+{
+  //! CellSpatialIndex: a uniform-grid index of cell bounding boxes, used by MeshTopology for point location.
+  /*!
+   Each cell is recorded in every grid bin its (slightly padded) axis-aligned bounding box overlaps.  A query returns
+   the cells whose bounding boxes contain the point; callers must still perform an exact inclusion test.  Points and
+   boxes outside the grid's domain are clamped to the boundary bins, so the index remains correct (if less selective)
+   for cells that extend beyond the domain the grid was sized for.
+
+   Cells whose geometry is not bounded by their vertices (e.g. those with curved edges) may be inserted as "unbounded";
+   such cells are returned as candidates for every query.
+   */
+  class CellSpatialIndex
+  {
+    int _spaceDim;
+    std::vector<double> _domainMin, _binWidth;
+    std::vector<int> _binCounts; // in each dimension
+    double _padding;
+    
+    std::vector< std::vector<IndexType> > _bins;
+    std::map<IndexType, std::vector<double> > _cellBoxes; // (min_0, ..., min_{d-1}, max_0, ..., max_{d-1})
+    std::vector<IndexType> _unboundedCells;
+    
+    int binCoordinate(double x, int d) const;
+    void binRange(const std::vector<double> &box, std::vector<int> &binMin, std::vector<int> &binMax) const;
+    template<class F>
+    void forEachBin(const std::vector<double> &box, F f);
+  public:
+    // ! domainMin, domainMax: the extent of the region to be indexed; targetCellsPerBin: used with cellCountEstimate to size the grid.
+    CellSpatialIndex(const std::vector<double> &domainMin, const std::vector<double> &domainMax, int cellCountEstimate,
+                     double targetCellsPerBin = 2.0);
+    
+    // ! cellVertices should have shape (numVertices, spaceDim)
+    void insertCell(IndexType cellID, const Intrepid::FieldContainer<double> &cellVertices);
+    void insertUnboundedCell(IndexType cellID);
+    void removeCell(IndexType cellID);
+    
+    // ! fills candidates with the cells whose bounding boxes contain the point (of length spaceDim)
+    void candidateCells(const double* point, std::vector<IndexType> &candidates) const;
+    
+    int binCount() const;
+    int cellCount() const;
+  };
+  
+  typedef Teuchos::RCP<CellSpatialIndex> CellSpatialIndexPtr;
+}
+
+#endif
@@ -24,6 +24,7 @@ public:
   string displayString();
   bool isZero();
   void values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache);
+  int compile(FunctionProgram &program);
   void scalarMultiplyFunctionValues(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache);
   void scalarDivideFunctionValues(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache);
   void scalarMultiplyBasisValues(Intrepid::FieldContainer<double> &basisValues, BasisCachePtr basisCache);
@@ -29,6 +29,9 @@
 // Camellia includes:
 #include "CellTopology.h"
 
+#include <map>
+#include <vector>
+
 namespace Camellia
 {
 
@@ -67,9 +70,46 @@ public:
   Teuchos::RCP<Intrepid::Cubature<double> > create(CellTopoPtr cellTopo, std::vector<int> cubDegree);
   //@}
 
+  //@{ \name Cached cubature points and weights
+
+  //! Fills cubPoints (P,D) and cubWeights (P) with the points and weights of the cubature that create(cellTopo, cubDegree) would construct.
+  /*!
+   Points and weights are computed once per (topology key, degree) and stored in a process-wide cache; subsequent
+   requests copy them from the cache.  Safe to call from multiple OpenMP threads.  If the topology admits no cubature
+   (e.g. a zero-dimensional topology), the containers are sized to have zero points.
+   */
+  static void getCubature(CellTopoPtr cellTopo, int cubDegree,
+                          Intrepid::FieldContainer<double> &cubPoints, Intrepid::FieldContainer<double> &cubWeights);
+
+  //! As above, with cubature degree that may vary according to dimension; see create(CellTopoPtr, std::vector<int>).
+  static void getCubature(CellTopoPtr cellTopo, const std::vector<int> &cubDegree,
+                          Intrepid::FieldContainer<double> &cubPoints, Intrepid::FieldContainer<double> &cubWeights);
+
+  //! Number of getCubature() requests satisfied from the cache.
+  static long long cacheHitCount();
+  //! Number of getCubature() requests that required a cubature to be constructed.
+  static long long cacheMissCount();
+  //! Empties the cache and resets the hit and miss counts.  Takes the same lock as getCubature(), so may be called while other threads use the cache.
+  static void clearCache();
+  //@}
+
 private:
   Intrepid::DefaultCubatureFactory<double> _cubFactory;
 
+  struct CachedCubature
+  {
+    Intrepid::FieldContainer<double> points;
+    Intrepid::FieldContainer<double> weights;
+  };
+
+  // key: (topology key, degrees); the uniform-degree variant stores its degree as a single entry, the per-dimension variant prepends -1
+  typedef std::pair<CellTopologyKey, std::vector<int> > CubatureKey;
+  static std::map<CubatureKey, CachedCubature> _cubatureCache;
+  static long long _cacheHitCount, _cacheMissCount;
+
+  static void getCachedCubature(CellTopoPtr cellTopo, const CubatureKey &key, const std::vector<int> &cubDegree,
+                                Intrepid::FieldContainer<double> &cubPoints, Intrepid::FieldContainer<double> &cubWeights);
+
 }; // class CubatureFactory
 
 } // namespace Camellia
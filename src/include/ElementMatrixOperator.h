@@ -0,0 +1,102 @@
+//
+//  ElementMatrixOperator.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_ElementMatrixOperator_h
+#define Camellia_ElementMatrixOperator_h
+
+#include "TypeDefs.h"
+
+#include "Epetra_CrsMatrix.h"
+#include "Epetra_Import.h"
+#include "Epetra_Map.h"
+#include "Epetra_MultiVector.h"
+#include "Epetra_Operator.h"
+#include "Epetra_Vector.h"
+
+#include <vector>
+
+namespace Camellia
+{
+//! ElementMatrixOperator: a global stiffness operator stored as the unassembled sum of dense blocks.
+/*!
+ Each block is a dense matrix with global row and column indices -- typically one cell's interpreted stiffness matrix,
+ as handed to the global matrix by Solution during assembly.  Apply() imports the input onto the rank's overlapped
+ (column) map, multiplies each block into an overlapped result, and exports that with Add.  Storage is therefore the
+ sum of the block sizes, rather than the assembled matrix's rows times its (wider) coupling stencil.
+
+ Blocks are added with sumIntoGlobalValues() until fillComplete() is called.  Dirichlet rows may then be set: their
+ rows and columns act as if zeroed, with a unit diagonal, as ML_Epetra::Apply_OAZToMatrix() does for assembled matrices.
+
+ galerkinProduct() forms P^T A P block by block, so that a multigrid hierarchy can be built without assembling A.
+ */
+class ElementMatrixOperator : public Epetra_Operator
+{
+  Epetra_Map _rowMap;
+  Teuchos::RCP<Epetra_Map> _overlapMap; // every index referenced by a block on this rank
+  Teuchos::RCP<Epetra_Import> _importer; // _rowMap -> _overlapMap
+
+  struct Block
+  {
+    int numRows, numCols;
+    size_t rowOffset, colOffset, valueOffset; // into _indices (rows, then columns) and _values (row-major)
+  };
+  std::vector<Block> _blocks;
+  std::vector<GlobalIndexTypeToCast> _indices; // global indices until fillComplete(), overlap-map LIDs after
+  std::vector<double> _values;
+
+  std::vector<int> _dirichletOverlapLIDs, _dirichletRowLIDs;
+  bool _filled = false;
+  bool _useTranspose = false;
+
+  mutable Teuchos::RCP<Epetra_MultiVector> _overlapX, _overlapY; // reused across Apply() calls
+
+  void checkFilled(bool expected) const;
+public:
+  // ! rowMap: the distribution of the global dofs; it is both the domain and the range map of the operator.
+  ElementMatrixOperator(const Epetra_Map &rowMap);
+
+  // ! adds a dense block with row-major values.  Rows need not be owned by this rank.
+  void sumIntoGlobalValues(int numRows, const GlobalIndexTypeToCast* rows, int numCols, const GlobalIndexTypeToCast* cols,
+                           const double* values);
+
+  // ! builds the overlapped map and the importer, and converts stored indices to local indices.  Collective.
+  void fillComplete();
+  bool filled() const;
+
+  // ! indices must be owned by this rank; zeroes the rows and columns for these (and any previously set) Dirichlet
+  // ! indices, and puts a one on the diagonal.  Collective; requires fillComplete().
+  void setDirichletRows(int numRows, const GlobalIndexTypeToCast* rows);
+
+  // ! the operator's diagonal, distributed according to the row map.  Collective.
+  int ExtractDiagonalCopy(Epetra_Vector &diagonal) const;
+
+  // ! computes P^T A P, with P's DomainMap() as its row map (as EpetraExt::MatrixMatrix::Multiply() would), importing the
+  // ! rows of P required by this rank's blocks.  P's row map must match this operator's row map.  Collective.
+  Teuchos::RCP<Epetra_CrsMatrix> galerkinProduct(const Epetra_CrsMatrix &P) const;
+
+  // ! number of blocks stored on this rank
+  int numBlocks() const;
+
+  // ! bytes used on this rank by the stored blocks and the overlapped vectors
+  size_t memoryUsed() const;
+
+  //! @name Epetra_Operator interface
+  //@{
+  int SetUseTranspose(bool UseTranspose);
+  int Apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const;
+  int ApplyInverse(const Epetra_MultiVector& X, Epetra_MultiVector& Y) const; // not supported: returns -1
+  double NormInf() const; // not supported
+  const char * Label() const;
+  bool UseTranspose() const;
+  bool HasNormInf() const;
+  const Epetra_Comm & Comm() const;
+  const Epetra_Map & OperatorDomainMap() const;
+  const Epetra_Map & OperatorRangeMap() const;
+  //@}
+};
+}
+
+#endif
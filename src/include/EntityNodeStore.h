@@ -0,0 +1,66 @@
+//
+//  EntityNodeStore.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_EntityNodeStore_h
+#define Camellia_EntityNodeStore_h
+
+#include "TypeDefs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace Camellia
+{
+  //! EntityNodeStore: compact storage for the (sorted) vertex lists of MeshTopology entities of a single dimension.
+  /*!
+   Node lists are stored in compressed-row (CSR) form: one contiguous array of vertex indices, together with an offsets
+   array.  Lookup from node list to entity index is provided by an open-addressing hash table whose slots hold only
+   entity indices; keys are read back from the CSR arrays, so each node list is stored exactly once.
+
+   Entities are append-only.  An entity may be added without being made findable (MeshTopology does this for vertices
+   that are identified with other vertices via periodic BCs).
+   */
+  class EntityNodeStore
+  {
+    std::vector<IndexType> _nodeOffsets; // entity i's nodes are _nodes[_nodeOffsets[i]] ... _nodes[_nodeOffsets[i+1]-1]
+    std::vector<IndexType> _nodes;
+    
+    std::vector<IndexType> _slots; // hash table of entity indices; -1 marks an empty slot.  Size is zero or a power of two.
+    IndexType _indexedCount;
+    
+    static size_t hashNodes(const IndexType* nodes, int nodeCount);
+    bool nodesMatch(IndexType entityIndex, const IndexType* nodes, int nodeCount) const;
+    void insertIntoSlots(IndexType entityIndex);
+    void rehash(size_t slotCount);
+  public:
+    EntityNodeStore();
+    
+    // ! appends an entity with the provided (sorted) nodes, and returns its index.  If findable is true, find() will locate it.
+    IndexType addEntity(const std::vector<IndexType> &sortedNodes, bool findable = true);
+    
+    // ! makes a previously added entity findable
+    void makeFindable(IndexType entityIndex);
+    
+    // ! returns the index of the findable entity with the provided (sorted) nodes, or -1 if there is none
+    IndexType find(const std::vector<IndexType> &sortedNodes) const;
+    
+    IndexType size() const;
+    
+    // ! returns the number of entities that are findable
+    IndexType findableCount() const;
+    
+    int nodeCount(IndexType entityIndex) const;
+    const IndexType* nodes(IndexType entityIndex) const;
+    std::vector<IndexType> nodeVector(IndexType entityIndex) const;
+    
+    // ! approximate memory used by the CSR node arrays, in bytes
+    long long approximateNodeStorageFootprint() const;
+    // ! approximate memory used by the hash table, in bytes
+    long long approximateLookupFootprint() const;
+  };
+}
+
+#endif
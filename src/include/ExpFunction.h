@@ -18,6 +18,7 @@ class Exp_x : public SimpleFunction<double>
 {
 public:
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -28,6 +29,7 @@ class Exp_y : public SimpleFunction<double>
 {
 public:
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -38,6 +40,7 @@ class Exp_z : public SimpleFunction<double>
 {
 public:
   double value(double x, double y, double z);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -50,6 +53,7 @@ class Exp_ax : public SimpleFunction<double>
 public:
   Exp_ax(double a);
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   std::string displayString();
@@ -61,6 +65,7 @@ class Exp_ay : public SimpleFunction<double>
 public:
   Exp_ay(double a);
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   string displayString();
@@ -74,6 +79,7 @@ public:
   double value(double x, double t);
   double value(double x, double y, double t);
   double value(double x, double y, double z, double t);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -14,6 +14,7 @@
 
 #include "Intrepid_FieldContainer.hpp"
 
+#include <map>
 #include <string>
 
 using namespace std;
@@ -27,11 +28,17 @@ private:
   enum FunctionModificationType { MULTIPLY, DIVIDE }; // private, used by scalarModify[.*]Values
   
   Scalar evaluateAtMeshPoint(MeshPtr mesh, GlobalIndexType cellID, Intrepid::FieldContainer<double> &physicalPoint);
+
+  std::map<int, FunctionProgramPtr> _compiledPrograms; // keys are spaceDim; null programs for functions that don't compile
 protected:
   int _rank;
   string _displayString; // this is here mostly for identifying functions in the debugger
   void CHECK_VALUES_RANK(Intrepid::FieldContainer<Scalar> &values); // throws exception on bad values rank
   double _time;
+
+  // ! If FunctionProgram::useCompiledEvaluation() is true and this function compiles (see compile()), fills values using
+  // ! the compiled program, and returns true.  Otherwise, returns false, leaving values untouched.
+  bool compiledValues(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache);
 public:
   TFunction();
   TFunction(int rank);
@@ -57,6 +64,11 @@ public:
 
   static TFunctionPtr<Scalar> op(TFunctionPtr<Scalar> f, Camellia::EOperator op);
 
+  // ! Adds instructions computing this scalar function's values to program, and returns the register that holds them
+  // ! (see FunctionProgram).  Returns -1 (the default) if this function has no such expression; it is then evaluated
+  // ! with values(), as a leaf of the program.
+  virtual int compile(FunctionProgram &program);
+
   virtual TFunctionPtr<Scalar> x();
   virtual TFunctionPtr<Scalar> y();
   virtual TFunctionPtr<Scalar> z();
@@ -0,0 +1,121 @@
+//
+//  FunctionProgram.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_FunctionProgram_h
+#define Camellia_FunctionProgram_h
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "TypeDefs.h"
+
+#include "Intrepid_FieldContainer.hpp"
+
+namespace Camellia
+{
+  //! FunctionProgram: a scalar Function expression tree, flattened into a list of instructions.
+  /*!
+   Evaluating an expression such as (u * u + v * v) / (2.0 * rho) through values() allocates a FieldContainer at every
+   node of the tree, and evaluates each operand over all the points before combining them.  A FunctionProgram instead
+   holds one instruction per distinct subexpression -- arithmetic, coordinates, constants, and the elementary functions
+   of the trig, exponential, and monomial Function classes -- and runs the instructions over blocks of points, with
+   registers that are reused across blocks and evaluations.
+
+   A Function that cannot be expressed this way (e.g. a solution Function) enters the program as a leaf: its values()
+   are computed once per evaluation, into a buffer the instructions read from.  Subexpressions are shared (hash-consed)
+   as they are added, so a leaf that appears several times in the tree is evaluated once, and constant subexpressions
+   are folded.
+
+   Functions describe themselves to the program by overriding TFunction::compile().  The sum, product, quotient,
+   composed, square root, and min/max Functions evaluate through a FunctionProgram (compiled on first use, for each
+   spatial dimension) when their expression contains anything more than a single leaf; see TFunction::compiledValues().
+   */
+  class FunctionProgram
+  {
+  public:
+    enum OpCode
+    {
+      CONSTANT,
+      COORDINATE, // coordinate _d_ of the physical points
+      LEAF,       // values of a Function that does not compile
+      ADD,
+      SUBTRACT,
+      MULTIPLY,
+      DIVIDE,
+      MIN,
+      MAX,
+      POWER,      // integer power
+      SQRT,
+      SIN,        // sin(a * arg + b); likewise for the ops that follow
+      COS,
+      EXP,
+      ARCTAN
+    };
+  private:
+    struct Instruction
+    {
+      OpCode op;
+      int arg1, arg2; // registers; for COORDINATE, arg1 is the coordinate; for LEAF, the leaf ordinal; for POWER, arg2 is the exponent
+      double a, b;    // for CONSTANT, a is the value; for the elementary functions, the argument is a * arg1 + b
+    };
+    typedef std::tuple<int,int,int,double,double> InstructionKey;
+
+    int _spaceDim;
+    std::vector<Instruction> _instructions; // instruction i writes register i; arguments precede the instructions using them
+    std::vector<TFunctionPtr<double>> _leaves;
+    std::map<InstructionKey, int> _instructionRegisters;
+    std::map<TFunction<double>*, int> _functionRegisters; // functions already added (outside compositions)
+    std::vector<TFunctionPtr<double>> _compiledFunctions;
+    std::vector<std::vector<int>> _coordinateSubstitutions; // stack, used while compiling the outer function of a composition
+    int _result = -1;
+
+    int addInstruction(OpCode op, int arg1, int arg2, double a, double b);
+    bool isConstant(int reg) const;
+    void finalize(int resultRegister); // drops instructions the result does not depend on
+
+    static bool _useCompiledEvaluation;
+  public:
+    // ! spaceDim: the dimension of the physical points the program will be evaluated at (for space-time, includes time)
+    FunctionProgram(int spaceDim);
+
+    int spaceDim() const;
+
+    //! @name Program construction
+    //  Each method returns the register holding the result, or -1 if it cannot be computed.  Arguments of -1 propagate.
+    //@{
+    // ! adds the scalar function f, using f->compile(); if f does not compile, it is added as a leaf.  Returns -1 if f is
+    // ! not scalar, or if it would be a leaf within the outer function of a composition (where it would need to be
+    // ! evaluated at points other than the BasisCache's).
+    int add(TFunctionPtr<double> f);
+    int constant(double value);
+    // ! coordinate d of the points (d = spaceDim - 1 is time in a space-time context); -1 if d >= spaceDim.
+    int coordinate(int d);
+    int binary(OpCode op, int arg1, int arg2);
+    int power(int arg, int n);
+    // ! SQRT, or an elementary function of the affine argument a * arg + b
+    int unary(OpCode op, int arg, double a = 1.0, double b = 0.0);
+    // ! adds f evaluated at the point whose coordinates are in the specified registers
+    int composed(TFunctionPtr<double> f, const std::vector<int> &coordinateRegisters);
+    //@}
+
+    // ! values should have dimensions (C,P), matching the BasisCache's physical cubature points (C,P,D), with D = spaceDim().
+    void evaluate(Intrepid::FieldContainer<double> &values, BasisCachePtr basisCache);
+
+    int numInstructions() const;
+    int numLeaves() const;
+
+    // ! compiles the scalar function f for points of dimension spaceDim.  Returns null if f is not scalar, or if it compiles
+    // ! to a single leaf -- that is, if f itself does not compile.
+    static FunctionProgramPtr compile(TFunction<double>* f, int spaceDim);
+
+    // ! When true (the default), Functions that support it evaluate their values through a compiled FunctionProgram.
+    static void setUseCompiledEvaluation(bool value);
+    static bool useCompiledEvaluation();
+  };
+}
+
+#endif
@@ -12,7 +12,9 @@
 #include "TypeDefs.h"
 
 #include <iostream>
+#include <unordered_map>
 
+#include "CellIndexedCache.h"
 #include "GlobalDofAssignment.h"
 
 #include "LocalDofMapper.h"
@@ -94,6 +96,23 @@ struct CellConstraints
   Teuchos::RCP<CellConstraints> spatialSliceConstraints;
 };
 
+//! GlobalDofRenumbering: how a rebuild of the GDAMinimumRule lookups renumbered the global dofs owned by the local partition.
+/*!
+ Each cell's owned dofs are numbered contiguously.  A cell whose owned dofs are unchanged by the rebuild contributes one run:
+ the old global dof indices [oldOffsets[i], oldOffsets[i] + dofCounts[i]) are now [newOffsets[i], newOffsets[i] + dofCounts[i]).
+ Cells in the local partition whose owned dofs were assigned afresh (refined cells and their constraint neighborhood, and
+ cells that have moved between partitions) are listed in cellsWithNewDofs.
+ */
+struct GlobalDofRenumbering
+{
+  int oldNumberingVersion = -1;
+  int newNumberingVersion = -1;
+  vector<GlobalIndexType> oldOffsets;
+  vector<GlobalIndexType> newOffsets;
+  vector<GlobalIndexType> dofCounts;
+  set<GlobalIndexType> cellsWithNewDofs;
+};
+
 class GDAMinimumRule : public GlobalDofAssignment
 {
   bool _checkConstraintConsistency = false;
@@ -118,12 +137,39 @@ class GDAMinimumRule : public GlobalDofAssignment
 
   bool _allowCascadingConstraints = false;
   
-  map< GlobalIndexType, CellConstraints > _constraintsCache;
-  map< GlobalIndexType, LocalDofMapperPtr > _dofMapperCache;
-  map< GlobalIndexType, map<int, map<int, LocalDofMapperPtr> > > _dofMapperForVariableOnSideCache; // cellID --> side --> variable --> LocalDofMapper
-  map< GlobalIndexType, SubCellDofIndexInfo> _ownedGlobalDofIndicesCache; // (cellID --> SubCellDofIndexInfo)
-  map< GlobalIndexType, SubCellDofIndexInfo> _globalDofIndicesForCellCache; // (cellID --> SubCellDofIndexInfo) -- this has a lot of overlap in its data with the _ownedGlobalDofIndicesCache; could save some memory by only storing the difference
-  map< pair<GlobalIndexType,pair<int,unsigned>>, set<GlobalIndexType>> _fittableGlobalIndicesCache; // keys: (cellID,(varID,sideOrdinal))
+  // the dofs a cell owns, numbered relative to the cell's first owned dof.  These depend only on the cell constraints and
+  // element types, so they persist across rebuilds of the lookups, and are erased along with the cell's constraints.
+  struct OwnedDofLayout
+  {
+    SubCellDofIndexInfo dofIndices;
+    GlobalIndexType fieldDofCount = 0, fluxDofCount = 0, traceDofCount = 0;
+    int numberingVersion = -1; // the numbering in which the cell's owned dofs began at globalDofOffset
+    GlobalIndexType globalDofOffset = 0;
+  };
+  CellIndexedCache< OwnedDofLayout > _ownedDofLayoutCache;
+  OwnedDofLayout computeOwnedDofLayout(GlobalIndexType cellID);
+  
+  int _dofNumberingVersion = 0; // incremented by each rebuild of the lookups
+  GlobalDofRenumbering _dofRenumbering;
+  
+  CellIndexedCache< CellConstraints > _constraintsCache;
+  CellIndexedCache< LocalDofMapperPtr > _dofMapperCache;
+  CellIndexedCache< map< pair<int,int>, LocalDofMapperPtr > > _dofMapperForVariableOnSideCache; // cellID --> (side, variable) --> LocalDofMapper
+  CellIndexedCache< SubCellDofIndexInfo > _ownedGlobalDofIndicesCache; // (cellID --> SubCellDofIndexInfo)
+  CellIndexedCache< SubCellDofIndexInfo > _globalDofIndicesForCellCache; // (cellID --> SubCellDofIndexInfo) -- this has a lot of overlap in its data with the _ownedGlobalDofIndicesCache; could save some memory by only storing the difference
+  CellIndexedCache< map< pair<int,unsigned>, set<GlobalIndexType> > > _fittableGlobalIndicesCache; // cellID --> (varID,sideOrdinal) --> fittable global indices
+
+  // constraints depend only on the topology and the element types, so refinements invalidate just the affected cells' entries;
+  // when this is true, rebuildLookups() keeps the remaining entries
+  bool _constraintsCacheUpdatedIncrementally = false;
+  
+  // constraint matrices for sub-basis maps, shared by all the dof mappers that use them.  Keys are hashes of the matrix entries.
+  std::unordered_multimap< size_t, Teuchos::RCP<const Intrepid::FieldContainer<double>> > _sharedConstraintMatrices;
+  Teuchos::RCP<const Intrepid::FieldContainer<double>> sharedConstraintMatrix(const Intrepid::FieldContainer<double> &constraintMatrix);
+  
+  static bool constraintsReferToCells(const CellConstraints &constraints, const set<GlobalIndexType> &cellIDs);
+  void clearConstraintsCache(); // also clears the owned dof layouts, which depend on the constraints
+  void invalidateConstraints(const set<GlobalIndexType> &changedCellIDs); // erases cached constraints that may depend on the changed cells
   
   vector<unsigned> allBasisDofOrdinalsVector(int basisCardinality);
 
@@ -159,7 +205,7 @@ public:
   BasisMap getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo& dofOwnershipInfo, VarPtr var);
   BasisMap getBasisMap(GlobalIndexType cellID, SubCellDofIndexInfo& dofOwnershipInfo, VarPtr var, int sideOrdinal);
   
-  CellConstraints getCellConstraints(GlobalIndexType cellID);
+  CellConstraints & getCellConstraints(GlobalIndexType cellID);
   LocalDofMapperPtr getDofMapper(GlobalIndexType cellID, CellConstraints &constraints, int varIDToMap = -1, int sideOrdinalToMap = -1);
   SubCellDofIndexInfo& getGlobalDofIndices(GlobalIndexType cellID, CellConstraints &cellConstraints);
   set<GlobalIndexType> getGlobalDofIndicesForIntegralContribution(GlobalIndexType cellID, int sideOrdinal); // assuming an integral is being done over the whole mesh skeleton, returns either an empty set or the global dof indices associated with the given side, depending on whether the cell "owns" the side for the purpose of such contributions.
@@ -189,11 +235,19 @@ public:
   void didPRefine(const set<GlobalIndexType> &cellIDs, int deltaP);
   void didHUnrefine(const set<GlobalIndexType> &parentCellIDs);
 
+  void setElementType(GlobalIndexType cellID, ElementTypePtr elemType);
+
   void didChangePartitionPolicy();
   
   ElementTypePtr elementType(GlobalIndexType cellID);
   GlobalIndexType globalDofCount();
   
+  // ! Describes how the most recent rebuild of the lookups renumbered the dofs owned by the local partition.
+  const GlobalDofRenumbering &dofRenumbering() const;
+  
+  // ! Incremented each time the lookups (and with them the global dof numbering) are rebuilt.
+  int dofNumberingVersion() const;
+  
   //!! Returns the global dof indices for the indicated cell.  Only guaranteed to provide correct values for cells that belong to the local partition.
   set<GlobalIndexType> globalDofIndicesForCell(GlobalIndexType cellID);
   
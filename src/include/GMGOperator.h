@@ -9,6 +9,7 @@
 #define __Camellia_debug__GMGOperator__
 
 #include "Epetra_Operator.h"
+#include "Epetra_Vector.h"
 
 #include "BasisReconciliation.h"
 #include "HDF5Exporter.h"
@@ -48,7 +49,8 @@ public:
     BLOCK_SYMMETRIC_GAUSS_SEIDEL,
     IFPACK_ADDITIVE_SCHWARZ,
     CAMELLIA_ADDITIVE_SCHWARZ,
-    NONE
+    NONE,
+    CHEBYSHEV
   };
   
   enum SmootherApplicationType
@@ -101,12 +103,22 @@ private:
   mutable map< pair< pair<int,int>, RefinementBranch >, LocalDofMapperPtr > _localCoefficientMap; // pair(fineH1Order,coarseH1Order)
 
   Epetra_CrsMatrix* _fineStiffnessMatrix;
+  ElementMatrixOperatorPtr _fineStiffnessOperator; // set in place of _fineStiffnessMatrix by setFineStiffnessOperator()
   
   mutable double _timeMapFineToCoarse, _timeMapCoarseToFine, _timeCoarseImport, _timeConstruction, _timeCoarseSolve, _timeLocalCoefficientMapConstruction, _timeComputeCoarseStiffnessMatrix, _timeProlongationOperatorConstruction,
       _timeSetUpSmoother, _timeUpdateCoarseOperator, _timeApplyFineStiffness, _timeApplySmoother; // totals over the life of the object
 
   mutable bool _haveSolvedOnCoarseMesh; // if this is true, then we can call resolve() instead of solve().
 
+  // ! Vectors reused across ApplyInverse() calls, so that applying the operator does not allocate.  Each is reallocated only
+  // ! when asked for with a different map or number of vectors; setFineStiffnessMatrix() sizes them for single-vector solves.
+  struct Workspace
+  {
+    Teuchos::RCP<Epetra_MultiVector> res, f, A_Y, B1_res, Y2, smootherTemp;
+  };
+  mutable Workspace _workspace;
+  static Epetra_MultiVector &workspaceVector(Teuchos::RCP<Epetra_MultiVector> &vector, const Epetra_BlockMap &map, int numVectors);
+
   MultigridStrategy _multigridStrategy;
   Teuchos::RCP<Epetra_CrsMatrix> _P; // prolongation operator
 
@@ -115,8 +127,20 @@ private:
   int _smootherApplicationCount; // default to 1, but 2 may often be a better choice (especially when doing more than 2 levels)
   Teuchos::RCP<Epetra_MultiVector> _smootherDiagonalWeight;
   bool _useSchwarzDiagonalWeight, _useSchwarzScalingWeight; // when true, will set _smootherWeight_sqrt and _smootherWeight during setUpSmoother()
+
+  int _chebyshevDegree, _chebyshevPowerIterations;
+  double _chebyshevEigenvalueRatio, _chebyshevMaxEigenvalue;
+  Teuchos::RCP<Epetra_Vector> _chebyshevInverseDiagonal; // D^-1 for the CHEBYSHEV smoother, which holds a pointer to it
   
   void reportTimings(StatisticChoice whichStat, bool sumAllOperators) const;
+
+  void sizeWorkspace(const Epetra_Map &fineMap);
+
+  // ! imports P^T A P (with the domain of P as its row map) to the coarse partition map, and hands it to the coarse solution
+  void setCoarseStiffnessFromGalerkinProduct(Teuchos::RCP<Epetra_CrsMatrix> PT_A_P);
+
+  // ! diagonal is the operator's diagonal; its inverse is stored in _chebyshevInverseDiagonal, which the smoother refers to
+  Teuchos::RCP<Ifpack_Preconditioner> chebyshevSmoother(const Epetra_Operator* fineOperator, const Epetra_Vector &diagonal);
   
   // ! private method; allows us to swap the fine and coarse roles in certain circumstances.
   Teuchos::RCP<Epetra_FECrsMatrix> constructProlongationOperator(Teuchos::RCP<DofInterpreter> coarseDofInterpreter,
@@ -333,6 +357,15 @@ public:
 
   // ! smoother weight vector (used for Camellia additive Schwarz; may be null in other cases)
   Teuchos::RCP<Epetra_MultiVector> getSmootherWeightVector();
+
+  // ! Degree of the Chebyshev polynomial (number of fine matrix applications per smoother application) used by the CHEBYSHEV smoother.  Default = 3.
+  void setChebyshevDegree(int degree);
+  // ! The CHEBYSHEV smoother targets the eigenvalues of D^-1 A in [lambdaMax / ratio, lambdaMax].  Default ratio = 30.
+  void setChebyshevEigenvalueRatio(double ratio);
+  // ! Number of power iterations used at setup to estimate lambdaMax for the CHEBYSHEV smoother.  Default = 10.
+  void setChebyshevPowerIterations(int iterations);
+  // ! Estimate of the maximum eigenvalue of D^-1 A computed during the last CHEBYSHEV smoother setup (-1 if none).
+  double getChebyshevMaxEigenvalueEstimate() const;
   
   void setLevelOfFill(int fillLevel);
   void setFillRatio(double fillRatio);
@@ -370,6 +403,11 @@ public:
   //! Set the fine stiffness matrix; calls computeCoarseStiffnessMatrix() and setUpSmoother()
   void setFineStiffnessMatrix(Epetra_CrsMatrix* fineStiffnessMatrix);
 
+  //! Set a fine stiffness that is stored as unassembled element matrices.  The coarse matrix is computed as P^T A P
+  //! element by element; coarser levels are assembled as usual.  Requires a CHEBYSHEV or NONE smoother, and that
+  //! fine and coarse roles not be swapped.
+  void setFineStiffnessOperator(ElementMatrixOperatorPtr fineStiffness);
+
   //! Returns the coarse operator applied in the coarse solve.
   Teuchos::RCP<GMGOperator> getCoarseOperator();
   
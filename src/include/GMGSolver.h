@@ -95,6 +95,9 @@ public:
   void setReturnErrorIfMaxItersReached(bool value);
 
   void setSmootherType(GMGOperator::SmootherChoice smootherType);
+
+  // ! The fine level then uses the element matrices directly; see GMGOperator::setFineStiffnessOperator().
+  void setMatrixFreeStiffness(ElementMatrixOperatorPtr stiffness);
   
   vector<int> getIterationCountLog();
   
@@ -0,0 +1,98 @@
+//
+//  GramMatrixCache.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_GramMatrixCache_h
+#define Camellia_GramMatrixCache_h
+
+#include <limits>
+#include <map>
+
+#include "TypeDefs.h"
+
+#include "Intrepid_FieldContainer.hpp"
+
+#include "RefinementObserver.h"
+
+namespace Camellia
+{
+  //! GramMatrixCache: per-cell storage of the Cholesky-factored test-space Gram (inner product) matrices.
+  /*!
+   When the inner product does not change between solves on a fixed mesh -- as is typical across Newton steps
+   and time steps -- the Gram matrix for each cell need only be integrated and factored once.  A GramMatrixCache
+   set on a BF (see TBF::setGramMatrixCache()) retains the factors computed during local stiffness determination.
+
+   Entries are keyed on cellID, and validated against the cell's test DofOrdering, the cubature degree used to integrate
+   the Gram matrix (which includes any cubature enrichment), the IP object, and an IP dependency fingerprint.  The cache registers itself as a RefinementObserver of its mesh, and discards
+   the entries for any cells that are h- or p-refined, or that leave the local partition.
+
+   If the IP depends on data that changes (e.g. a background flow in a graph norm for a nonlinear problem),
+   the caller is responsible for changing the fingerprint whenever that data changes; doing so discards all entries.
+   */
+  class GramMatrixCache : public RefinementObserver
+  {
+    struct Entry
+    {
+      const DofOrdering* testOrdering;
+      int cubatureDegree;
+      Intrepid::FieldContainer<double> choleskyFactor; // lower triangle, column-major (as produced by LAPACK's POTRF)
+    };
+    
+    MeshPtr _mesh; // weak RCP -- the mesh holds the BF, which holds this cache
+    const IP* _ip = NULL;
+    int _fingerprint = 0;
+    std::map<GlobalIndexType, Entry> _entries;
+    
+    size_t _memoryBudget; // in bytes
+    size_t _memoryUsed = 0;
+    
+    long long _hitCount = 0, _missCount = 0;
+    
+    // these do not take the lock; callers must hold it
+    void clearEntries();
+    void eraseEntry(GlobalIndexType cellID);
+  public:
+    // ! memoryBudgetInBytes: the maximum total size of the stored factors; once the budget is reached, further factors are not retained.
+    GramMatrixCache(MeshPtr mesh, size_t memoryBudgetInBytes = std::numeric_limits<size_t>::max());
+    ~GramMatrixCache();
+    
+    // ! if there is a valid entry for the indicated cell, copies its factor into choleskyFactor and returns true.  The copy is
+    // ! made while holding the cache's lock, since another thread may discard the entry at any time.  Changing the IP argument
+    // ! clears the cache.
+    bool getCholeskyFactor(GlobalIndexType cellID, const IP* ip, DofOrderingPtr testOrdering, int cubatureDegree,
+                           Intrepid::FieldContainer<double> &choleskyFactor);
+    
+    // ! stores a copy of the provided factor, provided that doing so does not exceed the memory budget
+    void storeCholeskyFactor(GlobalIndexType cellID, const IP* ip, DofOrderingPtr testOrdering, int cubatureDegree,
+                             const Intrepid::FieldContainer<double> &choleskyFactor);
+    
+    void clear();
+    
+    int ipDependencyFingerprint() const;
+    // ! Set to a new value whenever data on which the IP depends changes.  Changing the value clears the cache.
+    void setIPDependencyFingerprint(int value);
+    
+    Mesh* mesh() const;
+    
+    size_t memoryBudget() const;
+    size_t memoryUsed() const;
+    // ! true if factors totaling the indicated size would currently fit in the memory budget
+    bool hasRoomFor(size_t bytes);
+    void setMemoryBudget(size_t memoryBudgetInBytes);
+    
+    long long hitCount() const;
+    long long missCount() const;
+    
+    // RefinementObserver methods:
+    void didHRefine(MeshTopologyPtr meshToRefine, const set<GlobalIndexType> &cellIDs, Teuchos::RCP<RefinementPattern> refPattern);
+    void didHUnrefine(MeshTopologyPtr meshToRefine, const set<GlobalIndexType> &cellIDs);
+    void pRefine(const set<GlobalIndexType> &cellIDs);
+    void didRepartition(MeshTopologyPtr meshTopo);
+    
+    static Teuchos::RCP<GramMatrixCache> gramMatrixCache(MeshPtr mesh, size_t memoryBudgetInBytes = std::numeric_limits<size_t>::max());
+  };
+}
+
+#endif
@@ -41,15 +41,71 @@ private:
   set<double> _fieldTimeVals;
   set<double> _traceTimeVals;
 
+  int _numThreads;
+  int _cellBatchSize;
+  bool _useParallelHDF5;
+  bool _useSinglePrecision;
+  int _compressionLevel;
+
+  // physical points and function values for one exported cell; one entry per side for trace exports,
+  // a single entry for field exports.  Points are (1,P,D); values are (1,P) or (1,P,D).
+  struct CellExportValues
+  {
+    std::vector< Intrepid::FieldContainer<double> > physicalPoints;
+    std::vector< std::vector< Intrepid::FieldContainer<double> > > functionValues; // indexed [side][function]
+  };
+
+  void computeExportValues(std::vector<CellExportValues> &exportValues, const std::vector<TFunctionPtr<double>> &functions,
+                           const std::vector<GlobalIndexType> &cellIndices, const std::map<int, int> &cellIDToNum1DPts);
   void getPoints(Intrepid::FieldContainer<double> &points, CellTopoPtr cellTopo, int num1DPts);
 public:
+  // ! The contents of the files written by one exportFunction() call: the HDF5 datasets and this partition's XMF grid,
+  // ! and (on rank 0) the XMF collection files.  Produced by prepareExport(); written by writeExport().
+  struct ExportData
+  {
+    std::string h5FileName, xmfFileName; // full paths
+    std::string xmfContent; // this partition's grid
+    std::vector<std::string> datasetPaths; // Conns, Points, then one per function
+    std::vector<int> connArray;
+    std::vector<double> ptArray;
+    std::vector< std::vector<double> > valArrays;
+    std::vector<size_t> localSizes, localOffsets, globalSizes; // indexed as datasetPaths
+    bool useParallelHDF5;
+    bool useSinglePrecision;
+    int compressionLevel;
+    std::string fieldXmfFileName, fieldXmfContent; // empty unless this export updates the field collection
+    std::string traceXmfFileName, traceXmfContent; // empty unless this export updates the trace collection
+
+    size_t memoryFootprint() const; // approximate, in bytes
+  };
+
   HDF5Exporter(MeshPtr mesh, std::string outputDirName="output", std::string outputDirSuperPath = ".");
   ~HDF5Exporter();
   void setMesh(MeshPtr mesh)
   {
     _mesh = mesh;
   }
+
+  // Number of threads used to evaluate the exported functions (default 1).  Functions are evaluated in batches of cells
+  // sharing an element type; with more than one thread, the batches are distributed among threads.  Only use this
+  // when the exported functions may safely be evaluated concurrently.
+  void setNumThreads(int numThreads);
+  // Maximum number of cells evaluated together in a batch (default 64).
+  void setCellBatchSize(int cellBatchSize);
+  // When true, all ranks write collectively into one HDF5 file per export (requires a parallel HDF5 build);
+  // otherwise (the default), each rank writes its own file.
+  void setUseParallelHDF5(bool value);
+  // When true, points and function values are stored as 32-bit floats (default false).
+  void setUseSinglePrecision(bool value);
+  // gzip compression level (0-9) for the datasets; when nonzero, datasets are chunked and compressed (default 0).
+  void setCompressionLevel(int level);
+
   typedef std::map<int, int> map_int_int;
+
+  // the functions exportSolution() exports: one per field variable and one per trace variable of the mesh's bilinear form
+  void getSolutionFunctions(TSolutionPtr<double> solution, std::vector<TFunctionPtr<double>> &fieldFunctions,
+                            std::vector<std::string> &fieldFunctionNames, std::vector<TFunctionPtr<double>> &traceFunctions,
+                            std::vector<std::string> &traceFunctionNames);
   void exportFunction(TFunctionPtr<double> function, std::string functionName="function", double timeVal=0,
                       unsigned int defaultNum1DPts=4, map_int_int cellIDToNum1DPts=map_int_int(),
                       std::set<GlobalIndexType> cellIndices=std::set<GlobalIndexType>());
@@ -58,6 +114,14 @@ public:
                       std::set<GlobalIndexType> cellIndices=std::set<GlobalIndexType>());
   void exportSolution(TSolutionPtr<double> solution, double timeVal=0, unsigned int defaultNum1DPts=4,
                       map_int_int cellIDToNum1DPts=map_int_int(), set<GlobalIndexType> cellIndices=set<GlobalIndexType>());
+
+  // ! exportFunction() is writeExport(prepareExport(...)).  prepareExport() evaluates the functions, and does all the work
+  // ! that touches the mesh, the functions, or MPI; writeExport() only writes files (apart from the collective calls
+  // ! of parallel HDF5 output).
+  ExportData prepareExport(std::vector<TFunctionPtr<double>> functions, std::vector<std::string> functionNames, double timeVal=0,
+                           unsigned int defaultNum1DPts=4, map_int_int cellIDToNum1DPts=map_int_int(),
+                           std::set<GlobalIndexType> cellIndices=std::set<GlobalIndexType>());
+  void writeExport(const ExportData &exportData);
   void exportTimeSlab(TFunctionPtr<double> function, std::string functionName="function", double tInit=0, double tFinal=1, unsigned int numSlices=2,
                       unsigned int sliceH1Order=2, unsigned int defaultNum1DPts=4);
   void exportTimeSlab(std::vector<TFunctionPtr<double>> functions, std::vector<std::string> functionNames, double tInit=0, double tFinal=1, unsigned int numSlices=2,
@@ -27,6 +27,8 @@ class TIP
   std::vector< TLinearTermPtr<Scalar> > _zeroMeanTerms;
 
   bool _isLegacySubclass;
+
+  ReferenceIntegralCachePtr _referenceIntegralCache;
 protected:
   TBFPtr<Scalar> _bilinearForm; // for legacy subclasses (originally subclasses of DPGInnerProduct)
 public:
@@ -73,6 +75,11 @@ public:
 
   double computeMaxConditionNumber(DofOrderingPtr testSpace, BasisCachePtr basisCache);
 
+  ReferenceIntegralCachePtr referenceIntegralCache() const;
+  // ! Reference-cell integrals used for constant-coefficient terms on affine cells are retained here across calls to
+  // ! computeInnerProductMatrix(); each TIP creates one on construction.  Set to Teuchos::null to integrate them for each batch.
+  void setReferenceIntegralCache(ReferenceIntegralCachePtr referenceIntegralCache);
+
   // added by Nate
   TLinearTermPtr<Scalar> evaluate(const std::map< int, TFunctionPtr<Scalar>> &varFunctions);
   // added by Jesse
@@ -0,0 +1,44 @@
+//
+//  IntegrationKernels.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_IntegrationKernels_h
+#define Camellia_IntegrationKernels_h
+
+#include <vector>
+
+#include "Intrepid_FieldContainer.hpp"
+
+namespace Camellia
+{
+  //! IntegrationKernels: the innermost loops of local integration, over raw pointers.
+  /*!
+   The kernels work directly on the contiguous storage of their FieldContainer arguments, so that the reductions over
+   cubature points are unit-stride loops (which the compiler can vectorize) or BLAS GEMMs, rather than sequences of
+   multi-index operator() calls.  They take the cubature weights (BasisCache::getWeightedMeasures()) as an argument,
+   and apply them as they go, so that callers need not form weighted copies of the values.
+
+   TLinearTerm::integrate() uses these for its general (non-sum-factorized, non-affine) integrals; TBF and TIP use the
+   scatter into element matrices.
+   */
+  class IntegrationKernels
+  {
+  public:
+    // ! values (C,N) += weights (C,P) * fieldValues (C,F,P), summed over points; field f is summed into column dofIndices[f].
+    static void integrate(Intrepid::FieldContainer<double> &values, const Intrepid::FieldContainer<double> &fieldValues,
+                          const Intrepid::FieldContainer<double> &weights, const std::vector<int> &dofIndices);
+
+    // ! miniMatrix (C,F1,F2) = weights (C,P) * values1 (C,F1,P,...) * values2 (C,F2,P,...), summed over points and over
+    // ! any trailing (vector or tensor component) dimensions.  Computed as one GEMM per cell.
+    static void integrate(Intrepid::FieldContainer<double> &miniMatrix, const Intrepid::FieldContainer<double> &values1,
+                          const Intrepid::FieldContainer<double> &values2, const Intrepid::FieldContainer<double> &weights);
+
+    // ! values (C,N1,N2) += miniMatrix (C,F1,F2), with row i going to row rowDofIndices[i], column j to colDofIndices[j].
+    static void sumInto(Intrepid::FieldContainer<double> &values, const Intrepid::FieldContainer<double> &miniMatrix,
+                        const std::vector<int> &rowDofIndices, const std::vector<int> &colDofIndices);
+  };
+}
+
+#endif
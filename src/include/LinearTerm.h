@@ -51,17 +51,30 @@ class TLinearTerm
   static void integrate(Epetra_CrsMatrix *valuesCrsMatrix, Intrepid::FieldContainer<double> &valuesFC,
                         TLinearTermPtr<double> u, DofOrderingPtr uOrdering,
                         TLinearTermPtr<double> v, DofOrderingPtr vOrdering,
-                        BasisCachePtr basisCache, bool sumInto=true);
+                        BasisCachePtr basisCache, bool sumInto=true, ReferenceIntegralCache* refIntegralCache=NULL);
   static void integrate(Intrepid::FieldContainer<Scalar> &values,
                         TLinearTermPtr<Scalar> u, DofOrderingPtr uOrdering,
                         TLinearTermPtr<Scalar> v, DofOrderingPtr vOrdering,
                         BasisCachePtr basisCache, bool sumInto=true);
   static void multiplyFluxValuesByParity(Intrepid::FieldContainer<Scalar> &fluxValues, BasisCachePtr sideBasisCache);
+  // sum-factorized integration of the (uID, vID) block for space-time volume caches; returns false if the terms don't factor
+  static bool integrateSumFactorized(Intrepid::FieldContainer<double> &miniMatrix,
+                                     TLinearTermPtr<double> u, int uID, BasisPtr uBasis,
+                                     TLinearTermPtr<double> v, int vID, BasisPtr vBasis,
+                                     BasisCachePtr basisCache);
+  // integration of the (uID, vID) block on affine volume cells from reference-cell integrals, which are retained in
+  // refIntegralCache if it is not NULL; returns false if the terms aren't constant-coefficient H^1/L^2/H(div) terms, or
+  // if quadrature is expected to be cheaper
+  static bool integrateAffine(Intrepid::FieldContainer<double> &miniMatrix,
+                              TLinearTermPtr<double> u, int uID, BasisPtr uBasis,
+                              TLinearTermPtr<double> v, int vID, BasisPtr vBasis,
+                              BasisCachePtr basisCache, ReferenceIntegralCache* refIntegralCache);
 
   // poor man's templating: just provide both versions of the values argument, making the other version null or size 0
   void integrate(Epetra_CrsMatrix *valuesCrsMatrix, Intrepid::FieldContainer<double> &valuesFC, DofOrderingPtr thisDofOrdering,
                  TLinearTermPtr<double> otherTerm, DofOrderingPtr otherDofOrdering,
-                 BasisCachePtr basisCache, bool forceBoundaryTerm = false, bool sumInto = true);
+                 BasisCachePtr basisCache, bool forceBoundaryTerm = false, bool sumInto = true,
+                 ReferenceIntegralCache* refIntegralCache = NULL);
   void integrate(Epetra_CrsMatrix *valuesCrsMatrix, Intrepid::FieldContainer<double> &valuesFC, DofOrderingPtr thisDofOrdering,
                  TLinearTermPtr<double> otherTerm, VarPtr otherVarID, TFunctionPtr<double> fxn,
                  BasisCachePtr basisCache, bool forceBoundaryTerm = false);
@@ -105,9 +118,11 @@ public:
   // integrate into values FieldContainers:
   void integrate(Intrepid::FieldContainer<Scalar> &values, DofOrderingPtr thisOrdering,
                  BasisCachePtr basisCache, bool forceBoundaryTerm = false, bool sumInto = true);
+  // refIntegralCache: if not NULL, reference-cell integrals used on affine cells are retained there for later calls
   void integrate(Intrepid::FieldContainer<Scalar> &values, DofOrderingPtr thisDofOrdering,
                  TLinearTermPtr<Scalar> otherTerm, DofOrderingPtr otherDofOrdering,
-                 BasisCachePtr basisCache, bool forceBoundaryTerm = false, bool sumInto = true);
+                 BasisCachePtr basisCache, bool forceBoundaryTerm = false, bool sumInto = true,
+                 ReferenceIntegralCache* refIntegralCache = NULL);
   void integrate(Intrepid::FieldContainer<Scalar> &values, DofOrderingPtr thisDofOrdering,
                  TLinearTermPtr<Scalar> otherTerm, VarPtr otherVarID, TFunctionPtr<Scalar> fxn,
                  BasisCachePtr basisCache, bool forceBoundaryTerm = false);
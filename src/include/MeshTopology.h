@@ -13,6 +13,8 @@
 #include "Intrepid_FieldContainer.hpp"
 
 #include "Cell.h"
+#include "CellSpatialIndex.h"
+#include "EntityNodeStore.h"
 #include "EntitySet.h"
 #include "MeshGeometry.h"
 #include "MeshTopologyView.h"
@@ -43,15 +45,14 @@ class MeshTopology : public MeshTopologyView
   vector< PeriodicBCPtr > _periodicBCs;
   map<IndexType, set< pair<int, int> > > _periodicBCIndicesMatchingNode; // pair: first = index in _periodicBCs; second: 0 or 1, indicating first or second part of the identification matches.  IndexType is the vertex index.
   map< pair<IndexType, pair<int,int> >, IndexType > _equivalentNodeViaPeriodicBC;
-  map<IndexType, IndexType> _canonicalVertexPeriodic; // key is a vertex *not* in _knownEntities; the value is the matching vertex in _knownEntities
+  map<IndexType, IndexType> _canonicalVertexPeriodic; // key is a vertex that is *not* findable in _entities[0]; the value is the matching vertex that is
 
   // the following entity vectors are indexed on dimension of the entities
-  vector< vector< vector<IndexType> > > _entities; // vertices, edges, faces, solids, etc., up to dimension (_spaceDim - 1).  Innermost container is sorted by value of IndexType (nodes). The outer two indices are entityDim, entityIndex.
-  vector< map< vector<IndexType>, IndexType > > _knownEntities; // map keys are vectors of sorted vertex indices, values are entity indices in _entities[d]
+  vector< EntityNodeStore > _entities; // vertices, edges, faces, solids, etc., up to dimension (_spaceDim - 1), indexed by entityDim.  Each store holds the sorted vertex indices (nodes) of its entities, and maps sorted nodes back to entity index.
   vector< vector< vector<IndexType> > > _canonicalEntityOrdering;
   vector< vector< vector< pair<IndexType, unsigned> > > > _activeCellsForEntities; // inner vector entries are sorted (cellIndex, entityIndexInCell) (entityIndexInCell aka subcord)--I'm vascillating on whether this should contain entries for active ancestral cells.  Today, I think it should not.  I think we should have another set of activeEntities.  Things in that list either themselves have active cells or an ancestor that has an active cell.  So if your parent is inactive and you don't have any active cells of your own, then you know you can deactivate.
   vector< vector< vector<IndexType> > > _sidesForEntities; // vector indices: dimension d, entity index; innermost container stores entity indices of dimension _spaceDim-1 belonging to cells that contain the indicated entity, sorted by index.
-  map< IndexType, pair< pair<IndexType, unsigned>, pair<IndexType, unsigned> > > _cellsForSideEntities; // key: sideEntityIndex.  value.first is (cellIndex1, sideOrdinal1), value.second is (cellIndex2, sideOrdinal2).  On initialization, (cellIndex2, sideOrdinal2) == ((IndexType)-1,(IndexType)-1).
+  vector< pair< pair<IndexType, unsigned>, pair<IndexType, unsigned> > > _cellsForSideEntities; // index: sideEntityIndex.  value.first is (cellIndex1, sideOrdinal1), value.second is (cellIndex2, sideOrdinal2).  On initialization, (cellIndex2, sideOrdinal2) == ((IndexType)-1,(IndexType)-1); sides without cells have cellIndex1 == (IndexType)-1.
   set<IndexType> _boundarySides; // entities of dimension _spaceDim-1 on the mesh boundary
   vector< map< IndexType, vector< pair<IndexType, unsigned> > > > _parentEntities; // map from entity to its possible parents.  Not every entity has a parent.  We support entities having multiple parents.  Such things will be useful in the context of anisotropic refinements.  The pair entries here are (parentEntityIndex, refinementOrdinal), where the refinementOrdinal is the index into the _childEntities[d][parentEntityIndex] vector.
 
@@ -59,8 +60,8 @@ class MeshTopology : public MeshTopologyView
   vector< map< IndexType, vector< pair< RefinementPatternPtr, vector<IndexType> > > > > _childEntities; // map from parent to child entities, together with the RefinementPattern to get from one to the other.
   vector< vector< Camellia::CellTopologyKey > > _entityCellTopologyKeys;
 
-//  vector< CellPtr > _cells;
-  map<GlobalIndexType, CellPtr> _cells; // the cells known on this MPI rank.  Right now, all cells are stored on every rank; soon, this will not be true anymore.
+  vector< CellPtr > _cells; // indexed by cellIndex; null for cells not known on this MPI rank.  Right now, all cells are stored on every rank; soon, this will not be true anymore.
+  IndexType _knownCellCount; // number of non-null entries in _cells
 
   // these guys presently only support 2D:
   set< IndexType > _cellIDsWithCurves;
@@ -106,6 +107,12 @@ class MeshTopology : public MeshTopologyView
 
   // ! private method for deep-copying Cells during MeshToplogy::deepCopy()
   void deepCopyCells();
+  
+  CellSpatialIndexPtr _cellSpatialIndex; // index of active cells for point location; built on first use, maintained by refineCell(), and discarded when root cells or curves change
+  void addCellToSpatialIndex(IndexType cellIndex);
+  void buildCellSpatialIndex();
+  bool cellIsBoundedByVertices(IndexType cellIndex);
+  IndexType cellIDForPointByDescent(const vector<double> &point); // locates point by descending the refinement tree from the root cells
 public:
   MeshTopology(unsigned spaceDim, vector<PeriodicBCPtr> periodicBCs=vector<PeriodicBCPtr>());
   MeshTopology(MeshGeometryPtr meshGeometry, vector<PeriodicBCPtr> periodicBCs=vector<PeriodicBCPtr>());
@@ -145,6 +152,12 @@ public:
 
   bool cellContainsPoint(GlobalIndexType cellID, const std::vector<double> &point, int cubatureDegree);
   std::vector<IndexType> cellIDsForPoints(const Intrepid::FieldContainer<double> &physicalPoints);
+  
+  // ! For each point in physicalPoints (P,D), determines the active cell containing it (-1 if none) and the point's coordinates
+  // ! in that cell's reference frame, stored in refPoints (P,D).  Points are grouped by candidate cell, so that each cell's
+  // ! inverse map is computed once for all the points that might lie in it.
+  void cellIDsAndReferencePointsForPoints(const Intrepid::FieldContainer<double> &physicalPoints, std::vector<IndexType> &cellIDs,
+                                          Intrepid::FieldContainer<double> &refPoints);
 
   bool entityIsAncestor(unsigned d, IndexType ancestor, IndexType descendent);
   bool entityIsGeneralizedAncestor(unsigned ancestorDimension, IndexType ancestor,
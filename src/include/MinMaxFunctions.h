@@ -24,6 +24,7 @@ public:
   TFunctionPtr<double> z();
 
   void values(Intrepid::FieldContainer<double> &values, BasisCachePtr basisCache);
+  int compile(FunctionProgram &program);
   bool boundaryValueOnly();
 
   string displayString();
@@ -40,6 +41,7 @@ public:
   TFunctionPtr<double> z();
 
   void values(Intrepid::FieldContainer<double> &values, BasisCachePtr basisCache);
+  int compile(FunctionProgram &program);
   bool boundaryValueOnly();
 
   string displayString();
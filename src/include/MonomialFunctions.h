@@ -19,6 +19,7 @@ class Xn : public SimpleFunction<double>
 public:
   Xn(int n);
   double value(double x);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -32,6 +33,7 @@ class Yn : public SimpleFunction<double>
 public:
   Yn(int n);
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -45,6 +47,7 @@ class Zn : public SimpleFunction<double>
 public:
   Zn(int n);
   double value(double x, double y, double z);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -60,6 +63,7 @@ public:
   double value(double x, double t);
   double value(double x, double y, double t);
   double value(double x, double y, double z, double t);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
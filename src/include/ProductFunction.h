@@ -22,6 +22,7 @@ private:
 public:
   ProductFunction(TFunctionPtr<Scalar> f1, TFunctionPtr<Scalar> f2);
   void values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache);
+  int compile(FunctionProgram &program);
   virtual bool boundaryValueOnly();
 
   TFunctionPtr<Scalar> f1();
@@ -20,6 +20,7 @@ class QuotientFunction : public TFunction<Scalar>
 public:
   QuotientFunction(TFunctionPtr<Scalar> f, TFunctionPtr<Scalar> scalarDivisor);
   void values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache);
+  int compile(FunctionProgram &program);
   virtual bool boundaryValueOnly();
   TFunctionPtr<Scalar> dx();
   TFunctionPtr<Scalar> dy();
@@ -0,0 +1,75 @@
+//
+//  ReferenceIntegralCache.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_ReferenceIntegralCache_h
+#define Camellia_ReferenceIntegralCache_h
+
+#include <map>
+
+#include "TypeDefs.h"
+
+#include "Basis.h"
+
+#include "Intrepid_FieldContainer.hpp"
+
+namespace Camellia
+{
+  //! ReferenceIntegralCache: storage for reference-cell integrals of products of basis functions.
+  /*!
+   On affine cells, a constant-coefficient volume term is a per-cell linear combination of reference fields (e.g. the
+   reference value and the reference derivatives of an H^1 basis), so that its contribution to a local matrix is a
+   contraction of per-cell geometric factors with integrals over the reference cell (see TLinearTerm::integrate()).
+   Those reference integrals depend only on the two bases, the reference fields, and the cubature rule -- that is,
+   they are fixed for a given ElementType -- and a ReferenceIntegralCache retains them across cell batches.
+   TBF and TIP each hold one, used for stiffness and Gram matrix computations.
+
+   Entries are keyed on the bases, the reference field ordinals, and a fingerprint of the BasisCache's (current phase)
+   reference cubature points and weights.  Entries are never discarded except by clear(), so pointers returned by
+   integrals() remain valid until then.
+   */
+  class ReferenceIntegralCache
+  {
+  public:
+    struct Key
+    {
+      BasisPtr uBasis, vBasis; // held so that the Basis addresses in keys cannot be reused
+      int uField, vField;
+      int numPoints;
+      size_t cubatureFingerprint;
+
+      bool operator<(const Key &other) const;
+    };
+  private:
+    std::map<Key, Intrepid::FieldContainer<double> > _entries;
+    size_t _memoryUsed = 0;
+    long long _hitCount = 0, _missCount = 0;
+  public:
+    // ! key for the integrals of reference field uField of uBasis against reference field vField of vBasis, using the
+    // ! reference cubature points and weights of the (volume) basisCache
+    static Key key(BasisPtr uBasis, int uField, BasisPtr vBasis, int vField, BasisCachePtr basisCache);
+
+    // ! returns the stored integrals for the key, with dimensions (1, uCardinality, vCardinality), or NULL if there are none
+    const Intrepid::FieldContainer<double>* integrals(const Key &key);
+
+    // ! stores a copy of the integrals, and returns the stored copy.  If integrals for the key are already stored (e.g. by
+    // ! another thread), those are kept and returned instead.
+    const Intrepid::FieldContainer<double>* storeIntegrals(const Key &key, const Intrepid::FieldContainer<double> &integrals);
+
+    // ! discards all entries, taking the same lock as integrals() and storeIntegrals().  Pointers those returned are
+    // ! invalidated, so this must not be called while other threads are using the cache.
+    void clear();
+
+    int numEntries() const;
+    size_t memoryUsed() const;
+
+    long long hitCount() const;
+    long long missCount() const;
+
+    static Teuchos::RCP<ReferenceIntegralCache> referenceIntegralCache();
+  };
+}
+
+#endif
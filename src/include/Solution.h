@@ -42,6 +42,9 @@
 
 #include "Intrepid_FieldContainer.hpp"
 
+#include <functional>
+#include <limits>
+
 // Epetra includes
 #include <Epetra_Map.h>
 #ifdef HAVE_MPI
@@ -70,6 +73,8 @@ template <typename Scalar>
 {
 private:
   int _cubatureEnrichmentDegree;
+  int _numThreadsForLocalStiffness; // threads used to compute local stiffness matrices, residuals, and error representations
+  int _maxBatchSizeInBytes; // bounds the local matrix storage for each cell batch
   std::map< GlobalIndexType, Intrepid::FieldContainer<Scalar> > _solutionForCellIDGlobal; // eventually, replace this with a distributed _solutionForCellID
   std::map< GlobalIndexType, double > _energyErrorForCell; // now rank local
   std::map< GlobalIndexType, double > _energyErrorForCellGlobal;
@@ -93,6 +98,20 @@ private:
   Teuchos::RCP<Epetra_CrsMatrix> _globalStiffMatrix;
   Teuchos::RCP<Epetra_FEVector> _rhsVector;
   Teuchos::RCP<Epetra_FEVector> _lhsVector;
+  int _lhsVectorDofNumberingVersion = -1; // GDAMinimumRule dof numbering in which _lhsVector agrees with the cell coefficients; -1 if unknown
+
+  // sparsity of the last stiffness matrix assembled from scratch; later assemblies on the same dof numbering sum into it
+  Teuchos::RCP<Epetra_CrsGraph> _stiffnessGraph;
+  DofInterpreter* _stiffnessGraphDofInterpreter = NULL;
+  int _stiffnessGraphDofNumberingVersion = -1;
+  bool _reuseStiffnessGraph = true;
+  bool _stiffnessGraphIsStatic = false; // true while assembling into a matrix built on _stiffnessGraph
+  bool _stiffnessGraphMismatch = false; // set when an entry to be summed is not in _stiffnessGraph
+
+  GramMatrixCachePtr _gramMatrixCache; // set on the BF by setRetainGramFactorizations()
+
+  bool _useMatrixFreeStiffness = false;
+  ElementMatrixOperatorPtr _matrixFreeStiffness; // takes the place of _globalStiffMatrix when _useMatrixFreeStiffness is true
 
   TMatrixPtr<Scalar> _globalStiffMatrix2;
   TVectorPtr<Scalar> _rhsVector2;
@@ -133,6 +152,18 @@ private:
   static double conditionNumberEstimate( Epetra_LinearProblem & problem );
 
   void setGlobalSolutionFromCellLocalCoefficients();
+  void initializeLHSVectorForSolve(); // like initializeLHSVector(), but reuses the existing _lhsVector entries where the dof numbering allows
+  void addToGlobalStiffness(Epetra_FECrsMatrix* globalStiffness, int numRows, const GlobalIndexTypeToCast* rows,
+                            int numCols, const GlobalIndexTypeToCast* cols, const Scalar* values); // row-major values
+  void addToGlobalStiffnessRow(GlobalIndexTypeToCast row, int numEntries, Scalar* values, GlobalIndexTypeToCast* cols); // _globalStiffMatrix need not be an Epetra_FECrsMatrix
+
+  // ! Calls computeBatch for batches of rank-local cells that share an ElementType, with basisCache set up on the batch's cells;
+  // ! computeBatch fills values, sized (numCells, numTestDofs).  Batches run concurrently on up to numThreadsForLocalStiffness()
+  // ! threads; each cell's values are then stored, with dimensions (1, numTestDofs), in valuesForCell.
+  void computeTestValuesForCellBatches(std::map< GlobalIndexType, Intrepid::FieldContainer<double> > &valuesForCell,
+                                       bool testVsTest, int cubatureEnrichment,
+                                       std::function<void(Intrepid::FieldContainer<double> &values, ElementTypePtr elemType,
+                                                          BasisCachePtr basisCache)> computeBatch);
 
   void gatherSolutionData(); // get all solution data onto every node (not what we should do in the end)
 protected:
@@ -209,6 +240,19 @@ public:
   int cubatureEnrichmentDegree() const;
   void setCubatureEnrichmentDegree(int value);
 
+  // ! Number of shared-memory threads used to compute local stiffness matrices during populateStiffnessAndLoad(), and residuals and
+  // ! error representations in computeResiduals() and computeErrorRepresentation().  Default is 1.
+  int numThreadsForLocalStiffness() const;
+  // ! Each thread computes whole cell batches with its own BasisCaches; the BF, IP, RHS, and any Functions they involve must therefore
+  // ! be safe to evaluate concurrently.  Insertion into the global system remains serial, in batch order, so results are deterministic.
+  // ! Values greater than 1 have no effect unless Camellia is built with OpenMP.
+  void setNumThreadsForLocalStiffness(int value);
+
+  // ! Bound on the storage for the local matrices of one cell batch (each batch has at least one cell); batches are the unit of
+  // ! work distributed among threads.  Default is 3 MB.
+  int maxBatchSizeInBytes() const;
+  void setMaxBatchSizeInBytes(int value);
+
   void setSolution(TSolutionPtr<Scalar> soln); // thisSoln = soln
 
   void solutionValues(Intrepid::FieldContainer<Scalar> &values, int trialID,
@@ -255,6 +299,24 @@ public:
   void setFilter(Teuchos::RCP<LocalStiffnessMatrixFilter> newFilter);
   void setReportConditionNumber(bool value);
   void setReportTimingResults(bool value);
+  
+  // ! When true (the default), the sparsity graph of the stiffness matrix is kept, and reused by subsequent solves for
+  // ! as long as the global dof numbering is unchanged, so that those assemble into a static-profile matrix.
+  void setReuseStiffnessGraph(bool value);
+
+  // ! When true, a GramMatrixCache with the given memory budget is set on the BF, so that the Cholesky factors of the Gram
+  // ! matrices computed during solve() are retained (this requires the BF's FACTORED_CHOLESKY optimal test solver), and
+  // ! computeErrorRepresentation() need only back-substitute.  Cells whose
+  // ! factors do not fit within the budget have their Gram matrices recomputed.  If the BF already has a GramMatrixCache
+  // ! for this mesh (set by another Solution), that cache is shared rather than replaced.  computeErrorRepresentation()
+  // ! only uses a cache set here.  Default is false.
+  void setRetainGramFactorizations(bool value, size_t memoryBudgetInBytes = std::numeric_limits<size_t>::max());
+
+  // ! When true, populateStiffnessAndLoad() keeps the interpreted element matrices in an ElementMatrixOperator instead of
+  // ! assembling an Epetra_CrsMatrix (getStiffnessMatrix() then returns null).  Only solvers that need just the action of
+  // ! the matrix support this -- GMGSolver with a CHEBYSHEV (or no) fine smoother.  Not supported together with DG jump
+  // ! terms or zero-mean constraints imposed as a rank-one update.  Default is false.
+  void setUseMatrixFreeStiffness(bool value);
 
   void computeResiduals();
   void computeErrorRepresentation();
@@ -285,6 +347,8 @@ public:
 
   Teuchos::RCP<Epetra_CrsMatrix> getStiffnessMatrix();
   TMatrixPtr<Scalar> getStiffnessMatrix2();
+  // ! the stiffness assembled by populateStiffnessAndLoad() when matrix-free stiffness is in use; otherwise null
+  ElementMatrixOperatorPtr getMatrixFreeStiffness();
   void setStiffnessMatrix(Teuchos::RCP<Epetra_CrsMatrix> stiffness);
   void setStiffnessMatrix2(TMatrixPtr<Scalar> stiffness);
 
@@ -12,6 +12,7 @@
 #include "TypeDefs.h"
 
 #include <Teuchos_RCP.hpp>
+#include <Teuchos_TestForException.hpp>
 #include <Epetra_LinearProblem.h>
 #include <Epetra_Time.h>
 #include <Epetra_CrsMatrix.h>
@@ -45,9 +46,22 @@ protected:
   Teuchos::RCP<Epetra_MultiVector> _lhs;
   Teuchos::RCP<Epetra_MultiVector> _rhs;
 
+  ElementMatrixOperatorPtr _matrixFreeStiffness; // set in place of _stiffnessMatrix when no matrix is assembled
+
   TMatrixPtr<Scalar> _stiffnessMatrix2;
   TVectorPtr<Scalar> _lhs2;
   TVectorPtr<Scalar> _rhs2;
+
+  bool _reuseSymbolicFactorization = false;
+  // seconds spent by the last solve() in each phase; filled in by direct solvers
+  double _timeAnalysis = 0, _timeFactorization = 0, _timeSolve = 0;
+
+  // matrices built on the same graph (e.g. on Solution's cached stiffness graph) share its data; comparing the data
+  // is how we recognize an unchanged sparsity pattern.  Holding a copy of the analyzed graph keeps its data alive.
+  static bool sameGraph(const Epetra_CrsGraph &graph1, const Epetra_CrsGraph &graph2)
+  {
+    return graph1.DataPtr() == graph2.DataPtr();
+  }
 public:
   virtual ~TSolver() {}
   virtual void setProblem(Teuchos::RCP<Epetra_CrsMatrix> stiffnessMatrix, Teuchos::RCP<Epetra_MultiVector> lhs, Teuchos::RCP<Epetra_MultiVector> rhs)
@@ -74,6 +88,14 @@ public:
     _stiffnessMatrix2 = stiffnessMatrix;
     stiffnessMatrixChanged();
   }
+  // ! Set by TSolution when it stores the stiffness as unassembled element matrices (see TSolution::setUseMatrixFreeStiffness()),
+  // ! in which case the stiffness matrix is null.  Only solvers that need just the action of the matrix (GMGSolver) support
+  // ! this; they override this method.  Here, we throw for a non-null stiffness.
+  virtual void setMatrixFreeStiffness(ElementMatrixOperatorPtr stiffness)
+  {
+    TEUCHOS_TEST_FOR_EXCEPTION(stiffness != Teuchos::null, std::invalid_argument,
+                               "This solver requires an assembled stiffness matrix; matrix-free stiffness is not supported");
+  }
   virtual void setLHS(Teuchos::RCP<Epetra_MultiVector> lhs)
   {
     _lhs = lhs;
@@ -102,6 +124,32 @@ public:
     return solve();
   }
 
+  // ! When true, direct solvers that support it keep the symbolic analysis of the matrix, and when a new matrix has the
+  // ! same graph as the analyzed one, perform only the numeric factorization.  Default: false.
+  void setReuseSymbolicFactorization(bool value)
+  {
+    _reuseSymbolicFactorization = value;
+  }
+  bool reuseSymbolicFactorization() const
+  {
+    return _reuseSymbolicFactorization;
+  }
+
+  // ! Times (in seconds) spent by the last solve() in symbolic analysis, numeric factorization, and the solve proper.
+  // ! Solvers that do not separate these phases report zero.
+  double analysisTime() const
+  {
+    return _timeAnalysis;
+  }
+  double factorizationTime() const
+  {
+    return _timeFactorization;
+  }
+  double solveTime() const
+  {
+    return _timeSolve;
+  }
+
   enum SolverChoice
   {
     KLU,
@@ -145,6 +193,8 @@ class TAmesos2Solver : public TSolver<Scalar>
   bool _saveFactorization;
   std::string _solverString;
   Teuchos::RCP<Amesos2::Solver<Epetra_CrsMatrix,Epetra_MultiVector> > _savedSolver;
+  Teuchos::RCP<Epetra_CrsGraph> _analyzedGraph; // graph of the matrix _savedSolver analyzed, when reusing symbolic factorizations
+  bool _haveNumericFactorization = false; // false once the matrix changes, even if the symbolic factorization is kept
 public:
   // Solver options available: klu superlu_dist superlu_mt superlu pardisomkl lapack amesos2_cholmod
   // May require specific instructions while building Trilinos
@@ -154,23 +204,47 @@ public:
     TEUCHOS_TEST_FOR_EXCEPTION(this->_stiffnessMatrix.get() == NULL, std::invalid_argument, "stiffness matrix is unset.");
     TEUCHOS_TEST_FOR_EXCEPTION(this->_lhs.get() == NULL, std::invalid_argument, "lhs is unset.");
     TEUCHOS_TEST_FOR_EXCEPTION(this->_rhs.get() == NULL, std::invalid_argument, "rhs is unset.");
-    if (!_saveFactorization)
+    Epetra_Time timer(this->_stiffnessMatrix->Comm());
+    
+    Teuchos::RCP<Amesos2::Solver<Epetra_CrsMatrix,Epetra_MultiVector> > solver;
+    if (this->_reuseSymbolicFactorization && (_savedSolver != Teuchos::null) && (_analyzedGraph != Teuchos::null)
+        && this->sameGraph(*_analyzedGraph, this->_stiffnessMatrix->Graph()))
     {
-      Teuchos::RCP<Amesos2::Solver<Epetra_CrsMatrix,Epetra_MultiVector> > solver
-        = Amesos2::create<Epetra_CrsMatrix,Epetra_MultiVector>(_solverString, this->_stiffnessMatrix, this->_lhs, this->_rhs);
-      solver->solve();
+      // same sparsity pattern as the analyzed matrix: keep the symbolic factorization
+      solver = _savedSolver;
+      solver->setA(this->_stiffnessMatrix, Amesos2::SYMBFACT);
+      solver->setX(this->_lhs);
+      solver->setB(this->_rhs);
+      this->_timeAnalysis = 0;
     }
     else
     {
-      _savedSolver = Amesos2::create<Epetra_CrsMatrix,Epetra_MultiVector>(_solverString, this->_stiffnessMatrix, this->_lhs, this->_rhs);
-      _savedSolver->solve();
+      solver = Amesos2::create<Epetra_CrsMatrix,Epetra_MultiVector>(_solverString, this->_stiffnessMatrix, this->_lhs, this->_rhs);
+      timer.ResetStartTime();
+      solver->symbolicFactorization();
+      this->_timeAnalysis = timer.ElapsedTime();
+    }
+    timer.ResetStartTime();
+    solver->numericFactorization();
+    this->_timeFactorization = timer.ElapsedTime();
+    timer.ResetStartTime();
+    solver->solve();
+    this->_timeSolve = timer.ElapsedTime();
+    
+    if (_saveFactorization || this->_reuseSymbolicFactorization)
+    {
+      _savedSolver = solver;
+      _analyzedGraph = Teuchos::rcp( new Epetra_CrsGraph(this->_stiffnessMatrix->Graph()) );
+      _haveNumericFactorization = true;
     }
     return 0;
   }
   int resolve()
   {
-    if (_savedSolver.get() != NULL)
+    if ((_savedSolver.get() != NULL) && _haveNumericFactorization)
     {
+      _savedSolver->setX(this->_lhs);
+      _savedSolver->setB(this->_rhs);
       _savedSolver->solve();
     }
     else
@@ -181,7 +255,12 @@ public:
   }
   virtual void stiffnessMatrixChanged()
   {
-    _savedSolver = Teuchos::null;
+    _haveNumericFactorization = false;
+    if (!this->_reuseSymbolicFactorization)
+    {
+      _savedSolver = Teuchos::null;
+      _analyzedGraph = Teuchos::null;
+    }
   }
 };
 
@@ -201,6 +280,28 @@ class MumpsSolver : public TSolver<double>
   bool _saveFactorization;
   Teuchos::RCP<Amesos_Mumps> _savedSolver;
   Teuchos::RCP<Epetra_LinearProblem> _savedProblem;
+  Teuchos::RCP<Epetra_CrsGraph> _analyzedGraph; // graph of the matrix _savedSolver analyzed, when reusing symbolic factorizations
+  bool _haveNumericFactorization = false; // false once the matrix changes, even if the symbolic factorization is kept
+  
+  // numeric factorization and solve, using the analysis of a previous matrix with the same graph.  Returns false if
+  // the factorization fails (e.g. because the pivoting needs more memory than the analysis predicted).
+  bool solveReusingAnalysis(int &err)
+  {
+    Epetra_Time timer(this->_stiffnessMatrix->Comm());
+    _savedProblem->SetOperator(this->_stiffnessMatrix.get());
+    _savedProblem->SetLHS(this->_lhs.get());
+    _savedProblem->SetRHS(this->_rhs.get());
+    _savedSolver->NumericFactorization();
+    _timeAnalysis = 0;
+    _timeFactorization = timer.ElapsedTime();
+    if (_savedSolver->GetINFOG()[0] < 0) return false;
+    
+    timer.ResetStartTime();
+    err = _savedSolver->Solve();
+    _timeSolve = timer.ElapsedTime();
+    _haveNumericFactorization = true;
+    return true;
+  }
 // protected:
 //   Teuchos::RCP< Epetra_LinearProblem > _problem;
 public:
@@ -218,6 +319,21 @@ public:
   // }
   int solve()
   {
+    if (_reuseSymbolicFactorization && (_savedSolver != Teuchos::null) && (_analyzedGraph != Teuchos::null)
+        && sameGraph(*_analyzedGraph, this->_stiffnessMatrix->Graph()))
+    {
+      int err;
+      if (solveReusingAnalysis(err)) return err;
+      // otherwise, start over with a fresh analysis
+    }
+    _savedSolver = Teuchos::null; // Amesos_Mumps depends on the Epetra_LinearProblem, so it's important we dealloc this first
+    _savedProblem = Teuchos::null;
+    _analyzedGraph = Teuchos::null;
+    
+    Epetra_Time timer(this->_stiffnessMatrix->Comm());
+    _timeAnalysis = 0;
+    _timeFactorization = 0;
+    
     _savedProblem = Teuchos::rcp( new Epetra_LinearProblem(this->_stiffnessMatrix.get(), this->_lhs.get(), this->_rhs.get()) ) ;
     Teuchos::RCP<Amesos_Mumps> mumps = Teuchos::rcp(new Amesos_Mumps(*_savedProblem));
     Teuchos::ParameterList paramList;
@@ -243,8 +359,12 @@ public:
 //    int sizeToSet = _maxMemoryPerCoreMB;
 //    cout << "setting ICNTL 23 to " << sizeToSet << endl;
 //    mumps->SetICNTL(23, sizeToSet);
+    timer.ResetStartTime();
     mumps->SymbolicFactorization();
+    _timeAnalysis += timer.ElapsedTime();
+    timer.ResetStartTime();
     mumps->NumericFactorization();
+    _timeFactorization += timer.ElapsedTime();
     int relaxationParam = 0; // the default
     int* info = mumps->GetINFO();
     int* infog = mumps->GetINFOG();
@@ -313,8 +433,12 @@ public:
           TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "Unhandled MUMPS error code");
         }
       }
+      timer.ResetStartTime();
       mumps->SymbolicFactorization();
+      _timeAnalysis += timer.ElapsedTime();
+      timer.ResetStartTime();
       mumps->NumericFactorization();
+      _timeFactorization += timer.ElapsedTime();
       if (numErrors > 20)
       {
         if (rank==0) cout << "Too many errors during MUMPS factorization.  Quitting.\n";
@@ -322,11 +446,15 @@ public:
       }
     }
     
+    timer.ResetStartTime();
     int err = mumps->Solve();
+    _timeSolve = timer.ElapsedTime();
     
-    if (_saveFactorization)
+    if (_saveFactorization || _reuseSymbolicFactorization)
     {
       _savedSolver = mumps;
+      _analyzedGraph = Teuchos::rcp( new Epetra_CrsGraph(this->_stiffnessMatrix->Graph()) );
+      _haveNumericFactorization = true;
     }
     else
     {
@@ -344,8 +472,10 @@ public:
 //      TEUCHOS_TEST_FOR_EXCEPTION(true, std::invalid_argument, "You must call solve() before calling resolve().  Also, _saveFactorization must be true.");
 //    }
 //    return _savedSolver->Solve();
-    if (_savedSolver.get() != NULL)
+    if ((_savedSolver.get() != NULL) && _haveNumericFactorization)
     {
+      _savedProblem->SetLHS(this->_lhs.get());
+      _savedProblem->SetRHS(this->_rhs.get());
       return _savedSolver->Solve();
     }
     else
@@ -355,8 +485,13 @@ public:
   }
   virtual void stiffnessMatrixChanged()
   {
-    _savedSolver = Teuchos::null;
-    _savedProblem = Teuchos::null;
+    _haveNumericFactorization = false;
+    if (!_reuseSymbolicFactorization)
+    {
+      _savedSolver = Teuchos::null; // Amesos_Mumps depends on the Epetra_LinearProblem, so it's important we dealloc this first
+      _savedProblem = Teuchos::null;
+      _analyzedGraph = Teuchos::null;
+    }
   }
 };
 } // namespace
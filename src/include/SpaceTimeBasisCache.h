@@ -17,6 +17,7 @@ namespace Camellia
 class SpaceTimeBasisCache : public BasisCache
 {
   static bool _defaultStoreTransformedValues; // default for new SpaceTimeBasisCaches (see static setter, below)
+  static bool _useSumFactorization; // whether integration may use getTransformedComponentValues() (see static setter, below)
   
   typedef Teuchos::RCP< Intrepid::FieldContainer<double> > FCPtr;
   typedef Teuchos::RCP< const Intrepid::FieldContainer<double> > constFCPtr;
@@ -84,9 +85,19 @@ public:
   virtual constFCPtr getTransformedValues(BasisPtr basis, Camellia::EOperator op, bool useCubPointsSideRefCell = false);
   virtual constFCPtr getTransformedWeightedValues(BasisPtr basis, Camellia::EOperator op, bool useCubPointsSideRefCell = false);
 
+  // ! Returns the spatial (C,F,P,...) and temporal (C,F,P) factors of getTransformedValues(), without forming their tensor product.
+  // ! Returns false if basis values here do not factor that way (basis is not a TensorBasis, or is a trace basis on a temporal side).
+  bool getTransformedComponentValues(BasisPtr basis, Camellia::EOperator op,
+                                     constFCPtr &spatialValues, constFCPtr &temporalValues,
+                                     bool useCubPointsSideRefCell = false);
+
   static void getTensorialComponentPoints(CellTopoPtr spaceTimeTopo, const Intrepid::FieldContainer<double> &tensorPoints,
                                           Intrepid::FieldContainer<double> &spatialPoints, Intrepid::FieldContainer<double> &temporalPoints);
   static void setDefaultStoreTransformedValues(bool storeValues);
+
+  // ! When true (the default), TLinearTerm::integrate() uses TensorBasis::integrateSumFactorized() for volume terms it can factor.
+  static void setUseSumFactorization(bool value);
+  static bool useSumFactorization();
 };
 }
 
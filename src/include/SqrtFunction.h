@@ -10,6 +10,7 @@
 #define Camellia_SqrtFunction_h
 
 #include "Function.h"
+#include "FunctionProgram.h"
 
 namespace Camellia {
   template <typename Scalar>
@@ -24,12 +25,17 @@ namespace Camellia {
     ~SqrtFunction() {}
     void values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache)
     {
+      if (this->compiledValues(values, basisCache)) return;
       _f->values(values,basisCache);
       for (int i=0; i<values.size(); i++)
       {
         values[i] = sqrt(values[i]);
       }
     }
+    int compile(FunctionProgram &program)
+    {
+      return program.unary(FunctionProgram::SQRT, program.add(_f));
+    }
     TFunctionPtr<Scalar> dx()
     {
       TFunctionPtr<Scalar> sqrt_f = Teuchos::rcp( new SqrtFunction(_f) );
@@ -77,6 +77,9 @@ public:
 
   static SubBasisDofMapperPtr subBasisDofMapper(const set<int> &dofOrdinalFilter, const vector<GlobalIndexType> &globalDofOrdinals);
   static SubBasisDofMapperPtr subBasisDofMapper(const set<int> &dofOrdinalFilter, const vector<GlobalIndexType> &globalDofOrdinals, const Intrepid::FieldContainer<double> &constraintMatrix);
+  //! as above, but a matrix mapper will share the provided constraint matrix rather than copying it
+  static SubBasisDofMapperPtr subBasisDofMapper(const set<int> &dofOrdinalFilter, const vector<GlobalIndexType> &globalDofOrdinals,
+                                                Teuchos::RCP<const Intrepid::FieldContainer<double>> constraintMatrix);
   //  static SubBasisDofMapperPtr subBasisDofMapper(); // determines if the constraint is a permutation--if it is, then
 };
 }
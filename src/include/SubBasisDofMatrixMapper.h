@@ -22,11 +22,15 @@ class SubBasisDofMatrixMapper : public SubBasisDofMapper   // subclass that mult
 {
   std::set<int> _basisDofOrdinalFilter;
   std::vector<GlobalIndexType> _mappedGlobalDofOrdinals;
-  Intrepid::FieldContainer<double> _constraintMatrix;
+  Teuchos::RCP<const Intrepid::FieldContainer<double>> _constraintMatrix; // may be shared with other mappers
 public:
   SubBasisDofMatrixMapper(const std::set<int> &basisDofOrdinalFilter,
                           const std::vector<GlobalIndexType> &mappedGlobalDofOrdinals,
                           const Intrepid::FieldContainer<double> &constraintMatrix);
+  //! shares the provided constraint matrix, which should not be modified after construction
+  SubBasisDofMatrixMapper(const std::set<int> &basisDofOrdinalFilter,
+                          const std::vector<GlobalIndexType> &mappedGlobalDofOrdinals,
+                          Teuchos::RCP<const Intrepid::FieldContainer<double>> constraintMatrix);
   const set<int> &basisDofOrdinalFilter();
   
   //! returns true if the sub basis map is a simple permutation, negated  -- SubBasisDofMatrixMapper always returns false
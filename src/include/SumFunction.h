@@ -34,6 +34,7 @@ public:
   TFunctionPtr<Scalar> div();  // divergence of sum is sum of divergences
 
   void values(Intrepid::FieldContainer<Scalar> &values, BasisCachePtr basisCache);
+  int compile(FunctionProgram &program);
   bool boundaryValueOnly();
 
   string displayString();
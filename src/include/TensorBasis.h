@@ -88,6 +88,25 @@ public:
   void getTensorValues(ArrayScalar& outputValues, std::vector< ArrayScalar> & componentOutputValues,
                        std::vector<Intrepid::EOperator> operatorTypes) const;
 
+  /** \brief  Integrates the product of two tensor-product bases against a pointwise weight, working from the component
+              values rather than the tensor product values.  The spatial contraction is performed once per temporal point,
+              and the result is then combined with the temporal values, so that the cost per cell is
+              O(Pt*Ps*Fs_u*Fs_v + Pt*F_u*F_v) rather than O(Pt*Ps*F_u*F_v), and the tensor product values are never formed.
+
+   \param  integrals      [out] - integrals of u*v*weights, ordered (C,F_u,F_v), with F_u, F_v ordered as in getTensorValues().
+   \param  uSpatialValues  [in] - spatial component values for u.  Ordered (C,F,P,...).
+   \param  uTemporalValues [in] - temporal component values for u.  Ordered (C,F,P).
+   \param  vSpatialValues  [in] - spatial component values for v.  Ordered (C,F,P,...), with the same trailing dimensions as uSpatialValues.
+   \param  vTemporalValues [in] - temporal component values for v.  Ordered (C,F,P).
+   \param  weights         [in] - weights at the tensor product points, ordered (C,P), with points ordered as in getTensorPoints().
+   \param  sumInto         [in] - if true, integrals are added to the existing values in the integrals container.
+
+   */
+  static void integrateSumFactorized(ArrayScalar& integrals,
+                                     const ArrayScalar& uSpatialValues, const ArrayScalar& uTemporalValues,
+                                     const ArrayScalar& vSpatialValues, const ArrayScalar& vTemporalValues,
+                                     const ArrayScalar& weights, bool sumInto = false);
+
   /** \brief  Returns the basis corresponding to the provided tensorial rank.
 
    \param  tensorialBasisRank     [in] - tensorial rank of the desired component basis.  0 for space, 1 for time.
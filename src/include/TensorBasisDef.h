@@ -298,6 +298,101 @@ void TensorBasis<Scalar,ArrayScalar>::getTensorValues(ArrayScalar& outputValues,
   }
 }
 
+template<class Scalar, class ArrayScalar>
+void TensorBasis<Scalar,ArrayScalar>::integrateSumFactorized(ArrayScalar& integrals,
+    const ArrayScalar& uSpatialValues, const ArrayScalar& uTemporalValues,
+    const ArrayScalar& vSpatialValues, const ArrayScalar& vTemporalValues,
+    const ArrayScalar& weights, bool sumInto)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION((uTemporalValues.rank() != 3) || (vTemporalValues.rank() != 3), std::invalid_argument,
+                             "temporal values must be shaped (C,F,P)");
+  TEUCHOS_TEST_FOR_EXCEPTION((uSpatialValues.rank() < 3) || (uSpatialValues.rank() != vSpatialValues.rank()), std::invalid_argument,
+                             "spatial values must be shaped (C,F,P,...), with the same rank for u and v");
+  TEUCHOS_TEST_FOR_EXCEPTION(weights.rank() != 2, std::invalid_argument, "weights must be shaped (C,P)");
+
+  int numCells = weights.dimension(0);
+  int numSpacePoints = uSpatialValues.dimension(2);
+  int numTimePoints = uTemporalValues.dimension(2);
+  int uSpaceFields = uSpatialValues.dimension(1), uTimeFields = uTemporalValues.dimension(1);
+  int vSpaceFields = vSpatialValues.dimension(1), vTimeFields = vTemporalValues.dimension(1);
+
+  // values in the spatial containers beyond the point dimension get contracted (dot product)
+  int valuesPerPoint = 1;
+  for (int r=3; r<uSpatialValues.rank(); r++)
+  {
+    TEUCHOS_TEST_FOR_EXCEPTION(uSpatialValues.dimension(r) != vSpatialValues.dimension(r), std::invalid_argument,
+                               "uSpatialValues and vSpatialValues must have the same trailing dimensions");
+    valuesPerPoint *= uSpatialValues.dimension(r);
+  }
+
+  TEUCHOS_TEST_FOR_EXCEPTION(vSpatialValues.dimension(2) != numSpacePoints, std::invalid_argument,
+                             "uSpatialValues and vSpatialValues must have the same number of points");
+  TEUCHOS_TEST_FOR_EXCEPTION(vTemporalValues.dimension(2) != numTimePoints, std::invalid_argument,
+                             "uTemporalValues and vTemporalValues must have the same number of points");
+  TEUCHOS_TEST_FOR_EXCEPTION(weights.dimension(1) != numSpacePoints * numTimePoints, std::invalid_argument,
+                             "weights must have one entry per tensor product point");
+  TEUCHOS_TEST_FOR_EXCEPTION((uSpatialValues.dimension(0) != numCells) || (uTemporalValues.dimension(0) != numCells) ||
+                             (vSpatialValues.dimension(0) != numCells) || (vTemporalValues.dimension(0) != numCells),
+                             std::invalid_argument, "all values containers must have the same number of cells as weights");
+  TEUCHOS_TEST_FOR_EXCEPTION((integrals.rank() != 3) || (integrals.dimension(0) != numCells)
+                             || (integrals.dimension(1) != uSpaceFields * uTimeFields)
+                             || (integrals.dimension(2) != vSpaceFields * vTimeFields),
+                             std::invalid_argument, "integrals must be shaped (C,F_u,F_v)");
+
+  if (!sumInto) integrals.initialize(0.0);
+
+  // spatialIntegrals(i,j) holds the spatial contraction for one cell and one temporal point
+  ArrayScalar spatialIntegrals(uSpaceFields, vSpaceFields);
+
+  for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+  {
+    for (int timePointOrdinal=0; timePointOrdinal<numTimePoints; timePointOrdinal++)
+    {
+      spatialIntegrals.initialize(0.0);
+      for (int spacePointOrdinal=0; spacePointOrdinal<numSpacePoints; spacePointOrdinal++)
+      {
+        int spaceTimePointOrdinal = TENSOR_POINT_ORDINAL(spacePointOrdinal, timePointOrdinal, numSpacePoints);
+        Scalar weight = weights(cellOrdinal,spaceTimePointOrdinal);
+        for (int uSpaceFieldOrdinal=0; uSpaceFieldOrdinal<uSpaceFields; uSpaceFieldOrdinal++)
+        {
+          int uEnumeration = ((cellOrdinal * uSpaceFields + uSpaceFieldOrdinal) * numSpacePoints + spacePointOrdinal) * valuesPerPoint;
+          const Scalar* uValue = &uSpatialValues[uEnumeration];
+          for (int vSpaceFieldOrdinal=0; vSpaceFieldOrdinal<vSpaceFields; vSpaceFieldOrdinal++)
+          {
+            int vEnumeration = ((cellOrdinal * vSpaceFields + vSpaceFieldOrdinal) * numSpacePoints + spacePointOrdinal) * valuesPerPoint;
+            const Scalar* vValue = &vSpatialValues[vEnumeration];
+            Scalar dotProduct = 0.0;
+            for (int offset=0; offset<valuesPerPoint; offset++)
+            {
+              dotProduct += uValue[offset] * vValue[offset];
+            }
+            spatialIntegrals(uSpaceFieldOrdinal,vSpaceFieldOrdinal) += weight * dotProduct;
+          }
+        }
+      }
+
+      // combine with the temporal values at this point
+      for (int uTimeFieldOrdinal=0; uTimeFieldOrdinal<uTimeFields; uTimeFieldOrdinal++)
+      {
+        Scalar uTemporalValue = uTemporalValues(cellOrdinal,uTimeFieldOrdinal,timePointOrdinal);
+        for (int vTimeFieldOrdinal=0; vTimeFieldOrdinal<vTimeFields; vTimeFieldOrdinal++)
+        {
+          Scalar temporalProduct = uTemporalValue * vTemporalValues(cellOrdinal,vTimeFieldOrdinal,timePointOrdinal);
+          for (int uSpaceFieldOrdinal=0; uSpaceFieldOrdinal<uSpaceFields; uSpaceFieldOrdinal++)
+          {
+            int uFieldOrdinal = uTimeFieldOrdinal * uSpaceFields + uSpaceFieldOrdinal; // as TENSOR_FIELD_ORDINAL
+            for (int vSpaceFieldOrdinal=0; vSpaceFieldOrdinal<vSpaceFields; vSpaceFieldOrdinal++)
+            {
+              int vFieldOrdinal = vTimeFieldOrdinal * vSpaceFields + vSpaceFieldOrdinal;
+              integrals(cellOrdinal,uFieldOrdinal,vFieldOrdinal) += temporalProduct * spatialIntegrals(uSpaceFieldOrdinal,vSpaceFieldOrdinal);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
   // range info for basis values:
   template<class Scalar, class ArrayScalar>
   bool TensorBasis<Scalar,ArrayScalar>::isNodal() const
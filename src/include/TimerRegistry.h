@@ -0,0 +1,110 @@
+//
+//  TimerRegistry.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_TimerRegistry_h
+#define Camellia_TimerRegistry_h
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "Epetra_Comm.h"
+
+//! CAMELLIA_TIMED_REGION(name): times the enclosing scope as a region nested within any region that encloses it.
+//! CAMELLIA_COUNT(name, increment): adds increment to the named counter.
+/*!
+ Both macros expand to nothing unless CAMELLIA_ENABLE_TIMERS is defined (CMake option ENABLE_TIMER_REGISTRY), so
+ instrumented code pays nothing in a default build.  When compiled in, recording may also be switched off at runtime
+ with TimerRegistry::setEnabled(false), at the cost of one branch per region.  The name should be a string literal.
+ */
+#ifdef CAMELLIA_ENABLE_TIMERS
+#define CAMELLIA_TIMER_CONCAT_(a,b) a##b
+#define CAMELLIA_TIMER_CONCAT(a,b) CAMELLIA_TIMER_CONCAT_(a,b)
+#define CAMELLIA_TIMED_REGION(name) Camellia::ScopedTimer CAMELLIA_TIMER_CONCAT(camelliaScopedTimer_,__LINE__)(name)
+#define CAMELLIA_COUNT(name, increment) Camellia::TimerRegistry::count(name, increment)
+#else
+#define CAMELLIA_TIMED_REGION(name)
+#define CAMELLIA_COUNT(name, increment)
+#endif
+
+namespace Camellia
+{
+//! TimerRegistry: process-wide registry of nested timed regions and counters.
+/*!
+ Each thread records into its own tree of regions, so that recording requires no locking; a region's path is the
+ "/"-separated list of the names of the regions enclosing it on the same thread (regions entered on OpenMP worker
+ threads therefore appear as roots).  Regions with the same path on different threads are merged when reporting.
+
+ writeJSON() aggregates min/mean/max across MPI ranks; writeChromeTrace() writes this rank's recorded events in the
+ Chrome trace event format (chrome://tracing, Perfetto), if trace recording has been turned on.
+ */
+class TimerRegistry
+{
+public:
+  struct RegionSummary
+  {
+    long long calls = 0;
+    double totalTime = 0, minTime = 0, maxTime = 0; // seconds; min/max are over individual calls
+  };
+
+  // ! when false, regions and counters are not recorded (default: true)
+  static void setEnabled(bool value);
+  static bool enabled();
+
+  // ! when true, each region exit also records an event for writeChromeTrace() (default: false)
+  static void setRecordTrace(bool value);
+  static bool recordTrace();
+
+  // ! discards all recorded regions, counters, and events.  Must not be called from within a timed region, or
+  // ! while other threads are recording.
+  static void clear();
+
+  static void count(const char* name, long long increment = 1);
+
+  // ! summaries of this rank's regions, merged across threads, keyed by path
+  static std::map<std::string, RegionSummary> regionSummaries();
+  // ! this rank's counters, merged across threads
+  static std::map<std::string, long long> counters();
+
+  // ! writes regions and counters, with min/mean/max across the ranks of Comm.  Collective; rank 0 writes.
+  static void writeJSON(std::ostream &out, const Epetra_Comm &Comm);
+  // ! writes this rank's recorded trace events; pid is the MPI rank, tid the thread ordinal
+  static void writeChromeTrace(std::ostream &out, int rank = 0);
+
+  // used by ScopedTimer:
+  struct Node;
+  static Node* enter(const char* name);
+  static void exit(Node* node, std::chrono::steady_clock::time_point start);
+};
+
+//! ScopedTimer: records the time from its construction to its destruction as a region in TimerRegistry.
+//! Usually created by CAMELLIA_TIMED_REGION.
+class ScopedTimer
+{
+  TimerRegistry::Node* _node;
+  std::chrono::steady_clock::time_point _start;
+public:
+  ScopedTimer(const char* name)
+  {
+    if (!TimerRegistry::enabled())
+    {
+      _node = NULL;
+      return;
+    }
+    _node = TimerRegistry::enter(name);
+    _start = std::chrono::steady_clock::now();
+  }
+  ~ScopedTimer()
+  {
+    if (_node != NULL) TimerRegistry::exit(_node, _start);
+  }
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer& operator=(const ScopedTimer &) = delete;
+};
+}
+
+#endif
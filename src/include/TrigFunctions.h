@@ -16,6 +16,7 @@ namespace Camellia
 class Cos_y : public SimpleFunction<double>
 {
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -25,6 +26,7 @@ class Cos_y : public SimpleFunction<double>
 class Sin_y : public SimpleFunction<double>
 {
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -34,6 +36,7 @@ class Sin_y : public SimpleFunction<double>
 class Cos_x : public SimpleFunction<double>
 {
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -43,6 +46,7 @@ class Cos_x : public SimpleFunction<double>
 class Sin_x : public SimpleFunction<double>
 {
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   TFunctionPtr<double> dz();
@@ -55,6 +59,7 @@ class Cos_ax : public SimpleFunction<double>
 public:
   Cos_ax(double a, double b=0);
   double value(double x);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
 
@@ -67,6 +72,7 @@ class Sin_ax : public SimpleFunction<double>
 public:
   Sin_ax(double a, double b=0);
   double value(double x);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   std::string displayString();
@@ -78,6 +84,7 @@ class Cos_ay : public SimpleFunction<double>
 public:
   Cos_ay(double a);
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
 
@@ -90,6 +97,7 @@ class Sin_ay : public SimpleFunction<double>
 public:
   Sin_ay(double a);
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   std::string displayString();
@@ -101,6 +109,7 @@ class ArcTan_ax : public SimpleFunction<double>
 public:
   ArcTan_ax(double a, double b=0);
   double value(double x);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   std::string displayString();
@@ -112,6 +121,7 @@ class ArcTan_ay : public SimpleFunction<double>
 public:
   ArcTan_ay(double a, double b=0);
   double value(double x, double y);
+  int compile(FunctionProgram &program);
   TFunctionPtr<double> dx();
   TFunctionPtr<double> dy();
   std::string displayString();
@@ -52,9 +52,12 @@ class Cell;
 class DofOrdering;
 class DofOrderingFactory;
 class Element;
+class ElementMatrixOperator;
 class ElementType;
 class EntitySet;
+class FunctionProgram;
 class GlobalDofAssignment;
+class GramMatrixCache;
 class LagrangeConstraints;
 class Mesh;
 class MeshPartitionPolicy;
@@ -62,6 +65,7 @@ class MeshTopology;
 class MeshTopologyView;
 class ParameterFunction;
 class RefinementPattern;
+class ReferenceIntegralCache;
 class SpatialFilter;
 class Var;
 class VarFactory;
@@ -93,15 +97,19 @@ typedef Teuchos::RCP<Cell> CellPtr;
 typedef Teuchos::RCP<DofOrdering> DofOrderingPtr;
 typedef Teuchos::RCP<DofOrderingFactory> DofOrderingFactoryPtr;
 typedef Teuchos::RCP<Element> ElementPtr;
+typedef Teuchos::RCP<ElementMatrixOperator> ElementMatrixOperatorPtr;
 typedef Teuchos::RCP<ElementType> ElementTypePtr;
 typedef Teuchos::RCP<EntitySet> EntitySetPtr;
+typedef Teuchos::RCP<FunctionProgram> FunctionProgramPtr;
 typedef Teuchos::RCP<GlobalDofAssignment> GlobalDofAssignmentPtr;
+typedef Teuchos::RCP<GramMatrixCache> GramMatrixCachePtr;
 typedef Teuchos::RCP<Mesh> MeshPtr;
 typedef Teuchos::RCP<MeshPartitionPolicy> MeshPartitionPolicyPtr;
 typedef Teuchos::RCP<MeshTopology> MeshTopologyPtr;
 typedef Teuchos::RCP<MeshTopologyView> MeshTopologyViewPtr;
 typedef Teuchos::RCP<ParameterFunction> ParameterFunctionPtr;
 typedef Teuchos::RCP<RefinementPattern> RefinementPatternPtr;
+typedef Teuchos::RCP<ReferenceIntegralCache> ReferenceIntegralCachePtr;
 typedef Teuchos::RCP<SpatialFilter> SpatialFilterPtr;
 typedef Teuchos::RCP<Var> VarPtr;
 typedef Teuchos::RCP<VarFactory> VarFactoryPtr;
@@ -9,6 +9,7 @@
 #include "Teuchos_UnitTestHarness.hpp"
 
 #include "BF.h"
+#include "GramMatrixCache.h"
 #include "MeshFactory.h"
 #include "PoissonFormulation.h"
 #include "RHS.h"
@@ -22,6 +23,88 @@ using namespace Intrepid;
 
 namespace
 {
+  TEUCHOS_UNIT_TEST( BF, FactoredCholeskySolveBatched_AgreesWithPerCell )
+  {
+    // 11 cells: more than one interleaved group, with a partially-filled last group
+    int numCells = 11, testCount = 9, trialCount = 5;
+    
+    FieldContainer<double> ip(numCells,testCount,testCount);
+    FieldContainer<double> stiffnessEnriched(numCells,trialCount,testCount);
+    FieldContainer<double> rhsEnriched(numCells,testCount);
+    
+    // G = X X^T + I is SPD for any X
+    srand(1);
+    for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+    {
+      FieldContainer<double> X(testCount,testCount);
+      for (int i=0; i<X.size(); i++)
+      {
+        X[i] = (double) rand() / RAND_MAX - 0.5;
+      }
+      for (int i=0; i<testCount; i++)
+      {
+        for (int j=0; j<testCount; j++)
+        {
+          ip(cellOrdinal,i,j) = (i==j) ? 1.0 : 0.0;
+          for (int k=0; k<testCount; k++)
+          {
+            ip(cellOrdinal,i,j) += X(i,k) * X(j,k);
+          }
+        }
+        rhsEnriched(cellOrdinal,i) = (double) rand() / RAND_MAX;
+        for (int a=0; a<trialCount; a++)
+        {
+          stiffnessEnriched(cellOrdinal,a,i) = (double) rand() / RAND_MAX;
+        }
+      }
+    }
+    
+    FieldContainer<double> ipCopy = ip, stiffnessEnrichedCopy = stiffnessEnriched, rhsEnrichedCopy = rhsEnriched;
+    
+    FieldContainer<double> stiffness(numCells,trialCount,trialCount), rhs(numCells,trialCount);
+    int result = TBF<double>::factoredCholeskySolveBatched(ip, stiffnessEnriched, rhsEnriched, stiffness, rhs);
+    TEST_EQUALITY(result, 0);
+    
+    double tol = 1e-12;
+    for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+    {
+      FieldContainer<double> cellIP(testCount,testCount), cellStiffnessEnriched(trialCount,testCount), cellRHSEnriched(testCount,1);
+      for (int i=0; i<testCount; i++)
+      {
+        for (int j=0; j<testCount; j++)
+        {
+          cellIP(i,j) = ipCopy(cellOrdinal,i,j);
+        }
+        for (int a=0; a<trialCount; a++)
+        {
+          cellStiffnessEnriched(a,i) = stiffnessEnrichedCopy(cellOrdinal,a,i);
+        }
+        cellRHSEnriched(i,0) = rhsEnrichedCopy(cellOrdinal,i);
+      }
+      FieldContainer<double> stiffnessExpected(trialCount,trialCount), rhsExpected(trialCount,1);
+      TBF<double>::factoredCholeskySolve(cellIP, cellStiffnessEnriched, cellRHSEnriched, stiffnessExpected, rhsExpected);
+      
+      for (int a=0; a<trialCount; a++)
+      {
+        for (int b=0; b<trialCount; b++)
+        {
+          TEST_FLOATING_EQUALITY(stiffnessExpected(a,b), stiffness(cellOrdinal,a,b), tol);
+        }
+        TEST_FLOATING_EQUALITY(rhsExpected(a,0), rhs(cellOrdinal,a), tol);
+      }
+    }
+    
+    // inputs should be left unmodified
+    for (int i=0; i<ip.size(); i++)
+    {
+      TEST_EQUALITY(ip[i], ipCopy[i]);
+    }
+    for (int i=0; i<stiffnessEnriched.size(); i++)
+    {
+      TEST_EQUALITY(stiffnessEnriched[i], stiffnessEnrichedCopy[i]);
+    }
+  }
+  
   TEUCHOS_UNIT_TEST( BF, FactoredCholeskySolve_Identities )
   {
     int testCount = 5, trialCount = 4;
@@ -130,6 +213,75 @@ namespace
     }
   }
 
+  TEUCHOS_UNIT_TEST( BF, GramMatrixCache_ReusesFactors )
+  {
+    // check that cached Gram factors reproduce the factored Cholesky solve, and that refinement invalidates them
+    int spaceDim = 2;
+    bool useConformingTraces = true;
+    
+    PoissonFormulation form(spaceDim, useConformingTraces, PoissonFormulation::ULTRAWEAK);
+    BFPtr bf = form.bf();
+    IPPtr ip = bf->graphNorm();
+    
+    int H1Order = 2;
+    MeshPtr mesh = MeshFactory::rectilinearMesh(form.bf(), {1.0,1.0}, {1,1}, H1Order);
+    RHSPtr rhsPtr = RHS::rhs();
+    rhsPtr->addTerm(1.0 * form.q());
+    GlobalIndexType cellZero = 0;
+    
+    GramMatrixCachePtr gramMatrixCache = GramMatrixCache::gramMatrixCache(mesh);
+    
+    if (mesh->myCellsInclude(cellZero))
+    {
+      ElementTypePtr elemType = mesh->getElementType(cellZero);
+      int trialCount = elemType->trialOrderPtr->totalDofs();
+      BasisCachePtr basisCache = BasisCache::basisCacheForCell(mesh, cellZero);
+      BasisCachePtr ipBasisCache = BasisCache::basisCacheForCell(mesh, cellZero, true);
+      int numCells = 1;
+      FieldContainer<double> stiffnessExpected(numCells,trialCount,trialCount), rhsExpected(numCells,trialCount);
+      bf->setOptimalTestSolver(TBF<>::FACTORED_CHOLESKY);
+      bf->localStiffnessMatrixAndRHS(stiffnessExpected, rhsExpected, ip, ipBasisCache, rhsPtr, basisCache);
+      
+      bf->setGramMatrixCache(gramMatrixCache);
+      double tol = 1e-12;
+      for (int solveOrdinal=0; solveOrdinal<2; solveOrdinal++)
+      {
+        FieldContainer<double> stiffness(numCells,trialCount,trialCount), rhs(numCells,trialCount);
+        bf->localStiffnessMatrixAndRHS(stiffness, rhs, ip, ipBasisCache, rhsPtr, basisCache);
+        for (int i=0; i<stiffness.size(); i++)
+        {
+          TEST_COMPARE(abs(stiffnessExpected[i]-stiffness[i]), <, tol);
+        }
+        for (int i=0; i<rhs.size(); i++)
+        {
+          TEST_COMPARE(abs(rhsExpected[i]-rhs[i]), <, tol);
+        }
+      }
+      TEST_EQUALITY(gramMatrixCache->missCount(), 1);
+      TEST_EQUALITY(gramMatrixCache->hitCount(), 1);
+      TEST_COMPARE(gramMatrixCache->memoryUsed(), >, 0);
+
+      // a factor computed with one cubature degree should not be used with another
+      int cubatureEnrichment = 2;
+      BasisCachePtr enrichedIPBasisCache = BasisCache::basisCacheForCell(mesh, cellZero, true, cubatureEnrichment);
+      FieldContainer<double> stiffness(numCells,trialCount,trialCount), rhs(numCells,trialCount);
+      bf->localStiffnessMatrixAndRHS(stiffness, rhs, ip, enrichedIPBasisCache, rhsPtr, basisCache);
+      TEST_EQUALITY(gramMatrixCache->missCount(), 2);
+      TEST_EQUALITY(gramMatrixCache->hitCount(), 1);
+
+      // other solvers do not use the cache
+      bf->setOptimalTestSolver(TBF<>::CHOLESKY);
+      bf->localStiffnessMatrixAndRHS(stiffness, rhs, ip, ipBasisCache, rhsPtr, basisCache);
+      TEST_EQUALITY(gramMatrixCache->missCount(), 2);
+      TEST_EQUALITY(gramMatrixCache->hitCount(), 1);
+      bf->setGramMatrixCache(Teuchos::null);
+    }
+    
+    set<GlobalIndexType> cellIDs = {cellZero};
+    mesh->hRefine(cellIDs);
+    TEST_EQUALITY(gramMatrixCache->memoryUsed(), 0);
+  }
+  
   TEUCHOS_UNIT_TEST( BF, FactoredCholeskySolve_SimpleRectangularMatrices )
   {
     int testCount = 3, trialCount = 2;
@@ -0,0 +1,29 @@
+//
+//  BasisCacheSetting.h
+//  Camellia
+//
+//
+
+#ifndef Camellia_BasisCacheSetting_h
+#define Camellia_BasisCacheSetting_h
+
+// sets one of BasisCache's static flags for its lifetime, restoring the previous value on destruction, so that a throwing
+// check cannot leave the setting changed for later tests
+class BasisCacheSetting
+{
+  void (*_setter)(bool);
+  bool _previousValue;
+public:
+  BasisCacheSetting(bool (*getter)(), void (*setter)(bool), bool value)
+  {
+    _setter = setter;
+    _previousValue = getter();
+    _setter(value);
+  }
+  ~BasisCacheSetting()
+  {
+    _setter(_previousValue);
+  }
+};
+
+#endif
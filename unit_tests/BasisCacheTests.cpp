@@ -9,13 +9,16 @@
 #include "Teuchos_UnitTestHarness.hpp"
 
 #include "BasisCache.h"
+#include "BasisCacheSetting.h"
 #include "BasisFactory.h"
 #include "BasisSumFunction.h"
 #include "CamelliaCellTools.h"
 #include "CellTopology.h"
+#include "CubatureFactory.h"
 #include "MeshFactory.h"
 #include "PoissonFormulation.h"
 #include "SerialDenseWrapper.h"
+#include "SimpleFunction.h"
 #include "Solution.h"
 
 #include "Intrepid_CellTools.hpp"
@@ -26,6 +29,24 @@ using namespace Intrepid;
 
 namespace
 {
+// counts calls to values(), so that tests can check when Function values are recomputed
+class CountingFunction : public SimpleFunction<double>
+{
+public:
+  int evaluationCount = 0;
+
+  using SimpleFunction<double>::value;
+  double value(double x, double y)
+  {
+    return x + 2.0 * y;
+  }
+  void values(FieldContainer<double> &values, BasisCachePtr basisCache)
+  {
+    evaluationCount++;
+    SimpleFunction<double>::values(values, basisCache);
+  }
+};
+
 vector< CellTopoPtr > getShardsTopologies()
 {
   vector< CellTopoPtr > shardsTopologies;
@@ -78,6 +99,46 @@ TEUCHOS_UNIT_TEST( BasisCache, LineCubature )
   TEST_FLOATING_EQUALITY(expected_integral, integral, 1e-15);
 }
 
+TEUCHOS_UNIT_TEST( BasisCache, CubatureFactoryCacheMatchesCreate )
+{
+  // cached cubature points and weights should match a freshly constructed cubature, for both shards and space-time topologies
+  vector< CellTopoPtr > topos = {CellTopology::quad(), CellTopology::tetrahedron(), CellTopology::lineTensorTopology(CellTopology::triangle())};
+  int cubDegree = 4;
+  CubatureFactory cubFactory;
+  for (CellTopoPtr topo : topos)
+  {
+    Teuchos::RCP<Cubature<double> > cub = cubFactory.create(topo, cubDegree);
+    FieldContainer<double> expectedPoints(cub->getNumPoints(), cub->getDimension()), expectedWeights(cub->getNumPoints());
+    cub->getCubature(expectedPoints, expectedWeights);
+
+    for (int request=0; request<2; request++)
+    {
+      long long hitCount = CubatureFactory::cacheHitCount(), missCount = CubatureFactory::cacheMissCount();
+      FieldContainer<double> points, weights;
+      CubatureFactory::getCubature(topo, cubDegree, points, weights);
+      // the first request may or may not hit, depending on what other tests have run; the second must
+      TEST_EQUALITY(CubatureFactory::cacheHitCount() + CubatureFactory::cacheMissCount(), hitCount + missCount + 1);
+      if (request == 1)
+      {
+        TEST_EQUALITY(CubatureFactory::cacheHitCount(), hitCount + 1);
+      }
+
+      TEST_EQUALITY(points.dimension(0), expectedPoints.dimension(0));
+      TEST_EQUALITY(points.dimension(1), expectedPoints.dimension(1));
+      TEST_EQUALITY(weights.size(), expectedWeights.size());
+      if ((points.size() != expectedPoints.size()) || (weights.size() != expectedWeights.size())) continue;
+      for (int i=0; i<points.size(); i++)
+      {
+        TEST_EQUALITY(points[i], expectedPoints[i]);
+      }
+      for (int i=0; i<weights.size(); i++)
+      {
+        TEST_EQUALITY(weights[i], expectedWeights[i]);
+      }
+    }
+  }
+}
+
 TEUCHOS_UNIT_TEST(BasisCache, Jacobian3D)
 {
 
@@ -180,6 +241,73 @@ TEUCHOS_UNIT_TEST(BasisCache, Jacobian3D)
 //    }
 }
 
+TEUCHOS_UNIT_TEST( BasisCache, AffineCellJacobians )
+{
+  // a parallelogram is affine; a quad with one node moved off the parallelogram is not
+  CellTopoPtr quad = CellTopology::quad();
+  int numCells = 1, numNodes = 4, spaceDim = 2, cubDegree = 3;
+  FieldContainer<double> parallelogramNodes(numCells,numNodes,spaceDim);
+  double nodeCoords[4][2] = {{0.0,0.0},{2.0,0.5},{2.5,1.5},{0.5,1.0}};
+  for (int node=0; node<numNodes; node++)
+  {
+    for (int d=0; d<spaceDim; d++)
+    {
+      parallelogramNodes(0,node,d) = nodeCoords[node][d];
+    }
+  }
+  BasisCache parallelogramCache(parallelogramNodes, quad, cubDegree);
+  TEST_ASSERT(parallelogramCache.cellsAreAffine());
+
+  // the per-point Jacobians should agree with those computed pointwise
+  FieldContainer<double> expectedJacobian(numCells,parallelogramCache.getRefCellPoints().dimension(0),spaceDim,spaceDim);
+  CamelliaCellTools::setJacobian(expectedJacobian, parallelogramCache.getRefCellPoints(), parallelogramNodes, quad);
+  double tol = 1e-14;
+  TEST_COMPARE_FLOATING_ARRAYS(expectedJacobian, parallelogramCache.getJacobian(), tol);
+
+  FieldContainer<double> expectedJacobianDet(numCells,expectedJacobian.dimension(1));
+  FieldContainer<double> expectedJacobianInv(expectedJacobian.dimension(0),expectedJacobian.dimension(1),spaceDim,spaceDim);
+  SerialDenseWrapper::determinantAndInverse(expectedJacobianDet, expectedJacobianInv, expectedJacobian);
+  TEST_COMPARE_FLOATING_ARRAYS(expectedJacobianDet, parallelogramCache.getJacobianDet(), tol);
+  TEST_COMPARE_FLOATING_ARRAYS(expectedJacobianInv, parallelogramCache.getJacobianInv(), tol);
+  TEST_FLOATING_EQUALITY(parallelogramCache.getAffineCellJacobianDet()(0), expectedJacobianDet(0,0), tol);
+
+  FieldContainer<double> generalQuadNodes = parallelogramNodes;
+  generalQuadNodes(0,2,0) = 3.0;
+  BasisCache generalQuadCache(generalQuadNodes, quad, cubDegree);
+  TEST_ASSERT(!generalQuadCache.cellsAreAffine());
+}
+
+TEUCHOS_UNIT_TEST( BasisCache, MemoizedFunctionValues )
+{
+  BasisCacheSetting memoize(BasisCache::memoizeFunctionValues, BasisCache::setMemoizeFunctionValues, true);
+  int cubDegree = 3;
+  BasisCachePtr basisCache = BasisCache::basisCacheForReferenceCell(CellTopology::quad(), cubDegree);
+  Teuchos::RCP<CountingFunction> f = Teuchos::rcp( new CountingFunction );
+
+  constFCPtr firstValues = basisCache->getFunctionValues(f);
+  constFCPtr secondValues = basisCache->getFunctionValues(f);
+  TEST_EQUALITY(f->evaluationCount, 1);
+  TEST_ASSERT(firstValues.get() == secondValues.get());
+
+  double tol = 1e-15;
+  FieldContainer<double> expectedValues(firstValues->dimension(0),firstValues->dimension(1));
+  f->values(expectedValues, basisCache);
+  TEST_COMPARE_FLOATING_ARRAYS(expectedValues, *firstValues, tol);
+
+  // new cells: the values should be recomputed
+  FieldContainer<double> physicalCellNodes = basisCache->getPhysicalCellNodes();
+  for (int i=0; i<physicalCellNodes.size(); i++)
+  {
+    physicalCellNodes[i] *= 2.0;
+  }
+  bool createSideCache = false;
+  basisCache->setPhysicalCellNodes(physicalCellNodes, basisCache->cellIDs(), createSideCache);
+  constFCPtr newValues = basisCache->getFunctionValues(f);
+  TEST_EQUALITY(f->evaluationCount, 3);
+  f->values(expectedValues, basisCache);
+  TEST_COMPARE_FLOATING_ARRAYS(expectedValues, *newValues, tol);
+}
+
 TEUCHOS_UNIT_TEST( BasisCache, SideNormals_Space )
 {
   // pretty simple: just check that BasisCache gets values that agree with Intrepid's computation of side normals, on the reference cell
@@ -10,13 +10,27 @@
 #include "BasisCache.h"
 #include <CamelliaCellTools.h>
 #include "CellTopology.h"
+#include "ExpFunction.h"
 #include "Function.h"
+#include "FunctionProgram.h"
+#include "SimpleFunction.h"
+#include "TrigFunctions.h"
 
 using namespace Camellia;
 using namespace Intrepid;
 
 namespace
 {
+// a function that doesn't compile, so that it enters FunctionPrograms as a leaf
+class XYPlusOne : public SimpleFunction<double>
+{
+public:
+  double value(double x, double y)
+  {
+    return x * y + 1.0;
+  }
+};
+
 
 void testSpaceTimeNormalTimeComponent(CellTopoPtr spaceTopo, Teuchos::FancyOStream &out, bool &success)
 {
@@ -302,6 +316,40 @@ void testSpaceTimeNormal(CellTopoPtr spaceTopo, Teuchos::FancyOStream &out, bool
     testHFunction(cellTopo, out, success);
   }
   
+  TEUCHOS_UNIT_TEST( Function, CompiledValuesMatchValues )
+  {
+    FunctionPtr x = Function::xn(1), y = Function::yn(1);
+    FunctionPtr leaf = Teuchos::rcp( new XYPlusOne );
+    FunctionPtr sin_y = Teuchos::rcp( new Sin_y );
+    FunctionPtr exp_2x = Teuchos::rcp( new Exp_ax(2.0) );
+    FunctionPtr y_squared = Function::composedFunction(Function::xn(2), Function::vectorize(y, x));
+    FunctionPtr f = (Function::xn(2) * sin_y + exp_2x) / (1.0 + y_squared) - Function::sqrtFunction(1.0 + leaf * leaf)
+                    + Function::min(x, leaf) * 3.0 - leaf;
+
+    FunctionProgramPtr program = FunctionProgram::compile(f.get(), 2);
+    TEST_ASSERT(program != Teuchos::null);
+    if (program != Teuchos::null)
+    {
+      TEST_EQUALITY(program->numLeaves(), 1); // the three appearances of leaf share one evaluation
+    }
+
+    int cubatureDegree = 4;
+    BasisCachePtr basisCache = BasisCache::basisCacheForReferenceCell(CellTopology::quad(), cubatureDegree);
+    int numPoints = basisCache->getRefCellPoints().dimension(0);
+    FieldContainer<double> compiledValues(1,numPoints), expectedValues(1,numPoints);
+    f->values(compiledValues, basisCache);
+
+    FunctionProgram::setUseCompiledEvaluation(false);
+    f->values(expectedValues, basisCache);
+    FunctionProgram::setUseCompiledEvaluation(true);
+
+    double tol = 1e-14;
+    for (int pointOrdinal=0; pointOrdinal<numPoints; pointOrdinal++)
+    {
+      TEST_COMPARE(abs(compiledValues(0,pointOrdinal) - expectedValues(0,pointOrdinal)), <, tol);
+    }
+  }
+
 TEUCHOS_UNIT_TEST( Function, MinAndMaxFunctions )
 {
   FunctionPtr one = Function::constant(1);
@@ -1287,6 +1287,117 @@ namespace
     TEST_EQUALITY(numVertices, globalDofCount);
   }
   
+  TEUCHOS_UNIT_TEST( GDAMinimumRule, IncrementalConstraintUpdatesMatchFullRebuild )
+  {
+    // refinements invalidate only the cached constraints near the refined cells; check that what remains agrees with a recomputation
+    int spaceDim = 2;
+    bool useConformingTraces = true;
+    PoissonFormulation form(spaceDim, useConformingTraces);
+
+    int H1Order = 2, delta_k = 1;
+    MeshPtr mesh = MeshFactory::quadMeshMinRule(form.bf(), H1Order, delta_k, 1.0, 1.0, 4, 4);
+    GDAMinimumRule* minRule = dynamic_cast<GDAMinimumRule*>(mesh->globalDofAssignment().get());
+
+    mesh->hRefine(set<GlobalIndexType>{0, 5});
+    mesh->pRefine(set<GlobalIndexType>{10});
+    set<GlobalIndexType> childCells;
+    for (IndexType childID : mesh->getTopology()->getCell(0)->getChildIndices(mesh->getTopology()))
+    {
+      childCells.insert(childID);
+    }
+    mesh->hRefine(set<GlobalIndexType>{*childCells.begin()});
+    mesh->enforceOneIrregularity();
+
+    set<GlobalIndexType> activeCellIDs = mesh->getActiveCellIDs();
+    map<GlobalIndexType, CellConstraints> incrementalConstraints;
+    for (GlobalIndexType cellID : activeCellIDs)
+    {
+      incrementalConstraints[cellID] = minRule->getCellConstraints(cellID);
+    }
+
+    minRule->setAllowCascadingConstraints(false); // clears the constraints cache
+    for (GlobalIndexType cellID : activeCellIDs)
+    {
+      CellConstraints &expectedConstraints = minRule->getCellConstraints(cellID);
+      CellConstraints &actualConstraints = incrementalConstraints[cellID];
+      for (int d=0; d<=spaceDim; d++)
+      {
+        TEST_EQUALITY(actualConstraints.subcellConstraints[d].size(), expectedConstraints.subcellConstraints[d].size());
+        for (int scord=0; scord<expectedConstraints.subcellConstraints[d].size(); scord++)
+        {
+          TEST_ASSERT(actualConstraints.subcellConstraints[d][scord] == expectedConstraints.subcellConstraints[d][scord]);
+          TEST_EQUALITY(actualConstraints.owningCellIDForSubcell[d][scord].cellID, expectedConstraints.owningCellIDForSubcell[d][scord].cellID);
+          TEST_EQUALITY(actualConstraints.owningCellIDForSubcell[d][scord].owningSubcellEntityIndex,
+                        expectedConstraints.owningCellIDForSubcell[d][scord].owningSubcellEntityIndex);
+        }
+      }
+    }
+  }
+
+  TEUCHOS_UNIT_TEST( GDAMinimumRule, IncrementalRenumberingAfterRefinement )
+  {
+    // cells away from a refinement keep their owned dofs' relative numbering; dofRenumbering() says where they moved
+    int spaceDim = 2;
+    bool useConformingTraces = true;
+    PoissonFormulation form(spaceDim, useConformingTraces);
+
+    int H1Order = 2, delta_k = 1;
+    MeshPtr mesh = MeshFactory::quadMeshMinRule(form.bf(), H1Order, delta_k, 1.0, 1.0, 4, 4);
+    GDAMinimumRule* minRule = dynamic_cast<GDAMinimumRule*>(mesh->globalDofAssignment().get());
+
+    set<GlobalIndexType> oldActiveCellIDs = mesh->getActiveCellIDs();
+    map<GlobalIndexType, set<GlobalIndexType>> oldGlobalDofIndices;
+    for (GlobalIndexType cellID : oldActiveCellIDs)
+    {
+      oldGlobalDofIndices[cellID] = mesh->globalDofIndicesForCell(cellID);
+    }
+    int oldVersion = minRule->dofNumberingVersion();
+
+    GlobalIndexType refinedCellID = 0, distantCellID = 15;
+    mesh->hRefine(set<GlobalIndexType>{refinedCellID});
+
+    const GlobalDofRenumbering* renumbering = &minRule->dofRenumbering();
+    TEST_EQUALITY(renumbering->oldNumberingVersion, oldVersion);
+    TEST_EQUALITY(renumbering->newNumberingVersion, minRule->dofNumberingVersion());
+    TEST_ASSERT(renumbering->cellsWithNewDofs.find(distantCellID) == renumbering->cellsWithNewDofs.end());
+
+    map<GlobalIndexType, GlobalIndexType> newDofIndex;
+    GlobalIndexType renumberedDofCount = 0;
+    for (int run=0; run<renumbering->dofCounts.size(); run++)
+    {
+      for (GlobalIndexType i=0; i<renumbering->dofCounts[run]; i++)
+      {
+        newDofIndex[renumbering->oldOffsets[run] + i] = renumbering->newOffsets[run] + i;
+      }
+      renumberedDofCount += renumbering->dofCounts[run];
+    }
+    TEST_ASSERT(renumberedDofCount > 0);
+    TEST_ASSERT(renumberedDofCount < mesh->numGlobalDofs());
+
+    // for cells whose dofs were all carried over, the renumbered dofs should be exactly the cell's new dofs
+    for (GlobalIndexType cellID : oldActiveCellIDs)
+    {
+      if (cellID == refinedCellID) continue;
+      set<GlobalIndexType> renumberedDofIndices;
+      bool allCarriedOver = true;
+      for (GlobalIndexType oldDofIndex : oldGlobalDofIndices[cellID])
+      {
+        if (newDofIndex.find(oldDofIndex) == newDofIndex.end())
+        {
+          allCarriedOver = false;
+          break;
+        }
+        renumberedDofIndices.insert(newDofIndex[oldDofIndex]);
+      }
+      if (!allCarriedOver)
+      {
+        TEST_ASSERT(cellID != distantCellID);
+        continue;
+      }
+      TEST_ASSERT(renumberedDofIndices == mesh->globalDofIndicesForCell(cellID));
+    }
+  }
+
   TEUCHOS_UNIT_TEST( GDAMinimumRule, InterpretLocalBasisCoefficientsHangingNode_Triangles )
   {
     /*
@@ -8,9 +8,11 @@
 
 #include "Teuchos_UnitTestHarness.hpp"
 
+#include "EpetraExt_MatrixMatrix.h"
 #include "EpetraExt_RowMatrixOut.h"
 
 #include "CamelliaDebugUtility.h"
+#include "ElementMatrixOperator.h"
 #include "GDAMinimumRule.h"
 #include "GMGSolver.h"
 #include "MeshFactory.h"
@@ -831,7 +833,8 @@ void testOperatorIsSPD(int spaceDim, GridType gridType, GMGOperator::SmootherApp
     fineSolution->populateStiffnessAndLoad();
     solver->gmgOperator()->setFineStiffnessMatrix(fineSolution->getStiffnessMatrix().get());
 
-    vector<GMGOperator::SmootherChoice> smootherChoices = {GMGOperator::NONE, GMGOperator::IFPACK_ADDITIVE_SCHWARZ, GMGOperator::CAMELLIA_ADDITIVE_SCHWARZ};
+    vector<GMGOperator::SmootherChoice> smootherChoices = {GMGOperator::NONE, GMGOperator::IFPACK_ADDITIVE_SCHWARZ, GMGOperator::CAMELLIA_ADDITIVE_SCHWARZ,
+                                                            GMGOperator::CHEBYSHEV};
 
     for (GMGOperator::SmootherChoice smoother : smootherChoices)
     {
@@ -997,6 +1000,156 @@ void testOperatorIsSPD(int spaceDim, GridType gridType, GMGOperator::SmootherApp
     testOperatorIsSPD(spaceDim, gridType, smootherApplicationType, out, success);
   }
 
+  TEUCHOS_UNIT_TEST( GMGSolver, ApplyInverseReusesWorkspace )
+  {
+    // repeated applications reuse the operator's workspace vectors; they, and a block application, should match
+    // applications to the individual vectors
+    int spaceDim = 2;
+    FunctionPtr x = Function::xn(1);
+    FunctionPtr y = Function::yn(1);
+    FunctionPtr phiExact = x * x + x * y;
+    SolutionPtr fineSolution;
+    Teuchos::RCP<GMGSolver> solver;
+    setupPoissonGMGSolver_ThreeGrid(solver, fineSolution, spaceDim, phiExact, 1);
+
+    fineSolution->initializeLHSVector();
+    fineSolution->initializeStiffnessAndLoad();
+    fineSolution->populateStiffnessAndLoad();
+    Teuchos::RCP<GMGOperator> gmgOperator = solver->gmgOperator();
+    gmgOperator->setSmootherType(GMGOperator::CAMELLIA_ADDITIVE_SCHWARZ);
+    gmgOperator->setFineStiffnessMatrix(fineSolution->getStiffnessMatrix().get());
+
+    const Epetra_Map* map = &fineSolution->getStiffnessMatrix()->OperatorDomainMap();
+    int numVectors = 3;
+    Epetra_MultiVector X(*map, numVectors), Y_block(*map, numVectors);
+    X.Random();
+    gmgOperator->ApplyInverse(X, Y_block);
+
+    double tol = 1e-12;
+    for (int repetition=0; repetition<2; repetition++)
+    {
+      for (int vectorOrdinal=0; vectorOrdinal<numVectors; vectorOrdinal++)
+      {
+        Epetra_MultiVector X_j(View, X, vectorOrdinal, 1);
+        Epetra_MultiVector Y_j(*map, 1);
+        gmgOperator->ApplyInverse(X_j, Y_j);
+        Y_j.Update(-1.0, Epetra_MultiVector(View, Y_block, vectorOrdinal, 1), 1.0);
+        double diffNorm, blockNorm;
+        Y_j.Norm2(&diffNorm);
+        Epetra_MultiVector(View, Y_block, vectorOrdinal, 1).Norm2(&blockNorm);
+        TEST_COMPARE(blockNorm, >, 0);
+        TEST_COMPARE(diffNorm, <, tol * blockNorm);
+      }
+    }
+  }
+
+  TEUCHOS_UNIT_TEST( GMGSolver, MatrixFreeStiffnessMatchesAssembled )
+  {
+    // the unassembled stiffness, with BCs imposed, should agree with the assembled matrix in its action, its diagonal,
+    // and its Galerkin product with the prolongation operator
+    int spaceDim = 2;
+    FunctionPtr x = Function::xn(1);
+    FunctionPtr y = Function::yn(1);
+    FunctionPtr phiExact = x * x + x * y;
+    SolutionPtr fineSolution;
+    Teuchos::RCP<GMGSolver> solver;
+    setupPoissonGMGSolver_ThreeGrid(solver, fineSolution, spaceDim, phiExact, 1);
+
+    fineSolution->initializeLHSVector();
+    fineSolution->initializeStiffnessAndLoad();
+    fineSolution->populateStiffnessAndLoad();
+    Teuchos::RCP<Epetra_CrsMatrix> A = fineSolution->getStiffnessMatrix();
+
+    fineSolution->setUseMatrixFreeStiffness(true);
+    fineSolution->initializeLHSVector();
+    fineSolution->initializeStiffnessAndLoad();
+    fineSolution->populateStiffnessAndLoad();
+    ElementMatrixOperatorPtr A_mf = fineSolution->getMatrixFreeStiffness();
+    TEST_ASSERT(fineSolution->getStiffnessMatrix() == Teuchos::null);
+    TEST_ASSERT(A_mf != Teuchos::null);
+
+    double tol = 1e-12;
+    const Epetra_Map* map = &A->OperatorDomainMap();
+    Epetra_MultiVector X(*map, 2), AX(*map, 2), AX_mf(*map, 2);
+    X.Random();
+    A->Apply(X, AX);
+    A_mf->Apply(X, AX_mf);
+    AX_mf.Update(-1.0, AX, 1.0);
+    double diffNorms[2], norms[2];
+    AX.NormInf(norms);
+    AX_mf.NormInf(diffNorms);
+    for (int j=0; j<2; j++)
+    {
+      TEST_COMPARE(diffNorms[j], <, tol * norms[j]);
+    }
+
+    Epetra_Vector diagonal(*map), diagonal_mf(*map);
+    A->ExtractDiagonalCopy(diagonal);
+    A_mf->ExtractDiagonalCopy(diagonal_mf);
+    diagonal_mf.Update(-1.0, diagonal, 1.0);
+    diagonal.NormInf(norms);
+    diagonal_mf.NormInf(diffNorms);
+    TEST_COMPARE(diffNorms[0], <, tol * norms[0]);
+
+    Teuchos::RCP<Epetra_CrsMatrix> P = solver->gmgOperator()->constructProlongationOperator();
+    Epetra_CrsMatrix AP(::Copy, A->RowMap(), 0);
+    EpetraExt::MatrixMatrix::Multiply(*A, false, *P, false, AP);
+    Epetra_CrsMatrix PT_A_P(::Copy, P->DomainMap(), 0);
+    EpetraExt::MatrixMatrix::Multiply(*P, true, AP, false, PT_A_P);
+    Teuchos::RCP<Epetra_CrsMatrix> PT_A_P_mf = A_mf->galerkinProduct(*P);
+
+    Epetra_MultiVector X_coarse(P->DomainMap(), 1), Y_coarse(P->DomainMap(), 1), Y_coarse_mf(P->DomainMap(), 1);
+    X_coarse.Random();
+    PT_A_P.Apply(X_coarse, Y_coarse);
+    PT_A_P_mf->Apply(X_coarse, Y_coarse_mf);
+    Y_coarse_mf.Update(-1.0, Y_coarse, 1.0);
+    Y_coarse.NormInf(norms);
+    Y_coarse_mf.NormInf(diffNorms);
+    TEST_COMPARE(diffNorms[0], <, tol * norms[0]);
+  }
+
+  TEUCHOS_UNIT_TEST( GMGSolver, MatrixFreeSolveMatchesAssembled )
+  {
+    int spaceDim = 2;
+    FunctionPtr x = Function::xn(1);
+    FunctionPtr y = Function::yn(1);
+    FunctionPtr phiExact = x * x + x * y;
+    SolutionPtr fineSolution;
+    Teuchos::RCP<GMGSolver> solver;
+    setupPoissonGMGSolver_ThreeGrid(solver, fineSolution, spaceDim, phiExact, 1);
+    solver->setTolerance(1e-10);
+    solver->gmgOperator()->setSmootherType(GMGOperator::CHEBYSHEV);
+
+    fineSolution->solve(solver);
+    Epetra_MultiVector lhs = *fineSolution->getLHSVector();
+
+    fineSolution->setUseMatrixFreeStiffness(true);
+    fineSolution->solve(solver);
+    TEST_ASSERT(fineSolution->getMatrixFreeStiffness() != Teuchos::null);
+    Epetra_MultiVector lhs_mf = *fineSolution->getLHSVector();
+
+    lhs_mf.Update(-1.0, lhs, 1.0);
+    double diffNorm, norm;
+    lhs.NormInf(&norm);
+    lhs_mf.NormInf(&diffNorm);
+    TEST_COMPARE(norm, >, 0);
+    TEST_COMPARE(diffNorm, <, 1e-6 * norm);
+  }
+
+  TEUCHOS_UNIT_TEST( GMGSolver, MatrixFreeStiffnessRejectedByDirectSolver )
+  {
+    // solvers that factor the assembled matrix cannot use a matrix-free stiffness; solve() should say so
+    int spaceDim = 2;
+    FunctionPtr x = Function::xn(1);
+    FunctionPtr phiExact = x * x;
+    SolutionPtr fineSolution;
+    Teuchos::RCP<GMGSolver> solver;
+    setupPoissonGMGSolver_ThreeGrid(solver, fineSolution, spaceDim, phiExact, 1);
+
+    fineSolution->setUseMatrixFreeStiffness(true);
+    TEST_THROW(fineSolution->solve(Solver::getDirectSolver()), std::invalid_argument);
+  }
+
 //  TEUCHOS_UNIT_TEST( GMGSolver, DebuggingOperatorApplyInverse )
 //  {
 //    int rank = Teuchos::GlobalMPISession::getRank();
@@ -0,0 +1,170 @@
+//
+//  HDF5ExporterTests
+//  Camellia
+//
+
+#include "Teuchos_UnitTestHarness.hpp"
+
+#include "EpetraExt_ConfigDefs.h"
+#ifdef HAVE_EPETRAEXT_HDF5
+
+#include "AsyncHDF5Exporter.h"
+#include "Function.h"
+#include "HDF5Exporter.h"
+#include "MeshFactory.h"
+#include "PoissonFormulation.h"
+
+#include "hdf5.h"
+
+using namespace Camellia;
+using namespace Intrepid;
+
+namespace
+{
+  // reads a whole one-dimensional dataset, converting to double
+  vector<double> readDataset(const string &fileName, const string &datasetPath)
+  {
+    hid_t fileID = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    TEUCHOS_TEST_FOR_EXCEPTION(fileID < 0, std::runtime_error, "Failed to open HDF5 file " + fileName);
+    hid_t dataset = H5Dopen2(fileID, datasetPath.c_str(), H5P_DEFAULT);
+    TEUCHOS_TEST_FOR_EXCEPTION(dataset < 0, std::runtime_error, "Failed to open HDF5 dataset " + datasetPath);
+    hid_t dataspace = H5Dget_space(dataset);
+    hssize_t size = H5Sget_simple_extent_npoints(dataspace);
+    vector<double> values(size);
+    if (size > 0)
+      H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &values[0]);
+    H5Sclose(dataspace);
+    H5Dclose(dataset);
+    H5Fclose(fileID);
+    return values;
+  }
+
+  const int NUM_1D_PTS = 3; // points per direction in each exported quad
+
+  // reads back this rank's export of f = x + 2y on a 2D quad mesh, and checks the values against the points
+  void checkExportedFile(string dirName, double timeVal, int numLocalCells, double tol, Teuchos::FancyOStream &out, bool &success)
+  {
+    int spaceDim = 2;
+    int rank = Teuchos::GlobalMPISession::getRank();
+    ostringstream fileName;
+    fileName << "./" << dirName << "/HDF5/field-part" << rank << "-time" << timeVal << ".h5";
+    vector<double> points = readDataset(fileName.str(), "/Data/Points");
+    vector<double> values = readDataset(fileName.str(), "/Data/f");
+
+    TEST_EQUALITY(values.size(), numLocalCells * NUM_1D_PTS * NUM_1D_PTS);
+    TEST_EQUALITY(points.size(), spaceDim * values.size());
+
+    for (int pointOrdinal=0; pointOrdinal<values.size(); pointOrdinal++)
+    {
+      double xValue = points[spaceDim * pointOrdinal], yValue = points[spaceDim * pointOrdinal + 1];
+      TEST_FLOATING_EQUALITY(values[pointOrdinal] + 1.0, xValue + 2.0 * yValue + 1.0, tol);
+    }
+  }
+
+  MeshPtr quadMesh3x3()
+  {
+    int spaceDim = 2;
+    int H1Order = 2;
+    PoissonFormulation form(spaceDim, true);
+    return MeshFactory::quadMesh(form.bf(), H1Order, 1, 1.0, 1.0, 3, 3);
+  }
+
+  FunctionPtr xPlus2y()
+  {
+    FunctionPtr x = Function::xn(1), y = Function::yn(1);
+    return x + 2.0 * y;
+  }
+
+  // exports x + 2y on a 3x3 quad mesh, then reads back the points and values and checks that they agree
+  void testExportRoundTrip(int cellBatchSize, bool useSinglePrecision, int compressionLevel, double timeVal,
+                           Teuchos::FancyOStream &out, bool &success)
+  {
+    MeshPtr mesh = quadMesh3x3();
+
+    string dirName = "HDF5ExporterRoundTrip";
+    HDF5Exporter exporter(mesh, dirName);
+    exporter.setCellBatchSize(cellBatchSize);
+    exporter.setUseSinglePrecision(useSinglePrecision);
+    exporter.setCompressionLevel(compressionLevel);
+    exporter.exportFunction(xPlus2y(), "f", timeVal, NUM_1D_PTS);
+
+    double tol = useSinglePrecision ? 1e-6 : 1e-14;
+    checkExportedFile(dirName, timeVal, mesh->cellIDsInPartition().size(), tol, out, success);
+  }
+
+  TEUCHOS_UNIT_TEST( HDF5Exporter, ExportRoundTrip )
+  {
+    int cellBatchSize = 4; // does not divide the cell count, so that batches of several sizes are exercised
+    bool useSinglePrecision = false;
+    int compressionLevel = 0;
+    testExportRoundTrip(cellBatchSize, useSinglePrecision, compressionLevel, 0, out, success);
+  }
+
+  TEUCHOS_UNIT_TEST( HDF5Exporter, ExportRoundTripSinglePrecisionCompressed )
+  {
+    int cellBatchSize = 64;
+    bool useSinglePrecision = true;
+    int compressionLevel = 6;
+    testExportRoundTrip(cellBatchSize, useSinglePrecision, compressionLevel, 1, out, success);
+  }
+
+  TEUCHOS_UNIT_TEST( HDF5Exporter, BatchedPointsMatchPerCellExport )
+  {
+    // with all cells in one batch, each cell's slice of the batch's points and values should be what an export that
+    // evaluates the cells one at a time writes
+    MeshPtr mesh = quadMesh3x3();
+    int numLocalCells = mesh->cellIDsInPartition().size();
+    double timeVal = 0;
+
+    vector<string> dirNames = {"HDF5ExporterPerCell", "HDF5ExporterOneBatch"};
+    vector<int> cellBatchSizes = {1, numLocalCells};
+    for (int i=0; i<dirNames.size(); i++)
+    {
+      HDF5Exporter exporter(mesh, dirNames[i]);
+      exporter.setCellBatchSize(cellBatchSizes[i]);
+      exporter.exportFunction(xPlus2y(), "f", timeVal, NUM_1D_PTS);
+    }
+
+    int rank = Teuchos::GlobalMPISession::getRank();
+    vector< vector<double> > points(dirNames.size()), values(dirNames.size());
+    for (int i=0; i<dirNames.size(); i++)
+    {
+      ostringstream fileName;
+      fileName << "./" << dirNames[i] << "/HDF5/field-part" << rank << "-time" << timeVal << ".h5";
+      points[i] = readDataset(fileName.str(), "/Data/Points");
+      values[i] = readDataset(fileName.str(), "/Data/f");
+    }
+
+    double tol = 1e-14;
+    TEST_EQUALITY(values[1].size(), numLocalCells * NUM_1D_PTS * NUM_1D_PTS);
+    TEST_COMPARE_FLOATING_ARRAYS(points[1], points[0], tol);
+    TEST_COMPARE_FLOATING_ARRAYS(values[1], values[0], tol);
+    checkExportedFile(dirNames[1], timeVal, numLocalCells, tol, out, success);
+  }
+
+  TEUCHOS_UNIT_TEST( AsyncHDF5Exporter, ExportThenRefine )
+  {
+    // the first export is still pending (or being written) when the mesh is refined; its file should describe the
+    // unrefined mesh, and the second export's file the refined one
+    MeshPtr mesh = quadMesh3x3();
+    string dirName = "AsyncHDF5ExporterExportThenRefine";
+    AsyncHDF5Exporter exporter(mesh, dirName);
+
+    vector<FunctionPtr> functions = {xPlus2y()};
+    vector<string> functionNames = {"f"};
+    int numCellsBefore = mesh->cellIDsInPartition().size();
+    TEST_ASSERT(exporter.exportFunction(functions, functionNames, 0, NUM_1D_PTS));
+
+    mesh->hRefine(set<GlobalIndexType>({0}));
+    int numCellsAfter = mesh->cellIDsInPartition().size();
+    TEST_ASSERT(exporter.exportFunction(functions, functionNames, 1, NUM_1D_PTS));
+    exporter.flush();
+    TEST_EQUALITY(exporter.numPendingExports(), 0);
+
+    double tol = 1e-14;
+    checkExportedFile(dirName, 0, numCellsBefore, tol, out, success);
+    checkExportedFile(dirName, 1, numCellsAfter, tol, out, success);
+  }
+} // namespace
+
+#endif
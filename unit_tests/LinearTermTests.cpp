@@ -8,14 +8,23 @@
 
 #include "Teuchos_UnitTestHarness.hpp"
 
+#include "BasisCache.h"
+#include "BasisCacheSetting.h"
 #include "Function.h"
+#include "IntegrationKernels.h"
+#include "IP.h"
 #include "MeshFactory.h"
+#include "ParameterFunction.h"
 #include "PoissonFormulation.h"
+#include "ReferenceIntegralCache.h"
+#include "RHS.h"
 #include "SerialDenseWrapper.h"
 #include "SpaceTimeHeatFormulation.h"
 #include "TensorBasis.h"
 #include "TypeDefs.h"
 
+#include "Intrepid_FunctionSpaceTools.hpp"
+
 using namespace Camellia;
 using namespace Intrepid;
 
@@ -320,6 +329,239 @@ void testFauxSpaceTimeIntegrationByPartsInTime(int spaceDim, Teuchos::FancyOStre
   TEST_COMPARE(norm, <, tol);
 }
 
+void computeStiffnessAndGram(MeshPtr mesh, BFPtr bf, IPPtr ip, FieldContainer<double> &stiffness, FieldContainer<double> &gram)
+{
+  ElementTypePtr elemType = mesh->getElementType(0);
+  vector<GlobalIndexType> cellIDs = mesh->cellIDsOfTypeGlobal(elemType);
+  BasisCachePtr basisCache = BasisCache::basisCacheForCellType(mesh, elemType);
+  basisCache->setPhysicalCellNodes(mesh->physicalCellNodesGlobal(elemType), cellIDs, true);
+  FieldContainer<double> cellSideParities = basisCache->getCellSideParities();
+
+  int numCells = cellIDs.size();
+  stiffness.resize(numCells, elemType->testOrderPtr->totalDofs(), elemType->trialOrderPtr->totalDofs());
+  bf->stiffnessMatrix(stiffness, elemType, cellSideParities, basisCache);
+
+  BasisCachePtr ipBasisCache = BasisCache::basisCacheForCellType(mesh, elemType, true); // true: test vs. test
+  ipBasisCache->setPhysicalCellNodes(mesh->physicalCellNodesGlobal(elemType), cellIDs, false);
+  gram.resize(numCells, elemType->testOrderPtr->totalDofs(), elemType->testOrderPtr->totalDofs());
+  ip->computeInnerProductMatrix(gram, elemType->testOrderPtr, ipBasisCache);
+}
+
+TEUCHOS_UNIT_TEST( LinearTerm, AffineIntegrationMatchesQuadrature )
+{
+  // triangles are affine, so the volume terms with constant coefficients take the reference-integral path
+  int spaceDim = 2;
+  bool useConformingTraces = true;
+  PoissonFormulation form(spaceDim, useConformingTraces);
+  BFPtr bf = form.bf();
+  IPPtr ip = bf->graphNorm();
+
+  int H1Order = 3, delta_k = 2;
+  double width = 2.0, height = 1.0;
+  int horizontalElements = 4, verticalElements = 3;
+  bool divideIntoTriangles = true;
+  MeshPtr mesh = MeshFactory::quadMesh(bf, H1Order, delta_k, width, height, horizontalElements, verticalElements,
+                                       divideIntoTriangles);
+
+  // the batch BasisCache, as computeStiffnessAndGram() sets it up
+  ElementTypePtr elemType = mesh->getElementType(0);
+  BasisCachePtr basisCache = BasisCache::basisCacheForCellType(mesh, elemType);
+  basisCache->setPhysicalCellNodes(mesh->physicalCellNodesGlobal(elemType), mesh->cellIDsOfTypeGlobal(elemType), true);
+  TEST_ASSERT(basisCache->cellsAreAffine());
+
+  // only the affine path stores reference integrals, so the caches tell us which path ran
+  bf->referenceIntegralCache()->clear();
+  ip->referenceIntegralCache()->clear();
+
+  FieldContainer<double> affineStiffness, affineGram;
+  {
+    BasisCacheSetting affineIntegration(BasisCache::useAffineIntegration, BasisCache::setUseAffineIntegration, true);
+    computeStiffnessAndGram(mesh, bf, ip, affineStiffness, affineGram);
+  }
+  TEST_COMPARE(bf->referenceIntegralCache()->numEntries(), >, 0);
+  TEST_COMPARE(ip->referenceIntegralCache()->numEntries(), >, 0);
+
+  bf->referenceIntegralCache()->clear();
+  ip->referenceIntegralCache()->clear();
+
+  FieldContainer<double> quadratureStiffness, quadratureGram;
+  {
+    BasisCacheSetting affineIntegration(BasisCache::useAffineIntegration, BasisCache::setUseAffineIntegration, false);
+    computeStiffnessAndGram(mesh, bf, ip, quadratureStiffness, quadratureGram);
+  }
+  TEST_EQUALITY(bf->referenceIntegralCache()->numEntries(), 0);
+  TEST_EQUALITY(ip->referenceIntegralCache()->numEntries(), 0);
+
+  double tol = 1e-12;
+  SerialDenseWrapper::roundZeros(affineStiffness, tol);
+  SerialDenseWrapper::roundZeros(quadratureStiffness, tol);
+  SerialDenseWrapper::roundZeros(affineGram, tol);
+  SerialDenseWrapper::roundZeros(quadratureGram, tol);
+  TEST_COMPARE_FLOATING_ARRAYS(affineStiffness, quadratureStiffness, tol);
+  TEST_COMPARE_FLOATING_ARRAYS(affineGram, quadratureGram, tol);
+}
+
+TEUCHOS_UNIT_TEST( LinearTerm, ReferenceIntegralCacheReusesIntegrals )
+{
+  int spaceDim = 2;
+  bool useConformingTraces = true;
+  PoissonFormulation form(spaceDim, useConformingTraces);
+  BFPtr bf = form.bf();
+  IPPtr ip = bf->graphNorm();
+
+  int H1Order = 2, delta_k = 2;
+  double width = 1.0, height = 1.0;
+  int horizontalElements = 3, verticalElements = 3;
+  bool divideIntoTriangles = true;
+  MeshPtr mesh = MeshFactory::quadMesh(bf, H1Order, delta_k, width, height, horizontalElements, verticalElements,
+                                       divideIntoTriangles);
+
+  FieldContainer<double> firstStiffness, firstGram;
+  computeStiffnessAndGram(mesh, bf, ip, firstStiffness, firstGram);
+  int bfEntries = bf->referenceIntegralCache()->numEntries();
+  int ipEntries = ip->referenceIntegralCache()->numEntries();
+  TEST_COMPARE(bfEntries, >, 0);
+  TEST_COMPARE(ipEntries, >, 0);
+
+  // a second pass finds all the integrals it needs in the caches
+  long long bfHits = bf->referenceIntegralCache()->hitCount();
+  FieldContainer<double> secondStiffness, secondGram;
+  computeStiffnessAndGram(mesh, bf, ip, secondStiffness, secondGram);
+  TEST_EQUALITY(bf->referenceIntegralCache()->numEntries(), bfEntries);
+  TEST_EQUALITY(ip->referenceIntegralCache()->numEntries(), ipEntries);
+  TEST_COMPARE(bf->referenceIntegralCache()->hitCount(), >, bfHits);
+
+  ReferenceIntegralCachePtr bfCache = bf->referenceIntegralCache(), ipCache = ip->referenceIntegralCache();
+  bf->setReferenceIntegralCache(Teuchos::null);
+  ip->setReferenceIntegralCache(Teuchos::null);
+  FieldContainer<double> uncachedStiffness, uncachedGram;
+  computeStiffnessAndGram(mesh, bf, ip, uncachedStiffness, uncachedGram);
+  bf->setReferenceIntegralCache(bfCache);
+  ip->setReferenceIntegralCache(ipCache);
+
+  double tol = 1e-12;
+  TEST_COMPARE_FLOATING_ARRAYS(firstStiffness, secondStiffness, tol);
+  TEST_COMPARE_FLOATING_ARRAYS(firstGram, secondGram, tol);
+  TEST_COMPARE_FLOATING_ARRAYS(firstStiffness, uncachedStiffness, tol);
+  TEST_COMPARE_FLOATING_ARRAYS(firstGram, uncachedGram, tol);
+}
+
+TEUCHOS_UNIT_TEST( LinearTerm, MemoizedFunctionValuesMatchDirectEvaluation )
+{
+  // with the memo, a weight shared by several terms is evaluated once per batch; the local stiffness and load should be
+  // the same as without it, including after the weight changes between passes over the same BasisCaches
+  int spaceDim = 2;
+  bool useConformingTraces = true;
+  PoissonFormulation form(spaceDim, useConformingTraces);
+  BFPtr bf = form.bf();
+  FunctionPtr x = Function::xn(1), y = Function::yn(1);
+  Teuchos::RCP<ParameterFunction> betaParameter = ParameterFunction::parameterFunction(1.0 + x * y);
+  FunctionPtr beta = betaParameter;
+  bf->addTerm(beta * form.phi(), form.q());
+  bf->addTerm(beta * form.psi(), form.tau());
+  IPPtr ip = bf->graphNorm();
+  RHSPtr rhs = RHS::rhs();
+  rhs->addTerm(beta * form.q());
+
+  int H1Order = 2, delta_k = 2;
+  double width = 1.0, height = 1.0;
+  int horizontalElements = 2, verticalElements = 2;
+  MeshPtr mesh = MeshFactory::quadMesh(bf, H1Order, delta_k, width, height, horizontalElements, verticalElements);
+
+  ElementTypePtr elemType = mesh->getElementType(0);
+  vector<GlobalIndexType> cellIDs = mesh->cellIDsOfTypeGlobal(elemType);
+  BasisCachePtr basisCache = BasisCache::basisCacheForCellType(mesh, elemType);
+  basisCache->setPhysicalCellNodes(mesh->physicalCellNodesGlobal(elemType), cellIDs, true);
+  BasisCachePtr ipBasisCache = BasisCache::basisCacheForCellType(mesh, elemType, true); // true: test vs. test
+  ipBasisCache->setPhysicalCellNodes(mesh->physicalCellNodesGlobal(elemType), cellIDs, false);
+
+  int numCells = cellIDs.size();
+  int numTrialDofs = elemType->trialOrderPtr->totalDofs();
+  auto computeLocalStiffnessAndLoad = [&] (FieldContainer<double> &stiffness, FieldContainer<double> &load)
+  {
+    stiffness.resize(numCells, numTrialDofs, numTrialDofs);
+    load.resize(numCells, numTrialDofs);
+    bf->localStiffnessMatrixAndRHS(stiffness, load, ip, ipBasisCache, rhs, basisCache);
+  };
+
+  FieldContainer<double> memoStiffness, memoLoad;
+  {
+    BasisCacheSetting memoize(BasisCache::memoizeFunctionValues, BasisCache::setMemoizeFunctionValues, true);
+    computeLocalStiffnessAndLoad(memoStiffness, memoLoad);
+    betaParameter->setValue(2.0 + x * y);
+    computeLocalStiffnessAndLoad(memoStiffness, memoLoad);
+  }
+
+  FieldContainer<double> directStiffness, directLoad;
+  {
+    BasisCacheSetting memoize(BasisCache::memoizeFunctionValues, BasisCache::setMemoizeFunctionValues, false);
+    computeLocalStiffnessAndLoad(directStiffness, directLoad);
+  }
+
+  double tol = 1e-13;
+  SerialDenseWrapper::roundZeros(memoStiffness, tol);
+  SerialDenseWrapper::roundZeros(directStiffness, tol);
+  SerialDenseWrapper::roundZeros(memoLoad, tol);
+  SerialDenseWrapper::roundZeros(directLoad, tol);
+  TEST_COMPARE_FLOATING_ARRAYS(memoStiffness, directStiffness, tol);
+  TEST_COMPARE_FLOATING_ARRAYS(memoLoad, directLoad, tol);
+}
+
+TEUCHOS_UNIT_TEST( LinearTerm, IntegrationKernelsMatchFunctionSpaceTools )
+{
+  int numCells = 3, numFields1 = 4, numFields2 = 5, numPoints = 7, spaceDim = 2;
+  FieldContainer<double> values1(numCells,numFields1,numPoints,spaceDim), values2(numCells,numFields2,numPoints,spaceDim);
+  FieldContainer<double> weights(numCells,numPoints);
+  for (int i=0; i<values1.size(); i++) values1[i] = sin(i + 1.0);
+  for (int i=0; i<values2.size(); i++) values2[i] = cos(2.0 * i);
+  for (int i=0; i<weights.size(); i++) weights[i] = 1.0 + 0.1 * i;
+
+  FieldContainer<double> weightedValues1(numCells,numFields1,numPoints,spaceDim);
+  FunctionSpaceTools::multiplyMeasure<double>(weightedValues1, weights, values1);
+  FieldContainer<double> expectedMiniMatrix(numCells,numFields1,numFields2);
+  FunctionSpaceTools::integrate<double>(expectedMiniMatrix, weightedValues1, values2, COMP_CPP);
+
+  FieldContainer<double> miniMatrix(numCells,numFields1,numFields2);
+  IntegrationKernels::integrate(miniMatrix, values1, values2, weights);
+  double tol = 1e-13;
+  TEST_COMPARE_FLOATING_ARRAYS(miniMatrix, expectedMiniMatrix, tol);
+
+  // scatter into a larger matrix, with the fields in permuted positions
+  int numDofs = 9;
+  vector<int> rowDofIndices = {8,1,3,6}, colDofIndices = {0,7,2,5,4};
+  FieldContainer<double> values(numCells,numDofs,numDofs), expectedValues(numCells,numDofs,numDofs);
+  IntegrationKernels::sumInto(values, miniMatrix, rowDofIndices, colDofIndices);
+  IntegrationKernels::sumInto(values, miniMatrix, rowDofIndices, colDofIndices);
+  for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+  {
+    for (int i=0; i<numFields1; i++)
+    {
+      for (int j=0; j<numFields2; j++)
+      {
+        expectedValues(cellOrdinal,rowDofIndices[i],colDofIndices[j]) = 2.0 * expectedMiniMatrix(cellOrdinal,i,j);
+      }
+    }
+  }
+  TEST_COMPARE_FLOATING_ARRAYS(values, expectedValues, tol);
+
+  // linear integrals of scalar values
+  FieldContainer<double> fieldValues(numCells,numFields1,numPoints);
+  for (int i=0; i<fieldValues.size(); i++) fieldValues[i] = sin(3.0 * i);
+  FieldContainer<double> linearValues(numCells,numDofs), expectedLinearValues(numCells,numDofs);
+  IntegrationKernels::integrate(linearValues, fieldValues, weights, rowDofIndices);
+  for (int cellOrdinal=0; cellOrdinal<numCells; cellOrdinal++)
+  {
+    for (int i=0; i<numFields1; i++)
+    {
+      for (int ptOrdinal=0; ptOrdinal<numPoints; ptOrdinal++)
+      {
+        expectedLinearValues(cellOrdinal,rowDofIndices[i]) += weights(cellOrdinal,ptOrdinal) * fieldValues(cellOrdinal,i,ptOrdinal);
+      }
+    }
+  }
+  TEST_COMPARE_FLOATING_ARRAYS(linearValues, expectedLinearValues, tol);
+}
+
 TEUCHOS_UNIT_TEST( LinearTerm, CompareFauxWithTrueSpaceTime_1D )
 {
   /*
@@ -323,6 +323,147 @@ TEUCHOS_UNIT_TEST( MeshTopology, DeactivateCellOnRefinement)
   }
 }
 
+TEUCHOS_UNIT_TEST( MeshTopology, CellIDsAndReferencePointsForPoints )
+{
+  int spaceDim = 2;
+  int meshWidth = 4;
+  vector<double> dimensions(spaceDim,1.0);
+  vector<int> elementCounts(spaceDim,meshWidth);
+  MeshTopologyPtr meshTopo = MeshFactory::rectilinearMeshTopology(dimensions, elementCounts);
+
+  int numPoints = 50;
+  FieldContainer<double> physicalPoints(numPoints,spaceDim);
+  for (int pointOrdinal=0; pointOrdinal<numPoints; pointOrdinal++)
+  {
+    physicalPoints(pointOrdinal,0) = (pointOrdinal + 0.5) / numPoints;
+    physicalPoints(pointOrdinal,1) = 1.0 - (pointOrdinal * 7 % numPoints + 0.25) / numPoints;
+  }
+
+  // query once before refinement, so that the spatial index gets built and then must be updated incrementally
+  vector<IndexType> cellIDs = meshTopo->cellIDsForPoints(physicalPoints);
+  for (IndexType cellID : cellIDs)
+  {
+    TEST_INEQUALITY(cellID, (IndexType)-1);
+  }
+
+  RefinementPatternPtr refPattern = RefinementPattern::regularRefinementPatternQuad();
+  meshTopo->refineCell(5, refPattern, meshTopo->cellCount());
+  meshTopo->refineCell(meshTopo->cellCount() - 1, refPattern, meshTopo->cellCount());
+
+  FieldContainer<double> refPoints;
+  meshTopo->cellIDsAndReferencePointsForPoints(physicalPoints, cellIDs, refPoints);
+  TEST_EQUALITY(cellIDs.size(), numPoints);
+
+  double tol = 1e-12;
+  for (int pointOrdinal=0; pointOrdinal<numPoints; pointOrdinal++)
+  {
+    IndexType cellID = cellIDs[pointOrdinal];
+    TEST_ASSERT(meshTopo->getActiveCellIndices().find(cellID) != meshTopo->getActiveCellIndices().end());
+
+    // rectilinear cells: check that the reference point maps to the physical point
+    CellPtr cell = meshTopo->getCell(cellID);
+    FieldContainer<double> cellVertices(cell->vertices().size(), spaceDim);
+    meshTopo->verticesForCell(cellVertices, cellID);
+    for (int d=0; d<spaceDim; d++)
+    {
+      double xMin = cellVertices(0,d), xMax = cellVertices(0,d);
+      for (int vertexOrdinal=1; vertexOrdinal<cellVertices.dimension(0); vertexOrdinal++)
+      {
+        xMin = min(xMin, cellVertices(vertexOrdinal,d));
+        xMax = max(xMax, cellVertices(vertexOrdinal,d));
+      }
+      double x = xMin + (refPoints(pointOrdinal,d) + 1.0) / 2.0 * (xMax - xMin);
+      TEST_FLOATING_EQUALITY(x, physicalPoints(pointOrdinal,d), tol);
+    }
+  }
+
+  // a point outside the mesh should not be found
+  FieldContainer<double> outsidePoint(1,spaceDim);
+  outsidePoint(0,0) = 1.5;
+  outsidePoint(0,1) = 0.5;
+  cellIDs = meshTopo->cellIDsForPoints(outsidePoint);
+  TEST_EQUALITY(cellIDs[0], (IndexType)-1);
+}
+
+TEUCHOS_UNIT_TEST( MeshTopology, CellIDsForPointsOnCurvedCell )
+{
+  // two cells on [0,2] x [0,1]; we bow the right cell's right edge outward, and look for a point in the bulge
+  int spaceDim = 2;
+  int H1Order = 2;
+  PoissonFormulation form(spaceDim, false);
+  MeshPtr mesh = MeshFactory::quadMesh(form.bf(), H1Order, 1, 2.0, 1.0, 2, 1);
+  MeshTopologyViewPtr meshTopo = mesh->getTopology();
+
+  FieldContainer<double> bulgePoint(1,spaceDim);
+  bulgePoint(0,0) = 2.1;
+  bulgePoint(0,1) = 0.5;
+
+  // build the spatial index before the curve is set, so that it must be discarded
+  vector<GlobalIndexType> cellIDs = mesh->cellIDsForPoints(bulgePoint);
+  TEST_EQUALITY(cellIDs[0], (GlobalIndexType)-1);
+
+  IndexType v0, v1;
+  TEST_ASSERT(meshTopo->getVertexIndex({2.0,0.0}, v0));
+  TEST_ASSERT(meshTopo->getVertexIndex({2.0,1.0}, v1));
+  const static double PI  = 3.141592653589793238462;
+  double r = sqrt(0.5);
+  ParametricCurvePtr arc = ParametricCurve::circularArc(r, 1.5, 0.5, -PI / 4.0, PI / 4.0);
+  map< pair<GlobalIndexType, GlobalIndexType>, ParametricCurvePtr > edgeToCurveMap;
+  edgeToCurveMap[{v0,v1}] = arc;
+  mesh->setEdgeToCurveMap(edgeToCurveMap);
+
+  set< pair<IndexType, unsigned> > cellsForVertex = meshTopo->getCellsContainingEntity(0, v0);
+  TEST_EQUALITY(cellsForVertex.size(), 1);
+  GlobalIndexType curvedCellID = cellsForVertex.begin()->first;
+
+  cellIDs = mesh->cellIDsForPoints(bulgePoint);
+  TEST_EQUALITY(cellIDs[0], curvedCellID);
+
+  // refining the curved cell adds curves for its children's edges; the point should be found in one of the children
+  mesh->hRefine(set<GlobalIndexType>({curvedCellID}));
+  cellIDs = mesh->cellIDsForPoints(bulgePoint);
+  TEST_INEQUALITY(cellIDs[0], (GlobalIndexType)-1);
+  if (cellIDs[0] != -1)
+  {
+    TEST_EQUALITY(meshTopo->getCell(cellIDs[0])->getParent()->cellIndex(), curvedCellID);
+  }
+}
+
+TEUCHOS_UNIT_TEST( MeshTopology, EntityLookupRoundTrip_3D )
+{
+  // every entity's vertex set should map back to that entity, before and after refinement
+  int spaceDim = 3;
+  vector<double> dimensions(spaceDim,1.0);
+  vector<int> elementCounts(spaceDim,2);
+  MeshTopologyPtr meshTopo = MeshFactory::rectilinearMeshTopology(dimensions, elementCounts);
+
+  RefinementPatternPtr refPattern = RefinementPattern::regularRefinementPatternHexahedron();
+  for (int refinement=0; refinement<2; refinement++)
+  {
+    for (int d=0; d<spaceDim; d++)
+    {
+      IndexType entityCount = meshTopo->getEntityCount(d);
+      TEST_ASSERT(entityCount > 0);
+      for (IndexType entityIndex=0; entityIndex<entityCount; entityIndex++)
+      {
+        vector<IndexType> vertexIndices = meshTopo->getEntityVertexIndices(d, entityIndex);
+        set<IndexType> nodeSet(vertexIndices.begin(),vertexIndices.end());
+        TEST_EQUALITY(meshTopo->getEntityIndex(d, nodeSet), entityIndex);
+      }
+    }
+    // refine an active cell: first a root cell, then one of its children
+    IndexType cellToRefine = *meshTopo->getActiveCellIndices().rbegin();
+    meshTopo->refineCell(cellToRefine, refPattern, meshTopo->cellCount());
+  }
+
+  // a hexahedron's body diagonal is not an edge, so should not be found
+  vector<IndexType> cellVertices = meshTopo->getCell(1)->vertices();
+  set<IndexType> bogusEdge = {cellVertices[0], cellVertices[6]};
+  TEST_EQUALITY(meshTopo->getEntityIndex(1, bogusEdge), (IndexType)-1);
+  
+  TEST_ASSERT(meshTopo->approximateMemoryFootprint() > 0);
+}
+
 TEUCHOS_UNIT_TEST( MeshTopology, ConstrainingSideAncestryUniformMesh)
 {
   // one easy way to create a quad mesh topology is to use MeshFactory
@@ -14,15 +14,19 @@
 #include "CamelliaCellTools.h"
 #include "CamelliaDebugUtility.h"
 #include "Cell.h"
+#include "GDAMinimumRule.h"
 #include "GlobalDofAssignment.h"
+#include "GramMatrixCache.h"
 #include "HDF5Exporter.h"
 #include "MeshFactory.h"
 #include "MeshTools.h"
 #include "MeshUtilities.h"
+#include "MPIWrapper.h"
 #include "PoissonFormulation.h"
 #include "Projector.h"
 #include "RHS.h"
 #include "Solution.h"
+#include "Solver.h"
 #include "StokesVGPFormulation.h"
 #include "Var.h"
 
@@ -51,6 +55,78 @@ namespace
     return poissonUniformMesh(elementCounts, H1Order, useConformingTraces);
   }
   
+  // max over the locally-owned rows of the difference between A and B, entries matched by global column index
+  double maxEntryDifference(const Epetra_CrsMatrix &A, const Epetra_CrsMatrix &B)
+  {
+    double maxDiff = 0.0;
+    int maxEntries = max(A.MaxNumEntries(), B.MaxNumEntries());
+    vector<double> aValues(maxEntries), bValues(maxEntries);
+    vector<int> aIndices(maxEntries), bIndices(maxEntries);
+    for (int localRow=0; localRow<A.NumMyRows(); localRow++)
+    {
+      int globalRow = A.GRID(localRow);
+      int aNumEntries, bNumEntries;
+      A.ExtractGlobalRowCopy(globalRow, maxEntries, aNumEntries, &aValues[0], &aIndices[0]);
+      B.ExtractGlobalRowCopy(globalRow, maxEntries, bNumEntries, &bValues[0], &bIndices[0]);
+      map<int,double> difference;
+      for (int i=0; i<aNumEntries; i++) difference[aIndices[i]] += aValues[i];
+      for (int i=0; i<bNumEntries; i++) difference[bIndices[i]] -= bValues[i];
+      for (auto &entry : difference)
+      {
+        maxDiff = max(maxDiff, abs(entry.second));
+      }
+    }
+    return maxDiff;
+  }
+
+  // the 2D Poisson problem on a 4x4 mesh shared by the solve-path tests: forcing f, homogeneous Dirichlet conditions,
+  // and the graph norm
+  struct PoissonTestProblem
+  {
+    PoissonFormulation form;
+    MeshPtr mesh;
+    RHSPtr rhs;
+    BCPtr bc;
+    IPPtr ip;
+
+    PoissonTestProblem(FunctionPtr f = Function::constant(1.0)) : form(2, true)
+    {
+      int spaceDim = 2;
+      bool useConformingTraces = true;
+      int H1Order = 2;
+      int elementWidth = 4;
+      mesh = poissonUniformMesh(spaceDim, elementWidth, H1Order, useConformingTraces);
+
+      rhs = RHS::rhs();
+      rhs->addTerm(f * form.q());
+
+      bc = BC::bc();
+      bc->addDirichlet(form.phi_hat(), SpatialFilter::allSpace(), Function::zero());
+
+      ip = form.bf()->graphNorm();
+    }
+
+    SolutionPtr solution()
+    {
+      return Solution::solution(form.bf(), mesh, bc, rhs, ip);
+    }
+  };
+
+  // records the initial guess it is handed, then solves directly
+  class InitialGuessRecordingSolver : public TSolver<double>
+  {
+    SolverPtr _directSolver = Solver::getDirectSolver();
+  public:
+    Teuchos::RCP<Epetra_MultiVector> initialGuess;
+
+    int solve()
+    {
+      initialGuess = Teuchos::rcp( new Epetra_MultiVector(*_lhs) );
+      _directSolver->setProblem(_stiffnessMatrix, _lhs, _rhs);
+      return _directSolver->solve();
+    }
+  };
+
   MeshPtr poissonIrregularMesh(int spaceDim, int irregularity, int H1Order)
   {
     bool useConformingTraces = true;
@@ -1545,6 +1621,229 @@ namespace
     loadedMesh->pRefine(cellsToRefine);
   }
   
+  TEUCHOS_UNIT_TEST( Solution, SolveWithMultipleLocalStiffnessThreads )
+  {
+    // the threaded local stiffness computation should give the same result as the serial one
+    double tol = 1e-12;
+    PoissonTestProblem problem;
+    MeshPtr mesh = problem.mesh;
+    PoissonFormulation &form = problem.form;
+
+    SolutionPtr serialSolution = problem.solution();
+    serialSolution->solve();
+
+    // with the default batch size, the 16 cells fit in one batch, which would leave just one thread with work; with a
+    // 1-byte bound, each cell is its own batch, and the 16 batches are distributed among the threads
+    SolutionPtr threadedSolution = problem.solution();
+    threadedSolution->setNumThreadsForLocalStiffness(4);
+    threadedSolution->setMaxBatchSizeInBytes(1);
+    TEST_EQUALITY(threadedSolution->numThreadsForLocalStiffness(), 4);
+    threadedSolution->solve();
+
+    TEST_COMPARE(maxEntryDifference(*serialSolution->getStiffnessMatrix(), *threadedSolution->getStiffnessMatrix()), <, tol);
+
+    FunctionPtr phiSerial = Function::solution(form.phi(), serialSolution);
+    FunctionPtr phiThreaded = Function::solution(form.phi(), threadedSolution);
+
+    double l2norm = phiSerial->l2norm(mesh);
+    TEST_COMPARE(l2norm, >, 0);
+
+    double diff = (phiSerial - phiThreaded)->l2norm(mesh);
+    TEST_COMPARE(diff, <, tol);
+  }
+
+  TEUCHOS_UNIT_TEST( Solution, EnergyErrorWithMultipleThreads )
+  {
+    // residuals and error representations are computed in element-type batches; threading should not change them
+    double tol = 1e-12;
+    FunctionPtr x = Function::xn(1);
+    PoissonTestProblem problem(x * x);
+    MeshPtr mesh = problem.mesh;
+    mesh->pRefine(set<GlobalIndexType>{0}); // so that there is more than one element type
+
+    SolutionPtr serialSolution = problem.solution();
+    serialSolution->solve();
+    double serialEnergyError = serialSolution->energyErrorTotal();
+    TEST_COMPARE(serialEnergyError, >, 0);
+
+    // as in SolveWithMultipleLocalStiffnessThreads, a 1-byte bound puts each cell in its own batch, so that every thread
+    // has batches to work on
+    SolutionPtr threadedSolution = problem.solution();
+    threadedSolution->setNumThreadsForLocalStiffness(4);
+    threadedSolution->setMaxBatchSizeInBytes(1);
+    threadedSolution->solve();
+    TEST_FLOATING_EQUALITY(threadedSolution->energyErrorTotal(), serialEnergyError, tol);
+
+    const map<GlobalIndexType,double>* serialCellErrors = &serialSolution->globalEnergyError();
+    const map<GlobalIndexType,double>* threadedCellErrors = &threadedSolution->globalEnergyError();
+    TEST_EQUALITY(serialCellErrors->size(), mesh->numActiveElements());
+    for (auto &entry : *serialCellErrors)
+    {
+      TEST_FLOATING_EQUALITY(threadedCellErrors->find(entry.first)->second, entry.second, tol);
+    }
+  }
+
+  TEUCHOS_UNIT_TEST( Solution, EnergyErrorReusingGramFactorizations )
+  {
+    // with retained Gram factorizations, the energy error is computed by back-substitution, and should not change
+    double tol = 1e-10;
+    FunctionPtr x = Function::xn(1);
+    PoissonTestProblem problem(x * x);
+    MeshPtr mesh = problem.mesh;
+    PoissonFormulation &form = problem.form;
+
+    SolutionPtr solution = problem.solution();
+    solution->solve();
+    double expectedEnergyError = solution->energyErrorTotal();
+
+    form.bf()->setOptimalTestSolver(TBF<>::FACTORED_CHOLESKY); // the solver that uses retained factors
+
+    for (size_t memoryBudget : {std::numeric_limits<size_t>::max(), size_t(0)})
+    {
+      SolutionPtr retainingSolution = problem.solution();
+      retainingSolution->setRetainGramFactorizations(true, memoryBudget);
+      GramMatrixCachePtr gramMatrixCache = form.bf()->gramMatrixCache();
+      TEST_ASSERT(gramMatrixCache != Teuchos::null);
+      retainingSolution->solve();
+      long long hitsAfterSolve = gramMatrixCache->hitCount();
+      TEST_FLOATING_EQUALITY(retainingSolution->energyErrorTotal(), expectedEnergyError, tol);
+
+      int numLocalCells = mesh->cellIDsInPartition().size();
+      if (memoryBudget > 0)
+      {
+        TEST_EQUALITY(gramMatrixCache->hitCount() - hitsAfterSolve, numLocalCells);
+      }
+      else
+      {
+        TEST_EQUALITY(gramMatrixCache->memoryUsed(), 0);
+        TEST_EQUALITY(gramMatrixCache->hitCount(), hitsAfterSolve);
+      }
+
+      // a Solution that did not ask to retain factors computes its error representation without the BF's cache
+      SolutionPtr otherSolution = problem.solution();
+      otherSolution->solve();
+      long long hitsAfterOtherSolve = gramMatrixCache->hitCount();
+      TEST_FLOATING_EQUALITY(otherSolution->energyErrorTotal(), expectedEnergyError, tol);
+      TEST_EQUALITY(gramMatrixCache->hitCount(), hitsAfterOtherSolve);
+
+      retainingSolution->setRetainGramFactorizations(false);
+      TEST_ASSERT(form.bf()->gramMatrixCache() == Teuchos::null);
+    }
+  }
+
+  TEUCHOS_UNIT_TEST( Solution, SolveReusingStiffnessGraph )
+  {
+    // repeated solves on an unchanged mesh assemble into the stiffness graph from the first solve; results should not change
+    double tol = 1e-12;
+    PoissonTestProblem problem;
+    MeshPtr mesh = problem.mesh;
+    PoissonFormulation &form = problem.form;
+
+    SolutionPtr solution = problem.solution();
+    solution->solve();
+    const Epetra_CrsGraphData* firstGraphData = solution->getStiffnessMatrix()->Graph().DataPtr();
+    solution->solve();
+    TEST_ASSERT(solution->getStiffnessMatrix()->Graph().DataPtr() == firstGraphData);
+
+    SolutionPtr freshSolution = problem.solution();
+    freshSolution->setReuseStiffnessGraph(false);
+    freshSolution->solve();
+
+    FunctionPtr phiReused = Function::solution(form.phi(), solution);
+    FunctionPtr phiFresh = Function::solution(form.phi(), freshSolution);
+    TEST_COMPARE(phiFresh->l2norm(mesh), >, 0);
+    TEST_COMPARE((phiReused - phiFresh)->l2norm(mesh), <, tol);
+
+    // after refinement, the graph must be rebuilt
+    mesh->hRefine(set<GlobalIndexType>{0});
+    solution->solve();
+    TEST_ASSERT(solution->getStiffnessMatrix()->Graph().DataPtr() != firstGraphData);
+    freshSolution->solve();
+    TEST_COMPARE((phiReused - phiFresh)->l2norm(mesh), <, tol);
+  }
+
+  TEUCHOS_UNIT_TEST( Solution, SolveAfterRefinementStartsFromPreviousSolution )
+  {
+    // after a local refinement, the initial guess on cells whose dofs were only renumbered should be the previous solution
+    double tol = 1e-12;
+    PoissonTestProblem problem;
+    MeshPtr mesh = problem.mesh;
+
+    SolutionPtr solution = problem.solution();
+    solution->solve();
+
+    map<GlobalIndexType, FieldContainer<double>> previousCoefficients;
+    for (GlobalIndexType cellID : mesh->cellIDsInPartition())
+    {
+      previousCoefficients[cellID] = solution->allCoefficientsForCellID(cellID);
+    }
+
+    // refine a cell in the middle of the mesh, so that the dofs of cells on either side of it move
+    GlobalIndexType refinedCellID = mesh->numActiveElements() / 2;
+    mesh->hRefine(set<GlobalIndexType>{refinedCellID});
+
+    Teuchos::RCP<InitialGuessRecordingSolver> recordingSolver = Teuchos::rcp( new InitialGuessRecordingSolver );
+    solution->solve(recordingSolver);
+    TEST_ASSERT(recordingSolver->initialGuess != Teuchos::null);
+    if (recordingSolver->initialGuess == Teuchos::null) return;
+
+    GDAMinimumRule* minRule = dynamic_cast<GDAMinimumRule*>(mesh->globalDofAssignment().get());
+    TEST_ASSERT(minRule != NULL);
+    if (minRule == NULL) return;
+    const set<GlobalIndexType> &cellsWithNewDofs = minRule->dofRenumbering().cellsWithNewDofs;
+
+    const Epetra_BlockMap &lhsMap = recordingSolver->initialGuess->Map();
+    int carriedOverCellCount = 0;
+    for (auto &entry : previousCoefficients)
+    {
+      GlobalIndexType cellID = entry.first;
+      if ((cellID == refinedCellID) || (cellsWithNewDofs.find(cellID) != cellsWithNewDofs.end())) continue;
+
+      // the initial guess holds only this rank's dofs
+      bool allDofsLocal = true;
+      for (GlobalIndexType globalDofIndex : mesh->globalDofIndicesForCell(cellID))
+      {
+        if (lhsMap.LID((GlobalIndexTypeToCast)globalDofIndex) == -1) allDofsLocal = false;
+      }
+      if (!allDofsLocal) continue;
+
+      FieldContainer<double> initialGuessCoefficients;
+      mesh->interpretGlobalCoefficients(cellID, initialGuessCoefficients, *recordingSolver->initialGuess);
+      const FieldContainer<double> &previous = entry.second;
+      TEST_EQUALITY(initialGuessCoefficients.size(), previous.size());
+      if (initialGuessCoefficients.size() != previous.size()) continue;
+      for (int i=0; i<previous.size(); i++)
+      {
+        TEST_FLOATING_EQUALITY(initialGuessCoefficients[i] + 1.0, previous[i] + 1.0, tol);
+      }
+      carriedOverCellCount++;
+    }
+    int globalCarriedOverCellCount = MPIWrapper::sum(*mesh->Comm(), carriedOverCellCount);
+    TEST_COMPARE(globalCarriedOverCellCount, >, 0);
+  }
+
+  TEUCHOS_UNIT_TEST( Solution, SolveReusingSymbolicFactorization )
+  {
+    // with an unchanged stiffness graph, the second solve should skip the symbolic analysis and give the same result
+    double tol = 1e-12;
+    PoissonTestProblem problem;
+    MeshPtr mesh = problem.mesh;
+    PoissonFormulation &form = problem.form;
+
+    SolverPtr solver = Solver::getSolver(Solver::KLU, false);
+    solver->setReuseSymbolicFactorization(true);
+
+    SolutionPtr solution = problem.solution();
+    solution->solve(solver);
+    FunctionPtr phi = Function::solution(form.phi(), solution);
+    double firstNorm = phi->l2norm(mesh);
+    TEST_COMPARE(firstNorm, >, 0);
+
+    solution->solve(solver);
+    TEST_EQUALITY(solver->analysisTime(), 0.0);
+    TEST_FLOATING_EQUALITY(phi->l2norm(mesh), firstNorm, tol);
+  }
+
   TEUCHOS_UNIT_TEST( Solution, SaveAndLoadPoissonConforming )
   {
     int spaceDim = 2;
@@ -8,8 +8,11 @@
 
 #include "Teuchos_UnitTestHarness.hpp"
 
+#include "Intrepid_FunctionSpaceTools.hpp"
+
 #include "BasisFactory.h"
 #include "CellTopology.h"
+#include "SerialDenseWrapper.h"
 #include "SpaceTimeBasisCache.h"
 #include "PoissonFormulation.h"
 #include "TensorBasis.h"
@@ -520,6 +523,52 @@ TEUCHOS_UNIT_TEST( SpaceTimeBasisCache, GetValues )
   tensorBasis->getTensorValues(transformedSpaceTimeValuesExpected, componentValues, intrepidOperatorTypes);
 }
 
+TEUCHOS_UNIT_TEST( SpaceTimeBasisCache, SumFactorizedIntegrationQuad )
+{
+  // integrating from the component values should agree with integrating the tensor product values
+  CellTopoPtr spaceTopo = CellTopology::quad();
+  CellTopoPtr spaceTimeTopo = CellTopology::cellTopology(spaceTopo, 1);
+  int H1Order = 3;
+  MeshPtr mesh = getSpaceTimeMesh(spaceTopo, H1Order);
+
+  BasisPtr uBasis = BasisFactory::basisFactory()->getBasis(H1Order, spaceTimeTopo, Camellia::FUNCTION_SPACE_HGRAD,
+                    H1Order, Camellia::FUNCTION_SPACE_HGRAD);
+  BasisPtr vBasis = BasisFactory::basisFactory()->getBasis(H1Order, spaceTimeTopo, Camellia::FUNCTION_SPACE_HVOL,
+                    H1Order, Camellia::FUNCTION_SPACE_HGRAD);
+
+  GlobalIndexType cellID = 0;
+  BasisCachePtr basisCache = BasisCache::basisCacheForCell(mesh, cellID);
+  SpaceTimeBasisCache* spaceTimeBasisCache = dynamic_cast<SpaceTimeBasisCache*>(basisCache.get());
+  TEST_ASSERT(spaceTimeBasisCache != NULL);
+
+  const FC* weights = &basisCache->getWeightedMeasures();
+
+  vector<pair<Camellia::EOperator,Camellia::EOperator>> opPairs = {{OP_VALUE,OP_VALUE},{OP_GRAD,OP_GRAD},{OP_DT,OP_VALUE}};
+  for (pair<Camellia::EOperator,Camellia::EOperator> opPair : opPairs)
+  {
+    Camellia::EOperator uOp = opPair.first, vOp = opPair.second;
+    BasisPtr vOpBasis = (vOp == OP_GRAD) ? uBasis : vBasis; // gradients must have matching shapes
+
+    Teuchos::RCP< const FC > uSpatialValues, uTemporalValues, vSpatialValues, vTemporalValues;
+    TEST_ASSERT(spaceTimeBasisCache->getTransformedComponentValues(uBasis, uOp, uSpatialValues, uTemporalValues));
+    TEST_ASSERT(spaceTimeBasisCache->getTransformedComponentValues(vOpBasis, vOp, vSpatialValues, vTemporalValues));
+
+    FC actualIntegrals(1, uBasis->getCardinality(), vOpBasis->getCardinality());
+    TensorBasis<>::integrateSumFactorized(actualIntegrals, *uSpatialValues, *uTemporalValues,
+                                          *vSpatialValues, *vTemporalValues, *weights);
+
+    FC uValuesWeighted = *basisCache->getTransformedWeightedValues(uBasis, uOp);
+    FC vValues = *basisCache->getTransformedValues(vOpBasis, vOp);
+    FC expectedIntegrals(1, uBasis->getCardinality(), vOpBasis->getCardinality());
+    Intrepid::FunctionSpaceTools::integrate<double>(expectedIntegrals, uValuesWeighted, vValues, Intrepid::COMP_BLAS);
+
+    double tol = 1e-13;
+    SerialDenseWrapper::roundZeros(expectedIntegrals, tol);
+    SerialDenseWrapper::roundZeros(actualIntegrals, tol);
+    TEST_COMPARE_FLOATING_ARRAYS(expectedIntegrals, actualIntegrals, tol);
+  }
+}
+
 TEUCHOS_UNIT_TEST( SpaceTimeBasisCache, TransformedBasisValuesLine )
 {
   CellTopoPtr spaceTopo = CellTopology::line();
@@ -0,0 +1,90 @@
+//
+//  TimerRegistryTests.cpp
+//  Camellia
+//
+//
+
+#include "Teuchos_UnitTestHarness.hpp"
+
+#include "MPIWrapper.h"
+#include "TimerRegistry.h"
+
+#include <sstream>
+
+using namespace Camellia;
+using namespace std;
+
+namespace
+{
+// these tests use ScopedTimer directly, so that they do not depend on whether CAMELLIA_TIMED_REGION is compiled in
+void timedInnerRegion()
+{
+  ScopedTimer timer("inner");
+  TimerRegistry::count("innerCalls", 1);
+}
+
+TEUCHOS_UNIT_TEST( TimerRegistry, NestedRegions )
+{
+  TimerRegistry::clear();
+  {
+    ScopedTimer timer("outer");
+    timedInnerRegion();
+    timedInnerRegion();
+  }
+  timedInnerRegion();
+
+  map<string, TimerRegistry::RegionSummary> summaries = TimerRegistry::regionSummaries();
+  TEST_EQUALITY(summaries.size(), 3);
+  TEST_EQUALITY(summaries["outer"].calls, 1);
+  TEST_EQUALITY(summaries["outer/inner"].calls, 2);
+  TEST_EQUALITY(summaries["inner"].calls, 1);
+  TEST_ASSERT(summaries["outer"].totalTime >= summaries["outer/inner"].totalTime);
+  TEST_ASSERT(summaries["outer/inner"].minTime <= summaries["outer/inner"].maxTime);
+
+  TEST_EQUALITY(TimerRegistry::counters()["innerCalls"], 3);
+  TimerRegistry::clear();
+}
+
+TEUCHOS_UNIT_TEST( TimerRegistry, DisabledRecordsNothing )
+{
+  TimerRegistry::clear();
+  TimerRegistry::setEnabled(false);
+  timedInnerRegion();
+  TimerRegistry::setEnabled(true);
+
+  TEST_EQUALITY(TimerRegistry::regionSummaries().size(), 0);
+  TEST_EQUALITY(TimerRegistry::counters().size(), 0);
+}
+
+TEUCHOS_UNIT_TEST( TimerRegistry, WriteJSONIncludesRegionsFromAllRanks )
+{
+  // a region recorded on only one rank should still be reported by rank 0
+  TimerRegistry::clear();
+  int rank = MPIWrapper::rank();
+  int numProcs = MPIWrapper::CommWorld()->NumProc();
+  if (rank == numProcs - 1)
+  {
+    ScopedTimer timer("lastRankOnly");
+  }
+  ostringstream json;
+  TimerRegistry::writeJSON(json, *MPIWrapper::CommWorld());
+  if (rank == 0)
+  {
+    TEST_ASSERT(json.str().find("\"lastRankOnly\"") != string::npos);
+  }
+  TimerRegistry::clear();
+}
+
+TEUCHOS_UNIT_TEST( TimerRegistry, ChromeTrace )
+{
+  TimerRegistry::clear();
+  TimerRegistry::setRecordTrace(true);
+  timedInnerRegion();
+  TimerRegistry::setRecordTrace(false);
+
+  ostringstream trace;
+  TimerRegistry::writeChromeTrace(trace);
+  TEST_ASSERT(trace.str().find("\"name\": \"inner\", \"ph\": \"X\"") != string::npos);
+  TimerRegistry::clear();
+}
+} // namespace